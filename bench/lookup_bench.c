@@ -0,0 +1,116 @@
+/*
+ * lookup_bench - cirf_find_file() over the layouts of the same resource set
+ *
+ * Each shape written by mktree is generated three times: -I none walks
+ * cirf_folder_t/cirf_file_t directly, -I hot walks the hot lookup arrays
+ * and -I hash is the perfect-hash index, for reference. Every file of a
+ * set is looked up in one random order, shared by the layouts; the best of
+ * the runs is reported in nanoseconds per lookup.
+ */
+
+#include "deep_hash.h"
+#include "deep_hot.h"
+#include "deep_none.h"
+#include "wide_hash.h"
+#include "wide_hot.h"
+#include "wide_none.h"
+#include <cirf/runtime.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define RUNS 9
+
+typedef struct {
+        const char          *name;
+        const cirf_folder_t *root;
+} layout_t;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Paths of all files of root in a fixed random order */
+static const char **shuffled_paths(const cirf_folder_t *root, size_t *count) {
+    size_t       n = root->tree_file_count;
+    const char **paths = malloc(n * sizeof(*paths));
+    if(!paths) return NULL;
+
+    for(size_t i = 0; i < n; i++) {
+        paths[i] = root->tree_files[i].path;
+    }
+    uint64_t x = 0x9e3779b97f4a7c15u;
+    for(size_t i = n; i > 1; i--) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        size_t j = (size_t)(x % i);
+        const char *t = paths[i - 1];
+        paths[i - 1] = paths[j];
+        paths[j] = t;
+    }
+    *count = n;
+    return paths;
+}
+
+/* Best nanoseconds per lookup, or a negative value if a lookup failed */
+static double time_lookups(const cirf_folder_t *root, const char **paths, size_t count) {
+    double best = 0;
+    for(int run = 0; run < RUNS; run++) {
+        size_t found = 0;
+        double start = now_ns();
+        for(size_t i = 0; i < count; i++) {
+            found += cirf_find_file(root, paths[i]) != NULL;
+        }
+        double ns = (now_ns() - start) / (double)count;
+        if(found != count) return -1;
+        if(run == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+static int bench_shape(const char *title, const layout_t *layouts, size_t layout_count) {
+    size_t       count;
+    const char **paths = shuffled_paths(layouts[0].root, &count);
+    if(!paths) {
+        fprintf(stderr, "Error: out of memory\n");
+        return -1;
+    }
+
+    printf("%s, %zu files\n", title, count);
+    for(size_t i = 0; i < layout_count; i++) {
+        double ns = time_lookups(layouts[i].root, paths, count);
+        if(ns < 0) {
+            fprintf(stderr, "Error: -I %s missed a file\n", layouts[i].name);
+            free(paths);
+            return -1;
+        }
+        printf("  -I %-5s %7.1f ns\n", layouts[i].name, ns);
+    }
+    free(paths);
+    return 0;
+}
+
+int main(void) {
+    static const layout_t deep[] = {
+        {"none", &deep_none_root},
+        {"hot",  &deep_hot_root },
+        {"hash", &deep_hash_root},
+    };
+    static const layout_t wide[] = {
+        {"none", &wide_none_root},
+        {"hot",  &wide_hot_root },
+        {"hash", &wide_hash_root},
+    };
+
+    printf("Random-order cirf_find_file(), best of %d runs\n\n", RUNS);
+    if(bench_shape("deep: 800 folders x 50 files", deep, 3) != 0) return 1;
+    printf("\n");
+    if(bench_shape("wide: 20 folders x 2000 files, names sharing 8 bytes", wide, 3) != 0) {
+        return 1;
+    }
+    return 0;
+}
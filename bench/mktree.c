@@ -0,0 +1,120 @@
+/*
+ * mktree - Write the resource trees used by the lookup benchmark
+ *
+ * Usage: mktree <dir> deep|wide
+ *
+ * Creates <dir>/<shape>/ with one small file per resource and the config
+ * <dir>/<shape>.json describing it. Both shapes hold 40000 files:
+ *
+ *   deep  40 x 20 folders of 50 files   (d00/sub00/file_00.txt)
+ *   wide  20 folders of 2000 files      (folder_00/resource_0000.dat),
+ *         whose names share their first 8 bytes
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static int make_dir(const char *path) {
+    if(mkdir(path, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "mktree: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int make_file(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if(!fp) {
+        fprintf(stderr, "mktree: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fprintf(fp, "%s\n", path);
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/* One folder entry of files named by file_fmt, with sources under src */
+static int write_folder(FILE *cfg, const char *dir, const char *src, const char *name,
+                        const char *file_fmt, unsigned files, int last) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, src);
+    if(make_dir(path) != 0) return -1;
+
+    fprintf(cfg, "{\"type\": \"folder\", \"path\": \"%s\", \"entries\": [\n", name);
+    for(unsigned i = 0; i < files; i++) {
+        char file[64];
+        snprintf(file, sizeof(file), file_fmt, i);
+        snprintf(path, sizeof(path), "%s/%s/%s", dir, src, file);
+        if(make_file(path) != 0) return -1;
+        fprintf(cfg, "  {\"type\": \"file\", \"path\": \"%s\", \"source\": \"./%s/%s\"}%s\n", file,
+                src, file, i + 1 < files ? "," : "");
+    }
+    fprintf(cfg, "]}%s\n", last ? "" : ",");
+    return 0;
+}
+
+static int write_deep(FILE *cfg, const char *dir) {
+    for(unsigned d = 0; d < 40; d++) {
+        char name[16];
+        char src[32];
+        snprintf(name, sizeof(name), "d%02u", d);
+        snprintf(src, sizeof(src), "deep/%s", name);
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir, src);
+        if(make_dir(path) != 0) return -1;
+
+        fprintf(cfg, "{\"type\": \"folder\", \"path\": \"%s\", \"entries\": [\n", name);
+        for(unsigned s = 0; s < 20; s++) {
+            char sub[16];
+            char sub_src[48];
+            snprintf(sub, sizeof(sub), "sub%02u", s);
+            snprintf(sub_src, sizeof(sub_src), "%s/%s", src, sub);
+            if(write_folder(cfg, dir, sub_src, sub, "file_%02u.txt", 50, s == 19) != 0) {
+                return -1;
+            }
+        }
+        fprintf(cfg, "]}%s\n", d == 39 ? "" : ",");
+    }
+    return 0;
+}
+
+static int write_wide(FILE *cfg, const char *dir) {
+    for(unsigned d = 0; d < 20; d++) {
+        char name[16];
+        char src[32];
+        snprintf(name, sizeof(name), "folder_%02u", d);
+        snprintf(src, sizeof(src), "wide/%s", name);
+        if(write_folder(cfg, dir, src, name, "resource_%04u.dat", 2000, d == 19) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if(argc != 3 || (strcmp(argv[2], "deep") != 0 && strcmp(argv[2], "wide") != 0)) {
+        fprintf(stderr, "Usage: %s <dir> deep|wide\n", argv[0]);
+        return 1;
+    }
+    const char *dir = argv[1];
+    const char *shape = argv[2];
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, shape);
+    if(make_dir(dir) != 0 || make_dir(path) != 0) return 1;
+
+    snprintf(path, sizeof(path), "%s/%s.json", dir, shape);
+    FILE *cfg = fopen(path, "w");
+    if(!cfg) {
+        fprintf(stderr, "mktree: %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    fprintf(cfg, "{\"entries\": [\n");
+    int rc = shape[0] == 'd' ? write_deep(cfg, dir) : write_wide(cfg, dir);
+    fprintf(cfg, "]}\n");
+    if(fclose(cfg) != 0) rc = -1;
+    return rc == 0 ? 0 : 1;
+}
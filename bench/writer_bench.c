@@ -0,0 +1,147 @@
+/*
+ * writer_bench - Throughput of the hex data writer
+ *
+ * Usage: writer_bench [output-dir]
+ *
+ * Writes 64 MiB of random bytes as a C array, 12 bytes per line as codegen
+ * does, once through writer_write_bytes_hex() and once through the
+ * fprintf() loop it replaced. Both outputs must be identical; the best of
+ * the runs is reported in MB/s of generated output.
+ */
+
+#include "cirf/writer.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DATA_SIZE      (64u << 20)
+#define BYTES_PER_LINE 12
+#define RUNS           5
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* The writer before buffering: one fprintf() per byte, indent of one level */
+static void fprintf_write_bytes_hex(FILE *fp, const unsigned char *data, size_t len,
+                                    int bytes_per_line) {
+    for(size_t i = 0; i < len; i++) {
+        if(i > 0) {
+            fputc(',', fp);
+            if((i % bytes_per_line) == 0) {
+                fputc('\n', fp);
+                fputs("    ", fp);
+            } else {
+                fputc(' ', fp);
+            }
+        } else {
+            fputs("    ", fp);
+        }
+        fprintf(fp, "0x%02x", data[i]);
+    }
+}
+
+static int write_fprintf(FILE *fp, const unsigned char *data, size_t len) {
+    fputs("static const unsigned char data[] = {\n", fp);
+    fprintf_write_bytes_hex(fp, data, len, BYTES_PER_LINE);
+    fputs("\n};\n", fp);
+    return 0;
+}
+
+static int write_buffered(FILE *fp, const unsigned char *data, size_t len) {
+    writer_t *w = writer_create(fp);
+    if(!w) return -1;
+    writer_puts(w, "static const unsigned char data[] = {\n");
+    writer_indent(w);
+    writer_write_bytes_hex(w, data, len, BYTES_PER_LINE);
+    writer_newline(w);
+    writer_dedent(w);
+    writer_puts(w, "};\n");
+    int rc = writer_flush(w);
+    writer_destroy(w);
+    return rc;
+}
+
+/* Best MB/s of output over RUNS runs of fn into path, or a negative value */
+static double time_writer(int (*fn)(FILE *, const unsigned char *, size_t), const char *path,
+                          const unsigned char *data, size_t len) {
+    double best = -1;
+    for(int run = 0; run < RUNS; run++) {
+        FILE *fp = fopen(path, "wb");
+        if(!fp) return -1;
+        double start = now_s();
+        int    rc = fn(fp, data, len);
+        if(fclose(fp) != 0 || rc != 0) return -1;
+        double seconds = now_s() - start;
+
+        /* The buffered writer bypasses the FILE, so measure the file */
+        fp = fopen(path, "rb");
+        if(!fp) return -1;
+        fseek(fp, 0, SEEK_END);
+        long size = ftell(fp);
+        fclose(fp);
+        double mbps = (double)size / 1e6 / seconds;
+        if(mbps > best) best = mbps;
+    }
+    return best;
+}
+
+static int same_contents(const char *a, const char *b) {
+    FILE *fa = fopen(a, "rb");
+    FILE *fb = fopen(b, "rb");
+    int   same = fa && fb;
+    while(same) {
+        int ca = getc(fa);
+        int cb = getc(fb);
+        if(ca != cb) same = 0;
+        if(ca == EOF) break;
+    }
+    if(fa) fclose(fa);
+    if(fb) fclose(fb);
+    return same;
+}
+
+int main(int argc, char **argv) {
+    const char *dir = argc > 1 ? argv[1] : ".";
+    char        old_path[1024];
+    char        new_path[1024];
+    snprintf(old_path, sizeof(old_path), "%s/writer_bench_old.c", dir);
+    snprintf(new_path, sizeof(new_path), "%s/writer_bench_new.c", dir);
+
+    unsigned char *data = malloc(DATA_SIZE);
+    if(!data) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    uint64_t x = 0x9e3779b97f4a7c15u;
+    for(size_t i = 0; i < DATA_SIZE; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        data[i] = (unsigned char)(x >> 32);
+    }
+
+    double old_mbps = time_writer(write_fprintf, old_path, data, DATA_SIZE);
+    double new_mbps = time_writer(write_buffered, new_path, data, DATA_SIZE);
+    free(data);
+
+    int rc = 0;
+    if(old_mbps < 0 || new_mbps < 0) {
+        fprintf(stderr, "Error: writing to %s failed\n", dir);
+        rc = 1;
+    } else if(!same_contents(old_path, new_path)) {
+        fprintf(stderr, "Error: %s and %s differ\n", old_path, new_path);
+        rc = 1;
+    } else {
+        printf("Hex data, %u MiB in, %d bytes per line, best of %d runs\n\n", DATA_SIZE >> 20,
+               BYTES_PER_LINE, RUNS);
+        printf("  fprintf  %7.0f MB/s\n", old_mbps);
+        printf("  buffered %7.0f MB/s  (%.1fx)\n", new_mbps, new_mbps / old_mbps);
+    }
+    remove(old_path);
+    remove(new_path);
+    return rc;
+}
@@ -12,6 +12,7 @@
 # Functions:
 #   cirf_generate_resources()   - Generate resources, return source files in variable
 #   cirf_add_runtime_library()  - Add the CIRF runtime library for helper functions
+#   cirf_add_preload_library()  - Build an LD_PRELOAD interposer serving mounted resources
 #
 # Usage:
 #   include(CIRF)
@@ -77,6 +78,15 @@ function(_cirf_ensure_host_tool)
         return()
     endif()
 
+    # Host tool already added by an earlier call in this project?
+    set(_host_build_dir "${CMAKE_BINARY_DIR}/cirf-host-build")
+    set(_host_cirf "${_host_build_dir}/cirf")
+    if(TARGET cirf_host_tool)
+        set(CIRF_EXECUTABLE "${_host_cirf}" PARENT_SCOPE)
+        set(CIRF_HOST_TOOL_TARGET "cirf_host_tool" PARENT_SCOPE)
+        return()
+    endif()
+
     # Need to build cirf for host - find source directory
     _cirf_find_source_dir(_cirf_src)
     if(NOT _cirf_src)
@@ -88,10 +98,6 @@ function(_cirf_ensure_host_tool)
 
     message(STATUS "CIRF: Building host tool from ${_cirf_src}")
 
-    # Build directory for host tool
-    set(_host_build_dir "${CMAKE_BINARY_DIR}/cirf-host-build")
-    set(_host_cirf "${_host_build_dir}/cirf")
-
     # Determine the compiler for the host tool
     set(_cirf_cc "${CMAKE_C_COMPILER}")
     if(CMAKE_CROSSCOMPILING)
@@ -124,8 +130,11 @@ endfunction()
 #
 # cirf_generate_resources(
 #     NAME <name>
-#     CONFIG <config_file>
+#     CONFIG <config_file> [<config_file> ...]
 #     OUTPUT_VAR <variable_name>
+#     [COMPACT]
+#     [ENCODING hex|string|words|incbin|embed]
+#     [OBJECT_TARGET <target>]
 #     [DEPENDS <file1> <file2> ...]
 # )
 #
@@ -134,14 +143,28 @@ endfunction()
 #
 # Arguments:
 #   NAME       - Base name for generated symbols (e.g., "web_resources")
-#   CONFIG     - Path to the JSON configuration file
+#   CONFIG     - Path to the JSON configuration file. Several files generate
+#                one resource set per file ("<NAME>_<file stem>") plus
+#                <NAME>_overlay, in which later files take precedence
 #   OUTPUT_VAR - Name of variable to set with generated source file paths
+#                (the .c file, plus <NAME>_data.S with ENCODING incbin)
+#   COMPACT    - Generate the compact layout (cirf --compact, one CONFIG only);
+#                code using the cirf_node_* accessors needs CIRF_COMPACT
+#   ENCODING   - How file data is spelled (cirf --encoding). Defaults to the
+#                fastest for the C compiler: embed for GCC 15 and Clang 19 on,
+#                string for older GCC and Clang, words for MSVC, hex
+#                otherwise. incbin needs the ASM language enabled
+#   OBJECT_TARGET - Have cirf write an ELF object for this target (cirf
+#                --object --target, e.g. arm or riscv32) instead of C source;
+#                OUTPUT_VAR is then <NAME>.o. One CONFIG only; no COMPACT or
+#                ENCODING
 #   DEPENDS    - Additional files that trigger regeneration (optional)
 #
 # The generated files are placed in CMAKE_CURRENT_BINARY_DIR.
 #
 function(cirf_generate_resources)
-    cmake_parse_arguments(ARG "" "NAME;CONFIG;OUTPUT_VAR" "DEPENDS" ${ARGN})
+    cmake_parse_arguments(ARG "COMPACT" "NAME;OUTPUT_VAR;ENCODING;OBJECT_TARGET" "CONFIG;DEPENDS"
+                          ${ARGN})
 
     if(NOT ARG_NAME)
         message(FATAL_ERROR "cirf_generate_resources: NAME is required")
@@ -158,17 +181,69 @@ function(cirf_generate_resources)
         _cirf_ensure_host_tool()
     endif()
 
-    # Get absolute path to config
-    get_filename_component(_config_abs "${ARG_CONFIG}" ABSOLUTE)
-    get_filename_component(_config_dir "${_config_abs}" DIRECTORY)
+    # Get absolute paths to the configs; the first one sets the working directory
+    set(_config_args "")
+    set(_config_files "")
+    foreach(_config IN LISTS ARG_CONFIG)
+        get_filename_component(_config_abs "${_config}" ABSOLUTE)
+        list(APPEND _config_args -c "${_config_abs}")
+        list(APPEND _config_files "${_config_abs}")
+    endforeach()
+    list(GET _config_files 0 _config_first)
+    get_filename_component(_config_dir "${_config_first}" DIRECTORY)
+
+    set(_layout_args "")
+    if(ARG_COMPACT)
+        set(_layout_args -C)
+    endif()
+
+    if(ARG_OBJECT_TARGET AND (ARG_COMPACT OR ARG_ENCODING))
+        message(FATAL_ERROR "cirf_generate_resources: OBJECT_TARGET cannot be combined with "
+            "COMPACT or ENCODING")
+    endif()
+
+    # String literals compile an order of magnitude faster than hex bytes
+    # where the compiler takes literals of any length; #embed does not parse
+    # the data at all
+    if(NOT ARG_ENCODING AND NOT ARG_OBJECT_TARGET)
+        if((CMAKE_C_COMPILER_ID STREQUAL "GNU" AND CMAKE_C_COMPILER_VERSION VERSION_GREATER_EQUAL 15)
+           OR (CMAKE_C_COMPILER_ID STREQUAL "Clang" AND CMAKE_C_COMPILER_VERSION VERSION_GREATER_EQUAL 19))
+            set(ARG_ENCODING embed)
+        elseif(CMAKE_C_COMPILER_ID MATCHES "GNU|Clang")
+            set(ARG_ENCODING string)
+        elseif(CMAKE_C_COMPILER_ID STREQUAL "MSVC")
+            set(ARG_ENCODING words)
+        else()
+            set(ARG_ENCODING hex)
+        endif()
+    endif()
+    if(ARG_ENCODING)
+        list(APPEND _layout_args -E ${ARG_ENCODING})
+    endif()
 
     # Output paths
     set(_out_c "${CMAKE_CURRENT_BINARY_DIR}/${ARG_NAME}.c")
     set(_out_h "${CMAKE_CURRENT_BINARY_DIR}/${ARG_NAME}.h")
     set(_out_d "${CMAKE_CURRENT_BINARY_DIR}/${ARG_NAME}.d")
+    set(_out_s "")
+    set(_out_args -o "${_out_c}")
+    if(ARG_OBJECT_TARGET)
+        # Written by cirf itself, so the C compiler never sees the data
+        set(_out_c "${CMAKE_CURRENT_BINARY_DIR}/${ARG_NAME}.o")
+        set(_out_args -O "${_out_c}" -T "${ARG_OBJECT_TARGET}")
+        set_source_files_properties("${_out_c}" PROPERTIES EXTERNAL_OBJECT TRUE GENERATED TRUE)
+    endif()
+    if(ARG_ENCODING STREQUAL "incbin")
+        if(NOT CMAKE_ASM_COMPILER_LOADED)
+            message(FATAL_ERROR "cirf_generate_resources: ENCODING incbin needs the ASM language "
+                "(add ASM to project() or call enable_language(ASM))")
+        endif()
+        set(_out_s "${CMAKE_CURRENT_BINARY_DIR}/${ARG_NAME}_data.S")
+        list(APPEND _layout_args -A "${_out_s}")
+    endif()
 
-    # Build dependency list - start with config file
-    set(_depends "${_config_abs}")
+    # Build dependency list - start with the config files
+    set(_depends ${_config_files})
 
     # Add manually specified dependencies
     if(ARG_DEPENDS)
@@ -183,11 +258,12 @@ function(cirf_generate_resources)
     # Custom command to generate resources
     # Uses DEPFILE so that source file dependencies are tracked at build time
     add_custom_command(
-        OUTPUT "${_out_c}" "${_out_h}"
+        OUTPUT "${_out_c}" "${_out_h}" ${_out_s}
         COMMAND "${CIRF_EXECUTABLE}"
             -n "${ARG_NAME}"
-            -c "${_config_abs}"
-            -o "${_out_c}"
+            ${_config_args}
+            ${_layout_args}
+            ${_out_args}
             -H "${_out_h}"
             -M "${_out_d}"
         DEPENDS ${_depends}
@@ -199,11 +275,11 @@ function(cirf_generate_resources)
 
     # Create a target for the generation
     add_custom_target(generate_${ARG_NAME}
-        DEPENDS "${_out_c}" "${_out_h}"
+        DEPENDS "${_out_c}" "${_out_h}" ${_out_s}
     )
 
     # Set output variable with generated source file
-    set(${ARG_OUTPUT_VAR} "${_out_c}" PARENT_SCOPE)
+    set(${ARG_OUTPUT_VAR} "${_out_c}" ${_out_s} PARENT_SCOPE)
 
     # Also set header path in case caller needs it
     set(${ARG_OUTPUT_VAR}_HEADER "${_out_h}" PARENT_SCOPE)
@@ -249,7 +325,57 @@ function(cirf_add_runtime_library)
     if(CIRF_RUNTIME_NO_MOUNT)
         target_compile_definitions(${_target_name} PUBLIC CIRF_NO_MOUNT)
     endif()
+    if(CIRF_RUNTIME_MAX_MOUNTS)
+        target_compile_definitions(${_target_name} PUBLIC CIRF_MAX_MOUNTS=${CIRF_RUNTIME_MAX_MOUNTS})
+    endif()
+    if(CIRF_RUNTIME_NO_THREADS)
+        target_compile_definitions(${_target_name} PUBLIC CIRF_NO_THREADS)
+    else()
+        find_package(Threads REQUIRED)
+        target_link_libraries(${_target_name} PUBLIC Threads::Threads)
+    endif()
     if(CIRF_RUNTIME_MAX_PATH)
         target_compile_definitions(${_target_name} PUBLIC CIRF_MAX_PATH=${CIRF_RUNTIME_MAX_PATH})
     endif()
 endfunction()
+
+# cirf_add_preload_library(<target> <sources>...)
+#
+# Builds a shared object that serves mounted resources to unmodified
+# programs through LD_PRELOAD (see include/cirf/preload.h). The sources are
+# the generated resource sources plus a file defining cirf_preload_init(),
+# which mounts them. The runtime is compiled into the library.
+#
+# Example:
+#   cirf_add_preload_library(my_preload preload_init.c ${MY_RESOURCE_SOURCES})
+#   target_include_directories(my_preload PRIVATE ${MY_RESOURCE_SOURCES_INCLUDE_DIR})
+#
+#   LD_PRELOAD=$<TARGET_FILE:my_preload> ./program
+function(cirf_add_preload_library target)
+    if(NOT CMAKE_SYSTEM_NAME STREQUAL "Linux")
+        message(FATAL_ERROR "CIRF: the preload library needs Linux")
+    endif()
+    if(CIRF_RUNTIME_NO_MOUNT)
+        message(FATAL_ERROR "CIRF: the preload library needs the mount table (CIRF_RUNTIME_NO_MOUNT is set)")
+    endif()
+
+    _cirf_find_source_dir(_cirf_src)
+    if(NOT _cirf_src)
+        message(FATAL_ERROR
+            "CIRF: Cannot find CIRF source directory for preload library.\n"
+            "Set CIRF_SOURCE_DIR to the CIRF repository root.")
+    endif()
+
+    add_library(${target} SHARED
+        "${_cirf_src}/src/preload.c"
+        "${_cirf_src}/src/runtime.c"
+        ${ARGN}
+    )
+    target_include_directories(${target} PRIVATE "${_cirf_src}/include")
+    if(CIRF_RUNTIME_MAX_MOUNTS)
+        target_compile_definitions(${target} PRIVATE CIRF_MAX_MOUNTS=${CIRF_RUNTIME_MAX_MOUNTS})
+    endif()
+
+    find_package(Threads REQUIRED)
+    target_link_libraries(${target} PRIVATE Threads::Threads ${CMAKE_DL_LIBS})
+endfunction()
@@ -5,9 +5,12 @@
 # any embedded file will trigger regeneration automatically.
 
 # cirf_add_resources(<name>
-#     CONFIG <config_file>
+#     CONFIG <config_file> [<config_file> ...]
 #     [OUTPUT_DIR <output_directory>]
 #     [LINK_RUNTIME]
+#     [COMPACT]
+#     [ENCODING hex|string|words|incbin|embed]
+#     [OBJECT_TARGET <target>]
 #     [CIRF_EXECUTABLE <path>]
 # )
 #
@@ -16,11 +19,23 @@
 # Arguments:
 #   <name>          - Name of the CMake target to create. Also used as the base
 #                     name for generated C symbols.
-#   CONFIG          - Path to the JSON configuration file
+#   CONFIG          - Path to the JSON configuration file. Several files
+#                     generate one resource set per file ("<name>_<file stem>")
+#                     plus <name>_overlay, in which later files take precedence
 #   OUTPUT_DIR      - Directory for generated files (default: CMAKE_CURRENT_BINARY_DIR)
 #   LINK_RUNTIME    - If specified, link against cirf_runtime library to get
 #                     helper functions like cirf_find_file(), cirf_fopen(), etc.
 #                     Without this, only direct symbol access is available.
+#   COMPACT         - Generate the compact layout (cirf --compact, one CONFIG
+#                     only) and define CIRF_COMPACT for users of the target
+#   ENCODING        - How file data is spelled (cirf --encoding). Defaults to
+#                     the fastest for the C compiler: embed for GCC 15 and
+#                     Clang 19 on, string for older GCC and Clang, words for
+#                     MSVC, hex otherwise. incbin adds <name>_data.S to the
+#                     library and needs the ASM language enabled
+#   OBJECT_TARGET   - Have cirf write the library's ELF object itself for this
+#                     target (cirf --object --target, e.g. x86_64 or arm) instead
+#                     of C source. One CONFIG only; no COMPACT or ENCODING
 #   CIRF_EXECUTABLE - Path to cirf executable (for cross-compilation)
 #
 # Cross-compilation:
@@ -56,7 +71,7 @@
 set(CIRF_HOST_EXECUTABLE "" CACHE FILEPATH "Path to host-built cirf executable (for cross-compilation)")
 
 function(cirf_add_resources name)
-    cmake_parse_arguments(ARG "LINK_RUNTIME" "CONFIG;OUTPUT_DIR;CIRF_EXECUTABLE" "" ${ARGN})
+    cmake_parse_arguments(ARG "LINK_RUNTIME;COMPACT" "OUTPUT_DIR;CIRF_EXECUTABLE;ENCODING;OBJECT_TARGET" "CONFIG" ${ARGN})
 
     if(NOT ARG_CONFIG)
         message(FATAL_ERROR "cirf_add_resources: CONFIG is required")
@@ -104,24 +119,73 @@ function(cirf_add_resources name)
         set(CIRF_DEPENDS "")
     endif()
 
-    # Get absolute path to config file
-    get_filename_component(CONFIG_ABS ${ARG_CONFIG} ABSOLUTE)
-    get_filename_component(CONFIG_DIR ${CONFIG_ABS} DIRECTORY)
+    # Get absolute paths to the config files
+    set(CONFIG_ARGS "")
+    set(CONFIG_DEPS "")
+    foreach(CONFIG IN LISTS ARG_CONFIG)
+        get_filename_component(CONFIG_ABS ${CONFIG} ABSOLUTE)
+        list(APPEND CONFIG_ARGS -c ${CONFIG_ABS})
+        list(APPEND CONFIG_DEPS ${CONFIG_ABS})
+    endforeach()
 
     # Output depfile path
     set(OUTPUT_D ${ARG_OUTPUT_DIR}/${name}.d)
 
-    # Start dependency list with config file
-    set(CONFIG_DEPS ${CONFIG_ABS})
+    set(LAYOUT_ARGS "")
+    if(ARG_COMPACT)
+        set(LAYOUT_ARGS -C)
+    endif()
+
+    # An object written by cirf skips the C compiler altogether
+    set(OUTPUT_ARGS -o ${OUTPUT_C})
+    if(ARG_OBJECT_TARGET)
+        if(ARG_COMPACT OR ARG_ENCODING)
+            message(FATAL_ERROR "cirf_add_resources: OBJECT_TARGET cannot be combined with "
+                "COMPACT or ENCODING")
+        endif()
+        set(OUTPUT_C ${ARG_OUTPUT_DIR}/${name}.o)
+        set(OUTPUT_ARGS -O ${OUTPUT_C} -T ${ARG_OBJECT_TARGET})
+    endif()
+
+    # String literals compile an order of magnitude faster than hex bytes
+    # where the compiler takes literals of any length; #embed does not parse
+    # the data at all
+    if(NOT ARG_ENCODING AND NOT ARG_OBJECT_TARGET)
+        if((CMAKE_C_COMPILER_ID STREQUAL "GNU" AND CMAKE_C_COMPILER_VERSION VERSION_GREATER_EQUAL 15)
+           OR (CMAKE_C_COMPILER_ID STREQUAL "Clang" AND CMAKE_C_COMPILER_VERSION VERSION_GREATER_EQUAL 19))
+            set(ARG_ENCODING embed)
+        elseif(CMAKE_C_COMPILER_ID MATCHES "GNU|Clang")
+            set(ARG_ENCODING string)
+        elseif(CMAKE_C_COMPILER_ID STREQUAL "MSVC")
+            set(ARG_ENCODING words)
+        else()
+            set(ARG_ENCODING hex)
+        endif()
+    endif()
+    if(ARG_ENCODING)
+        list(APPEND LAYOUT_ARGS -E ${ARG_ENCODING})
+    endif()
+
+    # File data assembled from the resources themselves
+    set(OUTPUT_S "")
+    if(ARG_ENCODING STREQUAL "incbin")
+        if(NOT CMAKE_ASM_COMPILER_LOADED)
+            message(FATAL_ERROR "cirf_add_resources: ENCODING incbin needs the ASM language "
+                "(add ASM to project() or call enable_language(ASM))")
+        endif()
+        set(OUTPUT_S ${ARG_OUTPUT_DIR}/${name}_data.S)
+        list(APPEND LAYOUT_ARGS -A ${OUTPUT_S})
+    endif()
 
     # Custom command to generate resources
     # Uses DEPFILE so that source file dependencies are tracked at build time
     add_custom_command(
-        OUTPUT ${OUTPUT_C} ${OUTPUT_H}
+        OUTPUT ${OUTPUT_C} ${OUTPUT_H} ${OUTPUT_S}
         COMMAND ${CIRF_EXECUTABLE}
             -n ${name}
-            -c ${CONFIG_ABS}
-            -o ${OUTPUT_C}
+            ${CONFIG_ARGS}
+            ${LAYOUT_ARGS}
+            ${OUTPUT_ARGS}
             -H ${OUTPUT_H}
             -M ${OUTPUT_D}
         DEPENDS ${CIRF_DEPENDS} ${CONFIG_DEPS}
@@ -131,8 +195,15 @@ function(cirf_add_resources name)
         VERBATIM
     )
 
-    add_library(${name} STATIC ${OUTPUT_C})
+    add_library(${name} STATIC ${OUTPUT_C} ${OUTPUT_S})
     target_include_directories(${name} PUBLIC ${ARG_OUTPUT_DIR})
+    if(ARG_OBJECT_TARGET)
+        set_source_files_properties(${OUTPUT_C} PROPERTIES EXTERNAL_OBJECT TRUE)
+        set_target_properties(${name} PROPERTIES LINKER_LANGUAGE C)
+    endif()
+    if(ARG_COMPACT)
+        target_compile_definitions(${name} PUBLIC CIRF_COMPACT)
+    endif()
 
     # Need CIRF include directory for <cirf/types.h>
     # Priority: cirf_runtime target > cirf_lib target > installed path
@@ -174,5 +245,5 @@ function(cirf_add_resources name)
     endif()
 
     # Mark generated files as generated
-    set_source_files_properties(${OUTPUT_C} ${OUTPUT_H} PROPERTIES GENERATED TRUE)
+    set_source_files_properties(${OUTPUT_C} ${OUTPUT_H} ${OUTPUT_S} PROPERTIES GENERATED TRUE)
 endfunction()
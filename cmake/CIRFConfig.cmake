@@ -3,6 +3,9 @@
 
 include(CMakeFindDependencyMacro)
 
+# cirf_runtime links Threads::Threads for its mount table and parallel foreach
+find_dependency(Threads)
+
 # Include targets if available
 if(EXISTS "${CMAKE_CURRENT_LIST_DIR}/CIRFTargets.cmake")
     include("${CMAKE_CURRENT_LIST_DIR}/CIRFTargets.cmake")
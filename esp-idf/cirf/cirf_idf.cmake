@@ -125,6 +125,8 @@ endfunction()
 #     NAME <name>
 #     CONFIG <config_file>
 #     OUTPUT_SOURCES <variable_name>
+#     [COMPACT]
+#     [ENCODING hex|string|words]
 #     [DEPENDS <file1> <file2> ...]
 #     [WORKING_DIRECTORY <dir>]
 # )
@@ -135,6 +137,10 @@ endfunction()
 #   NAME             - Base name for generated symbols (e.g., "web_resources")
 #   CONFIG           - Path to the JSON configuration file
 #   OUTPUT_SOURCES   - Variable to set with path to generated .c file
+#   COMPACT          - Generate the compact layout (cirf --compact); code
+#                      using the cirf_node_* accessors needs CIRF_COMPACT
+#   ENCODING         - How file data is spelled (cirf --encoding); defaults to
+#                      string, the fastest to compile with the IDF's GCC/Clang
 #   DEPENDS          - Additional files that trigger regeneration
 #   WORKING_DIRECTORY - Working directory for cirf (default: CONFIG file's directory)
 #
@@ -142,7 +148,8 @@ endfunction()
 #   <OUTPUT_SOURCES>_INCLUDE_DIR - Directory containing the generated header
 #
 function(cirf_generate)
-    cmake_parse_arguments(ARG "" "NAME;CONFIG;OUTPUT_SOURCES;WORKING_DIRECTORY" "DEPENDS" ${ARGN})
+    cmake_parse_arguments(ARG "COMPACT" "NAME;CONFIG;OUTPUT_SOURCES;WORKING_DIRECTORY;ENCODING"
+                          "DEPENDS" ${ARGN})
 
     if(NOT ARG_NAME)
         message(FATAL_ERROR "cirf_generate: NAME is required")
@@ -180,12 +187,22 @@ function(cirf_generate)
         get_filename_component(_work_dir "${_config_abs}" DIRECTORY)
     endif()
 
+    set(_layout_args "")
+    if(ARG_COMPACT)
+        set(_layout_args -C)
+    endif()
+    if(NOT ARG_ENCODING)
+        set(ARG_ENCODING string)
+    endif()
+    list(APPEND _layout_args -E ${ARG_ENCODING})
+
     # Custom command to generate resources
     add_custom_command(
         OUTPUT "${_out_c}" "${_out_h}"
         COMMAND "${CIRF_HOST_EXECUTABLE}"
             -n "${ARG_NAME}"
             -c "${_config_abs}"
+            ${_layout_args}
             -o "${_out_c}"
             -H "${_out_h}"
             -M "${_out_d}"
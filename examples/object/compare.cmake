@@ -0,0 +1,24 @@
+# Runs EXPECTED and ACTUAL and fails unless both succeed with the same output
+#
+#   cmake -DEXPECTED=<program> -DACTUAL=<program> -P compare.cmake
+#
+# The outputs are kept as <program>.out next to each program for diffing.
+
+foreach(_var EXPECTED ACTUAL)
+    execute_process(
+        COMMAND ${${_var}}
+        OUTPUT_FILE ${${_var}}.out
+        RESULT_VARIABLE _rc
+    )
+    if(NOT _rc EQUAL 0)
+        message(FATAL_ERROR "${${_var}} failed: ${_rc}")
+    endif()
+endforeach()
+
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files ${EXPECTED}.out ${ACTUAL}.out
+    RESULT_VARIABLE _rc
+)
+if(NOT _rc EQUAL 0)
+    message(FATAL_ERROR "Outputs differ:\n  diff ${EXPECTED}.out ${ACTUAL}.out")
+endif()
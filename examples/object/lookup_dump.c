@@ -0,0 +1,151 @@
+/*
+ * CIRF Object Example
+ *
+ * Prints what the runtime sees of one resource set: the tree as listed
+ * and iterated, every file's data checksum and metadata, and the results
+ * of lookups that hit and miss. The program is built twice, once against
+ * the set generated as C source and once against the same set written as
+ * an ELF object by cirf --object, and the two outputs must be identical.
+ *
+ * RES_HEADER and RES_ROOT name the generated header and root folder.
+ */
+
+#include RES_HEADER
+#include <cirf/runtime.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ROOT (&RES_ROOT)
+
+/* FNV-1a of a file's data */
+static unsigned long long checksum(const unsigned char *data, size_t size)
+{
+    unsigned long long h = 0xcbf29ce484222325ull;
+    for(size_t i = 0; i < size; i++) {
+        h = (h ^ data[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+static void print_metadata(const cirf_metadata_t *meta, size_t count)
+{
+    for(size_t i = 0; i < count; i++) {
+        printf("    meta %s=%s id=%u type=%u int=%lld real=%g\n", meta[i].key, meta[i].value,
+               (unsigned)meta[i].key_id, (unsigned)meta[i].type, (long long)meta[i].integer,
+               meta[i].real);
+    }
+}
+
+static void print_file(const cirf_file_t *f)
+{
+    printf("file %s name=%s size=%zu mime=%s mime_id=%u parent=%s index=%zu sum=%016llx\n",
+           f->path, f->name, f->size, f->mime ? f->mime : "(null)", (unsigned)f->mime_id,
+           f->parent->path, cirf_file_index(ROOT, f), checksum(f->data, f->size));
+    print_metadata(f->metadata, f->metadata_count);
+}
+
+/* The tree as cirf_readdir() lists it, depth-first */
+static void list_folder(const cirf_folder_t *folder)
+{
+    printf("folder '%s' name='%s' children=%zu files=%zu tree_files=%zu tree_folders=%zu "
+           "flags=%u count=%zu/%zu\n",
+           folder->path, folder->name, folder->child_count, folder->file_count,
+           folder->tree_file_count, folder->tree_folder_count, (unsigned)folder->flags,
+           cirf_count_files(folder), cirf_count_folders(folder));
+    print_metadata(folder->metadata, folder->metadata_count);
+
+    cirf_dir_t           dir;
+    const cirf_dirent_t *ent;
+    cirf_opendir(&dir, folder);
+    while((ent = cirf_readdir(&dir))) {
+        if(ent->folder) {
+            list_folder(ent->folder);
+        } else {
+            print_file(ent->file);
+        }
+    }
+}
+
+static void print_find_file(const char *path, size_t len)
+{
+    const cirf_file_t *f = cirf_find_file_n(ROOT, path, len);
+    printf("find_file '%.*s' (%zu) -> %s\n", (int)len, path, len, f ? f->path : "NULL");
+}
+
+static void print_find_folder(const char *path, size_t len)
+{
+    const cirf_folder_t *d = cirf_find_folder_n(ROOT, path, len);
+    printf("find_folder '%.*s' (%zu) -> %s\n", (int)len, path, len, d ? d->path : "NULL");
+}
+
+static void on_file(const cirf_file_t *file, void *ctx)
+{
+    (void)ctx;
+    printf("foreach %s\n", file->path);
+}
+
+int main(void)
+{
+    static const char *misses[] = {
+        "", "/", "missing", "index.htm", "index.html/", "data/missing.json",
+        "docs/changelog_2025.txt", "docs/changelog_202", "assets/shaders/basic",
+        "DATA/config.json", "data//blob.bin", "/index.html",
+    };
+
+    list_folder(ROOT);
+
+    /* Iteration orders */
+    cirf_foreach_file_recursive(ROOT, on_file, NULL);
+
+    cirf_iter_t          it;
+    const cirf_file_t   *f;
+    const cirf_folder_t *d;
+    cirf_iter_init(&it, ROOT);
+    while((f = cirf_iter_next(&it))) {
+        printf("iter %s\n", f->path);
+    }
+    cirf_iter_init(&it, ROOT);
+    while((d = cirf_iter_next_folder(&it))) {
+        printf("iter_folder %s\n", d->path);
+    }
+
+    /* Every path, with and without a trailing slash or an embedded NUL */
+    for(size_t i = 0; i < ROOT->tree_file_count; i++) {
+        const char *path = ROOT->tree_files[i].path;
+        size_t      len = strlen(path);
+        print_find_file(path, len);
+        print_find_file(path, len + 1);
+        print_find_folder(path, len);
+    }
+    cirf_iter_init(&it, ROOT);
+    while((d = cirf_iter_next_folder(&it))) {
+        char   path[256];
+        size_t len = strlen(d->path);
+        snprintf(path, sizeof(path), "%s/", d->path);
+        print_find_folder(d->path, len);
+        print_find_folder(path, len + 1);
+        print_find_file(d->path, len);
+    }
+    for(size_t i = 0; i < sizeof(misses) / sizeof(misses[0]); i++) {
+        print_find_file(misses[i], strlen(misses[i]));
+        print_find_folder(misses[i], strlen(misses[i]));
+    }
+
+    /* Lookups relative to a folder */
+    cirf_cursor_t cur;
+    if(cirf_cursor_init(&cur, cirf_find_folder(ROOT, "docs")) == 0) {
+        f = cirf_cursor_find_file(&cur, "guide.md", 8);
+        printf("cursor docs/guide.md -> %s\n", f ? f->path : "NULL");
+        f = cirf_cursor_find_file(&cur, "nope.md", 7);
+        printf("cursor docs/nope.md -> %s\n", f ? f->path : "NULL");
+    }
+
+    /* Metadata by key */
+    printf("root app=%s\n", cirf_get_metadata(ROOT->metadata, ROOT->metadata_count, "app"));
+    f = cirf_find_file(ROOT, "index.html");
+    if(f) {
+        printf("index.html cache=%s\n", cirf_get_metadata(f->metadata, f->metadata_count, "cache"));
+        printf("index.html root=%s\n", cirf_get_root(f) == ROOT ? "yes" : "no");
+    }
+    return 0;
+}
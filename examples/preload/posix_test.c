@@ -0,0 +1,173 @@
+/*
+ * CIRF Preload Example
+ *
+ * A plain POSIX program: it knows nothing about cirf and links nothing
+ * from it. Run under LD_PRELOAD=libpreload_example.so, the embedded files
+ * appear under /cirf/ and are checked against the originals in the
+ * directory given on the command line.
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(cond)                                                  \
+    do {                                                             \
+        checks++;                                                    \
+        if(!(cond)) {                                                \
+            failures++;                                              \
+            fprintf(stderr, "%s:%d: check failed: %s (errno %d)\n", \
+                    __FILE__, __LINE__, #cond, errno);               \
+        }                                                            \
+    } while(0)
+
+/* Read a real file from the source tree */
+static char *slurp(const char *dir, const char *name, size_t *size)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return NULL;
+
+    struct stat st;
+    char *buf = NULL;
+    if(fstat(fd, &st) == 0 && (buf = malloc((size_t)st.st_size + 1))) {
+        *size = (size_t)read(fd, buf, (size_t)st.st_size);
+    }
+    close(fd);
+    return buf;
+}
+
+static void check_file(const char *srcdir, const char *name)
+{
+    size_t size = 0;
+    char *expect = slurp(srcdir, name, &size);
+    CHECK(expect != NULL);
+    if(!expect) return;
+
+    char path[256];
+    snprintf(path, sizeof(path), "/cirf/%s", name);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    CHECK(fd >= 0);
+    if(fd < 0) {
+        free(expect);
+        return;
+    }
+
+    /* Sequential reads in small pieces, then EOF */
+    char buf[4096];
+    size_t got = 0;
+    ssize_t n;
+    while((n = read(fd, buf + got, 5)) > 0)
+        got += (size_t)n;
+    CHECK(n == 0);
+    CHECK(got == size && memcmp(buf, expect, size) == 0);
+
+    struct stat st;
+    CHECK(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && (size_t)st.st_size == size);
+    CHECK(lseek(fd, 0, SEEK_END) == (off_t)size);
+    CHECK(lseek(fd, 3, SEEK_SET) == 3);
+    CHECK(read(fd, buf, 4) == 4 && memcmp(buf, expect + 3, 4) == 0);
+    CHECK(lseek(fd, -2, SEEK_CUR) == 5);
+    CHECK(pread(fd, buf, 6, 1) == 6 && memcmp(buf, expect + 1, 6) == 0);
+    CHECK(lseek(fd, 0, SEEK_CUR) == 5); /* pread leaves the position */
+    CHECK(lseek(fd, -1, SEEK_SET) == -1 && errno == EINVAL);
+
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    CHECK(map != MAP_FAILED);
+    if(map != MAP_FAILED) {
+        CHECK(memcmp(map, expect, size) == 0);
+        munmap(map, size);
+    }
+    CHECK(mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) == MAP_FAILED &&
+          errno == EACCES);
+    CHECK(fcntl(fd, F_GETFD) == FD_CLOEXEC);
+
+    /* Duplicates share the position, and outlive the original */
+    int dup_fd = dup(fd);
+    int dup_fd2 = fcntl(fd, F_DUPFD_CLOEXEC, 100);
+    CHECK(dup_fd >= 0 && dup_fd2 >= 100);
+    CHECK(lseek(fd, 2, SEEK_SET) == 2);
+    CHECK(read(dup_fd, buf, 3) == 3 && memcmp(buf, expect + 2, 3) == 0);
+    CHECK(lseek(dup_fd2, 0, SEEK_CUR) == 5);
+    CHECK(dup2(dup_fd, dup_fd2) == dup_fd2);
+    CHECK(close(fd) == 0 && close(dup_fd) == 0);
+    CHECK(read(dup_fd2, buf, 2) == 2 && memcmp(buf, expect + 5, 2) == 0);
+    CHECK(close(dup_fd2) == 0);
+
+    /* stdio */
+    FILE *fp = fopen(path, "r");
+    CHECK(fp != NULL);
+    if(fp) {
+        CHECK(fread(buf, 1, sizeof(buf), fp) == size && memcmp(buf, expect, size) == 0);
+        fclose(fp);
+    }
+    free(expect);
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2) {
+        fprintf(stderr, "usage: %s <resources-dir>\n", argv[0]);
+        return 2;
+    }
+
+    struct stat st;
+    if(stat("/cirf", &st) != 0) {
+        fprintf(stderr, "/cirf not found: run with LD_PRELOAD=libpreload_example.so\n");
+        return 1;
+    }
+    CHECK(S_ISDIR(st.st_mode));
+
+    check_file(argv[1], "hello.txt");
+    check_file(argv[1], "docs/guide.md");
+
+    /* Relative to a directory descriptor */
+    int dfd = open("/cirf/docs", O_RDONLY | O_DIRECTORY);
+    CHECK(dfd >= 0);
+    int fd = openat(dfd, "guide.md", O_RDONLY);
+    CHECK(fd >= 0);
+    char buf[64];
+    CHECK(read(fd, buf, 7) == 7 && memcmp(buf, "# Guide", 7) == 0);
+    CHECK(read(dfd, buf, 1) == -1 && errno == EISDIR);
+    close(fd);
+    close(dfd);
+
+    /* Listing */
+    DIR *dir = opendir("/cirf");
+    CHECK(dir != NULL);
+    if(dir) {
+        int seen = 0;
+        struct dirent *ent;
+        while((ent = readdir(dir))) {
+            if(strcmp(ent->d_name, "hello.txt") == 0 && ent->d_type == DT_REG) seen |= 1;
+            if(strcmp(ent->d_name, "docs") == 0 && ent->d_type == DT_DIR) seen |= 2;
+            if(strcmp(ent->d_name, ".") == 0) seen |= 4;
+        }
+        CHECK(seen == 7);
+        CHECK(fstat(dirfd(dir), &st) == 0 && S_ISDIR(st.st_mode));
+        CHECK(closedir(dir) == 0);
+    }
+
+    /* Read-only, and misses fall through to the real filesystem */
+    CHECK(open("/cirf/hello.txt", O_WRONLY) == -1 && errno == EROFS);
+    CHECK(open("/cirf/hello.txt", O_RDONLY | O_DIRECTORY) == -1 && errno == ENOTDIR);
+    CHECK(open("/cirf/missing.txt", O_RDONLY) == -1 && errno == ENOENT);
+    CHECK(opendir("/cirf/hello.txt") == NULL && errno == ENOTDIR);
+    dir = opendir(argv[1]);
+    CHECK(dir != NULL && readdir(dir) != NULL);
+    if(dir) closedir(dir);
+
+    printf("%d/%d checks passed\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,13 @@
+/*
+ * Mounts the example resources for the interposer. Built into
+ * libpreload_example.so together with cirf's preload.c and runtime.c.
+ */
+
+#include <cirf/preload.h>
+#include <cirf/runtime.h>
+#include "preload_resources.h"
+
+void cirf_preload_init(void)
+{
+    cirf_mount("/cirf/", &preload_resources_root);
+}
@@ -44,9 +44,13 @@ int main(void)
            simple_resources_dir_config.file_count);
 
     /* Access nested file directly */
-    printf("Direct: simple_resources_file_config_data_json->path = %s\n\n",
+    printf("Direct: simple_resources_file_config_data_json->path = %s\n",
            simple_resources_file_config_data_json->path);
 
+    /* Constant path resolved at compile time (a typo fails to build) */
+    printf("Constant: SIMPLE_RESOURCES_FILE(\"config/data.json\")->size = %zu\n\n",
+           SIMPLE_RESOURCES_FILE("config/data.json")->size);
+
     /* ========================================
      * Using cirf_runtime library functions
      * (Requires linking against cirf_runtime)
@@ -0,0 +1,24 @@
+#ifndef CIRF_BLOOM_H
+#define CIRF_BLOOM_H
+
+#include "error.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Blocked Bloom filter over a set of 64-bit key hashes, laid out as
+ * block_count blocks of CIRF_BLOOM_WORDS words (see <cirf/hash.h>). Used to
+ * reject paths that are not in a resource set without touching the tree.
+ * The runtime side lives in src/runtime.c.
+ */
+typedef struct bloom {
+        uint64_t *words;       /* block_count * CIRF_BLOOM_WORDS words */
+        size_t    block_count; /* Number of blocks */
+} bloom_t;
+
+/* Build a filter with roughly bits_per_key bits of space per key */
+cirf_error_t bloom_build(const uint64_t *hashes, size_t count, size_t bits_per_key,
+                         bloom_t **out);
+void         bloom_destroy(bloom_t *bloom);
+
+#endif /* CIRF_BLOOM_H */
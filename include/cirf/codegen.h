@@ -2,14 +2,74 @@
 #define CIRF_CODEGEN_H
 
 #include "config.h"
+#include "elf.h"
 #include "error.h"
 
+/* Lookup indexes emitted next to the root folder (codegen_options_t.indexes) */
+#define CODEGEN_INDEX_HASH (1u << 0) /* Minimal perfect hash over all paths */
+#define CODEGEN_INDEX_TRIE (1u << 1) /* Radix trie for prefix queries */
+#define CODEGEN_INDEX_FILTER (1u << 2) /* Bloom filter over file paths */
+#define CODEGEN_INDEX_QUERY (1u << 3) /* Inverted metadata and MIME indexes */
+#define CODEGEN_INDEX_HOT (1u << 4) /* Hot lookup arrays for tree walks */
+
+/*
+ * How file data arrays are spelled (codegen_options_t.data_encoding). The
+ * bytes at run time are the same; compile time and compiler memory are not.
+ * incbin and embed leave the bytes out of the C source altogether: the
+ * assembler or preprocessor reads each file from its source path again,
+ * under the same symbol and with at least the same alignment.
+ */
+#define CODEGEN_DATA_HEX 0    /* { 0x12, 0x34, ... }: any compiler, slowest */
+#define CODEGEN_DATA_STRING 1 /* Exactly sized string literal: fastest on GCC/Clang */
+#define CODEGEN_DATA_WORDS 2  /* uint64_t words: little-endian targets only */
+#define CODEGEN_DATA_INCBIN 3 /* .incbin in a separate assembly file (asm_path) */
+#define CODEGEN_DATA_EMBED 4  /* C23 #embed of each source file */
+
+/*
+ * Table sizes of a compact set (codegen_options_t.compact): its records and
+ * string pool, and what the same tables take in the pointer layout, counting
+ * file and folder structures, children arrays, file symbols and distinct
+ * strings. File data, metadata and lookup indexes are not included.
+ */
+typedef struct codegen_stats {
+        size_t compact_bytes;    /* Compact layout */
+        size_t pointer_bytes_32; /* Pointer layout on 32-bit targets */
+        size_t pointer_bytes_64; /* Pointer layout on 64-bit targets */
+} codegen_stats_t;
+
 typedef struct codegen_options {
-        const char *name;        /* Base name for generated symbols (e.g., "my_resources") */
-        const char *source_path; /* Output .c file path */
-        const char *header_path; /* Output .h file path */
+        const char         *name;          /* Base name for generated symbols (e.g., "res") */
+        const char         *source_path;   /* Output .c file path */
+        const char         *header_path;   /* Output .h file path */
+        unsigned            indexes;       /* CODEGEN_INDEX_* flags (pointer layout only) */
+        int                 compact;       /* Generate the compact layout (one config only) */
+        int                 data_encoding; /* CODEGEN_DATA_* */
+        const char         *asm_path;      /* Output .S file path (CODEGEN_DATA_INCBIN only) */
+        const char         *object_path;   /* Output ELF .o file path instead of source_path */
+        const elf_target_t *object_target; /* Target of object_path */
+        const char         *pack_path;     /* Output pack file path instead of source and header */
+        codegen_stats_t    *stats;         /* Filled in for the compact layout, may be NULL */
 } codegen_options_t;
 
+/*
+ * With object_path set, the set's data and structures are written as a
+ * relocatable ELF object for object_target instead of C source; the header
+ * is the same. This covers one config in the pointer layout, with at most
+ * the hash and filter indexes, and ignores data_encoding.
+ *
+ * With pack_path set, the same kind of set is written to a pack file for
+ * cirf_pack_open() (see <cirf/pack.h>) and nothing else is generated;
+ * header_path may be NULL.
+ */
 cirf_error_t codegen_generate(const cirf_config_t *config, const codegen_options_t *options);
 
+/*
+ * Generate several resource sets (layers) into one source/header pair,
+ * plus {options->name}_overlay, which resolves each path to the file of
+ * the last layer that has it. Each layer's symbols are prefixed with its
+ * config's name. With count == 1 this is codegen_generate().
+ */
+cirf_error_t codegen_generate_overlay(cirf_config_t *const *layers, size_t count,
+                                      const codegen_options_t *options);
+
 #endif /* CIRF_CODEGEN_H */
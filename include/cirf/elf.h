@@ -0,0 +1,75 @@
+#ifndef CIRF_ELF_H
+#define CIRF_ELF_H
+
+#include "error.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Relocatable ELF object writer, used by codegen for --object. An object
+ * has two sections: ELF_RODATA for bytes without addresses (file data,
+ * strings, hash seeds) and ELF_RELRO (.data.rel.ro) for structures holding
+ * pointers, which get one absolute relocation per pointer. Addresses are
+ * given as labels, which may be placed after they are used; all labels
+ * and relocations are resolved when the object is written.
+ */
+
+#define ELF_RODATA 0
+#define ELF_RELRO  1
+
+typedef struct elf_target {
+        const char *name;        /* --target name, e.g. "aarch64" */
+        unsigned    pointer_size; /* 4 (ELFCLASS32) or 8 (ELFCLASS64) */
+        int         big_endian;
+        uint16_t    machine;     /* e_machine */
+        uint32_t    flags;       /* e_flags */
+        uint32_t    reloc_type;  /* Absolute relocation of pointer size */
+        int         rela;        /* Relocations carry their addends (SHT_RELA) */
+        unsigned    align64;     /* Alignment of 64-bit integers and doubles in structures */
+} elf_target_t;
+
+typedef struct elf_object elf_object_t;
+
+/* Target by name, or NULL if unknown */
+const elf_target_t *elf_target_find(const char *name);
+
+/* Target cirf itself was built for, or NULL if it is not in the table */
+const elf_target_t *elf_target_host(void);
+
+/* Comma-separated names of all targets, for messages */
+const char *elf_target_names(void);
+
+elf_object_t *elf_create(const elf_target_t *target);
+void          elf_destroy(elf_object_t *obj);
+
+/*
+ * Building. These never fail on their own: running out of memory is
+ * remembered and reported by elf_write(). Integers are written in the
+ * target's byte order and aligned as in the target's structures.
+ */
+void elf_align(elf_object_t *obj, int section, size_t align);
+void elf_put_bytes(elf_object_t *obj, int section, const void *data, size_t len);
+void elf_put_u32(elf_object_t *obj, int section, uint32_t value);
+void elf_put_u64(elf_object_t *obj, int section, uint64_t value);
+void elf_put_f64(elf_object_t *obj, int section, double value);
+void elf_put_size(elf_object_t *obj, int section, uint64_t value); /* size_t */
+
+/* Offset of the next byte of a section */
+size_t elf_offset(const elf_object_t *obj, int section);
+
+/*
+ * Labels: a new label is unplaced until elf_place() puts it at the current
+ * end of a section. elf_put_addr() writes a pointer to label + addend, or
+ * NULL for label -1. Labels are numbered from 0.
+ */
+int  elf_label(elf_object_t *obj);
+void elf_place(elf_object_t *obj, int label, int section);
+void elf_put_addr(elf_object_t *obj, int section, int label, size_t addend);
+
+/* Global data symbol of size bytes at a label */
+void elf_symbol(elf_object_t *obj, const char *name, int label, size_t size);
+
+/* Write the object; CIRF_ERR_INVALID if a used label was never placed */
+cirf_error_t elf_write(elf_object_t *obj, const char *path);
+
+#endif /* CIRF_ELF_H */
@@ -0,0 +1,300 @@
+/*
+ * cirf/hash.h - Path hashing shared by the generator and the runtime
+ *
+ * The generator hashes every virtual path at build time and stores the
+ * resulting lookup tables in the generated source. The runtime hashes the
+ * requested path with the same function, so both sides must agree bit for
+ * bit on every platform. Everything here is header-only and uses fixed-width
+ * arithmetic only.
+ *
+ * The hash is a 64-bit polynomial over the path bytes (each byte weighted by
+ * a power of CIRF_HASH_MUL) followed by a finalizing mix that folds in the
+ * length. Because every byte contributes independently, a hash can be
+ * resumed from a saved prefix state.
+ */
+
+#ifndef CIRF_HASH_H
+#define CIRF_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CIRF_HASH_MUL 0x9e3779b97f4a7c15ULL
+
+/* Used on the helpers that must fold away for compile-time lookups */
+#if defined(__has_attribute)
+#if __has_attribute(always_inline)
+#define CIRF_ALWAYS_INLINE static inline __attribute__((always_inline))
+#endif
+#endif
+#ifndef CIRF_ALWAYS_INLINE
+#define CIRF_ALWAYS_INLINE static inline
+#endif
+
+typedef uint64_t cirf_hash_t;
+
+/*
+ * Incremental hash state.
+ */
+typedef struct cirf_hash_state {
+        uint64_t sum; /* Polynomial sum of bytes seen so far */
+        uint64_t pow; /* Weight of the next byte */
+        size_t   len; /* Bytes seen so far */
+} cirf_hash_state_t;
+
+CIRF_ALWAYS_INLINE uint64_t cirf_hash_fmix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline void cirf_hash_init(cirf_hash_state_t *st) {
+    st->sum = 0;
+    st->pow = CIRF_HASH_MUL;
+    st->len = 0;
+}
+
+static inline void cirf_hash_update(cirf_hash_state_t *st, const char *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t             sum = st->sum;
+    uint64_t             pow = st->pow;
+    for(size_t i = 0; i < len; i++) {
+        sum += (uint64_t)p[i] * pow;
+        pow *= CIRF_HASH_MUL;
+    }
+    st->sum = sum;
+    st->pow = pow;
+    st->len += len;
+}
+
+static inline cirf_hash_t cirf_hash_final(const cirf_hash_state_t *st) {
+    return cirf_hash_fmix(st->sum ^ ((uint64_t)st->len * 0xff51afd7ed558ccdULL));
+}
+
+/*
+ * Hash a byte string in one call.
+ */
+static inline cirf_hash_t cirf_hash_bytes(const char *data, size_t len) {
+    cirf_hash_state_t st;
+    cirf_hash_init(&st);
+    cirf_hash_update(&st, data, len);
+    return cirf_hash_final(&st);
+}
+
+/*
+ * Derive a secondary hash from a primary hash and a seed. Used by the
+ * perfect-hash tables to place the keys of one bucket.
+ */
+static inline cirf_hash_t cirf_hash_mix(cirf_hash_t h, uint32_t seed) {
+    return cirf_hash_fmix(h + (uint64_t)seed * CIRF_HASH_MUL);
+}
+
+/*
+ * Blocked Bloom filter over path hashes. A key selects one block of
+ * CIRF_BLOOM_WORDS 64-bit words (one cache line) and sets one bit in every
+ * word of it, so a query reads a single block. Bit j comes from byte j of
+ * cirf_bloom_bits().
+ */
+#define CIRF_BLOOM_WORDS 8
+
+static inline size_t cirf_bloom_block(cirf_hash_t h, size_t block_count) {
+    return (size_t)((h >> 32) % block_count);
+}
+
+static inline uint64_t cirf_bloom_bits(cirf_hash_t h) {
+    return cirf_hash_fmix(h ^ 0x2545f4914f6cdd1dULL);
+}
+
+static inline uint64_t cirf_bloom_mask(uint64_t bits, unsigned word) {
+    return 1ULL << ((bits >> (8 * word)) & 63);
+}
+
+/*
+ * Compile-time hashing of string literals.
+ *
+ * CIRF_HASH_LITERAL("a/b.txt") expands to the same value as
+ * cirf_hash_bytes("a/b.txt", 7), spelled as an unrolled expression that an
+ * optimizing compiler folds to a constant. Only string literals are accepted
+ * and at most CIRF_CONST_PATH_MAX bytes are hashed; longer literals hash to 0,
+ * which generated headers never treat as a path. Generated headers use this
+ * to resolve constant paths without a runtime lookup.
+ */
+#define CIRF_CONST_PATH_MAX 128
+
+#define CIRF_HASH_LIT_(s, i, w) \
+    ((i) < sizeof(s) - 1 ? (uint64_t)(unsigned char)(s)[(i) < sizeof(s) - 1 ? (i) : 0] * (w) : 0)
+
+#define CIRF_HASH_LITERAL(s) \
+    cirf_hash_literal_(CIRF_HASH_LITERAL_SUM_("" s ""), sizeof("" s "") - 1)
+
+CIRF_ALWAYS_INLINE cirf_hash_t cirf_hash_literal_(uint64_t sum, size_t len) {
+    if(len > CIRF_CONST_PATH_MAX) return 0;
+    return cirf_hash_fmix(sum ^ ((uint64_t)len * 0xff51afd7ed558ccdULL));
+}
+
+/*
+ * When the compiler optimizes and supports the error attribute, a call to
+ * this function that survives constant folding is a compile error. Generated
+ * headers reach it only for a hash that folded to a constant yet names no
+ * file, i.e. a mistyped literal. If the hash did not fold (low optimization
+ * levels), the lookup simply runs the switch at run time.
+ */
+#if defined(__OPTIMIZE__) && defined(__has_attribute)
+#if __has_attribute(error)
+#define CIRF_HAVE_CONST_PATH_CHECK 1
+extern const void *cirf_const_path_unknown(void)
+    __attribute__((error("constant path is not part of this resource set")));
+#endif
+#endif
+
+#ifdef CIRF_HAVE_CONST_PATH_CHECK
+#define CIRF_CONST_PATH_UNKNOWN(T, hash) \
+    (__builtin_constant_p(hash) ? (T)cirf_const_path_unknown() : (T)NULL)
+#else
+#define CIRF_CONST_PATH_UNKNOWN(T, hash) ((T)NULL)
+#endif
+
+/* clang-format off */
+#define CIRF_HASH_LITERAL_SUM_(s) \
+    (CIRF_HASH_LIT_(s, 0, 0x9e3779b97f4a7c15ULL) + \
+     CIRF_HASH_LIT_(s, 1, 0xdf442d22ce4859b9ULL) + \
+     CIRF_HASH_LIT_(s, 2, 0x604a5ce3addef82dULL) + \
+     CIRF_HASH_LIT_(s, 3, 0xd94363fc538227b1ULL) + \
+     CIRF_HASH_LIT_(s, 4, 0x2e2b795f2d10fd85ULL) + \
+     CIRF_HASH_LIT_(s, 5, 0x4be7956e30a337e9ULL) + \
+     CIRF_HASH_LIT_(s, 6, 0x5ecb31e4ccd2721dULL) + \
+     CIRF_HASH_LIT_(s, 7, 0x06d4b2611beb6861ULL) + \
+     CIRF_HASH_LIT_(s, 8, 0x0f10cd6a9be88bf5ULL) + \
+     CIRF_HASH_LIT_(s, 9, 0x80e0dcf76db02719ULL) + \
+     CIRF_HASH_LIT_(s, 10, 0x779023cf069d510dULL) + \
+     CIRF_HASH_LIT_(s, 11, 0x4114e3439eebf211ULL) + \
+     CIRF_HASH_LIT_(s, 12, 0x8fc15a19ba851765ULL) + \
+     CIRF_HASH_LIT_(s, 13, 0x50687085a271d749ULL) + \
+     CIRF_HASH_LIT_(s, 14, 0x82fe791be9b804fdULL) + \
+     CIRF_HASH_LIT_(s, 15, 0xf53f7dff42a4f4c1ULL) + \
+     CIRF_HASH_LIT_(s, 16, 0xc1712bcbdcdf8fd5ULL) + \
+     CIRF_HASH_LIT_(s, 17, 0x204db59ca693f879ULL) + \
+     CIRF_HASH_LIT_(s, 18, 0xe1a216043077fdedULL) + \
+     CIRF_HASH_LIT_(s, 19, 0x07dde4bf1258a071ULL) + \
+     CIRF_HASH_LIT_(s, 20, 0x657df06edea5e545ULL) + \
+     CIRF_HASH_LIT_(s, 21, 0xfb5e617f1f9b3aa9ULL) + \
+     CIRF_HASH_LIT_(s, 22, 0xb39afcd693ffabddULL) + \
+     CIRF_HASH_LIT_(s, 23, 0x761af3294c1a2521ULL) + \
+     CIRF_HASH_LIT_(s, 24, 0x3737591302ab07b5ULL) + \
+     CIRF_HASH_LIT_(s, 25, 0xa6a140ea15154dd9ULL) + \
+     CIRF_HASH_LIT_(s, 26, 0xa09b3202342e7ecdULL) + \
+     CIRF_HASH_LIT_(s, 27, 0x590dd8f2277db2d1ULL) + \
+     CIRF_HASH_LIT_(s, 28, 0x3710df127f56e725ULL) + \
+     CIRF_HASH_LIT_(s, 29, 0xf0f4b4b9b5c8e209ULL) + \
+     CIRF_HASH_LIT_(s, 30, 0x196a94fe0490e6bdULL) + \
+     CIRF_HASH_LIT_(s, 31, 0xcdfb8afc05487981ULL) + \
+     CIRF_HASH_LIT_(s, 32, 0xbbf1bbaea8167395ULL) + \
+     CIRF_HASH_LIT_(s, 33, 0x477aac3ffde5a739ULL) + \
+     CIRF_HASH_LIT_(s, 34, 0xf4323bc3ae5053adULL) + \
+     CIRF_HASH_LIT_(s, 35, 0x66e0293c3820a931ULL) + \
+     CIRF_HASH_LIT_(s, 36, 0x66b667e9a3cb9d05ULL) + \
+     CIRF_HASH_LIT_(s, 37, 0x2685e2deee344d69ULL) + \
+     CIRF_HASH_LIT_(s, 38, 0x7b6df7115723359dULL) + \
+     CIRF_HASH_LIT_(s, 39, 0x707345dc963d71e1ULL) + \
+     CIRF_HASH_LIT_(s, 40, 0xa22921b8a03d5375ULL) + \
+     CIRF_HASH_LIT_(s, 41, 0x7d788c7104468499ULL) + \
+     CIRF_HASH_LIT_(s, 42, 0xaf359f12bd3cfc8dULL) + \
+     CIRF_HASH_LIT_(s, 43, 0x7c7b3c0304170391ULL) + \
+     CIRF_HASH_LIT_(s, 44, 0xd68c186f728786e5ULL) + \
+     CIRF_HASH_LIT_(s, 45, 0xf3420c33a3a6fcc9ULL) + \
+     CIRF_HASH_LIT_(s, 46, 0xa5c7d76f183e187dULL) + \
+     CIRF_HASH_LIT_(s, 47, 0x1030134928168e41ULL) + \
+     CIRF_HASH_LIT_(s, 48, 0xcad2517b948b2755ULL) + \
+     CIRF_HASH_LIT_(s, 49, 0x668c1d40200965f9ULL) + \
+     CIRF_HASH_LIT_(s, 50, 0xba93c4062f23f96dULL) + \
+     CIRF_HASH_LIT_(s, 51, 0x8a8d513f774641f1ULL) + \
+     CIRF_HASH_LIT_(s, 52, 0x192e4d296f5e24c5ULL) + \
+     CIRF_HASH_LIT_(s, 53, 0xd122fb29187a7029ULL) + \
+     CIRF_HASH_LIT_(s, 54, 0x0cd9c1e413390f5dULL) + \
+     CIRF_HASH_LIT_(s, 55, 0x48b84d57cb014ea1ULL) + \
+     CIRF_HASH_LIT_(s, 56, 0xba5e1e43e2bb6f35ULL) + \
+     CIRF_HASH_LIT_(s, 57, 0x58e24e0ad38fcb59ULL) + \
+     CIRF_HASH_LIT_(s, 58, 0x4e99271ff004ca4dULL) + \
+     CIRF_HASH_LIT_(s, 59, 0x7c710644afa3e451ULL) + \
+     CIRF_HASH_LIT_(s, 60, 0x470d23e2f972f6a5ULL) + \
+     CIRF_HASH_LIT_(s, 61, 0x98ed40464c982789ULL) + \
+     CIRF_HASH_LIT_(s, 62, 0x3bfd4577603b9a3dULL) + \
+     CIRF_HASH_LIT_(s, 63, 0x66c0333b9c3b3301ULL) + \
+     CIRF_HASH_LIT_(s, 64, 0x5d6befb3bad9ab15ULL) + \
+     CIRF_HASH_LIT_(s, 65, 0x06484637a1cb34b9ULL) + \
+     CIRF_HASH_LIT_(s, 66, 0xe4ccd384b7aeef2dULL) + \
+     CIRF_HASH_LIT_(s, 67, 0x8be0a09943356ab1ULL) + \
+     CIRF_HASH_LIT_(s, 68, 0xb6eb196809397c85ULL) + \
+     CIRF_HASH_LIT_(s, 69, 0x833682819379a2e9ULL) + \
+     CIRF_HASH_LIT_(s, 70, 0x0b434c6bb23d391dULL) + \
+     CIRF_HASH_LIT_(s, 71, 0xf38f4f282c11bb61ULL) + \
+     CIRF_HASH_LIT_(s, 72, 0x8ecabed27d415af5ULL) + \
+     CIRF_HASH_LIT_(s, 73, 0xa8e6c500c43d2219ULL) + \
+     CIRF_HASH_LIT_(s, 74, 0x6c980ac4f7c1e80dULL) + \
+     CIRF_HASH_LIT_(s, 75, 0xf422f0bac6105511ULL) + \
+     CIRF_HASH_LIT_(s, 76, 0xd06114772e753665ULL) + \
+     CIRF_HASH_LIT_(s, 77, 0x277d08226a286249ULL) + \
+     CIRF_HASH_LIT_(s, 78, 0x3321966de5056bfdULL) + \
+     CIRF_HASH_LIT_(s, 79, 0xe15114eb23e267c1ULL) + \
+     CIRF_HASH_LIT_(s, 80, 0xceac810f589dfed5ULL) + \
+     CIRF_HASH_LIT_(s, 81, 0x5b72d93320f71379ULL) + \
+     CIRF_HASH_LIT_(s, 82, 0xbf82f2af09ad34edULL) + \
+     CIRF_HASH_LIT_(s, 83, 0xa0caaea3905a2371ULL) + \
+     CIRF_HASH_LIT_(s, 84, 0x444704a2ce39a445ULL) + \
+     CIRF_HASH_LIT_(s, 85, 0x428fc5438d3de5a9ULL) + \
+     CIRF_HASH_LIT_(s, 86, 0x9a8747e8cb2bb2ddULL) + \
+     CIRF_HASH_LIT_(s, 87, 0xc79cc7942c1ab821ULL) + \
+     CIRF_HASH_LIT_(s, 88, 0xf0abce6f27eb16b5ULL) + \
+     CIRF_HASH_LIT_(s, 89, 0x5486e679809a88d9ULL) + \
+     CIRF_HASH_LIT_(s, 90, 0x7b9a0ea29cb055cdULL) + \
+     CIRF_HASH_LIT_(s, 91, 0x327da2eac44855d1ULL) + \
+     CIRF_HASH_LIT_(s, 92, 0x053180d9a0ea4625ULL) + \
+     CIRF_HASH_LIT_(s, 93, 0x899ce60d4ee3ad09ULL) + \
+     CIRF_HASH_LIT_(s, 94, 0xbd895e763c178dbdULL) + \
+     CIRF_HASH_LIT_(s, 95, 0xb4a1d58312382c81ULL) + \
+     CIRF_HASH_LIT_(s, 96, 0xd7f7451d90742295ULL) + \
+     CIRF_HASH_LIT_(s, 97, 0xce40c6cc04590239ULL) + \
+     CIRF_HASH_LIT_(s, 98, 0xd75b16dd63dacaadULL) + \
+     CIRF_HASH_LIT_(s, 99, 0x1e27c05694206c31ULL) + \
+     CIRF_HASH_LIT_(s, 100, 0x2207f64e703a9c05ULL) + \
+     CIRF_HASH_LIT_(s, 101, 0x2b7ad3c02cd33869ULL) + \
+     CIRF_HASH_LIT_(s, 102, 0xc24a976562007c9dULL) + \
+     CIRF_HASH_LIT_(s, 103, 0xd95b5b342ec844e1ULL) + \
+     CIRF_HASH_LIT_(s, 104, 0x7695c1995fd4a275ULL) + \
+     CIRF_HASH_LIT_(s, 105, 0x2f850f9bdbf3ff99ULL) + \
+     CIRF_HASH_LIT_(s, 106, 0xcda76d39040c138dULL) + \
+     CIRF_HASH_LIT_(s, 107, 0xae6382b8c837e691ULL) + \
+     CIRF_HASH_LIT_(s, 108, 0x19bffd77152e25e5ULL) + \
+     CIRF_HASH_LIT_(s, 109, 0x0be91ca7a65607c9ULL) + \
+     CIRF_HASH_LIT_(s, 110, 0xf003f24e47edff7dULL) + \
+     CIRF_HASH_LIT_(s, 111, 0xfc9b5e230b688141ULL) + \
+     CIRF_HASH_LIT_(s, 112, 0x19b5f7b429f81655ULL) + \
+     CIRF_HASH_LIT_(s, 113, 0x13e81b533bbd00f9ULL) + \
+     CIRF_HASH_LIT_(s, 114, 0xa482fbd241f3b06dULL) + \
+     CIRF_HASH_LIT_(s, 115, 0x0f2078ed84f444f1ULL) + \
+     CIRF_HASH_LIT_(s, 116, 0xd8bd4fdab61863c5ULL) + \
+     CIRF_HASH_LIT_(s, 117, 0x33df700d52459b29ULL) + \
+     CIRF_HASH_LIT_(s, 118, 0x79b776aaa7b7965dULL) + \
+     CIRF_HASH_LIT_(s, 119, 0x7dc8921b48c661a1ULL) + \
+     CIRF_HASH_LIT_(s, 120, 0xf04f4d9d2719fe35ULL) + \
+     CIRF_HASH_LIT_(s, 121, 0x643f70c192958659ULL) + \
+     CIRF_HASH_LIT_(s, 122, 0xf92bb7117011214dULL) + \
+     CIRF_HASH_LIT_(s, 123, 0xf18ed0d450cb0751ULL) + \
+     CIRF_HASH_LIT_(s, 124, 0x98e69e67449cd5a5ULL) + \
+     CIRF_HASH_LIT_(s, 125, 0xb74d0844350b7289ULL) + \
+     CIRF_HASH_LIT_(s, 126, 0x7b32406bf804c13dULL) + \
+     CIRF_HASH_LIT_(s, 127, 0x46741c4fc49f6601ULL))
+/* clang-format on */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CIRF_HASH_H */
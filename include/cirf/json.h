@@ -19,7 +19,11 @@ struct json_value {
         json_type_t type;
         union {
                 int   boolean;
-                long  number;
+                struct {
+                        long   integer;    /* Value truncated to an integer */
+                        double real;       /* Value as parsed */
+                        int    is_integer; /* No fraction or exponent, fits a long */
+                } number;
                 char *string;
                 struct {
                         json_value_t *items;
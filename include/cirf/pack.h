@@ -0,0 +1,105 @@
+/*
+ * cirf/pack.h - On-disk format of resource packs
+ *
+ * A pack is one resource set in a file of its own, written by cirf --pack
+ * and opened at run time with cirf_pack_open() from <cirf/runtime.h>, so
+ * the data never goes into the executable. The file is mapped as a whole:
+ * the runtime builds the usual cirf_folder_t/cirf_file_t tree with names,
+ * paths, MIME types, metadata strings and file data pointing into the
+ * mapping, and nothing proportional to the data size is read or copied.
+ *
+ * Layout, every table aligned to 8 bytes:
+ *
+ *   header | folders | files | metadata | mimes | hash seeds | hash entries
+ *          | filter | string pool | file data
+ *
+ * All integers are little-endian; offsets are bytes from the start of the
+ * pack. Folders are stored depth-first like the folder numbering of the
+ * pointer layout: a folder's first child follows it, and each next sibling
+ * follows the subtree of the one before. Files are stored in the order of
+ * the flat file table (see cirf_folder_t). A folder's files and children
+ * are sorted by name, as in CIRF_FOLDER_SORTED folders. String fields are
+ * offsets into the pool of NUL-terminated strings, which ends with a NUL
+ * byte. File data is aligned like the data arrays of generated sources: 32
+ * bytes for files of 32 bytes or more, 16 for files of 16 or more.
+ */
+
+#ifndef CIRF_PACK_H
+#define CIRF_PACK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CIRF_PACK_MAGIC   "CIRFPACK" /* 8 bytes, no NUL */
+#define CIRF_PACK_VERSION 1u         /* Bumped on any change to the records below */
+
+#define CIRF_PACK_NONE   0xffffffffu /* No folder (parent of the root) */
+#define CIRF_PACK_FOLDER 0x80000000u /* Hash entry refers to a folder, not a file */
+
+typedef struct cirf_pack_header {
+        char     magic[8];           /* CIRF_PACK_MAGIC */
+        uint32_t version;            /* CIRF_PACK_VERSION */
+        uint32_t header_size;        /* sizeof(cirf_pack_header_t) */
+        uint64_t pack_size;          /* Size of the whole file */
+        uint32_t folder_count;       /* Root included */
+        uint32_t file_count;
+        uint32_t metadata_count;     /* Entries of all folders and files */
+        uint32_t mime_count;
+        uint32_t hash_bucket_count;  /* 0 without a hash index */
+        uint32_t hash_entry_count;   /* Every path but the root's, or 0 */
+        uint32_t filter_block_count; /* 0 without a filter */
+        uint32_t reserved;           /* 0 */
+        uint64_t folders;            /* cirf_pack_folder_t[folder_count] */
+        uint64_t files;              /* cirf_pack_file_t[file_count] */
+        uint64_t metadata;           /* cirf_pack_meta_t[metadata_count] */
+        uint64_t mimes;              /* uint32_t[mime_count]: strings, MIME ID - 1 */
+        uint64_t hash_seeds;         /* int32_t[hash_bucket_count], as cirf_index_t */
+        uint64_t hash_entries;       /* uint32_t[hash_entry_count] in slot order */
+        uint64_t filter;             /* uint64_t[filter_block_count * CIRF_BLOOM_WORDS] */
+        uint64_t strings;            /* String pool */
+        uint64_t strings_size;       /* Bytes in the pool */
+        uint64_t data;               /* First byte of file data */
+        uint64_t data_size;          /* Bytes from data to the end of the pack */
+} cirf_pack_header_t;
+
+typedef struct cirf_pack_folder {
+        uint32_t name;              /* Name ("" for the root) */
+        uint32_t path;              /* Full virtual path */
+        uint32_t parent;            /* Parent folder, CIRF_PACK_NONE for the root */
+        uint32_t child_count;       /* Number of child folders */
+        uint32_t tree_folder_count; /* Number of folders below this one */
+        uint32_t files;             /* First own file; the subtree's files follow */
+        uint32_t file_count;        /* Number of own files */
+        uint32_t tree_file_count;   /* Number of files in the subtree */
+        uint32_t metadata;          /* First entry, sorted by key ID */
+        uint32_t metadata_count;    /* Number of entries */
+} cirf_pack_folder_t;
+
+typedef struct cirf_pack_file {
+        uint64_t data;           /* Offset of the file data */
+        uint64_t size;           /* File size in bytes */
+        uint32_t name;           /* Name */
+        uint32_t path;           /* Full virtual path */
+        uint32_t parent;         /* Folder */
+        uint32_t mime_id;        /* 1-based index into the MIME table, 0 if unknown */
+        uint32_t metadata;       /* First entry, sorted by key ID */
+        uint32_t metadata_count; /* Number of entries */
+} cirf_pack_file_t;
+
+typedef struct cirf_pack_meta {
+        uint32_t key;     /* Key string */
+        uint32_t value;   /* Text form of the value */
+        uint32_t key_id;  /* Interned key ID, see cirf_metadata_t */
+        uint32_t type;    /* CIRF_META_* */
+        int64_t  integer; /* INT and BOOL value, REAL truncated */
+        uint64_t real;    /* Bits of the IEEE 754 double */
+} cirf_pack_meta_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CIRF_PACK_H */
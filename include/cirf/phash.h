@@ -0,0 +1,25 @@
+#ifndef CIRF_PHASH_H
+#define CIRF_PHASH_H
+
+#include "error.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Minimal perfect hash over a set of 64-bit key hashes, built with the
+ * hash-and-displace scheme. Keys are grouped into buckets by
+ * (hash % bucket_count); each bucket stores either a seed that places all of
+ * its keys into free slots via cirf_hash_mix(), or -(slot + 1) when the bucket
+ * holds a single key. The runtime side lives in src/runtime.c.
+ */
+typedef struct phash {
+        int32_t *seeds;        /* Per-bucket seed or encoded direct slot */
+        size_t   bucket_count; /* Number of buckets */
+        size_t  *slots;        /* Table slot assigned to each input key */
+        size_t   key_count;    /* Number of keys (and table slots) */
+} phash_t;
+
+cirf_error_t phash_build(const uint64_t *hashes, size_t count, phash_t **out);
+void         phash_destroy(phash_t *ph);
+
+#endif /* CIRF_PHASH_H */
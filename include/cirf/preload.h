@@ -0,0 +1,53 @@
+/*
+ * cirf/preload.h - LD_PRELOAD interposer over the mount table
+ *
+ * src/preload.c builds into a shared object that makes mounted resources
+ * look like real files to unmodified programs. Loaded with LD_PRELOAD, it
+ * intercepts the POSIX file calls (open, openat, read, pread, lseek, fstat,
+ * stat, statx, mmap, dup, fcntl, close, opendir/readdir/closedir, fopen)
+ * and serves any path under a mounted prefix straight from the embedded
+ * data. All other paths and descriptors go to the next definition
+ * (normally libc).
+ *
+ * The library is built from preload.c, runtime.c, the generated resource
+ * sources and one file that defines cirf_preload_init():
+ *
+ *   #include <cirf/preload.h>
+ *   #include <cirf/runtime.h>
+ *   #include "my_resources.h"
+ *
+ *   void cirf_preload_init(void) {
+ *       cirf_mount("/opt/app/share/", &my_resources_root);
+ *   }
+ *
+ *   $ LD_PRELOAD=./libmy_preload.so ./program
+ *
+ * An opened resource is backed by a real descriptor on /dev/null, so
+ * fcntl(), poll() and the like behave, and reads through calls that are
+ * not intercepted (readv, sendfile, calls made inside libc itself) see an
+ * empty file. Descriptors made by dup(), dup2(), dup3() and fcntl(F_DUPFD)
+ * share the resource and its position; descriptors do not survive exec.
+ * Resources are read-only: opening one for writing fails with EROFS.
+ *
+ * Linux/glibc only. Needs the mount table (no CIRF_NO_MOUNT).
+ */
+
+#ifndef CIRF_PRELOAD_H
+#define CIRF_PRELOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Mount the resource trees to serve. Defined by the program that builds
+ * the interposer; called once from the library constructor before any
+ * call is intercepted. Use cirf_mount() here.
+ */
+void cirf_preload_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CIRF_PRELOAD_H */
@@ -6,14 +6,20 @@
  * access to resources via generated symbols do not need this library.
  *
  * Configuration options (define before including):
- *   CIRF_MAX_PATH  - Maximum path length for lookups (default: 256)
+ *   CIRF_MAX_PATH  - Unused; lookups never copy the path (kept for compatibility)
  *   CIRF_NO_STDIO  - Disable FILE* functions (cirf_fopen, etc.)
+ *   CIRF_NO_FD     - Disable memfd export (cirf_open_fd, cirf_fd_path)
+ *   CIRF_NO_PACK   - Disable resource packs (cirf_pack_open, etc.)
  *   CIRF_NO_MOUNT  - Disable mount system (saves code size, avoids malloc)
+ *   CIRF_NO_THREADS - No pthreads or atomics: single-threaded mount table and
+ *                     no cirf_foreach_file_parallel()
+ *   CIRF_MAX_MOUNTS - Static mount table of this capacity (no malloc)
+ *   CIRF_COMPACT   - Layout-independent cirf_node_* names refer to the
+ *                    compact layout (sets generated with cirf --compact)
  *
  * For embedded systems (ESP32, etc.), you may want:
  *   #define CIRF_NO_STDIO
- *   #define CIRF_NO_MOUNT
- *   #define CIRF_MAX_PATH 128
+ *   #define CIRF_MAX_MOUNTS 4   (or CIRF_NO_MOUNT)
  *
  * Usage:
  *   #include <cirf/runtime.h>
@@ -25,6 +31,7 @@
 #ifndef CIRF_RUNTIME_H
 #define CIRF_RUNTIME_H
 
+#include "hash.h"
 #include "types.h"
 
 #ifndef CIRF_NO_STDIO
@@ -42,6 +49,11 @@ extern "C" {
 /*
  * Find a file by its virtual path.
  *
+ * When the root carries a generated path index (root->index), a canonical
+ * path is resolved with a single hash and one verifying compare. Other roots
+ * and non-canonical spellings (leading, trailing or doubled slashes) walk
+ * the folder tree.
+ *
  * @param root  Root folder to search from
  * @param path  Virtual path (e.g., "images/icon.png")
  * @return Pointer to file, or NULL if not found
@@ -49,7 +61,8 @@ extern "C" {
 const cirf_file_t *cirf_find_file(const cirf_folder_t *root, const char *path);
 
 /*
- * Find a folder by its virtual path.
+ * Find a folder by its virtual path. Uses the path index like
+ * cirf_find_file().
  *
  * @param root  Root folder to search from
  * @param path  Virtual path (e.g., "images/icons"), empty string for root
@@ -57,6 +70,227 @@ const cirf_file_t *cirf_find_file(const cirf_folder_t *root, const char *path);
  */
 const cirf_folder_t *cirf_find_folder(const cirf_folder_t *root, const char *path);
 
+/*
+ * Find a file by a path given as pointer and length, e.g. a slice of a
+ * network receive buffer. The path need not be NUL-terminated, is never
+ * copied and has no length limit.
+ *
+ * @param root  Root folder to search from
+ * @param path  Virtual path bytes (may be NULL if len is 0)
+ * @param len   Path length in bytes
+ * @return Pointer to file, or NULL if not found
+ */
+const cirf_file_t *cirf_find_file_n(const cirf_folder_t *root, const char *path, size_t len);
+
+/*
+ * Find a folder by a path given as pointer and length. See
+ * cirf_find_file_n().
+ *
+ * @param root  Root folder to search from
+ * @param path  Virtual path bytes (may be NULL if len is 0)
+ * @param len   Path length in bytes, 0 for root
+ * @return Pointer to folder, or NULL if not found
+ */
+const cirf_folder_t *cirf_find_folder_n(const cirf_folder_t *root, const char *path,
+                                        size_t len);
+
+/* ========================================================================
+ * Relative lookup
+ * ======================================================================== */
+
+/*
+ * Cursor for repeated lookups below one folder. It holds the path hash of
+ * the folder, so with a hash index a lookup only hashes the relative part;
+ * otherwise the walk starts at the folder rather than the root. A cursor
+ * is plain data and may be copied freely.
+ */
+typedef struct cirf_cursor {
+        const cirf_folder_t *root;     /* Root of the folder's resource set */
+        const cirf_folder_t *folder;   /* Folder lookups are relative to */
+        size_t               path_len; /* strlen(folder->path) */
+        cirf_hash_state_t    hash;     /* Hash state after "<folder path>/" */
+} cirf_cursor_t;
+
+/*
+ * Initialize a cursor on a folder.
+ *
+ * @param cur     Cursor to initialize
+ * @param folder  Folder that later lookups are relative to
+ * @return 0 on success, -1 on invalid arguments
+ */
+int cirf_cursor_init(cirf_cursor_t *cur, const cirf_folder_t *folder);
+
+/*
+ * Find a file by a path relative to the cursor's folder.
+ *
+ * @param cur   Initialized cursor
+ * @param path  Relative path bytes (e.g., "icons/app.png")
+ * @param len   Path length in bytes
+ * @return Pointer to file, or NULL if not found
+ */
+const cirf_file_t *cirf_cursor_find_file(const cirf_cursor_t *cur, const char *path,
+                                         size_t len);
+
+/*
+ * Find a folder by a path relative to the cursor's folder.
+ *
+ * @param cur   Initialized cursor
+ * @param path  Relative path bytes, length 0 for the cursor's folder
+ * @param len   Path length in bytes
+ * @return Pointer to folder, or NULL if not found
+ */
+const cirf_folder_t *cirf_cursor_find_folder(const cirf_cursor_t *cur, const char *path,
+                                             size_t len);
+
+/* ========================================================================
+ * Prefix queries
+ *
+ * These use the generated radix trie (cirf -I trie) when the root has one.
+ * None of them allocate.
+ * ======================================================================== */
+
+/*
+ * Longest-prefix match: find the deepest file or folder whose path is a
+ * component-wise prefix of `path`. For "css/theme/x.css" with folders
+ * "css" and "css/theme", the result is "css/theme". Without a trie the
+ * tree is walked one component at a time.
+ *
+ * @param root      Root folder to search from
+ * @param path      Virtual path
+ * @param consumed  Receives the length of the matched prefix (may be NULL)
+ * @return The matching entry; both members are NULL if nothing matched
+ */
+cirf_path_entry_t cirf_match_prefix(const cirf_folder_t *root, const char *path,
+                                    size_t *consumed);
+
+/*
+ * Route a path to the deepest folder whose path is a component-wise prefix
+ * of it. The remainder of the request starts at path + *consumed.
+ *
+ * @param root      Root folder to search from
+ * @param path      Virtual path
+ * @param consumed  Receives the length of the matched prefix (may be NULL)
+ * @return Deepest matching folder, or root if no folder matched
+ */
+const cirf_folder_t *cirf_match_folder(const cirf_folder_t *root, const char *path,
+                                       size_t *consumed);
+
+/*
+ * Iterator over all files whose path starts with a given string prefix.
+ * Files are returned in path order. The matching entries are one
+ * contiguous range of the trie, so iteration needs no recursion.
+ */
+typedef struct cirf_prefix_iter {
+        const cirf_path_entry_t *next;
+        const cirf_path_entry_t *end;
+} cirf_prefix_iter_t;
+
+/*
+ * Start iterating the files under a prefix (e.g., "css/", or "" for all).
+ *
+ * @param it      Iterator to initialize
+ * @param root    Root folder with a trie index
+ * @param prefix  Path prefix, matched byte for byte
+ * @return 0 on success, -1 if root has no trie index
+ */
+int cirf_prefix_iter_init(cirf_prefix_iter_t *it, const cirf_folder_t *root,
+                          const char *prefix);
+
+/*
+ * Get the next file from a prefix iterator.
+ *
+ * @param it  Iterator
+ * @return Next file, or NULL when done
+ */
+const cirf_file_t *cirf_prefix_iter_next(cirf_prefix_iter_t *it);
+
+/* ========================================================================
+ * Inverted indexes
+ *
+ * These use the generated query index (cirf -I query, on by default) of a
+ * set's root folder and return the matching files as one contiguous span.
+ * None of them allocate.
+ * ======================================================================== */
+
+/*
+ * Files matched by a query: files[ids[0]] .. files[ids[count - 1]], where
+ * files is the set's flat file table and ids are positions in it (see
+ * cirf_file_index()). Files of one posting are in table order.
+ */
+typedef struct cirf_file_span {
+        const cirf_file_t *files; /* The set's flat file table */
+        const uint32_t    *ids;   /* Positions in files */
+        size_t             count; /* Number of files */
+} cirf_file_span_t;
+
+/*
+ * Find all files with a metadata key, or with one key/value pair. Values
+ * are compared in their text form ("3600" for the number 3600). A file's
+ * first entry of a key is the one indexed.
+ *
+ * @param span   Receives the matching files (empty if none)
+ * @param root   Root folder of a resource set
+ * @param key    Metadata key
+ * @param value  Value to match, or NULL for any value
+ * @return 0 on success, -1 if root has no query index
+ */
+int cirf_query_meta(cirf_file_span_t *span, const cirf_folder_t *root, const char *key,
+                    const char *value);
+
+/*
+ * Find all files of a MIME type. A type ending in a wildcard subtype
+ * ("image/" followed by '*') matches every subtype, and a lone '*' every
+ * file.
+ *
+ * @param span  Receives the matching files (empty if none)
+ * @param root  Root folder of a resource set
+ * @param mime  MIME type, e.g. "text/css"
+ * @return 0 on success, -1 if root has no query index
+ */
+int cirf_query_mime(cirf_file_span_t *span, const cirf_folder_t *root, const char *mime);
+
+/* ========================================================================
+ * Overlays
+ *
+ * Generated by passing several configs to cirf; see cirf_overlay_t.
+ * ======================================================================== */
+
+/*
+ * Find a file in an overlay. With the generated index this is one hash
+ * and one compare, however many layers there are. Without one, the layers
+ * are searched from the last to the first.
+ *
+ * @param ov    Overlay
+ * @param path  Virtual path
+ * @return File of the highest-precedence layer that has it, or NULL
+ */
+const cirf_file_t *cirf_overlay_find_file(const cirf_overlay_t *ov, const char *path);
+
+/*
+ * Find a file in an overlay by a path given as pointer and length. See
+ * cirf_find_file_n().
+ *
+ * @param ov    Overlay
+ * @param path  Virtual path bytes (may be NULL if len is 0)
+ * @param len   Path length in bytes
+ * @return File of the highest-precedence layer that has it, or NULL
+ */
+const cirf_file_t *cirf_overlay_find_file_n(const cirf_overlay_t *ov, const char *path,
+                                            size_t len);
+
+/*
+ * Iterate over the merged view of an overlay: every path once, with the
+ * file that wins it. Generated overlays are visited in path order; for
+ * hand-written ones (files == NULL) the layers are walked from the last
+ * to the first and shadowed files are skipped.
+ *
+ * @param ov        Overlay
+ * @param callback  Function to call for each file
+ * @param ctx       User context passed to callback
+ */
+void cirf_overlay_foreach_file(const cirf_overlay_t *ov, cirf_file_callback_t callback,
+                               void *ctx);
+
 /* ========================================================================
  * Metadata functions
  * ======================================================================== */
@@ -71,6 +305,39 @@ const cirf_folder_t *cirf_find_folder(const cirf_folder_t *root, const char *pat
  */
 const char *cirf_get_metadata(const cirf_metadata_t *metadata, size_t count, const char *key);
 
+/*
+ * Get a file's metadata entry by interned key ID ({NAME}_META_<KEY> from the
+ * generated header). Constant time for the 64 most used keys of a cirf run, a
+ * binary search over the file's few entries beyond that.
+ *
+ * @param file    File to query
+ * @param key_id  Key ID
+ * @return The entry, or NULL if the file has no value for the key
+ */
+const cirf_metadata_t *cirf_file_meta(const cirf_file_t *file, uint32_t key_id);
+
+/*
+ * Get a folder's metadata entry by interned key ID. See cirf_file_meta().
+ *
+ * @param folder  Folder to query
+ * @param key_id  Key ID
+ * @return The entry, or NULL if the folder has no value for the key
+ */
+const cirf_metadata_t *cirf_folder_meta(const cirf_folder_t *folder, uint32_t key_id);
+
+/*
+ * Typed metadata values. cirf_meta_int() and cirf_meta_real() read any
+ * number or bool (a REAL truncated towards zero, a bool as 0 or 1),
+ * cirf_meta_bool() only bools. Strings are never parsed; the text of any
+ * entry is m->value.
+ *
+ * @param m         Entry, may be NULL
+ * @param fallback  Returned if m is NULL or has no value of the type
+ */
+int64_t cirf_meta_int(const cirf_metadata_t *m, int64_t fallback);
+double  cirf_meta_real(const cirf_metadata_t *m, double fallback);
+int     cirf_meta_bool(const cirf_metadata_t *m, int fallback);
+
 /* ========================================================================
  * Navigation functions
  * ======================================================================== */
@@ -97,7 +364,9 @@ const cirf_folder_t *cirf_get_root(const cirf_file_t *file);
 void cirf_foreach_file(const cirf_folder_t *folder, cirf_file_callback_t callback, void *ctx);
 
 /*
- * Iterate over all files in a folder tree (recursive).
+ * Iterate over all files in a folder tree (recursive). Files of a folder
+ * are visited before those of its subfolders. Uses a cirf_iter_t, so the
+ * stack depth does not grow with the depth of the tree.
  *
  * @param folder    Root folder to iterate from
  * @param callback  Function to call for each file
@@ -107,7 +376,8 @@ void cirf_foreach_file_recursive(const cirf_folder_t *folder, cirf_file_callback
                                  void *ctx);
 
 /*
- * Count total files in a folder tree (recursive).
+ * Count total files in a folder tree (recursive). Constant time for
+ * generated folders.
  *
  * @param folder  Root folder to count from
  * @return Total number of files
@@ -116,12 +386,483 @@ size_t cirf_count_files(const cirf_folder_t *folder);
 
 /*
  * Count total folders in a folder tree (recursive, excluding root).
+ * Constant time for generated folders.
  *
  * @param folder  Root folder to count from
  * @return Total number of folders (not including the root itself)
  */
 size_t cirf_count_folders(const cirf_folder_t *folder);
 
+/*
+ * Dense index of a file within its resource set: its position in the
+ * root's tree_files, from 0 to cirf_count_files(root) - 1. Usable as a key
+ * into caller-owned per-file arrays.
+ *
+ * @param root  Root folder of the file's resource set
+ * @param file  File of that set
+ * @return Index, or (size_t)-1 if file is not in root's flat file table
+ */
+size_t cirf_file_index(const cirf_folder_t *root, const cirf_file_t *file);
+
+/* ========================================================================
+ * Explicit iteration
+ *
+ * Pull-style alternatives to the callbacks above: the caller can stop at
+ * any point and resume later. Neither recurses nor allocates; the state
+ * is a few words that can live on the stack or in a static.
+ * ======================================================================== */
+
+/*
+ * Depth-first iterator over a folder tree. Moving back up uses the parent
+ * pointers, and the position of a folder among its siblings is found again
+ * by name (a binary search in generated folders). Use one iterator either
+ * for files or for folders.
+ */
+typedef struct cirf_iter {
+        const cirf_folder_t *top;    /* Folder the iteration started at */
+        const cirf_folder_t *folder; /* Folder being visited, NULL when done */
+        size_t               file;   /* Next file index in folder */
+        size_t               child;  /* Next child index in folder */
+} cirf_iter_t;
+
+/*
+ * Start iterating a folder tree.
+ *
+ * @param it      Iterator to initialize
+ * @param folder  Folder to iterate from (NULL gives an empty iteration)
+ */
+void cirf_iter_init(cirf_iter_t *it, const cirf_folder_t *folder);
+
+/*
+ * Get the next file, in the same order as cirf_foreach_file_recursive().
+ *
+ * @param it  Iterator
+ * @return Next file, or NULL when done
+ */
+const cirf_file_t *cirf_iter_next(cirf_iter_t *it);
+
+/*
+ * Get the next folder below the starting folder, in depth-first preorder.
+ * The starting folder itself is not returned.
+ *
+ * @param it  Iterator
+ * @return Next folder, or NULL when done
+ */
+const cirf_folder_t *cirf_iter_next_folder(cirf_iter_t *it);
+
+/*
+ * Directory entry returned by cirf_readdir(). Exactly one of file/folder
+ * is set.
+ */
+typedef struct cirf_dirent {
+        const char          *name;   /* Entry name (e.g., "icon.png") */
+        const cirf_file_t   *file;   /* File, or NULL */
+        const cirf_folder_t *folder; /* Subfolder, or NULL */
+} cirf_dirent_t;
+
+/*
+ * Directory listing handle for the immediate entries of one folder.
+ * Needs no closing.
+ */
+typedef struct cirf_dir {
+        const cirf_folder_t *folder; /* Folder being listed */
+        size_t               pos;    /* Next entry: children first, then files */
+        cirf_dirent_t        ent;    /* Storage for the last entry returned */
+} cirf_dir_t;
+
+/*
+ * Open a folder for listing.
+ *
+ * @param dir     Handle to initialize
+ * @param folder  Folder to list
+ * @return 0 on success, -1 if folder is NULL
+ */
+int cirf_opendir(cirf_dir_t *dir, const cirf_folder_t *folder);
+
+/*
+ * Get the next entry of a folder. Subfolders come first, then files; in
+ * generated folders each group is in name order.
+ *
+ * @param dir  Open handle
+ * @return Entry (valid until the next call on dir), or NULL when done
+ */
+const cirf_dirent_t *cirf_readdir(cirf_dir_t *dir);
+
+/*
+ * Restart a listing from the first entry.
+ *
+ * @param dir  Open handle
+ */
+void cirf_rewinddir(cirf_dir_t *dir);
+
+/* ========================================================================
+ * Parallel iteration
+ *
+ * Not available with CIRF_NO_THREADS.
+ * ======================================================================== */
+
+#ifndef CIRF_NO_THREADS
+
+/*
+ * Call a function for every file of a folder tree from several threads.
+ * The calling thread takes part; threads - 1 more are started and joined
+ * before returning, so every call has completed when this returns. Work
+ * moves between threads in chunks of files, so one large file does not
+ * hold up the rest. The callback must be safe to call concurrently, and
+ * files are not visited in any particular order.
+ *
+ * Hand-written trees (without CIRF_FOLDER_SUBTREE) are iterated on the
+ * calling thread, as is everything if no thread can be started.
+ *
+ * @param folder    Root folder to iterate from
+ * @param callback  Function to call for each file
+ * @param ctx       User context passed to callback
+ * @param threads   Number of threads including the caller, 0 for one per
+ *                  online CPU
+ * @return 0 on success, -1 on invalid arguments
+ */
+int cirf_foreach_file_parallel(const cirf_folder_t *folder, cirf_file_callback_t callback,
+                               void *ctx, unsigned threads);
+
+#endif /* CIRF_NO_THREADS */
+
+/* ========================================================================
+ * Compact layout
+ *
+ * Accessors for sets generated with cirf --compact (see cirf_cfile_t).
+ * Lookups walk the tree, binary-searching each folder.
+ * ======================================================================== */
+
+/*
+ * File fields. The name and MIME type are NUL-terminated.
+ *
+ * @param file  File record (not NULL)
+ */
+const char          *cirf_cfile_name(const cirf_cfile_t *file);
+const char          *cirf_cfile_mime(const cirf_cfile_t *file);
+const unsigned char *cirf_cfile_data(const cirf_cfile_t *file);
+size_t               cirf_cfile_size(const cirf_cfile_t *file);
+
+/*
+ * Get a file's metadata entry by interned key ID. See cirf_file_meta().
+ *
+ * @param file    File to query
+ * @param key_id  Key ID
+ * @return The entry, or NULL if the file has no value for the key
+ */
+const cirf_cmeta_t *cirf_cfile_meta(const cirf_cfile_t *file, uint32_t key_id);
+
+/*
+ * Folder fields. cirf_cfolder_files() returns the folder's own files,
+ * file_count of them, followed by the rest of its subtree's, for
+ * tree_file_count in all. cirf_cfolder_children() returns child_count
+ * consecutive folders.
+ *
+ * @param folder  Folder record (not NULL)
+ */
+const char           *cirf_cfolder_name(const cirf_cfolder_t *folder);
+const cirf_cfile_t   *cirf_cfolder_files(const cirf_cfolder_t *folder);
+const cirf_cfolder_t *cirf_cfolder_children(const cirf_cfolder_t *folder);
+
+/*
+ * Get a folder's metadata entry by interned key ID. See cirf_file_meta().
+ *
+ * @param folder  Folder to query
+ * @param key_id  Key ID
+ * @return The entry, or NULL if the folder has no value for the key
+ */
+const cirf_cmeta_t *cirf_cfolder_meta(const cirf_cfolder_t *folder, uint32_t key_id);
+
+/*
+ * Metadata entry fields. The key and the text of the value are
+ * NUL-terminated; the typed values read like cirf_meta_int() and friends.
+ *
+ * @param m  Entry (not NULL for the strings, may be NULL for typed values)
+ */
+const char *cirf_cmeta_key(const cirf_cmeta_t *m);
+const char *cirf_cmeta_value(const cirf_cmeta_t *m);
+int64_t     cirf_cmeta_int(const cirf_cmeta_t *m, int64_t fallback);
+double      cirf_cmeta_real(const cirf_cmeta_t *m, double fallback);
+int         cirf_cmeta_bool(const cirf_cmeta_t *m, int fallback);
+
+/*
+ * Find a file by its virtual path. Extra slashes are ignored.
+ *
+ * @param root  Root folder to search from (&{name}_root)
+ * @param path  Virtual path (e.g., "images/icon.png")
+ * @return Pointer to file, or NULL if not found
+ */
+const cirf_cfile_t *cirf_compact_find_file(const cirf_cfolder_t *root, const char *path);
+
+/*
+ * Find a folder by its virtual path.
+ *
+ * @param root  Root folder to search from (&{name}_root)
+ * @param path  Virtual path (e.g., "images/icons"), empty string for root
+ * @return Pointer to folder, or NULL if not found
+ */
+const cirf_cfolder_t *cirf_compact_find_folder(const cirf_cfolder_t *root, const char *path);
+
+/*
+ * Iterate over the files of a folder, or of its whole subtree (the
+ * folder's own files first, then each child subtree in turn).
+ *
+ * @param folder    Folder to iterate
+ * @param callback  Function to call for each file
+ * @param ctx       User context passed to callback
+ */
+void cirf_compact_foreach_file(const cirf_cfolder_t *folder, cirf_cfile_callback_t callback,
+                               void *ctx);
+void cirf_compact_foreach_file_recursive(const cirf_cfolder_t *folder,
+                                         cirf_cfile_callback_t callback, void *ctx);
+
+/* ========================================================================
+ * Layout-independent access
+ *
+ * Code that uses these names builds against sets of either layout: define
+ * CIRF_COMPACT (before including this header) when the sets are generated
+ * with cirf --compact. Roots are &{name}_root and files {name}_file_* in
+ * both layouts.
+ * ======================================================================== */
+
+#ifdef CIRF_COMPACT
+
+typedef cirf_cfile_t          cirf_node_file_t;
+typedef cirf_cfolder_t        cirf_node_folder_t;
+typedef cirf_cmeta_t          cirf_node_meta_t;
+typedef cirf_cfile_callback_t cirf_node_callback_t;
+
+static inline const cirf_node_file_t *cirf_node_find_file(const cirf_node_folder_t *root,
+                                                          const char *path) {
+    return cirf_compact_find_file(root, path);
+}
+
+static inline const cirf_node_folder_t *cirf_node_find_folder(const cirf_node_folder_t *root,
+                                                              const char *path) {
+    return cirf_compact_find_folder(root, path);
+}
+
+static inline const char *cirf_node_file_name(const cirf_node_file_t *file) {
+    return cirf_cfile_name(file);
+}
+
+static inline const char *cirf_node_file_mime(const cirf_node_file_t *file) {
+    return cirf_cfile_mime(file);
+}
+
+static inline const unsigned char *cirf_node_file_data(const cirf_node_file_t *file) {
+    return cirf_cfile_data(file);
+}
+
+static inline const cirf_node_meta_t *cirf_node_file_meta(const cirf_node_file_t *file,
+                                                          uint32_t key_id) {
+    return cirf_cfile_meta(file, key_id);
+}
+
+static inline const char *cirf_node_meta_value(const cirf_node_meta_t *m) {
+    return cirf_cmeta_value(m);
+}
+
+static inline int64_t cirf_node_meta_int(const cirf_node_meta_t *m, int64_t fallback) {
+    return cirf_cmeta_int(m, fallback);
+}
+
+static inline double cirf_node_meta_real(const cirf_node_meta_t *m, double fallback) {
+    return cirf_cmeta_real(m, fallback);
+}
+
+static inline int cirf_node_meta_bool(const cirf_node_meta_t *m, int fallback) {
+    return cirf_cmeta_bool(m, fallback);
+}
+
+static inline const char *cirf_node_folder_name(const cirf_node_folder_t *folder) {
+    return cirf_cfolder_name(folder);
+}
+
+static inline void cirf_node_foreach_file(const cirf_node_folder_t *folder,
+                                          cirf_node_callback_t callback, void *ctx) {
+    cirf_compact_foreach_file_recursive(folder, callback, ctx);
+}
+
+static inline size_t cirf_node_count_files(const cirf_node_folder_t *folder) {
+    return folder->tree_file_count;
+}
+
+#else
+
+typedef cirf_file_t          cirf_node_file_t;
+typedef cirf_folder_t        cirf_node_folder_t;
+typedef cirf_metadata_t      cirf_node_meta_t;
+typedef cirf_file_callback_t cirf_node_callback_t;
+
+static inline const cirf_node_file_t *cirf_node_find_file(const cirf_node_folder_t *root,
+                                                          const char *path) {
+    return cirf_find_file(root, path);
+}
+
+static inline const cirf_node_folder_t *cirf_node_find_folder(const cirf_node_folder_t *root,
+                                                              const char *path) {
+    return cirf_find_folder(root, path);
+}
+
+static inline const char *cirf_node_file_name(const cirf_node_file_t *file) {
+    return file->name;
+}
+
+static inline const char *cirf_node_file_mime(const cirf_node_file_t *file) {
+    return file->mime;
+}
+
+static inline const unsigned char *cirf_node_file_data(const cirf_node_file_t *file) {
+    return file->data;
+}
+
+static inline const cirf_node_meta_t *cirf_node_file_meta(const cirf_node_file_t *file,
+                                                          uint32_t key_id) {
+    return cirf_file_meta(file, key_id);
+}
+
+static inline const char *cirf_node_meta_value(const cirf_node_meta_t *m) {
+    return m->value;
+}
+
+static inline int64_t cirf_node_meta_int(const cirf_node_meta_t *m, int64_t fallback) {
+    return cirf_meta_int(m, fallback);
+}
+
+static inline double cirf_node_meta_real(const cirf_node_meta_t *m, double fallback) {
+    return cirf_meta_real(m, fallback);
+}
+
+static inline int cirf_node_meta_bool(const cirf_node_meta_t *m, int fallback) {
+    return cirf_meta_bool(m, fallback);
+}
+
+static inline const char *cirf_node_folder_name(const cirf_node_folder_t *folder) {
+    return folder->name;
+}
+
+static inline void cirf_node_foreach_file(const cirf_node_folder_t *folder,
+                                          cirf_node_callback_t callback, void *ctx) {
+    cirf_foreach_file_recursive(folder, callback, ctx);
+}
+
+static inline size_t cirf_node_count_files(const cirf_node_folder_t *folder) {
+    return cirf_count_files(folder);
+}
+
+#endif /* CIRF_COMPACT */
+
+/* Size and MIME type ID are plain fields of both layouts */
+static inline size_t cirf_node_file_size(const cirf_node_file_t *file) {
+    return file->size;
+}
+
+static inline uint32_t cirf_node_file_mime_id(const cirf_node_file_t *file) {
+    return file->mime_id;
+}
+
+/* ========================================================================
+ * Streams
+ *
+ * A cirf_stream_t reads an embedded file in place. It is plain data that
+ * lives wherever the caller puts it, usually the stack: opening one never
+ * allocates, and reading takes no locks and needs no stdio, so streams work
+ * where fmemopen() does not exist. Data is never copied unless asked for:
+ * cirf_stream_peek() and cirf_stream_readline() return views into the file.
+ * A stream may be copied freely; each copy has its own position.
+ * ======================================================================== */
+
+typedef struct cirf_stream {
+        const unsigned char *data; /* File contents */
+        size_t               size; /* File size in bytes */
+        size_t               pos;  /* Read position, 0..size */
+} cirf_stream_t;
+
+/* cirf_stream_seek() origins */
+#define CIRF_SEEK_SET 0 /* Start of the file */
+#define CIRF_SEEK_CUR 1 /* Current position */
+#define CIRF_SEEK_END 2 /* End of the file */
+
+/*
+ * Open a stream on an embedded file.
+ *
+ * @param stream  Stream to initialize
+ * @param file    File to read
+ * @return 0 on success, -1 on invalid arguments
+ */
+int cirf_stream_open(cirf_stream_t *stream, const cirf_file_t *file);
+
+/*
+ * Open a stream on any bytes, e.g. cirf_cfile_data() of a compact file.
+ *
+ * @param stream  Stream to initialize
+ * @param data    Bytes to read (may be NULL if size is 0)
+ * @param size    Number of bytes
+ */
+void cirf_stream_init(cirf_stream_t *stream, const void *data, size_t size);
+
+/*
+ * Copy up to size bytes from the current position and advance past them.
+ *
+ * @param stream  Open stream
+ * @param buf     Destination
+ * @param size    Maximum number of bytes
+ * @return Number of bytes copied, 0 at the end of the file
+ */
+size_t cirf_stream_read(cirf_stream_t *stream, void *buf, size_t size);
+
+/*
+ * Move the read position to offset bytes from origin. Positions outside
+ * the file are rejected and leave the position unchanged.
+ *
+ * @param stream  Open stream
+ * @param offset  Offset from origin, may be negative
+ * @param origin  CIRF_SEEK_SET, CIRF_SEEK_CUR or CIRF_SEEK_END
+ * @return 0 on success, -1 on invalid origin or position
+ */
+int cirf_stream_seek(cirf_stream_t *stream, int64_t offset, int origin);
+
+/*
+ * Current read position, in bytes from the start of the file.
+ */
+size_t cirf_stream_tell(const cirf_stream_t *stream);
+
+/*
+ * Non-zero once the read position has reached the end of the file.
+ */
+int cirf_stream_eof(const cirf_stream_t *stream);
+
+/*
+ * View of the bytes from the read position to the end of the file, which
+ * are always contiguous. The position does not move; consume what was
+ * parsed with cirf_stream_seek(stream, n, CIRF_SEEK_CUR).
+ *
+ * @param stream  Open stream
+ * @param len     Receives the number of bytes in view
+ * @return Pointer to the next byte (not NUL-terminated)
+ */
+const unsigned char *cirf_stream_peek(const cirf_stream_t *stream, size_t *len);
+
+/*
+ * Read the next line without copying it: the view runs through the next
+ * '\n', which is included, or to the end of the file.
+ *
+ * @param stream  Open stream
+ * @param len     Receives the line length in bytes
+ * @return Pointer to the line (not NUL-terminated), or NULL at the end of the file
+ *
+ * Example:
+ *   cirf_stream_t s;
+ *   cirf_stream_open(&s, f);
+ *   const char *line;
+ *   size_t len;
+ *   while ((line = cirf_stream_readline(&s, &len))) {
+ *       printf("%.*s", (int)len, line);
+ *   }
+ */
+const char *cirf_stream_readline(cirf_stream_t *stream, size_t *len);
+
 /* ========================================================================
  * Standard I/O compatibility (POSIX)
  *
@@ -168,15 +909,110 @@ FILE *cirf_fopen(const cirf_file_t *file);
  */
 FILE *cirf_fopen_path(const cirf_folder_t *root, const char *path);
 
+/*
+ * FILE* view of a stream, for libraries that only take FILE*. Reads and
+ * seeks go through the stream, which must stay valid until fclose(). Only
+ * the FILE itself is allocated. Needs fopencookie() (glibc) or funopen()
+ * (BSD, macOS); NULL elsewhere.
+ *
+ * @param stream  Open stream
+ * @return FILE* for reading, or NULL on error or if unsupported
+ */
+FILE *cirf_stream_fopen(cirf_stream_t *stream);
+
 #endif /* CIRF_NO_STDIO */
 
+/* ========================================================================
+ * File descriptors (Linux)
+ *
+ * For consumers that only take a file descriptor or a path (decoders,
+ * sqlite, dlopen). The first request for a file copies it into a memfd
+ * sealed against writes and resizing; the memfd stays open for the life
+ * of the process, so each file is materialized at most once and nothing
+ * is written to disk. Thread-safe unless CIRF_NO_THREADS is defined.
+ * Other platforms, and builds with CIRF_NO_FD, get -1.
+ * ======================================================================== */
+
+#ifndef CIRF_NO_FD
+
+/*
+ * Open a read-only file descriptor on an embedded file. Each call returns
+ * a new descriptor with its own file offset, which the caller must close().
+ * It is close-on-exec; clear FD_CLOEXEC to pass it to a child process.
+ *
+ * @param file  Embedded file
+ * @return File descriptor, or -1 on error (errno is set)
+ */
+int cirf_open_fd(const cirf_file_t *file);
+
+/*
+ * Path of an embedded file for path-only APIs: "/proc/self/fd/<n>" of the
+ * cached memfd. Valid for the life of the process, in this process only.
+ *
+ * @param file  Embedded file
+ * @param buf   Receives the NUL-terminated path
+ * @param size  Size of buf (CIRF_FD_PATH_MAX is always enough)
+ * @return 0 on success, -1 on error or if buf is too small
+ */
+int cirf_fd_path(const cirf_file_t *file, char *buf, size_t size);
+
+#define CIRF_FD_PATH_MAX 32
+
+#endif /* CIRF_NO_FD */
+
+/* ========================================================================
+ * Resource packs
+ *
+ * A pack (written by cirf --pack, see <cirf/pack.h>) keeps a set's data
+ * out of the executable. cirf_pack_open() maps the file read-only and
+ * builds the folder and file structures over the mapping, so the root it
+ * returns works with every function above and with cirf_mount(). Names,
+ * metadata strings and file data are not copied: processes opening the
+ * same pack share its pages through the page cache, and opening takes time
+ * and memory in proportion to the number of files and folders, not to
+ * their size. Needs mmap(); other platforms get NULL (errno ENOSYS).
+ * ======================================================================== */
+
+#ifndef CIRF_NO_PACK
+
+typedef struct cirf_pack cirf_pack_t;
+
+/*
+ * Open and map a pack file. Every count, offset and reference in the file
+ * is checked, so a damaged or foreign file is refused rather than read out
+ * of bounds.
+ *
+ * @param path  Pack file
+ * @return Open pack, or NULL on error (errno is set; EINVAL if the file is
+ *         not a pack of this format version)
+ */
+cirf_pack_t *cirf_pack_open(const char *path);
+
+/*
+ * Root folder of an open pack, with the pack's hash and filter indexes.
+ * It and everything reached from it stay valid until cirf_pack_close().
+ */
+const cirf_folder_t *cirf_pack_root(const cirf_pack_t *pack);
+
+/*
+ * Unmap a pack and free its structures. Unmount it first if it was
+ * mounted. NULL is ignored.
+ */
+void cirf_pack_close(cirf_pack_t *pack);
+
+#endif /* CIRF_NO_PACK */
+
 /* ========================================================================
  * Virtual filesystem mount (advanced)
  *
  * For applications that need to intercept file operations, this provides
  * a mechanism to register CIRF resources under a virtual path prefix.
  *
- * Note: Uses malloc/free. Define CIRF_NO_MOUNT to disable for embedded.
+ * The global table uses malloc/free unless CIRF_MAX_MOUNTS is defined, in
+ * which case it is a static table of that capacity. Tables with
+ * caller-provided storage never allocate. Lookups are lock-free; define
+ * CIRF_NO_THREADS for single-threaded builds without atomics or pthreads.
+ * Define CIRF_NO_MOUNT to remove the mount system entirely.
  * ======================================================================== */
 
 #ifndef CIRF_NO_MOUNT
@@ -185,28 +1021,79 @@ FILE *cirf_fopen_path(const cirf_folder_t *root, const char *path);
  * Mounted filesystem entry.
  */
 typedef struct cirf_mount {
-        const char          *prefix; /* Path prefix (e.g., "/assets/") */
-        const cirf_folder_t *root;   /* Resource root */
-        struct cirf_mount   *next;   /* Next mount in chain */
+        const char          *prefix;     /* Path prefix (e.g., "/assets/") */
+        size_t               prefix_len; /* strlen(prefix) */
+        const cirf_folder_t *root;       /* Resource root */
 } cirf_mount_t;
 
 /*
- * Global mount list head (for applications managing multiple resource sets).
- * Applications can maintain their own mount lists instead of using this.
+ * Mount table with caller-provided storage. Entries are kept sorted by
+ * prefix length, longest first. These functions never allocate and do no
+ * locking; a table shared between threads must be protected by the caller.
+ */
+typedef struct cirf_mount_table {
+        cirf_mount_t *mounts;   /* Caller-provided storage */
+        size_t        count;    /* Entries in use */
+        size_t        capacity; /* Entries available */
+} cirf_mount_table_t;
+
+/*
+ * Initialize an empty table on caller-provided storage.
+ *
+ * @param table     Table to initialize
+ * @param storage   Array of at least `capacity` entries
+ * @param capacity  Number of entries in storage
+ */
+void cirf_mount_table_init(cirf_mount_table_t *table, cirf_mount_t *storage, size_t capacity);
+
+/*
+ * Add a mount to a table. Mounting a prefix that is already mounted
+ * replaces its root. The prefix string is not copied.
+ *
+ * @param table   Table to modify
+ * @param prefix  Path prefix (should end with '/')
+ * @param root    Resource root folder
+ * @return 0 on success, -1 if the table is full
+ */
+int cirf_mount_table_add(cirf_mount_table_t *table, const char *prefix,
+                         const cirf_folder_t *root);
+
+/*
+ * Remove a mount from a table.
+ *
+ * @param table   Table to modify
+ * @param prefix  Path prefix to unmount
+ * @return 0 on success, -1 if not found
  */
-extern cirf_mount_t *cirf_mounts;
+int cirf_mount_table_remove(cirf_mount_table_t *table, const char *prefix);
 
 /*
- * Mount a resource tree under a path prefix.
+ * Find a file through a table. The longest matching prefix wins.
+ *
+ * @param table  Table to search
+ * @param path   Full path including mount prefix
+ * @return File if found, NULL otherwise
+ */
+const cirf_file_t *cirf_mount_table_resolve(const cirf_mount_table_t *table, const char *path);
+
+/*
+ * Mount a resource tree under a path prefix. Mounting a prefix that is
+ * already mounted replaces its root. The prefix string is not copied and
+ * must stay valid until it is unmounted.
+ *
+ * Safe to call while other threads resolve paths; concurrent mount and
+ * unmount calls are serialized.
  *
  * @param prefix  Path prefix (should end with '/')
  * @param root    Resource root folder
- * @return 0 on success, -1 on error (allocation failure)
+ * @return 0 on success, -1 on error (allocation failure, or more than
+ *         CIRF_MAX_MOUNTS prefixes with a static table)
  */
 int cirf_mount(const char *prefix, const cirf_folder_t *root);
 
 /*
- * Unmount a resource tree.
+ * Unmount a resource tree. Returns once no thread can still be reading the
+ * previous mount table.
  *
  * @param prefix  Path prefix to unmount
  * @return 0 on success, -1 if not found
@@ -214,13 +1101,28 @@ int cirf_mount(const char *prefix, const cirf_folder_t *root);
 int cirf_unmount(const char *prefix);
 
 /*
- * Find a file across all mounted filesystems.
+ * Find a file across all mounted filesystems. When several prefixes match,
+ * the longest one wins.
+ *
+ * Never takes a lock, so any number of threads can resolve concurrently
+ * (unless built with CIRF_NO_THREADS). The first call on a thread
+ * registers a per-thread reader record.
  *
  * @param path  Full path including mount prefix
  * @return File if found, NULL otherwise
  */
 const cirf_file_t *cirf_resolve_file(const char *path);
 
+/*
+ * Find a folder across all mounted filesystems. A mount prefix without its
+ * trailing '/' names the mounted root, and a trailing '/' on the path is
+ * ignored. Lock-free like cirf_resolve_file().
+ *
+ * @param path  Full path including mount prefix
+ * @return Folder if found, NULL otherwise
+ */
+const cirf_folder_t *cirf_resolve_folder(const char *path);
+
 /*
  * Open a file across all mounted filesystems.
  *
@@ -0,0 +1,36 @@
+#ifndef CIRF_TRIE_H
+#define CIRF_TRIE_H
+
+#include "error.h"
+#include <stddef.h>
+
+/*
+ * Read-only radix trie over a sorted set of keys, laid out in DFS preorder.
+ * The subtree of node i is the node range [i, end) and, because keys are
+ * sorted, the keys below it form the contiguous range [entry_first,
+ * entry_end) of the input array. Children follow their parent in label
+ * order; the next sibling of node c is node c.end.
+ */
+typedef struct trie_node {
+        size_t label;       /* Offset of the edge label in the label pool */
+        size_t label_len;   /* Edge label length (0 for the root only) */
+        int    terminal;    /* A key ends at this node (it is entry_first) */
+        size_t end;         /* One past the last node of the subtree */
+        size_t entry_first; /* First key of the subtree */
+        size_t entry_end;   /* One past the last key of the subtree */
+} trie_node_t;
+
+typedef struct trie {
+        trie_node_t *nodes;
+        size_t       node_count;
+        size_t       node_cap;
+        char        *labels; /* Label pool (not NUL-terminated) */
+        size_t       labels_len;
+        size_t       labels_cap;
+} trie_t;
+
+/* Keys must be sorted in byte order and unique */
+cirf_error_t trie_build(const char *const *keys, size_t count, trie_t **out);
+void         trie_destroy(trie_t *trie);
+
+#endif /* CIRF_TRIE_H */
@@ -10,23 +10,56 @@
 #define CIRF_TYPES_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * Layout version of the structures below. Generated headers check it so that
+ * sources produced by one cirf version are never compiled against the types
+ * of another. Bumped whenever a field is added, removed or reordered.
+ */
+#define CIRF_ABI_VERSION 9
+
+/*
+ * cirf_folder_t flags.
+ */
+#define CIRF_FOLDER_SORTED  0x1u /* files[] and children[] are sorted by name */
+#define CIRF_FOLDER_SUBTREE 0x2u /* tree_files and the tree counts are set */
+
+/*
+ * cirf_metadata_t value types, from the JSON type of the value.
+ */
+#define CIRF_META_STRING 0u
+#define CIRF_META_INT    1u /* JSON number without fraction or exponent */
+#define CIRF_META_REAL   2u /* Any other JSON number */
+#define CIRF_META_BOOL   3u
+
 /*
  * Metadata key-value pair.
+ *
+ * Generated keys are interned: key_id indexes the key table of the
+ * generated header ({NAME}_META_<KEY>), shared by all sets of one cirf run.
+ * A file's or folder's entries are sorted by key_id, each key once, and
+ * metadata_keys has bit k set when key ID k (k < 64) is present, so an entry
+ * is found by ID in constant time (see cirf_file_meta()).
  */
 typedef struct cirf_metadata {
         const char *key;
-        const char *value;
+        const char *value;   /* Text form, also of numbers and bools */
+        uint32_t    key_id;  /* Interned key ID */
+        uint32_t    type;    /* CIRF_META_* */
+        int64_t     integer; /* INT and BOOL value, REAL truncated */
+        double      real;    /* Numeric value */
 } cirf_metadata_t;
 
 /*
- * Forward declaration for folder type.
+ * Forward declarations for folder and index types.
  */
 typedef struct cirf_folder cirf_folder_t;
+typedef struct cirf_index  cirf_index_t;
 
 /*
  * Embedded file entry.
@@ -34,16 +67,26 @@ typedef struct cirf_folder cirf_folder_t;
 typedef struct cirf_file {
         const char            *name;   /* Filename only (e.g., "icon.png") */
         const char            *path;   /* Full virtual path (e.g., "images/icon.png") */
-        const char            *mime;   /* MIME type (e.g., "image/png") */
+        const char            *mime;   /* MIME type (e.g., "image/png"), shared per type */
         const unsigned char   *data;   /* Raw file data */
         size_t                 size;   /* File size in bytes */
         const cirf_folder_t   *parent; /* Parent folder */
         const cirf_metadata_t *metadata;
         size_t                 metadata_count;
+        uint64_t               metadata_keys; /* Bit k: key ID k is present */
+        uint32_t               name_len; /* strlen(name) */
+        uint32_t               mime_id;  /* {NAME}_MIME_<TYPE>, 0 if unknown */
+        uint64_t               name_fp;  /* cirf_name_fp() of name */
 } cirf_file_t;
 
 /*
  * Virtual folder/directory.
+ *
+ * Generated sets keep all files in one flat array in depth-first order: a
+ * folder's own files, then the files of each child subtree in turn. files[]
+ * and tree_files[] are slices of that array, so the files of a whole
+ * subtree are contiguous. The root's tree_files is the start of the array,
+ * and a file's position there is a dense index (see cirf_file_index()).
  */
 struct cirf_folder {
         const char            *name;        /* Folder name only (e.g., "images") */
@@ -55,12 +98,219 @@ struct cirf_folder {
         size_t                 file_count;  /* Number of files */
         const cirf_metadata_t *metadata;
         size_t                 metadata_count;
+        uint64_t               metadata_keys; /* Bit k: key ID k is present */
+        const cirf_index_t    *index;       /* Lookup indexes (root only, may be NULL) */
+        const cirf_file_t     *tree_files;  /* All files of the subtree, this folder's first */
+        size_t                 tree_file_count;   /* Number of files in the subtree */
+        size_t                 tree_folder_count; /* Number of folders below this one */
+        uint32_t               name_len;    /* strlen(name) */
+        uint32_t               flags;       /* CIRF_FOLDER_* flags */
+        uint64_t               name_fp;     /* cirf_name_fp() of name */
+};
+
+/*
+ * One virtual path in a resource set. Exactly one of file/folder is set.
+ */
+typedef struct cirf_path_entry {
+        const cirf_file_t   *file;
+        const cirf_folder_t *folder;
+} cirf_path_entry_t;
+
+/*
+ * Radix trie node. Nodes are stored in DFS preorder: the subtree of node i
+ * is [i, end), its first child (if any) is i + 1 and the sibling after
+ * child c is c.end. Children are ordered by label.
+ */
+typedef struct cirf_trie_node {
+        uint32_t label;       /* Offset of the edge label in trie_labels */
+        uint16_t label_len;   /* Edge label length in bytes */
+        uint16_t terminal;    /* Non-zero if a path ends here (entry_first) */
+        uint32_t end;         /* One past the last node of the subtree */
+        uint32_t entry_first; /* First trie entry below this node */
+        uint32_t entry_end;   /* One past the last trie entry below this node */
+} cirf_trie_node_t;
+
+/*
+ * Inverted index posting: the files that share one metadata key/value pair
+ * or one MIME type. Their positions in the set's flat file table (see
+ * cirf_file_index()) are query_files[first .. first + count), ascending.
+ */
+typedef struct cirf_posting {
+        const char *key;   /* Metadata key; NULL in MIME postings */
+        const char *value; /* Metadata value (text form), or MIME type */
+        uint32_t    first; /* First file in query_files */
+        uint32_t    count; /* Number of files */
+} cirf_posting_t;
+
+/*
+ * Hot lookup arrays: what a path walk reads of cirf_folder_t and cirf_file_t,
+ * split out into dense parallel arrays. A folder's binary search touches only
+ * its slice of fingerprints, 8 per cache line. Names sharing their first 8
+ * bytes are told apart by their tails, the fingerprints of bytes 8-15, and
+ * lengths are read once both match. Names are only read when they share 16
+ * bytes, and the structures themselves ("cold" data) not until the walk has
+ * found its target.
+ *
+ * Folders are numbered breadth-first from the root (0), so the children of
+ * a folder are consecutive, and files by their position in the set's flat
+ * file table (see cirf_file_index()). Within a range, entries are sorted
+ * by name as in CIRF_FOLDER_SORTED folders.
+ */
+typedef struct cirf_hot_range {
+        uint32_t child_first; /* First child folder */
+        uint32_t child_count; /* Number of child folders */
+        uint32_t file_first;  /* First own file */
+        uint32_t file_count;  /* Number of own files */
+} cirf_hot_range_t;
+
+typedef struct cirf_hot {
+        const uint64_t              *folder_fps;    /* cirf_name_fp() of each name */
+        const uint64_t              *folder_tails;  /* Fingerprints of bytes 8-15, or 0 */
+        const uint32_t              *folder_lens;   /* Name lengths */
+        const uint32_t              *folder_names;  /* Name offsets in names */
+        const cirf_hot_range_t      *folder_ranges; /* Children and own files */
+        const cirf_folder_t * const *folders;       /* Cold structures (root first) */
+        size_t                       folder_count;  /* Number of folders, root included */
+        const uint64_t              *file_fps;      /* cirf_name_fp() of each name */
+        const uint64_t              *file_tails;    /* Fingerprints of bytes 8-15, or 0 */
+        const uint32_t              *file_lens;     /* Name lengths */
+        const uint32_t              *file_names;    /* Name offsets in names */
+        size_t                       file_count;    /* Number of files */
+        const char                  *names;         /* Pool of NUL-terminated names */
+} cirf_hot_t;
+
+/*
+ * Per-resource-set lookup indexes, generated next to the root folder.
+ * Each index is optional; unused members are NULL/0.
+ *
+ * The hash index is a minimal perfect hash over the full virtual path of
+ * every file and folder (the root itself excluded). A path is hashed with
+ * cirf_hash_bytes() from <cirf/hash.h>; hash_seeds[hash % hash_bucket_count]
+ * is either a seed for cirf_hash_mix() selecting the slot, or -(slot + 1).
+ * The entry in that slot is the only candidate and must be verified.
+ *
+ * The trie index is a radix trie over the same paths. Its entries are sorted
+ * by path, so every prefix maps to one contiguous range of trie_entries.
+ *
+ * The filter is a blocked Bloom filter over the paths of all files (see
+ * <cirf/hash.h>). A path it rejects is certainly not a file of the set.
+ *
+ * The query index inverts file metadata and MIME types. Postings are sorted
+ * and their file lists are laid out in posting order, metadata first, so
+ * all files with one key, or with MIME types under one prefix ("image/"),
+ * form one contiguous run of query_files.
+ *
+ * The hot arrays (see cirf_hot_t) speed up tree walks from the root: lookups
+ * without a hash or trie index, and paths not in canonical form.
+ */
+struct cirf_index {
+        const int32_t           *hash_seeds;        /* Per-bucket seeds */
+        size_t                   hash_bucket_count; /* Number of buckets */
+        const cirf_path_entry_t *hash_entries;      /* Entries in slot order */
+        size_t                   hash_entry_count;  /* Number of entries */
+        const cirf_trie_node_t  *trie_nodes;        /* Node 0 is the root */
+        size_t                   trie_node_count;   /* Number of nodes */
+        const char              *trie_labels;       /* Edge label pool */
+        const cirf_path_entry_t *trie_entries;      /* Entries in path order */
+        size_t                   trie_entry_count;  /* Number of entries */
+        const uint64_t          *filter;            /* Bloom filter blocks */
+        size_t                   filter_block_count; /* Number of blocks */
+        const cirf_posting_t    *meta_postings;     /* Sorted by key, then value */
+        size_t                   meta_posting_count; /* Number of metadata postings */
+        const cirf_posting_t    *mime_postings;     /* Sorted by MIME type */
+        size_t                   mime_posting_count; /* Number of MIME postings */
+        const uint32_t          *query_files;       /* File lists of all postings */
+        const cirf_hot_t        *hot;               /* Hot lookup arrays */
 };
 
+/*
+ * Overlay of several resource sets ("layers"), generated by passing several
+ * configs to cirf. A path resolves to the file of the last layer that has
+ * it. The index is built over the winning files only, and files[] lists
+ * them in path order, so each path appears once.
+ */
+typedef struct cirf_overlay {
+        const cirf_folder_t * const *layers;      /* Layer roots, lowest precedence first */
+        size_t                       layer_count; /* Number of layers */
+        const cirf_index_t          *index;       /* Index over the winners (may be NULL) */
+        const cirf_file_t * const   *files;       /* Winning files in path order */
+        size_t                       file_count;  /* Number of winning files */
+} cirf_overlay_t;
+
+/*
+ * Compact layout, generated by cirf --compact for targets where the
+ * structures above cost too much. A set is one image object holding its
+ * folders, files, metadata, a string pool and one blob of all file data.
+ * Records refer into the image through 32-bit self-relative offsets: field
+ * x refers to (const char *)&x + x. Parent pointers, full paths, name keys
+ * and lookup indexes are left out. Read records through the cirf_cfile_*()
+ * and cirf_cfolder_*() accessors of <cirf/runtime.h>.
+ *
+ * Folders are stored breadth-first, so the children of a folder are
+ * consecutive records. Files are stored depth-first as in the pointer
+ * layout, so the files of a subtree are consecutive as well. Metadata
+ * entries are cirf_cmeta_t, whose key and value are self-relative offsets
+ * into the string pool like every other reference, so an image needs no
+ * relocations at all.
+ */
+typedef struct cirf_cfile {
+        int32_t  name;           /* Name, NUL-terminated */
+        int32_t  mime;           /* MIME type, NUL-terminated */
+        int32_t  data;           /* Raw file data */
+        uint32_t size;           /* File size in bytes */
+        int32_t  metadata;       /* Entries, sorted by key ID */
+        uint16_t metadata_count; /* Number of entries */
+        uint16_t mime_id;        /* {NAME}_MIME_<TYPE> */
+} cirf_cfile_t;
+
+typedef struct cirf_cfolder {
+        int32_t  name;              /* Name, NUL-terminated ("" for the root) */
+        int32_t  files;             /* First own file; the subtree's files follow */
+        uint32_t file_count;        /* Number of own files */
+        uint32_t tree_file_count;   /* Number of files in the subtree */
+        int32_t  children;          /* First child folder */
+        uint32_t child_count;       /* Number of child folders */
+        uint32_t tree_folder_count; /* Number of folders below this one */
+        int32_t  metadata;          /* Entries, sorted by key ID */
+        uint32_t metadata_count;    /* Number of entries */
+} cirf_cfolder_t;
+
+typedef struct cirf_cmeta {
+        int32_t  key;     /* Key, NUL-terminated */
+        int32_t  value;   /* Text form of the value, NUL-terminated */
+        uint32_t key_id;  /* Interned key ID */
+        uint32_t type;    /* CIRF_META_* */
+        int64_t  integer; /* INT and BOOL value, REAL truncated */
+        double   real;    /* Numeric value */
+} cirf_cmeta_t;
+
+/*
+ * Self-relative offset from member `from` to member `to` of the image type
+ * T, as used in the initializers of generated compact images.
+ */
+#define CIRF_REL(T, to, from) \
+    ((int32_t)((long long)offsetof(T, to) - (long long)offsetof(T, from)))
+
+/*
+ * Name fingerprint: the first 8 bytes of a name packed big-endian and
+ * zero-padded. Since names never contain NUL, comparing fingerprints as
+ * integers orders names exactly like comparing their first 8 bytes with
+ * memcmp(), so most mismatches are decided without touching the string.
+ */
+static inline uint64_t cirf_name_fp(const char *name, size_t len) {
+    uint64_t fp = 0;
+    for(size_t i = 0; i < 8; i++) {
+        fp <<= 8;
+        if(i < len) fp |= (unsigned char)name[i];
+    }
+    return fp;
+}
+
 /*
  * Callback type for file iteration.
  */
 typedef void (*cirf_file_callback_t)(const cirf_file_t *file, void *ctx);
+typedef void (*cirf_cfile_callback_t)(const cirf_cfile_t *file, void *ctx);
 
 #ifdef __cplusplus
 }
@@ -4,9 +4,19 @@
 #include "error.h"
 #include <stddef.h>
 
+typedef enum {
+    VFS_META_STRING,
+    VFS_META_INT,
+    VFS_META_REAL,
+    VFS_META_BOOL
+} vfs_meta_type_t;
+
 typedef struct vfs_metadata {
         char                *key;
-        char                *value;
+        char                *value;   /* Text form, also of numbers and bools */
+        vfs_meta_type_t      type;
+        long long            integer; /* INT and BOOL value, REAL truncated */
+        double               real;    /* Numeric value */
         struct vfs_metadata *next;
 } vfs_metadata_t;
 
@@ -45,11 +55,15 @@ vfs_file_t *vfs_find_file(vfs_folder_t *root, const char *path);
 cirf_error_t vfs_load_file_data(vfs_file_t *file);
 cirf_error_t vfs_load_all_data(vfs_folder_t *root);
 
-void        vfs_add_metadata(vfs_metadata_t **list, const char *key, const char *value);
-const char *vfs_get_metadata(const vfs_metadata_t *list, const char *key);
-size_t      vfs_metadata_count(const vfs_metadata_t *list);
+/* Adds a string entry; the caller may set the type and numeric values after */
+vfs_metadata_t *vfs_add_metadata(vfs_metadata_t **list, const char *key, const char *value);
+const char     *vfs_get_metadata(const vfs_metadata_t *list, const char *key);
+size_t          vfs_metadata_count(const vfs_metadata_t *list);
 
 size_t vfs_folder_count(const vfs_folder_t *folder);
 size_t vfs_file_count(const vfs_folder_t *folder);
 
+/* Sort files and child folders of every folder by name (byte order) */
+cirf_error_t vfs_sort(vfs_folder_t *folder);
+
 #endif /* CIRF_VFS_H */
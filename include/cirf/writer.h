@@ -9,6 +9,9 @@ typedef struct writer writer_t;
 writer_t *writer_create(FILE *fp);
 void      writer_destroy(writer_t *w);
 
+/* Write out buffered output; -1 if any write to the file has failed */
+int writer_flush(writer_t *w);
+
 void writer_printf(writer_t *w, const char *fmt, ...);
 void writer_puts(writer_t *w, const char *s);
 void writer_putc(writer_t *w, char c);
@@ -18,6 +21,11 @@ void writer_indent(writer_t *w);
 void writer_dedent(writer_t *w);
 
 void writer_write_bytes_hex(writer_t *w, const unsigned char *data, size_t len, int bytes_per_line);
+void writer_write_bytes_string(writer_t *w, const unsigned char *data, size_t len,
+                               int bytes_per_line);
+void writer_write_bytes_words(writer_t *w, const unsigned char *data, size_t len,
+                              int words_per_line);
 void writer_write_string_escaped(writer_t *w, const char *s);
+void writer_write_string_bytes(writer_t *w, const unsigned char *data, size_t len);
 
 #endif /* CIRF_WRITER_H */
@@ -0,0 +1,40 @@
+#include "cirf/bloom.h"
+#include "cirf/hash.h"
+#include <stdlib.h>
+
+cirf_error_t bloom_build(const uint64_t *hashes, size_t count, size_t bits_per_key,
+                         bloom_t **out) {
+    if(!out || (!hashes && count)) return CIRF_ERR_INVALID;
+    *out = NULL;
+
+    size_t block_bits = CIRF_BLOOM_WORDS * 64;
+    size_t block_count = (count * bits_per_key + block_bits - 1) / block_bits;
+    if(block_count == 0) block_count = 1;
+
+    bloom_t *bloom = calloc(1, sizeof(bloom_t));
+    if(!bloom) return CIRF_ERR_NOMEM;
+
+    bloom->words = calloc(block_count * CIRF_BLOOM_WORDS, sizeof(uint64_t));
+    if(!bloom->words) {
+        free(bloom);
+        return CIRF_ERR_NOMEM;
+    }
+    bloom->block_count = block_count;
+
+    for(size_t i = 0; i < count; i++) {
+        uint64_t *block = bloom->words + cirf_bloom_block(hashes[i], block_count) * CIRF_BLOOM_WORDS;
+        uint64_t  bits = cirf_bloom_bits(hashes[i]);
+        for(unsigned j = 0; j < CIRF_BLOOM_WORDS; j++) {
+            block[j] |= cirf_bloom_mask(bits, j);
+        }
+    }
+
+    *out = bloom;
+    return CIRF_OK;
+}
+
+void bloom_destroy(bloom_t *bloom) {
+    if(!bloom) return;
+    free(bloom->words);
+    free(bloom);
+}
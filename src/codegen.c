@@ -1,16 +1,42 @@
 #include "cirf/codegen.h"
+#include "cirf/bloom.h"
+#include "cirf/elf.h"
+#include "cirf/hash.h"
+#include "cirf/pack.h"
+#include "cirf/phash.h"
+#include "cirf/trie.h"
+#include "cirf/types.h"
 #include "cirf/writer.h"
 #include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* Bloom filter density: about 0.4% false positives */
+#define CODEGEN_FILTER_BITS_PER_KEY 12
+
+/* Interned metadata keys and MIME types, see collect_meta_keys() and
+ * collect_mime_types() */
+typedef struct meta_keys  meta_keys_t;
+typedef struct mime_table mime_table_t;
+
 typedef struct {
-        const char *name;
-        writer_t   *w;
-        int         file_index;
-        int         folder_index;
-        int         metadata_index;
+        const char         *name;
+        writer_t           *w;
+        int                 file_index;
+        int                 folder_index;
+        int                 metadata_index;
+        const meta_keys_t  *meta_keys;
+        const mime_table_t *mimes;
+        unsigned            indexes;   /* CODEGEN_INDEX_* flags requested */
+        int                 data_encoding; /* CODEGEN_DATA_* */
+        writer_t           *asm_w;     /* The .S file (CODEGEN_DATA_INCBIN) */
+        int                 has_index; /* Set once {name}_index has been emitted */
+        size_t              trie_node_count;
+        size_t              filter_block_count;
+        size_t              meta_posting_count;
+        size_t              mime_posting_count;
 } codegen_ctx_t;
 
 static char *make_identifier(const char *path) {
@@ -104,47 +130,533 @@ static void generate_folder_extern_decls(writer_t *w, const char *name,
     }
 }
 
-static void generate_file_data(codegen_ctx_t *ctx, const vfs_file_t *file, int index) {
-    writer_printf(ctx->w, "static const unsigned char %s_data_%d[] = {\n", ctx->name, index);
-    writer_indent(ctx->w);
+/* Bytes per string-literal line: few tokens, short enough for any editor */
+#define CODEGEN_STRING_LINE 256
+
+/*
+ * Absolute path of a file's source, so that .incbin and #embed find it
+ * whatever directory the output is compiled from. NULL, with a message,
+ * if it cannot be resolved or spelled in a #embed header name.
+ */
+static char *absolute_source_path(const vfs_file_t *file) {
+    char *path = realpath(file->source_path, NULL);
+    if(!path) {
+        fprintf(stderr, "Error: Cannot resolve '%s'\n", file->source_path);
+        return NULL;
+    }
+    if(strpbrk(path, "\"\n")) {
+        fprintf(stderr, "Error: Cannot include '%s' by name\n", path);
+        free(path);
+        return NULL;
+    }
+    return path;
+}
+
+/*
+ * Alignment of a file's data in the .S file: what GCC and Clang give a
+ * static char array of that size on x86-64, the strictest of the common
+ * targets, so that no target sees less than its C array would get.
+ */
+static unsigned incbin_alignment(size_t size) {
+    return size >= 32 ? 32 : size >= 16 ? 16 : 1;
+}
+
+static void write_asm_prologue(writer_t *w, const char *name) {
+    writer_printf(w, "/* File data of %s, included from the source files */\n\n", name);
+    writer_puts(w, "#define CIRF_SYM_(prefix, sym) prefix##sym\n");
+    writer_puts(w, "#define CIRF_SYM2_(prefix, sym) CIRF_SYM_(prefix, sym)\n");
+    writer_puts(w, "#define CIRF_SYM(sym) CIRF_SYM2_(__USER_LABEL_PREFIX__, sym)\n\n");
+    writer_puts(w, "#if defined(__ELF__)\n");
+    writer_puts(w, "#define CIRF_HIDDEN(sym) .hidden CIRF_SYM(sym)\n");
+    writer_puts(w, "#define CIRF_TYPE(sym) .type CIRF_SYM(sym), %object\n");
+    writer_puts(w, "#define CIRF_SIZE(sym) .size CIRF_SYM(sym), . - CIRF_SYM(sym)\n");
+    writer_puts(w, "    .section .rodata\n");
+    writer_puts(w, "#elif defined(__APPLE__)\n");
+    writer_puts(w, "#define CIRF_HIDDEN(sym) .private_extern CIRF_SYM(sym)\n");
+    writer_puts(w, "#define CIRF_TYPE(sym)\n");
+    writer_puts(w, "#define CIRF_SIZE(sym)\n");
+    writer_puts(w, "    .section __TEXT,__const\n");
+    writer_puts(w, "#else\n");
+    writer_puts(w, "#define CIRF_HIDDEN(sym)\n");
+    writer_puts(w, "#define CIRF_TYPE(sym)\n");
+    writer_puts(w, "#define CIRF_SIZE(sym)\n");
+    writer_puts(w, "    .section .rdata,\"dr\"\n");
+    writer_puts(w, "#endif\n\n");
+}
+
+static void write_asm_epilogue(writer_t *w) {
+    writer_puts(w, "#if defined(__ELF__)\n");
+    writer_puts(w, "    .section .note.GNU-stack,\"\",%progbits\n");
+    writer_puts(w, "#endif\n");
+}
+
+/* The C side declares the symbol; the .S file defines it */
+static cirf_error_t generate_file_incbin(codegen_ctx_t *ctx, const vfs_file_t *file, int index) {
+    char *path = absolute_source_path(file);
+    if(!path) return CIRF_ERR_INVALID;
+
+    writer_printf(ctx->w, "extern const unsigned char %s_data_%d[];\n\n", ctx->name, index);
+
+    writer_t *w = ctx->asm_w;
+    writer_printf(w, "    .globl CIRF_SYM(%s_data_%d)\n", ctx->name, index);
+    writer_printf(w, "    CIRF_HIDDEN(%s_data_%d)\n", ctx->name, index);
+    writer_printf(w, "    CIRF_TYPE(%s_data_%d)\n", ctx->name, index);
+    writer_printf(w, "    .balign %u\n", incbin_alignment(file->size));
+    writer_printf(w, "CIRF_SYM(%s_data_%d):\n", ctx->name, index);
+    writer_puts(w, "    .incbin ");
+    writer_write_string_escaped(w, path);
+    writer_newline(w);
+    writer_printf(w, "    CIRF_SIZE(%s_data_%d)\n\n", ctx->name, index);
+
+    free(path);
+    return CIRF_OK;
+}
+
+static cirf_error_t generate_file_data(codegen_ctx_t *ctx, const vfs_file_t *file, int index) {
+    /* Empty files and files without a source are always written inline */
+    int external = file->size > 0 && file->source_path;
+
+    if(external && ctx->data_encoding == CODEGEN_DATA_INCBIN) {
+        return generate_file_incbin(ctx, file, index);
+    }
+
+    if(external && ctx->data_encoding == CODEGEN_DATA_EMBED) {
+        char *path = absolute_source_path(file);
+        if(!path) return CIRF_ERR_INVALID;
+        writer_printf(ctx->w, "static const unsigned char %s_data_%d[] = {\n", ctx->name, index);
+        writer_printf(ctx->w, "#embed \"%s\"\n", path);
+        writer_puts(ctx->w, "};\n\n");
+        free(path);
+        return CIRF_OK;
+    }
+
+    if(file->size > 0 && ctx->data_encoding == CODEGEN_DATA_STRING) {
+        /* Sized to leave out the literal's terminator */
+        writer_printf(ctx->w, "static const unsigned char %s_data_%d[%zu] =\n", ctx->name, index,
+                      file->size);
+        writer_indent(ctx->w);
+        writer_write_bytes_string(ctx->w, file->data, file->size, CODEGEN_STRING_LINE);
+        writer_puts(ctx->w, ";\n\n");
+        writer_dedent(ctx->w);
+        return CIRF_OK;
+    }
 
-    if(file->size > 0) {
-        writer_write_bytes_hex(ctx->w, file->data, file->size, 12);
+    if(file->size > 0 && ctx->data_encoding == CODEGEN_DATA_WORDS) {
+        writer_printf(ctx->w, "static const uint64_t %s_data_%d[] = {\n", ctx->name, index);
+        writer_indent(ctx->w);
+        writer_write_bytes_words(ctx->w, file->data, file->size, 4);
+    } else {
+        writer_printf(ctx->w, "static const unsigned char %s_data_%d[] = {\n", ctx->name, index);
+        writer_indent(ctx->w);
+        if(file->size > 0) {
+            writer_write_bytes_hex(ctx->w, file->data, file->size, 12);
+        }
     }
 
     writer_newline(ctx->w);
     writer_dedent(ctx->w);
     writer_printf(ctx->w, "};\n\n");
+    return CIRF_OK;
+}
+
+/* ========================================================================
+ * Metadata
+ * ======================================================================== */
+
+typedef struct {
+        const char *key;
+        size_t      uses; /* Entries with this key across all layers */
+        uint32_t    id;
+} meta_key_t;
+
+/*
+ * All metadata keys of a cirf run, distinct and sorted by name. IDs are
+ * assigned by descending use, so the most common keys get the IDs below 64
+ * that the runtime finds without searching.
+ */
+struct meta_keys {
+        meta_key_t  *items;
+        meta_key_t **by_id;
+        size_t       count;
+        size_t       capacity;
+};
+
+static int add_meta_keys(meta_keys_t *keys, const vfs_metadata_t *meta) {
+    for(const vfs_metadata_t *m = meta; m; m = m->next) {
+        if(keys->count == keys->capacity) {
+            size_t      capacity = keys->capacity ? keys->capacity * 2 : 16;
+            meta_key_t *grown = realloc(keys->items, capacity * sizeof(*grown));
+            if(!grown) return -1;
+            keys->items = grown;
+            keys->capacity = capacity;
+        }
+        keys->items[keys->count].key = m->key;
+        keys->items[keys->count].uses = 1;
+        keys->items[keys->count].id = 0;
+        keys->count++;
+    }
+    return 0;
+}
+
+static int add_folder_meta_keys(meta_keys_t *keys, const vfs_folder_t *folder) {
+    if(add_meta_keys(keys, folder->metadata) != 0) return -1;
+    for(const vfs_file_t *f = folder->files; f; f = f->next) {
+        if(add_meta_keys(keys, f->metadata) != 0) return -1;
+    }
+    for(const vfs_folder_t *c = folder->children; c; c = c->next) {
+        if(add_folder_meta_keys(keys, c) != 0) return -1;
+    }
+    return 0;
+}
+
+static int compare_key_name(const void *a, const void *b) {
+    return strcmp(((const meta_key_t *)a)->key, ((const meta_key_t *)b)->key);
+}
+
+static int compare_key_uses(const void *a, const void *b) {
+    const meta_key_t *ka = *(const meta_key_t *const *)a;
+    const meta_key_t *kb = *(const meta_key_t *const *)b;
+    if(ka->uses != kb->uses) return ka->uses > kb->uses ? -1 : 1;
+    return strcmp(ka->key, kb->key);
+}
+
+/* Intern the metadata keys of all layers */
+static cirf_error_t collect_meta_keys(cirf_config_t *const *layers, size_t count,
+                                      meta_keys_t *keys) {
+    for(size_t l = 0; l < count; l++) {
+        if(add_folder_meta_keys(keys, layers[l]->root) != 0) {
+            return CIRF_ERR_NOMEM;
+        }
+    }
+
+    if(keys->count == 0) return CIRF_OK;
+    qsort(keys->items, keys->count, sizeof(meta_key_t), compare_key_name);
+    size_t kept = 1;
+    for(size_t i = 1; i < keys->count; i++) {
+        if(strcmp(keys->items[i].key, keys->items[kept - 1].key) == 0) {
+            keys->items[kept - 1].uses++;
+        } else {
+            keys->items[kept++] = keys->items[i];
+        }
+    }
+    keys->count = kept;
+
+    keys->by_id = malloc(keys->count * sizeof(meta_key_t *));
+    if(!keys->by_id) return CIRF_ERR_NOMEM;
+    for(size_t i = 0; i < keys->count; i++) {
+        keys->by_id[i] = &keys->items[i];
+    }
+    qsort(keys->by_id, keys->count, sizeof(meta_key_t *), compare_key_uses);
+    for(size_t i = 0; i < keys->count; i++) {
+        keys->by_id[i]->id = (uint32_t)i;
+    }
+    return CIRF_OK;
+}
+
+static uint32_t meta_key_id(const meta_keys_t *keys, const char *key) {
+    meta_key_t        probe = {.key = key};
+    const meta_key_t *found =
+        bsearch(&probe, keys->items, keys->count, sizeof(meta_key_t), compare_key_name);
+    return found->id;
+}
+
+typedef struct {
+        uint32_t              key_id;
+        size_t                order; /* Position in the config */
+        const vfs_metadata_t *meta;
+} meta_entry_t;
+
+static int compare_meta_entry(const void *a, const void *b) {
+    const meta_entry_t *ea = (const meta_entry_t *)a;
+    const meta_entry_t *eb = (const meta_entry_t *)b;
+    if(ea->key_id != eb->key_id) return ea->key_id < eb->key_id ? -1 : 1;
+    return (ea->order > eb->order) - (ea->order < eb->order);
 }
 
-static int generate_metadata(codegen_ctx_t *ctx, const vfs_metadata_t *meta) {
-    if(!meta) return -1;
+static const char *meta_type_name(vfs_meta_type_t type) {
+    switch(type) {
+        case VFS_META_INT:
+            return "CIRF_META_INT";
+        case VFS_META_REAL:
+            return "CIRF_META_REAL";
+        case VFS_META_BOOL:
+            return "CIRF_META_BOOL";
+        default:
+            return "CIRF_META_STRING";
+    }
+}
 
-    int    index = ctx->metadata_index++;
+/*
+ * Sort metadata by key ID, keeping each key once (the first occurrence wins,
+ * as with cirf_get_metadata()). Returns the entries, or NULL if there is no
+ * metadata or memory ran out; the caller frees them.
+ */
+static meta_entry_t *sort_metadata(const meta_keys_t *keys, const vfs_metadata_t *meta,
+                                   size_t *count_out) {
     size_t count = vfs_metadata_count(meta);
+    *count_out = 0;
+    if(count == 0) return NULL;
 
-    writer_printf(ctx->w, "static const cirf_metadata_t %s_meta_%d[] = {\n", ctx->name, index);
-    writer_indent(ctx->w);
+    meta_entry_t *entries = malloc(count * sizeof(meta_entry_t));
+    if(!entries) return NULL;
 
-    for(const vfs_metadata_t *m = meta; m; m = m->next) {
-        writer_puts(ctx->w, "{ ");
-        writer_write_string_escaped(ctx->w, m->key);
-        writer_puts(ctx->w, ", ");
-        writer_write_string_escaped(ctx->w, m->value);
-        writer_puts(ctx->w, " }");
-        if(m->next) {
-            writer_puts(ctx->w, ",");
+    size_t n = 0;
+    for(const vfs_metadata_t *m = meta; m; m = m->next, n++) {
+        entries[n].key_id = meta_key_id(keys, m->key);
+        entries[n].order = n;
+        entries[n].meta = m;
+    }
+    qsort(entries, count, sizeof(meta_entry_t), compare_meta_entry);
+
+    size_t kept = 1;
+    for(size_t i = 1; i < count; i++) {
+        if(entries[i].key_id != entries[kept - 1].key_id) {
+            entries[kept++] = entries[i];
         }
-        writer_newline(ctx->w);
     }
+    *count_out = kept;
+    return entries;
+}
+
+/* Emit the members after key and value of a metadata initializer */
+static void write_meta_values(writer_t *w, const meta_entry_t *e) {
+    const vfs_metadata_t *m = e->meta;
+
+    writer_printf(w, ", %u, %s, ", (unsigned)e->key_id, meta_type_name(m->type));
+    if(m->integer == LLONG_MIN) {
+        writer_puts(w, "(-9223372036854775807LL - 1)");
+    } else {
+        writer_printf(w, "%lldLL", m->integer);
+    }
+    writer_printf(w, ", %.17g },\n", m->real);
+}
+
+/* Emit one cirf_metadata_t initializer */
+static void write_meta_entry(writer_t *w, const meta_entry_t *e) {
+    writer_puts(w, "{ ");
+    writer_write_string_escaped(w, e->meta->key);
+    writer_puts(w, ", ");
+    writer_write_string_escaped(w, e->meta->value);
+    write_meta_values(w, e);
+}
+
+/*
+ * Emit one metadata array, see sort_metadata(). Returns the array's index,
+ * or -1 if there is no metadata or memory ran out, and sets the number of
+ * entries and the key mask.
+ */
+static int generate_metadata(codegen_ctx_t *ctx, const vfs_metadata_t *meta, size_t *count_out,
+                             uint64_t *keys_out) {
+    size_t        count;
+    meta_entry_t *entries = sort_metadata(ctx->meta_keys, meta, &count);
+    if(!entries) return -1;
+
+    int      index = ctx->metadata_index++;
+    uint64_t keys = 0;
 
+    writer_printf(ctx->w, "static const cirf_metadata_t %s_meta_%d[] = {\n", ctx->name, index);
+    writer_indent(ctx->w);
+    for(size_t i = 0; i < count; i++) {
+        if(entries[i].key_id < 64) keys |= (uint64_t)1 << entries[i].key_id;
+        write_meta_entry(ctx->w, &entries[i]);
+    }
     writer_dedent(ctx->w);
     writer_printf(ctx->w, "};\n\n");
 
-    (void)count;
+    free(entries);
+    *count_out = count;
+    *keys_out = keys;
     return index;
 }
 
+/* Emit .metadata, .metadata_count and .metadata_keys */
+static void write_metadata_ref(codegen_ctx_t *ctx, int index, size_t count, uint64_t keys) {
+    if(index >= 0) {
+        writer_printf(ctx->w, ".metadata = %s_meta_%d,\n", ctx->name, index);
+        writer_printf(ctx->w, ".metadata_count = %zu,\n", count);
+        writer_printf(ctx->w, ".metadata_keys = 0x%llxULL,\n", (unsigned long long)keys);
+    } else {
+        writer_puts(ctx->w, ".metadata = NULL,\n");
+        writer_puts(ctx->w, ".metadata_count = 0,\n");
+        writer_puts(ctx->w, ".metadata_keys = 0,\n");
+    }
+}
+
+/* ========================================================================
+ * MIME types
+ * ======================================================================== */
+
+/* MIME types of all layers, sorted and distinct; a type's ID is its index + 1 */
+struct mime_table {
+        const char  *name; /* Symbol prefix: {name}_mimes[], {name}_mime_<id> */
+        const char **types;
+        size_t       count;
+        size_t       capacity;
+};
+
+static const char *file_mime(const vfs_file_t *file) {
+    return file->mime ? file->mime : "application/octet-stream";
+}
+
+static int add_folder_mime_types(mime_table_t *table, const vfs_folder_t *folder) {
+    for(const vfs_file_t *f = folder->files; f; f = f->next) {
+        if(table->count == table->capacity) {
+            size_t       capacity = table->capacity ? table->capacity * 2 : 16;
+            const char **grown = realloc(table->types, capacity * sizeof(*grown));
+            if(!grown) return -1;
+            table->types = grown;
+            table->capacity = capacity;
+        }
+        table->types[table->count++] = file_mime(f);
+    }
+    for(const vfs_folder_t *c = folder->children; c; c = c->next) {
+        if(add_folder_mime_types(table, c) != 0) return -1;
+    }
+    return 0;
+}
+
+static int compare_string(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/* Intern the MIME types of all layers */
+static cirf_error_t collect_mime_types(cirf_config_t *const *layers, size_t count,
+                                       mime_table_t *table) {
+    for(size_t l = 0; l < count; l++) {
+        if(add_folder_mime_types(table, layers[l]->root) != 0) {
+            return CIRF_ERR_NOMEM;
+        }
+    }
+
+    if(table->count == 0) return CIRF_OK;
+    qsort(table->types, table->count, sizeof(*table->types), compare_string);
+    size_t kept = 1;
+    for(size_t i = 1; i < table->count; i++) {
+        if(strcmp(table->types[i], table->types[kept - 1]) != 0) {
+            table->types[kept++] = table->types[i];
+        }
+    }
+    table->count = kept;
+    return CIRF_OK;
+}
+
+static size_t mime_id(const mime_table_t *table, const char *type) {
+    const char **found =
+        bsearch(&type, table->types, table->count, sizeof(*table->types), compare_string);
+    return (size_t)(found - table->types) + 1;
+}
+
+/* Each type is stored once; files and the table point at the same string */
+static void write_mime_table(writer_t *w, const mime_table_t *table) {
+    if(table->count == 0) return;
+
+    writer_puts(w, "/* MIME types by ID */\n");
+    for(size_t i = 0; i < table->count; i++) {
+        writer_printf(w, "static const char %s_mime_%zu[] = ", table->name, i + 1);
+        writer_write_string_escaped(w, table->types[i]);
+        writer_puts(w, ";\n");
+    }
+    writer_newline(w);
+
+    writer_printf(w, "const char * const %s_mimes[%zu] = {\n", table->name, table->count + 1);
+    writer_indent(w);
+    writer_puts(w, "NULL,\n");
+    for(size_t i = 0; i < table->count; i++) {
+        writer_printf(w, "%s_mime_%zu", table->name, i + 1);
+        writer_puts(w, i + 1 < table->count ? ",\n" : "\n");
+    }
+    writer_dedent(w);
+    writer_puts(w, "};\n\n");
+}
+
+/*
+ * Emit "#define {NAME}_{kind}_<VALUE> <id>" for values[i] with IDs from
+ * first_id, then {NAME}_{kind}_{count_suffix} as one past the last ID. A
+ * value whose symbol clashes with an earlier one gets its ID appended.
+ */
+static cirf_error_t write_id_defines(writer_t *w, const char *name, const char *kind,
+                                     const char *count_suffix, const char *const *values,
+                                     size_t count, size_t first_id) {
+    char *prefix = make_identifier(name);
+    if(!prefix) return CIRF_ERR_NOMEM;
+    for(char *p = prefix; *p; p++)
+        *p = toupper((unsigned char)*p);
+
+    char **symbols = calloc(count + 1, sizeof(char *));
+    if(!symbols) {
+        free(prefix);
+        return CIRF_ERR_NOMEM;
+    }
+
+    /* The count comes first so that no value can take its name */
+    cirf_error_t err = CIRF_OK;
+    size_t       prefix_len = strlen(prefix) + 1 + strlen(kind) + 1;
+    symbols[0] = malloc(prefix_len + strlen(count_suffix) + 1);
+    if(symbols[0]) {
+        sprintf(symbols[0], "%s_%s_%s", prefix, kind, count_suffix);
+    } else {
+        err = CIRF_ERR_NOMEM;
+    }
+
+    for(size_t i = 0; i < count && err == CIRF_OK; i++) {
+        char *id = make_identifier(values[i]);
+        if(!id) {
+            err = CIRF_ERR_NOMEM;
+            break;
+        }
+        for(char *p = id; *p; p++)
+            *p = toupper((unsigned char)*p);
+
+        /* prefix + id + "_" + up to 20 digits + null */
+        char *sym = malloc(prefix_len + strlen(id) + 22);
+        if(!sym) {
+            free(id);
+            err = CIRF_ERR_NOMEM;
+            break;
+        }
+        sprintf(sym, "%s_%s_%s", prefix, kind, id);
+        free(id);
+        for(size_t j = 0; j <= i; j++) {
+            if(symbols[j] && strcmp(symbols[j], sym) == 0) {
+                sprintf(sym + strlen(sym), "_%zu", first_id + i);
+                break;
+            }
+        }
+        symbols[i + 1] = sym;
+
+        writer_printf(w, "#define %s %zuu /* ", sym, first_id + i);
+        writer_write_string_escaped(w, values[i]);
+        writer_puts(w, " */\n");
+    }
+    if(err == CIRF_OK) {
+        writer_printf(w, "#define %s %zuu\n\n", symbols[0], first_id + count);
+    }
+
+    for(size_t i = 0; i <= count; i++) {
+        free(symbols[i]);
+    }
+    free(symbols);
+    free(prefix);
+    return err;
+}
+
+/* Emit {NAME}_META_<KEY> for every interned key, plus {NAME}_META_KEY_COUNT */
+static cirf_error_t write_meta_key_defines(writer_t *w, const char *name,
+                                           const meta_keys_t *keys) {
+    if(keys->count == 0) return CIRF_OK;
+
+    const char **values = malloc(keys->count * sizeof(char *));
+    if(!values) return CIRF_ERR_NOMEM;
+    for(size_t i = 0; i < keys->count; i++) {
+        values[i] = keys->by_id[i]->key;
+    }
+
+    writer_puts(w, "/* Metadata key IDs (cirf_metadata_t.key_id) */\n");
+    cirf_error_t err = write_id_defines(w, name, "META", "KEY_COUNT", values, keys->count, 0);
+    free(values);
+    return err;
+}
+
 static void generate_folder_forward_decl(codegen_ctx_t *ctx, const vfs_folder_t *folder) {
     char *sym = make_dir_symbol(ctx->name, folder->path);
     if(sym) {
@@ -153,19 +665,24 @@ static void generate_folder_forward_decl(codegen_ctx_t *ctx, const vfs_folder_t
     }
 }
 
-static void generate_all_data(codegen_ctx_t *ctx, const vfs_folder_t *folder) {
+static cirf_error_t generate_all_data(codegen_ctx_t *ctx, const vfs_folder_t *folder) {
     for(const vfs_file_t *f = folder->files; f; f = f->next) {
-        generate_file_data(ctx, f, ctx->file_index++);
+        cirf_error_t err = generate_file_data(ctx, f, ctx->file_index++);
+        if(err != CIRF_OK) return err;
     }
 
     for(const vfs_folder_t *c = folder->children; c; c = c->next) {
-        generate_all_data(ctx, c);
+        cirf_error_t err = generate_all_data(ctx, c);
+        if(err != CIRF_OK) return err;
     }
+    return CIRF_OK;
 }
 
 typedef struct file_meta_info {
         const vfs_file_t      *file;
         int                    metadata_index;
+        size_t                 metadata_count;
+        uint64_t               metadata_keys;
         struct file_meta_info *next;
 } file_meta_info_t;
 
@@ -175,7 +692,11 @@ typedef struct folder_info {
         int                 files_count;
         int                 children_start;
         int                 children_count;
+        int                 tree_files_end;   /* One past the last file of the subtree */
+        int                 tree_folders_end; /* One past the last folder of the subtree */
         int                 metadata_index;
+        size_t              metadata_count;
+        uint64_t            metadata_keys;
         const vfs_folder_t *folder;
         struct folder_info *next;
 } folder_info_t;
@@ -206,6 +727,8 @@ static void collect_folder_info(const vfs_folder_t *folder, folder_info_t **list
     for(const vfs_folder_t *c = folder->children; c; c = c->next) {
         collect_folder_info(c, list, file_idx, folder_idx);
     }
+    info->tree_files_end = *file_idx;
+    info->tree_folders_end = *folder_idx;
 }
 
 static folder_info_t *find_folder_info(folder_info_t *list, const vfs_folder_t *folder) {
@@ -231,13 +754,14 @@ static void free_file_meta_info(file_meta_info_t *list) {
     }
 }
 
-static int find_file_meta_index(file_meta_info_t *list, const vfs_file_t *file) {
+static const file_meta_info_t *find_file_meta_info(file_meta_info_t *list,
+                                                   const vfs_file_t *file) {
     for(file_meta_info_t *m = list; m; m = m->next) {
         if(m->file == file) {
-            return m->metadata_index;
+            return m;
         }
     }
-    return -1;
+    return NULL;
 }
 
 static void generate_all_file_metadata(codegen_ctx_t *ctx, const vfs_folder_t *folder,
@@ -247,7 +771,8 @@ static void generate_all_file_metadata(codegen_ctx_t *ctx, const vfs_folder_t *f
             file_meta_info_t *info = calloc(1, sizeof(file_meta_info_t));
             if(info) {
                 info->file = f;
-                info->metadata_index = generate_metadata(ctx, f->metadata);
+                info->metadata_index = generate_metadata(ctx, f->metadata, &info->metadata_count,
+                                                         &info->metadata_keys);
                 info->next = *list;
                 *list = info;
             }
@@ -259,24 +784,19 @@ static void generate_all_file_metadata(codegen_ctx_t *ctx, const vfs_folder_t *f
     }
 }
 
-static void generate_files_array(codegen_ctx_t *ctx, const vfs_folder_t *folder,
-                                 folder_info_t *info_list, file_meta_info_t *file_meta_list,
-                                 int *file_idx) {
-    if(!folder->files) return;
-
-    folder_info_t *folder_info = find_folder_info(info_list, folder);
-    if(!folder_info) return;
-
-    /* Use path-based name for files array */
-    char *dir_sym = make_dir_symbol(ctx->name, folder->path);
-    if(!dir_sym) return;
-
-    writer_printf(ctx->w, "static const cirf_file_t %s_files[] = {\n", dir_sym);
-    free(dir_sym);
-    writer_indent(ctx->w);
+/* Emit .name_len/.name_fp, the binary-search key of a file or folder */
+static void write_name_key(codegen_ctx_t *ctx, const char *name) {
+    size_t len = strlen(name);
+    writer_printf(ctx->w, ".name_len = %zu,\n", len);
+    writer_printf(ctx->w, ".name_fp = 0x%016llxULL\n",
+                  (unsigned long long)cirf_name_fp(name, len));
+}
 
+/* Emit the entries of one folder's files into the flat {name}_files[] table */
+static void generate_files_array(codegen_ctx_t *ctx, const vfs_folder_t *folder,
+                                 file_meta_info_t *file_meta_list, int *file_idx) {
     for(const vfs_file_t *f = folder->files; f; f = f->next) {
-        int meta_idx = find_file_meta_index(file_meta_list, f);
+        const file_meta_info_t *meta = find_file_meta_info(file_meta_list, f);
 
         writer_puts(ctx->w, "{\n");
         writer_indent(ctx->w);
@@ -289,11 +809,16 @@ static void generate_files_array(codegen_ctx_t *ctx, const vfs_folder_t *folder,
         writer_write_string_escaped(ctx->w, f->path);
         writer_puts(ctx->w, ",\n");
 
-        writer_puts(ctx->w, ".mime = ");
-        writer_write_string_escaped(ctx->w, f->mime ? f->mime : "application/octet-stream");
-        writer_puts(ctx->w, ",\n");
+        size_t mime = mime_id(ctx->mimes, file_mime(f));
+        writer_printf(ctx->w, ".mime = %s_mime_%zu,\n", ctx->mimes->name, mime);
+        writer_printf(ctx->w, ".mime_id = %zu,\n", mime);
 
-        writer_printf(ctx->w, ".data = %s_data_%d,\n", ctx->name, *file_idx);
+        if(ctx->data_encoding == CODEGEN_DATA_WORDS && f->size > 0) {
+            writer_printf(ctx->w, ".data = (const unsigned char *)%s_data_%d,\n", ctx->name,
+                          *file_idx);
+        } else {
+            writer_printf(ctx->w, ".data = %s_data_%d,\n", ctx->name, *file_idx);
+        }
         writer_printf(ctx->w, ".size = %zu,\n", f->size);
 
         /* Parent pointer using path-based name */
@@ -303,42 +828,37 @@ static void generate_files_array(codegen_ctx_t *ctx, const vfs_folder_t *folder,
             free(parent_sym);
         }
 
-        if(meta_idx >= 0) {
-            writer_printf(ctx->w, ".metadata = %s_meta_%d,\n", ctx->name, meta_idx);
-            writer_printf(ctx->w, ".metadata_count = %zu\n", vfs_metadata_count(f->metadata));
+        if(meta) {
+            write_metadata_ref(ctx, meta->metadata_index, meta->metadata_count,
+                               meta->metadata_keys);
         } else {
-            writer_puts(ctx->w, ".metadata = NULL,\n");
-            writer_puts(ctx->w, ".metadata_count = 0\n");
+            write_metadata_ref(ctx, -1, 0, 0);
         }
 
+        write_name_key(ctx, f->name);
+
         writer_dedent(ctx->w);
-        writer_puts(ctx->w, "}");
-        if(f->next) {
-            writer_puts(ctx->w, ",");
-        }
-        writer_newline(ctx->w);
+        writer_puts(ctx->w, "},\n");
 
         (*file_idx)++;
     }
+}
 
-    writer_dedent(ctx->w);
-    writer_printf(ctx->w, "};\n\n");
-
-    /* Generate individual file pointer aliases */
-    char *arr_sym = make_dir_symbol(ctx->name, folder->path);
-    if(arr_sym) {
-        int file_index = 0;
-        for(const vfs_file_t *f = folder->files; f; f = f->next) {
-            char *file_sym = make_file_symbol(ctx->name, f->path);
-            if(file_sym) {
-                writer_printf(ctx->w, "const cirf_file_t * const %s = &%s_files[%d];\n", file_sym,
-                              arr_sym, file_index);
-                free(file_sym);
-            }
-            file_index++;
+/* Emit the individual file pointer aliases into {name}_files[] */
+static void generate_file_aliases(codegen_ctx_t *ctx, const vfs_folder_t *folder,
+                                  int *file_idx) {
+    for(const vfs_file_t *f = folder->files; f; f = f->next) {
+        char *file_sym = make_file_symbol(ctx->name, f->path);
+        if(file_sym) {
+            writer_printf(ctx->w, "const cirf_file_t * const %s = &%s_files[%d];\n", file_sym,
+                          ctx->name, *file_idx);
+            free(file_sym);
         }
-        free(arr_sym);
-        writer_newline(ctx->w);
+        (*file_idx)++;
+    }
+
+    for(const vfs_folder_t *c = folder->children; c; c = c->next) {
+        generate_file_aliases(ctx, c, file_idx);
     }
 }
 
@@ -349,7 +869,8 @@ static void generate_folder_struct(codegen_ctx_t *ctx, const vfs_folder_t *folde
 
     /* Generate metadata if present */
     if(folder->metadata) {
-        info->metadata_index = generate_metadata(ctx, folder->metadata);
+        info->metadata_index = generate_metadata(ctx, folder->metadata, &info->metadata_count,
+                                                 &info->metadata_keys);
     }
 
     /* Use path-based symbol name */
@@ -423,13 +944,9 @@ static void generate_folder_struct(codegen_ctx_t *ctx, const vfs_folder_t *folde
         writer_puts(ctx->w, ".child_count = 0,\n");
     }
 
-    /* Files - use path-based array name */
+    /* Files - a slice of the flat table */
     if(info->files_count > 0) {
-        char *files_sym = make_dir_symbol(ctx->name, folder->path);
-        if(files_sym) {
-            writer_printf(ctx->w, ".files = %s_files,\n", files_sym);
-            free(files_sym);
-        }
+        writer_printf(ctx->w, ".files = &%s_files[%d],\n", ctx->name, info->files_start);
         writer_printf(ctx->w, ".file_count = %d,\n", info->files_count);
     } else {
         writer_puts(ctx->w, ".files = NULL,\n");
@@ -437,25 +954,40 @@ static void generate_folder_struct(codegen_ctx_t *ctx, const vfs_folder_t *folde
     }
 
     /* Metadata */
-    if(info->metadata_index >= 0) {
-        writer_printf(ctx->w, ".metadata = %s_meta_%d,\n", ctx->name, info->metadata_index);
-        writer_printf(ctx->w, ".metadata_count = %zu\n", vfs_metadata_count(folder->metadata));
+    write_metadata_ref(ctx, info->metadata_index, info->metadata_count, info->metadata_keys);
+
+    /* Lookup indexes hang off the root only */
+    if(!folder->parent && ctx->has_index) {
+        writer_printf(ctx->w, ".index = &%s_index,\n", ctx->name);
     } else {
-        writer_puts(ctx->w, ".metadata = NULL,\n");
-        writer_puts(ctx->w, ".metadata_count = 0\n");
+        writer_puts(ctx->w, ".index = NULL,\n");
     }
 
+    /* The subtree's files follow the folder's own files in the flat table */
+    int tree_file_count = info->tree_files_end - info->files_start;
+    if(tree_file_count > 0) {
+        writer_printf(ctx->w, ".tree_files = &%s_files[%d],\n", ctx->name, info->files_start);
+    } else {
+        writer_puts(ctx->w, ".tree_files = NULL,\n");
+    }
+    writer_printf(ctx->w, ".tree_file_count = %d,\n", tree_file_count);
+    writer_printf(ctx->w, ".tree_folder_count = %d,\n",
+                  info->tree_folders_end - info->self_index - 1);
+
+    /* Siblings were sorted by codegen_generate() */
+    writer_puts(ctx->w, ".flags = CIRF_FOLDER_SORTED | CIRF_FOLDER_SUBTREE,\n");
+    write_name_key(ctx, folder->name);
+
     writer_dedent(ctx->w);
     writer_printf(ctx->w, "};\n\n");
 }
 
 static void generate_all_files_arrays(codegen_ctx_t *ctx, const vfs_folder_t *folder,
-                                      folder_info_t *info_list, file_meta_info_t *file_meta_list,
-                                      int *file_idx) {
-    generate_files_array(ctx, folder, info_list, file_meta_list, file_idx);
+                                      file_meta_info_t *file_meta_list, int *file_idx) {
+    generate_files_array(ctx, folder, file_meta_list, file_idx);
 
     for(const vfs_folder_t *c = folder->children; c; c = c->next) {
-        generate_all_files_arrays(ctx, c, info_list, file_meta_list, file_idx);
+        generate_all_files_arrays(ctx, c, file_meta_list, file_idx);
     }
 }
 
@@ -470,79 +1002,1518 @@ static void generate_all_folders(codegen_ctx_t *ctx, const vfs_folder_t *folder,
     generate_folder_struct(ctx, folder, info_list);
 }
 
-static cirf_error_t generate_header(const cirf_config_t *config, const char *path) {
-    FILE *fp = fopen(path, "w");
-    if(!fp) return CIRF_ERR_IO;
-
-    writer_t *w = writer_create(fp);
-    if(!w) {
-        fclose(fp);
-        return CIRF_ERR_NOMEM;
-    }
+/* ========================================================================
+ * Set plans
+ * ======================================================================== */
 
-    const char *name = config->name;
+typedef struct {
+        const vfs_folder_t *folder;
+        uint32_t            files;             /* First own file, depth-first */
+        uint32_t            tree_file_count;
+        uint32_t            children;          /* First child, breadth-first */
+        uint32_t            tree_folder_count;
+        uint32_t            metadata;          /* First entry in the image's metadata[] */
+        uint32_t            metadata_count;
+} cfolder_plan_t;
 
-    /* Header guard */
-    char *guard = make_identifier(name);
-    for(char *p = guard; *p; p++)
-        *p = toupper((unsigned char)*p);
+typedef struct {
+        const vfs_file_t *file;
+        uint32_t          data;     /* Offset in the image's blob[] */
+        uint32_t          metadata; /* First entry in the image's metadata[] */
+        uint32_t          metadata_count;
+} cfile_plan_t;
 
-    writer_printf(w, "#ifndef %s_H\n", guard);
-    writer_printf(w, "#define %s_H\n\n", guard);
-    free(guard);
+/* Position of every folder and file of a set, see plan_tree() */
+typedef struct {
+        cfolder_plan_t *folders;        /* Breadth-first */
+        size_t          folder_count;
+        cfile_plan_t   *files;          /* Depth-first */
+        size_t          file_count;
+        size_t          metadata_count;
+        const char    **strings;        /* String pool, sorted and distinct */
+        size_t         *string_offsets; /* Offset of each string in the pool */
+        size_t          string_count;
+        size_t          string_bytes;
+        size_t          blob_bytes;
+} compact_plan_t;
+
+static size_t subtree_file_count(const vfs_folder_t *folder) {
+    size_t count = vfs_file_count(folder);
+    for(const vfs_folder_t *c = folder->children; c; c = c->next) {
+        count += subtree_file_count(c);
+    }
+    return count;
+}
 
-    /* Include common types - use cirf_file_t, cirf_folder_t, cirf_metadata_t */
-    writer_puts(w, "#include <cirf/types.h>\n\n");
+static size_t subtree_folder_count(const vfs_folder_t *folder) {
+    size_t count = 0;
+    for(const vfs_folder_t *c = folder->children; c; c = c->next) {
+        count += 1 + subtree_folder_count(c);
+    }
+    return count;
+}
 
-    /* Root declaration */
-    writer_printf(w, "extern const cirf_folder_t %s_root;\n", name);
+static void plan_files(compact_plan_t *plan, const vfs_folder_t *folder) {
+    for(const vfs_file_t *f = folder->files; f; f = f->next) {
+        plan->files[plan->file_count++].file = f;
+    }
+    for(const vfs_folder_t *c = folder->children; c; c = c->next) {
+        plan_files(plan, c);
+    }
+}
 
-    /* Folder declarations */
-    generate_folder_extern_decls(w, name, config->root);
-    writer_newline(w);
+static void free_compact_plan(compact_plan_t *plan) {
+    free(plan->folders);
+    free(plan->files);
+    free(plan->strings);
+    free(plan->string_offsets);
+}
 
-    /* File declarations */
-    generate_file_extern_decls(w, name, config->root);
+/*
+ * Plan the records of a set: folders breadth-first, so that each folder's
+ * children are consecutive, and files depth-first like the flat file table.
+ * Every folder and file name is added to the string pool; callers may add
+ * strings_per_file - 1 more strings per file and extra_strings in all
+ * before pool_strings().
+ */
+static cirf_error_t plan_tree(const vfs_folder_t *root, size_t strings_per_file,
+                              size_t extra_strings, compact_plan_t *plan) {
+    size_t folder_total = 1 + subtree_folder_count(root);
+    size_t file_total = subtree_file_count(root);
+    size_t string_total = folder_total + strings_per_file * file_total + extra_strings;
+
+    plan->folders = calloc(folder_total, sizeof(cfolder_plan_t));
+    plan->files = calloc(file_total ? file_total : 1, sizeof(cfile_plan_t));
+    plan->strings = malloc(string_total * sizeof(char *));
+    plan->string_offsets = malloc(string_total * sizeof(size_t));
+    if(!plan->folders || !plan->files || !plan->strings || !plan->string_offsets) {
+        return CIRF_ERR_NOMEM;
+    }
 
-    writer_printf(w, "\n#endif /* %s_H */\n", name);
+    /* The folder array is its own breadth-first queue */
+    plan->folders[0].folder = root;
+    plan->folder_count = 1;
+    for(size_t i = 0; i < plan->folder_count; i++) {
+        cfolder_plan_t *d = &plan->folders[i];
+        uint32_t        next_file = d->files + (uint32_t)vfs_file_count(d->folder);
+
+        d->tree_file_count = (uint32_t)subtree_file_count(d->folder);
+        d->tree_folder_count = (uint32_t)subtree_folder_count(d->folder);
+        d->children = d->folder->children ? (uint32_t)plan->folder_count : 0;
+        for(const vfs_folder_t *c = d->folder->children; c; c = c->next) {
+            cfolder_plan_t *child = &plan->folders[plan->folder_count++];
+            child->folder = c;
+            child->files = next_file;
+            next_file += (uint32_t)subtree_file_count(c);
+        }
+        plan->strings[plan->string_count++] = d->folder->name;
+    }
 
-    writer_destroy(w);
-    fclose(fp);
+    plan_files(plan, root);
+    for(size_t i = 0; i < plan->file_count; i++) {
+        plan->strings[plan->string_count++] = plan->files[i].file->name;
+    }
     return CIRF_OK;
 }
 
-static cirf_error_t generate_source(const cirf_config_t *config, const char *path,
-                                    const char *header_name) {
-    FILE *fp = fopen(path, "w");
-    if(!fp) return CIRF_ERR_IO;
-
-    writer_t *w = writer_create(fp);
-    if(!w) {
-        fclose(fp);
-        return CIRF_ERR_NOMEM;
+/* Sort the string pool, drop duplicates and assign offsets */
+static void pool_strings(compact_plan_t *plan) {
+    qsort(plan->strings, plan->string_count, sizeof(char *), compare_string);
+    size_t kept = 0;
+    for(size_t i = 0; i < plan->string_count; i++) {
+        if(kept > 0 && strcmp(plan->strings[i], plan->strings[kept - 1]) == 0) continue;
+        plan->strings[kept] = plan->strings[i];
+        plan->string_offsets[kept] = plan->string_bytes;
+        plan->string_bytes += strlen(plan->strings[i]) + 1;
+        kept++;
     }
+    plan->string_count = kept;
+}
 
-    const char *name = config->name;
+/* Offset of s in the string pool */
+static size_t compact_string(const compact_plan_t *plan, const char *s) {
+    const char **found =
+        bsearch(&s, plan->strings, plan->string_count, sizeof(char *), compare_string);
+    return plan->string_offsets[found - plan->strings];
+}
 
-    writer_printf(w, "#include \"%s\"\n\n", header_name);
+/* ========================================================================
+ * Lookup indexes
+ * ======================================================================== */
 
-    codegen_ctx_t ctx = {
-        .name = name, .w = w, .file_index = 0, .folder_index = 0, .metadata_index = 0};
+typedef struct path_entry {
+        const vfs_file_t   *file;
+        const vfs_folder_t *folder;
+        uint64_t            hash;
+        const char         *set;        /* Symbol prefix of the entry's resource set */
+        size_t              layer;      /* Overlay layer of the set */
+        size_t              file_index; /* Position of file in {set}_files[] */
+} path_entry_t;
+
+typedef struct path_list {
+        path_entry_t *items;
+        size_t        count;
+        size_t        cap;
+        size_t        file_count;
+} path_list_t;
+
+static int path_list_push(path_list_t *list, const char *set, const vfs_file_t *file,
+                          const vfs_folder_t *folder) {
+    if(list->count == list->cap) {
+        size_t        cap = list->cap ? list->cap * 2 : 64;
+        path_entry_t *items = realloc(list->items, cap * sizeof(path_entry_t));
+        if(!items) return -1;
+        list->items = items;
+        list->cap = cap;
+    }
 
-    /* Generate all file data arrays */
-    generate_all_data(&ctx, config->root);
+    path_entry_t *e = &list->items[list->count++];
+    const char   *path = file ? file->path : folder->path;
+    e->file = file;
+    e->folder = folder;
+    e->hash = cirf_hash_bytes(path, strlen(path));
+    e->set = set;
+    e->layer = 0;
+    e->file_index = file ? list->file_count++ : 0;
+    return 0;
+}
 
-    /* Collect folder info for cross-references */
-    folder_info_t *info_list = NULL;
-    int            file_idx = 0;
-    int            folder_idx = 0;
-    collect_folder_info(config->root, &info_list, &file_idx, &folder_idx);
+/* Collect every file and folder below (and excluding) the root of set. Files
+ * are visited in the order of the flat {set}_files[] table. */
+static int collect_paths(const vfs_folder_t *folder, const char *set, path_list_t *list) {
+    if(folder->parent && path_list_push(list, set, NULL, folder) != 0) return -1;
 
-    /* Forward declarations for all folders (except root) */
-    for(folder_info_t *info = info_list; info; info = info->next) {
-        if(info->self_index > 0) { /* Skip root */
-            generate_folder_forward_decl(&ctx, info->folder);
-        }
+    for(const vfs_file_t *f = folder->files; f; f = f->next) {
+        if(path_list_push(list, set, f, NULL) != 0) return -1;
+    }
+    for(const vfs_folder_t *c = folder->children; c; c = c->next) {
+        if(collect_paths(c, set, list) != 0) return -1;
+    }
+    return 0;
+}
+
+/* Expression for the address of an entry's file struct */
+static void write_file_ref(writer_t *w, const path_entry_t *e) {
+    writer_printf(w, "&%s_files[%zu]", e->set, e->file_index);
+}
+
+static void write_folder_ref(writer_t *w, const path_entry_t *e) {
+    char *sym = make_dir_symbol(e->set, e->folder->path);
+    if(sym) {
+        writer_printf(w, "&%s", sym);
+        free(sym);
+    }
+}
+
+static void write_path_entry(codegen_ctx_t *ctx, const path_entry_t *e) {
+    writer_puts(ctx->w, "{ ");
+    if(e->file) {
+        write_file_ref(ctx->w, e);
+        writer_puts(ctx->w, ", NULL }");
+    } else {
+        writer_puts(ctx->w, "NULL, ");
+        write_folder_ref(ctx->w, e);
+        writer_puts(ctx->w, " }");
+    }
+}
+
+/*
+ * Build the perfect hash over the paths of list and the entries in slot
+ * order. Returns 1 on success, 0 if the hashes collide (warned about), -1 on
+ * allocation failure.
+ */
+static int plan_hash_slots(const char *name, const path_list_t *list, phash_t **ph_out,
+                           const path_entry_t ***by_slot_out) {
+    uint64_t *hashes = malloc(list->count * sizeof(uint64_t));
+    if(!hashes) return -1;
+    for(size_t i = 0; i < list->count; i++) {
+        hashes[i] = list->items[i].hash;
+    }
+
+    phash_t     *ph = NULL;
+    cirf_error_t err = phash_build(hashes, list->count, &ph);
+    free(hashes);
+    if(err == CIRF_ERR_NOMEM) return -1;
+    if(err != CIRF_OK) {
+        /* Colliding path hashes: lookups fall back to walking the tree */
+        fprintf(stderr, "Warning: cannot build path hash index for '%s': %s\n", name,
+                cirf_error_string(err));
+        return 0;
+    }
+
+    /* Invert the key -> slot assignment so entries are written in slot order */
+    const path_entry_t **by_slot = calloc(list->count, sizeof(path_entry_t *));
+    if(!by_slot) {
+        phash_destroy(ph);
+        return -1;
+    }
+    for(size_t i = 0; i < list->count; i++) {
+        by_slot[ph->slots[i]] = &list->items[i];
+    }
+
+    *ph_out = ph;
+    *by_slot_out = by_slot;
+    return 1;
+}
+
+/* Returns 1 if the tables were emitted, 0 if skipped, -1 on allocation failure */
+static int generate_hash_tables(codegen_ctx_t *ctx, const path_list_t *list) {
+    phash_t             *ph = NULL;
+    const path_entry_t **by_slot = NULL;
+    int                  planned = plan_hash_slots(ctx->name, list, &ph, &by_slot);
+    if(planned <= 0) return planned;
+
+    writer_printf(ctx->w, "static const int32_t %s_hash_seeds[] = {\n", ctx->name);
+    writer_indent(ctx->w);
+    for(size_t b = 0; b < ph->bucket_count; b++) {
+        writer_printf(ctx->w, "%ld", (long)ph->seeds[b]);
+        if(b + 1 < ph->bucket_count) {
+            writer_puts(ctx->w, (b + 1) % 12 == 0 ? ",\n" : ", ");
+        }
+    }
+    writer_newline(ctx->w);
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, "};\n\n");
+
+    writer_printf(ctx->w, "static const cirf_path_entry_t %s_hash_entries[] = {\n", ctx->name);
+    writer_indent(ctx->w);
+    for(size_t i = 0; i < list->count; i++) {
+        write_path_entry(ctx, by_slot[i]);
+        writer_puts(ctx->w, i + 1 < list->count ? ",\n" : "\n");
+    }
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, "};\n\n");
+
+    free(by_slot);
+    phash_destroy(ph);
+    return 1;
+}
+
+/* Bloom filter over the file paths of list, NULL if out of memory */
+static bloom_t *plan_filter(const path_list_t *list) {
+    uint64_t *hashes = malloc((list->count ? list->count : 1) * sizeof(uint64_t));
+    if(!hashes) return NULL;
+    size_t count = 0;
+    for(size_t i = 0; i < list->count; i++) {
+        if(list->items[i].file) hashes[count++] = list->items[i].hash;
+    }
+
+    bloom_t     *bloom = NULL;
+    cirf_error_t err = bloom_build(hashes, count, CODEGEN_FILTER_BITS_PER_KEY, &bloom);
+    free(hashes);
+    return err == CIRF_OK ? bloom : NULL;
+}
+
+/* Bloom filter over file paths; returns 1 if emitted, -1 on allocation failure */
+static int generate_filter_tables(codegen_ctx_t *ctx, const path_list_t *list) {
+    bloom_t *bloom = plan_filter(list);
+    if(!bloom) return -1;
+
+    size_t words = bloom->block_count * CIRF_BLOOM_WORDS;
+    writer_printf(ctx->w, "static const uint64_t %s_filter[] = {\n", ctx->name);
+    writer_indent(ctx->w);
+    for(size_t i = 0; i < words; i++) {
+        writer_printf(ctx->w, "0x%016llxULL", (unsigned long long)bloom->words[i]);
+        if(i + 1 < words) {
+            writer_puts(ctx->w, (i + 1) % 4 == 0 ? ",\n" : ", ");
+        }
+    }
+    writer_newline(ctx->w);
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, "};\n\n");
+
+    ctx->filter_block_count = bloom->block_count;
+    bloom_destroy(bloom);
+    return 1;
+}
+
+static int compare_entry_path(const void *a, const void *b) {
+    const path_entry_t *x = *(const path_entry_t *const *)a;
+    const path_entry_t *y = *(const path_entry_t *const *)b;
+    return strcmp(x->file ? x->file->path : x->folder->path,
+                  y->file ? y->file->path : y->folder->path);
+}
+
+/* Returns 1 if the tables were emitted, 0 if skipped, -1 on allocation failure */
+static int generate_trie_tables(codegen_ctx_t *ctx, const path_list_t *list) {
+    const path_entry_t **sorted = malloc(list->count * sizeof(path_entry_t *));
+    const char         **keys = malloc(list->count * sizeof(char *));
+    if(!sorted || !keys) {
+        free(sorted);
+        free(keys);
+        return -1;
+    }
+    for(size_t i = 0; i < list->count; i++) {
+        sorted[i] = &list->items[i];
+    }
+    qsort(sorted, list->count, sizeof(path_entry_t *), compare_entry_path);
+    for(size_t i = 0; i < list->count; i++) {
+        keys[i] = sorted[i]->file ? sorted[i]->file->path : sorted[i]->folder->path;
+    }
+
+    trie_t      *trie = NULL;
+    cirf_error_t err = trie_build(keys, list->count, &trie);
+    free(keys);
+    if(err != CIRF_OK) {
+        free(sorted);
+        return err == CIRF_ERR_NOMEM ? -1 : 0;
+    }
+
+    /* Node fields are 16/32-bit in the generated tables */
+    int fits = trie->labels_len <= UINT32_MAX && trie->node_count <= UINT32_MAX;
+    for(size_t i = 0; fits && i < trie->node_count; i++) {
+        fits = trie->nodes[i].label_len <= UINT16_MAX;
+    }
+    if(!fits) {
+        fprintf(stderr, "Warning: paths too long for the trie index of '%s'\n", ctx->name);
+        trie_destroy(trie);
+        free(sorted);
+        return 0;
+    }
+
+    writer_printf(ctx->w, "static const cirf_trie_node_t %s_trie_nodes[] = {\n", ctx->name);
+    writer_indent(ctx->w);
+    for(size_t i = 0; i < trie->node_count; i++) {
+        const trie_node_t *n = &trie->nodes[i];
+        writer_printf(ctx->w, "{ %zu, %zu, %d, %zu, %zu, %zu }", n->label, n->label_len,
+                      n->terminal, n->end, n->entry_first, n->entry_end);
+        writer_puts(ctx->w, i + 1 < trie->node_count ? ",\n" : "\n");
+    }
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, "};\n\n");
+
+    /* Sized exactly: the pool is not NUL-terminated */
+    writer_printf(ctx->w, "static const char %s_trie_labels[%zu] =\n", ctx->name,
+                  trie->labels_len ? trie->labels_len : 1);
+    writer_indent(ctx->w);
+    for(size_t off = 0; off < trie->labels_len || off == 0; off += 64) {
+        size_t n = trie->labels_len - off < 64 ? trie->labels_len - off : 64;
+        writer_write_string_bytes(ctx->w, (const unsigned char *)trie->labels + off, n);
+        writer_newline(ctx->w);
+        if(!trie->labels_len) break;
+    }
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, ";\n\n");
+
+    writer_printf(ctx->w, "static const cirf_path_entry_t %s_trie_entries[] = {\n", ctx->name);
+    writer_indent(ctx->w);
+    for(size_t i = 0; i < list->count; i++) {
+        write_path_entry(ctx, sorted[i]);
+        writer_puts(ctx->w, i + 1 < list->count ? ",\n" : "\n");
+    }
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, "};\n\n");
+
+    ctx->trie_node_count = trie->node_count;
+    trie_destroy(trie);
+    free(sorted);
+    return 1;
+}
+
+typedef struct {
+        const char *key;   /* NULL for MIME postings */
+        const char *value;
+        size_t      file_index;
+} query_entry_t;
+
+static int compare_query_entry(const void *a, const void *b) {
+    const query_entry_t *ea = (const query_entry_t *)a;
+    const query_entry_t *eb = (const query_entry_t *)b;
+    int                  c = ea->key ? strcmp(ea->key, eb->key) : 0;
+    if(!c) c = strcmp(ea->value, eb->value);
+    if(!c) c = (ea->file_index > eb->file_index) - (ea->file_index < eb->file_index);
+    return c;
+}
+
+static int same_posting(const query_entry_t *a, const query_entry_t *b) {
+    return (!a->key || strcmp(a->key, b->key) == 0) && strcmp(a->value, b->value) == 0;
+}
+
+/* Emit the postings of sorted entries; their file lists go to files[*next] */
+static void write_postings(codegen_ctx_t *ctx, const char *table, const query_entry_t *entries,
+                           size_t count, uint32_t *files, size_t *next, size_t *posting_count) {
+    writer_printf(ctx->w, "static const cirf_posting_t %s_%s[] = {\n", ctx->name, table);
+    writer_indent(ctx->w);
+    *posting_count = 0;
+    for(size_t i = 0; i < count;) {
+        size_t end = i + 1;
+        while(end < count && same_posting(&entries[i], &entries[end])) {
+            end++;
+        }
+
+        writer_puts(ctx->w, "{ ");
+        if(entries[i].key) {
+            writer_write_string_escaped(ctx->w, entries[i].key);
+            writer_puts(ctx->w, ", ");
+            writer_write_string_escaped(ctx->w, entries[i].value);
+        } else {
+            writer_printf(ctx->w, "NULL, %s_mime_%zu", ctx->mimes->name,
+                          mime_id(ctx->mimes, entries[i].value));
+        }
+        writer_printf(ctx->w, ", %zu, %zu },\n", *next, end - i);
+
+        for(; i < end; i++) {
+            files[(*next)++] = (uint32_t)entries[i].file_index;
+        }
+        (*posting_count)++;
+    }
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, "};\n\n");
+}
+
+/*
+ * Inverted metadata and MIME indexes over the files of list. A file's
+ * metadata counts once per key, like its generated metadata array.
+ * Returns 1 if emitted, 0 if the set has no files, -1 on allocation failure.
+ */
+static int generate_query_tables(codegen_ctx_t *ctx, const path_list_t *list) {
+    size_t meta_count = 0;
+    size_t mime_count = 0;
+    for(size_t i = 0; i < list->count; i++) {
+        if(!list->items[i].file) continue;
+        meta_count += vfs_metadata_count(list->items[i].file->metadata);
+        mime_count++;
+    }
+    if(mime_count == 0) return 0;
+
+    query_entry_t *meta = malloc((meta_count ? meta_count : 1) * sizeof(query_entry_t));
+    query_entry_t *mime = malloc(mime_count * sizeof(query_entry_t));
+    uint32_t      *files = malloc((meta_count + mime_count) * sizeof(uint32_t));
+    if(!meta || !mime || !files) {
+        free(meta);
+        free(mime);
+        free(files);
+        return -1;
+    }
+
+    meta_count = 0;
+    mime_count = 0;
+    for(size_t i = 0; i < list->count; i++) {
+        const path_entry_t *e = &list->items[i];
+        if(!e->file) continue;
+
+        for(const vfs_metadata_t *m = e->file->metadata; m; m = m->next) {
+            /* Only the first entry of a key, as in the metadata array */
+            if(vfs_get_metadata(e->file->metadata, m->key) != m->value) continue;
+            meta[meta_count].key = m->key;
+            meta[meta_count].value = m->value;
+            meta[meta_count].file_index = e->file_index;
+            meta_count++;
+        }
+
+        mime[mime_count].key = NULL;
+        mime[mime_count].value = file_mime(e->file);
+        mime[mime_count].file_index = e->file_index;
+        mime_count++;
+    }
+    qsort(meta, meta_count, sizeof(query_entry_t), compare_query_entry);
+    qsort(mime, mime_count, sizeof(query_entry_t), compare_query_entry);
+
+    size_t next = 0;
+    if(meta_count > 0) {
+        write_postings(ctx, "meta_postings", meta, meta_count, files, &next,
+                       &ctx->meta_posting_count);
+    } else {
+        ctx->meta_posting_count = 0;
+    }
+    write_postings(ctx, "mime_postings", mime, mime_count, files, &next,
+                   &ctx->mime_posting_count);
+
+    writer_printf(ctx->w, "static const uint32_t %s_query_files[] = {\n", ctx->name);
+    writer_indent(ctx->w);
+    for(size_t i = 0; i < next; i++) {
+        writer_printf(ctx->w, "%lu", (unsigned long)files[i]);
+        if(i + 1 < next) {
+            writer_puts(ctx->w, (i + 1) % 16 == 0 ? ",\n" : ", ");
+        }
+    }
+    writer_newline(ctx->w);
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, "};\n\n");
+
+    free(meta);
+    free(mime);
+    free(files);
+    return 1;
+}
+
+/* Emit one hot array of name lengths or pool offsets */
+static void write_hot_u32s(codegen_ctx_t *ctx, const char *table, const uint32_t *values,
+                           size_t count) {
+    writer_printf(ctx->w, "static const uint32_t %s_hot_%s[%zu] = {\n", ctx->name, table,
+                  count ? count : 1);
+    writer_indent(ctx->w);
+    for(size_t i = 0; i < count; i++) {
+        writer_printf(ctx->w, "%u", (unsigned)values[i]);
+        if(i + 1 < count) {
+            writer_puts(ctx->w, (i + 1) % 16 == 0 ? ",\n" : ", ");
+        }
+    }
+    if(!count) writer_puts(ctx->w, "0");
+    writer_newline(ctx->w);
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, "};\n\n");
+}
+
+/* Emit one hot array of fingerprints */
+static void write_hot_u64s(codegen_ctx_t *ctx, const char *table, const uint64_t *values,
+                           size_t count) {
+    writer_printf(ctx->w, "static const uint64_t %s_hot_%s[%zu] = {\n", ctx->name, table,
+                  count ? count : 1);
+    writer_indent(ctx->w);
+    for(size_t i = 0; i < count; i++) {
+        writer_printf(ctx->w, "0x%016llxULL", (unsigned long long)values[i]);
+        if(i + 1 < count) {
+            writer_puts(ctx->w, (i + 1) % 4 == 0 ? ",\n" : ", ");
+        }
+    }
+    if(!count) writer_puts(ctx->w, "0");
+    writer_newline(ctx->w);
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, "};\n\n");
+}
+
+/* Emit the fingerprints, tails, lengths and name offsets of count names */
+static void write_hot_names(codegen_ctx_t *ctx, const char *kind, const compact_plan_t *plan,
+                            const char *const *names, size_t count, uint64_t *fps,
+                            uint32_t *scratch) {
+    char table[32];
+
+    for(size_t i = 0; i < count; i++) {
+        fps[i] = cirf_name_fp(names[i], strlen(names[i]));
+    }
+    snprintf(table, sizeof(table), "%s_fps", kind);
+    write_hot_u64s(ctx, table, fps, count);
+
+    for(size_t i = 0; i < count; i++) {
+        size_t len = strlen(names[i]);
+        fps[i] = len > 8 ? cirf_name_fp(names[i] + 8, len - 8) : 0;
+    }
+    snprintf(table, sizeof(table), "%s_tails", kind);
+    write_hot_u64s(ctx, table, fps, count);
+
+    for(size_t i = 0; i < count; i++) {
+        scratch[i] = (uint32_t)strlen(names[i]);
+    }
+    snprintf(table, sizeof(table), "%s_lens", kind);
+    write_hot_u32s(ctx, table, scratch, count);
+
+    for(size_t i = 0; i < count; i++) {
+        scratch[i] = (uint32_t)compact_string(plan, names[i]);
+    }
+    snprintf(table, sizeof(table), "%s_names", kind);
+    write_hot_u32s(ctx, table, scratch, count);
+}
+
+/*
+ * Hot lookup arrays: the names of all folders, breadth-first, and files, in
+ * flat-table order, as parallel arrays, each folder's child and file ranges,
+ * and one pool of the distinct names. Returns 1, or -1 on allocation failure.
+ */
+static int generate_hot_tables(codegen_ctx_t *ctx, const vfs_folder_t *root) {
+    compact_plan_t plan = {0};
+    if(plan_tree(root, 1, 0, &plan) != CIRF_OK) {
+        free_compact_plan(&plan);
+        return -1;
+    }
+    pool_strings(&plan);
+
+    size_t       total = plan.folder_count > plan.file_count ? plan.folder_count : plan.file_count;
+    const char **names = malloc(total * sizeof(char *));
+    uint64_t    *fps = malloc(total * sizeof(uint64_t));
+    uint32_t    *scratch = malloc(total * sizeof(uint32_t));
+    if(!names || !fps || !scratch) {
+        free(names);
+        free(fps);
+        free(scratch);
+        free_compact_plan(&plan);
+        return -1;
+    }
+
+    for(size_t i = 0; i < plan.folder_count; i++) {
+        names[i] = plan.folders[i].folder->name;
+    }
+    write_hot_names(ctx, "folder", &plan, names, plan.folder_count, fps, scratch);
+
+    writer_printf(ctx->w, "static const cirf_hot_range_t %s_hot_ranges[%zu] = {\n", ctx->name,
+                  plan.folder_count);
+    writer_indent(ctx->w);
+    for(size_t i = 0; i < plan.folder_count; i++) {
+        const cfolder_plan_t *d = &plan.folders[i];
+        writer_printf(ctx->w, "{ %u, %zu, %u, %zu }%s\n", (unsigned)d->children,
+                      vfs_folder_count(d->folder), (unsigned)d->files, vfs_file_count(d->folder),
+                      i + 1 < plan.folder_count ? "," : "");
+    }
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, "};\n\n");
+
+    writer_printf(ctx->w, "static const cirf_folder_t * const %s_hot_folders[%zu] = {\n",
+                  ctx->name, plan.folder_count);
+    writer_indent(ctx->w);
+    for(size_t i = 0; i < plan.folder_count; i++) {
+        char *sym = make_dir_symbol(ctx->name, plan.folders[i].folder->path);
+        if(sym) {
+            writer_printf(ctx->w, "&%s%s\n", sym, i + 1 < plan.folder_count ? "," : "");
+            free(sym);
+        }
+    }
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, "};\n\n");
+
+    for(size_t i = 0; i < plan.file_count; i++) {
+        names[i] = plan.files[i].file->name;
+    }
+    write_hot_names(ctx, "file", &plan, names, plan.file_count, fps, scratch);
+
+    writer_printf(ctx->w, "static const char %s_hot_names[%zu] =\n", ctx->name,
+                  plan.string_bytes);
+    writer_indent(ctx->w);
+    for(size_t i = 0; i < plan.string_count; i++) {
+        writer_write_string_bytes(ctx->w, (const unsigned char *)plan.strings[i],
+                                  strlen(plan.strings[i]) + 1);
+        writer_puts(ctx->w, i + 1 < plan.string_count ? "\n" : ";\n\n");
+    }
+    writer_dedent(ctx->w);
+
+    writer_printf(ctx->w, "static const cirf_hot_t %s_hot = {\n", ctx->name);
+    writer_indent(ctx->w);
+    writer_printf(ctx->w, ".folder_fps = %s_hot_folder_fps,\n", ctx->name);
+    writer_printf(ctx->w, ".folder_tails = %s_hot_folder_tails,\n", ctx->name);
+    writer_printf(ctx->w, ".folder_lens = %s_hot_folder_lens,\n", ctx->name);
+    writer_printf(ctx->w, ".folder_names = %s_hot_folder_names,\n", ctx->name);
+    writer_printf(ctx->w, ".folder_ranges = %s_hot_ranges,\n", ctx->name);
+    writer_printf(ctx->w, ".folders = %s_hot_folders,\n", ctx->name);
+    writer_printf(ctx->w, ".folder_count = %zu,\n", plan.folder_count);
+    writer_printf(ctx->w, ".file_fps = %s_hot_file_fps,\n", ctx->name);
+    writer_printf(ctx->w, ".file_tails = %s_hot_file_tails,\n", ctx->name);
+    writer_printf(ctx->w, ".file_lens = %s_hot_file_lens,\n", ctx->name);
+    writer_printf(ctx->w, ".file_names = %s_hot_file_names,\n", ctx->name);
+    writer_printf(ctx->w, ".file_count = %zu,\n", plan.file_count);
+    writer_printf(ctx->w, ".names = %s_hot_names\n", ctx->name);
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, "};\n\n");
+
+    free(names);
+    free(fps);
+    free(scratch);
+    free_compact_plan(&plan);
+    return 1;
+}
+
+/* Emit the tables requested in ctx->indexes and {name}_index over list */
+static cirf_error_t generate_index_tables(codegen_ctx_t *ctx, const vfs_folder_t *root,
+                                          const path_list_t *list) {
+    int has_hash = 0;
+    int has_trie = 0;
+    int has_filter = 0;
+    int has_query = 0;
+    int has_hot = 0;
+    if(ctx->indexes & CODEGEN_INDEX_HASH) {
+        has_hash = generate_hash_tables(ctx, list);
+    }
+    if(has_hash >= 0 && (ctx->indexes & CODEGEN_INDEX_TRIE)) {
+        has_trie = generate_trie_tables(ctx, list);
+    }
+    if(has_hash >= 0 && has_trie >= 0 && (ctx->indexes & CODEGEN_INDEX_FILTER)) {
+        has_filter = generate_filter_tables(ctx, list);
+    }
+    if(has_hash >= 0 && has_trie >= 0 && has_filter >= 0 &&
+       (ctx->indexes & CODEGEN_INDEX_QUERY)) {
+        has_query = generate_query_tables(ctx, list);
+    }
+    /* Hot arrays need a tree; the overlay index (root == NULL) has none */
+    if(has_hash >= 0 && has_trie >= 0 && has_filter >= 0 && has_query >= 0 && root &&
+       (ctx->indexes & CODEGEN_INDEX_HOT)) {
+        has_hot = generate_hot_tables(ctx, root);
+    }
+    if(has_hash < 0 || has_trie < 0 || has_filter < 0 || has_query < 0 || has_hot < 0) {
+        return CIRF_ERR_NOMEM;
+    }
+
+    if(has_hash || has_trie || has_filter || has_query || has_hot) {
+        writer_printf(ctx->w, "static const cirf_index_t %s_index = {\n", ctx->name);
+        writer_indent(ctx->w);
+        if(has_hash) {
+            writer_printf(ctx->w, ".hash_seeds = %s_hash_seeds,\n", ctx->name);
+            writer_printf(ctx->w, ".hash_bucket_count = %zu,\n", list->count);
+            writer_printf(ctx->w, ".hash_entries = %s_hash_entries,\n", ctx->name);
+            writer_printf(ctx->w, ".hash_entry_count = %zu,\n", list->count);
+        }
+        if(has_trie) {
+            writer_printf(ctx->w, ".trie_nodes = %s_trie_nodes,\n", ctx->name);
+            writer_printf(ctx->w, ".trie_node_count = %zu,\n", ctx->trie_node_count);
+            writer_printf(ctx->w, ".trie_labels = %s_trie_labels,\n", ctx->name);
+            writer_printf(ctx->w, ".trie_entries = %s_trie_entries,\n", ctx->name);
+            writer_printf(ctx->w, ".trie_entry_count = %zu,\n", list->count);
+        }
+        if(has_filter) {
+            writer_printf(ctx->w, ".filter = %s_filter,\n", ctx->name);
+            writer_printf(ctx->w, ".filter_block_count = %zu,\n", ctx->filter_block_count);
+        }
+        if(has_query) {
+            if(ctx->meta_posting_count) {
+                writer_printf(ctx->w, ".meta_postings = %s_meta_postings,\n", ctx->name);
+                writer_printf(ctx->w, ".meta_posting_count = %zu,\n", ctx->meta_posting_count);
+            }
+            writer_printf(ctx->w, ".mime_postings = %s_mime_postings,\n", ctx->name);
+            writer_printf(ctx->w, ".mime_posting_count = %zu,\n", ctx->mime_posting_count);
+            writer_printf(ctx->w, ".query_files = %s_query_files,\n", ctx->name);
+        }
+        if(has_hot) {
+            writer_printf(ctx->w, ".hot = &%s_hot,\n", ctx->name);
+        }
+        writer_dedent(ctx->w);
+        writer_puts(ctx->w, "};\n\n");
+        ctx->has_index = 1;
+    }
+    return CIRF_OK;
+}
+
+static cirf_error_t generate_index(codegen_ctx_t *ctx, const vfs_folder_t *root) {
+    path_list_t list = {0};
+    if(collect_paths(root, ctx->name, &list) != 0) {
+        free(list.items);
+        return CIRF_ERR_NOMEM;
+    }
+
+    cirf_error_t err = CIRF_OK;
+    if(list.count > 0) {
+        err = generate_index_tables(ctx, root, &list);
+    }
+    free(list.items);
+    return err;
+}
+
+static int compare_entry_hash(const void *a, const void *b) {
+    uint64_t ha = ((const path_entry_t *)a)->hash;
+    uint64_t hb = ((const path_entry_t *)b)->hash;
+    return (ha > hb) - (ha < hb);
+}
+
+/*
+ * Emit {NAME}_FILE("path"): a switch over the path hashes of all files that
+ * an optimizing compiler folds to the file pointer when the argument is a
+ * string literal. Unknown literals reach cirf_const_path_unknown(), which is
+ * a compile error where CIRF_HAVE_CONST_PATH_CHECK is available. A hash
+ * shared by several paths gets a case that looks the literal up with
+ * find(&{name}_{root}, path) at run time.
+ */
+static cirf_error_t generate_const_lookup(writer_t *w, const char *name, path_list_t *list,
+                                          const char *file_type, const char *find,
+                                          const char *root) {
+    /* Keep files short enough for CIRF_HASH_LITERAL() */
+    size_t count = 0;
+    for(size_t i = 0; i < list->count; i++) {
+        const vfs_file_t *f = list->items[i].file;
+        if(f && strlen(f->path) <= CIRF_CONST_PATH_MAX && list->items[i].hash != 0) {
+            list->items[count++] = list->items[i];
+        }
+    }
+    list->count = count;
+    qsort(list->items, count, sizeof(path_entry_t), compare_entry_hash);
+
+    char *macro = make_identifier(name);
+    if(!macro) {
+        return CIRF_ERR_NOMEM;
+    }
+    for(char *p = macro; *p; p++)
+        *p = toupper((unsigned char)*p);
+
+    writer_puts(w, "\n/* Compile-time lookup of constant paths */\n");
+    writer_printf(w,
+                  "CIRF_ALWAYS_INLINE const %s *%s_const_file(cirf_hash_t hash, const char *path) "
+                  "{\n",
+                  file_type, name);
+    writer_indent(w);
+    writer_puts(w, "switch(hash) {\n");
+    for(size_t i = 0; i < count; i++) {
+        uint64_t hash = list->items[i].hash;
+        size_t   end = i + 1;
+        while(end < count && list->items[end].hash == hash)
+            end++;
+
+        /* Colliding paths cannot be told apart by the hash alone */
+        if(end - i > 1) {
+            for(size_t j = i; j < end; j++) {
+                fprintf(stderr,
+                        "Warning: path hash of '%s' collides, looked up at run time by "
+                        "%s_FILE()\n",
+                        list->items[j].file->path, macro);
+            }
+            writer_printf(w, "case 0x%016llxULL: return %s(&%s_%s, path);\n",
+                          (unsigned long long)hash, find, name, root);
+            i = end - 1;
+            continue;
+        }
+
+        char *sym = make_file_symbol(list->items[i].set, list->items[i].file->path);
+        if(!sym) {
+            free(macro);
+            return CIRF_ERR_NOMEM;
+        }
+        writer_printf(w, "case 0x%016llxULL: return %s;\n", (unsigned long long)hash, sym);
+        free(sym);
+    }
+    writer_puts(w, "default: break;\n");
+    writer_puts(w, "}\n");
+    writer_puts(w, "(void)path;\n");
+    writer_printf(w, "return CIRF_CONST_PATH_UNKNOWN(const %s *, hash);\n", file_type);
+    writer_dedent(w);
+    writer_puts(w, "}\n\n");
+
+    writer_printf(w, "/* %s_FILE(\"path\") - file for a string literal path (NULL or compile error\n",
+                  macro);
+    writer_puts(w, " * if unknown). Use cirf_find_file() for paths known only at run time. */\n");
+    writer_printf(w, "#define %s_FILE(path) %s_const_file(CIRF_HASH_LITERAL(path), path)\n",
+                  macro, name);
+
+    free(macro);
+    return CIRF_OK;
+}
+
+/* ========================================================================
+ * Overlays
+ *
+ * With several configs, each becomes a resource set (a layer) of its own
+ * and {name}_overlay resolves a path to the file of the last layer that
+ * has it. The overlay index covers only the winning files.
+ * ======================================================================== */
+
+static int compare_entry_layer_path(const void *a, const void *b) {
+    const path_entry_t *ea = (const path_entry_t *)a;
+    const path_entry_t *eb = (const path_entry_t *)b;
+    int                 c = strcmp(ea->file->path, eb->file->path);
+    if(c) return c;
+    return (ea->layer > eb->layer) - (ea->layer < eb->layer);
+}
+
+/*
+ * Collect the files of all layers, then keep only the winner for each path
+ * (in path order). A path that is a file in one layer and a folder in
+ * another cannot be merged.
+ */
+static cirf_error_t collect_overlay_files(cirf_config_t *const *layers, size_t count,
+                                          path_list_t *list) {
+    for(size_t l = 0; l < count; l++) {
+        size_t first = list->count;
+        list->file_count = 0;
+        if(collect_paths(layers[l]->root, layers[l]->name, list) != 0) {
+            return CIRF_ERR_NOMEM;
+        }
+        for(size_t i = first; i < list->count; i++) {
+            list->items[i].layer = l;
+        }
+    }
+
+    size_t files = 0;
+    for(size_t i = 0; i < list->count; i++) {
+        if(list->items[i].file) list->items[files++] = list->items[i];
+    }
+    list->count = files;
+
+    for(size_t i = 0; i < list->count; i++) {
+        const char *path = list->items[i].file->path;
+        for(size_t l = 0; l < count; l++) {
+            if(vfs_find_folder(layers[l]->root, path)) {
+                fprintf(stderr, "Error: '%s' is a file in one layer and a folder in another\n",
+                        path);
+                return CIRF_ERR_DUPLICATE;
+            }
+        }
+    }
+
+    /* Sorted by path, then layer: the last entry of each path wins */
+    qsort(list->items, list->count, sizeof(path_entry_t), compare_entry_layer_path);
+    size_t kept = 0;
+    for(size_t i = 0; i < list->count; i++) {
+        if(i + 1 < list->count &&
+           strcmp(list->items[i].file->path, list->items[i + 1].file->path) == 0) {
+            continue;
+        }
+        list->items[kept++] = list->items[i];
+    }
+    list->count = kept;
+    return CIRF_OK;
+}
+
+static cirf_error_t generate_overlay(codegen_ctx_t *ctx, cirf_config_t *const *layers,
+                                     size_t count, const path_list_t *list) {
+    writer_printf(ctx->w, "/* Overlay: a path resolves to the last layer that has it */\n");
+    writer_printf(ctx->w, "static const cirf_folder_t * const %s_layers[] = {\n", ctx->name);
+    writer_indent(ctx->w);
+    for(size_t l = 0; l < count; l++) {
+        writer_printf(ctx->w, "&%s_root,\n", layers[l]->name);
+    }
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, "};\n\n");
+
+    if(list->count > 0) {
+        writer_printf(ctx->w, "static const cirf_file_t * const %s_overlay_files[] = {\n",
+                      ctx->name);
+        writer_indent(ctx->w);
+        for(size_t i = 0; i < list->count; i++) {
+            write_file_ref(ctx->w, &list->items[i]);
+            writer_puts(ctx->w, ",\n");
+        }
+        writer_dedent(ctx->w);
+        writer_puts(ctx->w, "};\n\n");
+
+        cirf_error_t err = generate_index_tables(ctx, NULL, list);
+        if(err != CIRF_OK) return err;
+    }
+
+    writer_printf(ctx->w, "const cirf_overlay_t %s_overlay = {\n", ctx->name);
+    writer_indent(ctx->w);
+    writer_printf(ctx->w, ".layers = %s_layers,\n", ctx->name);
+    writer_printf(ctx->w, ".layer_count = %zu,\n", count);
+    if(ctx->has_index) {
+        writer_printf(ctx->w, ".index = &%s_index,\n", ctx->name);
+    } else {
+        writer_puts(ctx->w, ".index = NULL,\n");
+    }
+    if(list->count > 0) {
+        writer_printf(ctx->w, ".files = %s_overlay_files,\n", ctx->name);
+    } else {
+        writer_puts(ctx->w, ".files = NULL,\n");
+    }
+    writer_printf(ctx->w, ".file_count = %zu\n", list->count);
+    writer_dedent(ctx->w);
+    writer_puts(ctx->w, "};\n");
+    return CIRF_OK;
+}
+
+/* ========================================================================
+ * Compact layout
+ * ======================================================================== */
+
+/* Metadata entries of a subtree before sort_metadata() drops repeated keys */
+static size_t subtree_metadata_count(const vfs_folder_t *folder) {
+    size_t count = vfs_metadata_count(folder->metadata);
+    for(const vfs_file_t *f = folder->files; f; f = f->next) {
+        count += vfs_metadata_count(f->metadata);
+    }
+    for(const vfs_folder_t *c = folder->children; c; c = c->next) {
+        count += subtree_metadata_count(c);
+    }
+    return count;
+}
+
+/*
+ * Reserve the metadata entries of one record and add their keys and values
+ * to the string pool; -1 if out of memory
+ */
+static int plan_compact_metadata(compact_plan_t *plan, const meta_keys_t *keys,
+                                 const vfs_metadata_t *meta, uint32_t *first, uint32_t *count) {
+    size_t        n;
+    meta_entry_t *entries = sort_metadata(keys, meta, &n);
+    if(!entries && meta) return -1;
+    for(size_t i = 0; i < n; i++) {
+        plan->strings[plan->string_count++] = entries[i].meta->key;
+        plan->strings[plan->string_count++] = entries[i].meta->value;
+    }
+    free(entries);
+
+    *first = n ? (uint32_t)plan->metadata_count : 0;
+    *count = (uint32_t)n;
+    plan->metadata_count += n;
+    return 0;
+}
+
+/*
+ * Lay out the compact image of a set: the records of plan_tree(), metadata
+ * of the folders, then of the files, one blob of all file data, and one
+ * string pool holding every name, MIME type, metadata key and value once.
+ */
+static cirf_error_t plan_compact(const cirf_config_t *config, const meta_keys_t *keys,
+                                 compact_plan_t *plan) {
+    cirf_error_t err =
+        plan_tree(config->root, 2, 2 * subtree_metadata_count(config->root), plan);
+    if(err != CIRF_OK) return err;
+
+    for(size_t i = 0; i < plan->folder_count; i++) {
+        cfolder_plan_t *d = &plan->folders[i];
+        if(plan_compact_metadata(plan, keys, d->folder->metadata, &d->metadata,
+                                 &d->metadata_count) != 0) {
+            return CIRF_ERR_NOMEM;
+        }
+    }
+
+    for(size_t i = 0; i < plan->file_count; i++) {
+        cfile_plan_t *f = &plan->files[i];
+
+        f->data = (uint32_t)plan->blob_bytes;
+        plan->blob_bytes += f->file->size;
+        if(plan_compact_metadata(plan, keys, f->file->metadata, &f->metadata,
+                                 &f->metadata_count) != 0) {
+            return CIRF_ERR_NOMEM;
+        }
+        if(f->metadata_count > UINT16_MAX) {
+            fprintf(stderr, "Error: '%s' has too many metadata entries for the compact layout\n",
+                    f->file->path);
+            return CIRF_ERR_INVALID;
+        }
+        plan->strings[plan->string_count++] = file_mime(f->file);
+    }
+    pool_strings(plan);
+
+    /* Self-relative offsets are 32-bit */
+    size_t image_bytes = plan->folder_count * sizeof(cirf_cfolder_t) +
+                         plan->file_count * sizeof(cirf_cfile_t) +
+                         plan->metadata_count * sizeof(cirf_cmeta_t) + plan->string_bytes;
+    if(plan->blob_bytes > (size_t)INT32_MAX || image_bytes > (size_t)INT32_MAX - plan->blob_bytes) {
+        fprintf(stderr, "Error: '%s' is too large for the compact layout (2 GiB)\n",
+                config->name);
+        return CIRF_ERR_INVALID;
+    }
+    return CIRF_OK;
+}
+
+static size_t align_up(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+/*
+ * Bytes of the pointer layout's tables for the same set on a target with
+ * pointer_size-byte pointers and size_t, see codegen_stats_t. The structure
+ * sizes follow the member lists of cirf_file_t and cirf_folder_t.
+ */
+static cirf_error_t pointer_layout_bytes(const compact_plan_t *plan, const mime_table_t *mimes,
+                                         size_t pointer_size, size_t *bytes_out) {
+    size_t p = pointer_size;
+    size_t file_bytes = align_up(8 * p, 8) + 8 + 4 + 4 + 8;
+    size_t folder_bytes = align_up(9 * p, 8) + 8 + 4 * p + 4 + 4 + 8;
+
+    /* Identical literals are emitted once by the compiler */
+    size_t       string_count = 0;
+    const char **strings = malloc((plan->folder_count + plan->file_count) * 2 * sizeof(char *) +
+                                  sizeof(char *));
+    if(!strings) return CIRF_ERR_NOMEM;
+    for(size_t i = 0; i < plan->folder_count; i++) {
+        strings[string_count++] = plan->folders[i].folder->name;
+        strings[string_count++] = plan->folders[i].folder->path;
+    }
+    for(size_t i = 0; i < plan->file_count; i++) {
+        strings[string_count++] = plan->files[i].file->name;
+        strings[string_count++] = plan->files[i].file->path;
+    }
+    qsort(strings, string_count, sizeof(char *), compare_string);
+
+    size_t bytes = 0;
+    for(size_t i = 0; i < string_count; i++) {
+        if(i == 0 || strcmp(strings[i], strings[i - 1]) != 0) {
+            bytes += strlen(strings[i]) + 1;
+        }
+    }
+    free(strings);
+
+    /* MIME strings and the {name}_mimes[] table */
+    for(size_t i = 0; i < mimes->count; i++) {
+        bytes += strlen(mimes->types[i]) + 1;
+    }
+    bytes += (mimes->count + 1) * p;
+
+    /* Structures, children arrays and the {name}_file_* pointers */
+    bytes += plan->folder_count * folder_bytes + (plan->folder_count - 1) * p;
+    bytes += plan->file_count * (file_bytes + p);
+
+    *bytes_out = bytes;
+    return CIRF_OK;
+}
+
+static cirf_error_t compact_stats(const compact_plan_t *plan, const mime_table_t *mimes,
+                                  codegen_stats_t *stats) {
+    stats->compact_bytes = plan->folder_count * sizeof(cirf_cfolder_t) +
+                           plan->file_count * sizeof(cirf_cfile_t) + plan->string_bytes;
+
+    cirf_error_t err = pointer_layout_bytes(plan, mimes, 4, &stats->pointer_bytes_32);
+    if(err == CIRF_OK) {
+        err = pointer_layout_bytes(plan, mimes, 8, &stats->pointer_bytes_64);
+    }
+    return err;
+}
+
+/* Image type, image and record macros of a compact set */
+static cirf_error_t write_compact_decls(writer_t *w, const cirf_config_t *config,
+                                        const compact_plan_t *plan) {
+    const char *name = config->name;
+
+    writer_puts(w, "/* Compact image, see cirf_cfile_t in <cirf/types.h> */\n");
+    writer_puts(w, "typedef struct {\n");
+    writer_indent(w);
+    writer_indent(w);
+    writer_printf(w, "cirf_cfolder_t  folders[%zu];\n", plan->folder_count);
+    writer_printf(w, "cirf_cfile_t    files[%zu];\n", plan->file_count ? plan->file_count : 1);
+    writer_printf(w, "cirf_cmeta_t    metadata[%zu];\n",
+                  plan->metadata_count ? plan->metadata_count : 1);
+    writer_printf(w, "char            strings[%zu];\n", plan->string_bytes);
+    writer_printf(w, "unsigned char   blob[%zu];\n", plan->blob_bytes ? plan->blob_bytes : 1);
+    writer_dedent(w);
+    writer_dedent(w);
+    writer_printf(w, "} %s_image_t;\n\n", name);
+    writer_printf(w, "extern const %s_image_t %s_image;\n\n", name, name);
+
+    /* Same spelling as the pointer layout: &{name}_root, {name}_file_* */
+    writer_printf(w, "#define %s_root (%s_image.folders[0])\n", name, name);
+    for(size_t i = 1; i < plan->folder_count; i++) {
+        char *sym = make_dir_symbol(name, plan->folders[i].folder->path);
+        if(!sym) return CIRF_ERR_NOMEM;
+        writer_printf(w, "#define %s (%s_image.folders[%zu])\n", sym, name, i);
+        free(sym);
+    }
+    writer_newline(w);
+
+    for(size_t i = 0; i < plan->file_count; i++) {
+        char *sym = make_file_symbol(name, plan->files[i].file->path);
+        if(!sym) return CIRF_ERR_NOMEM;
+        writer_printf(w, "#define %s (&%s_image.files[%zu])\n", sym, name, i);
+        free(sym);
+    }
+
+    path_list_t list = {0};
+    if(collect_paths(config->root, name, &list) != 0) {
+        free(list.items);
+        return CIRF_ERR_NOMEM;
+    }
+    cirf_error_t err = generate_const_lookup(w, name, &list, "cirf_cfile_t",
+                                             "cirf_compact_find_file", "root");
+    free(list.items);
+    return err;
+}
+
+/* Emit a path as a comment, unless it could end the comment early */
+static void write_path_comment(writer_t *w, const char *path) {
+    if(strstr(path, "*/")) return;
+    writer_puts(w, "/* ");
+    writer_write_string_escaped(w, path);
+    writer_puts(w, " */");
+}
+
+/*
+ * Emit the metadata entries of one record into the image's metadata[],
+ * starting at *index; rel is the image's offset macro
+ */
+static cirf_error_t write_compact_metadata(writer_t *w, const char *rel, const meta_keys_t *keys,
+                                           const compact_plan_t *plan,
+                                           const vfs_metadata_t *meta, size_t *index) {
+    size_t        count;
+    meta_entry_t *entries = sort_metadata(keys, meta, &count);
+    if(!entries) return meta ? CIRF_ERR_NOMEM : CIRF_OK;
+
+    for(size_t i = 0; i < count; i++, (*index)++) {
+        writer_printf(w, "{ %s_REL(strings[%zu], metadata[%zu].key), ", rel,
+                      compact_string(plan, entries[i].meta->key), *index);
+        writer_printf(w, "%s_REL(strings[%zu], metadata[%zu].value)", rel,
+                      compact_string(plan, entries[i].meta->value), *index);
+        write_meta_values(w, &entries[i]);
+    }
+    free(entries);
+    return CIRF_OK;
+}
+
+/* The image of a compact set; every reference is a CIRF_REL() offset */
+static cirf_error_t write_compact_source(writer_t *w, const cirf_config_t *config,
+                                         const meta_keys_t *keys, const mime_table_t *mimes,
+                                         const compact_plan_t *plan, int data_encoding) {
+    const char *name = config->name;
+    char       *rel = make_identifier(name);
+    if(!rel) return CIRF_ERR_NOMEM;
+    for(char *p = rel; *p; p++)
+        *p = toupper((unsigned char)*p);
+
+    writer_printf(w, "#define %s_REL(to, from) CIRF_REL(%s_image_t, to, from)\n\n", rel, name);
+    writer_printf(w, "const %s_image_t %s_image = {\n", name, name);
+    writer_indent(w);
+
+    writer_puts(w, ".folders = {\n");
+    writer_indent(w);
+    for(size_t i = 0; i < plan->folder_count; i++) {
+        const cfolder_plan_t *d = &plan->folders[i];
+
+        writer_puts(w, "{ ");
+        write_path_comment(w, d->folder->path);
+        writer_newline(w);
+        writer_indent(w);
+        writer_printf(w, "%s_REL(strings[%zu], folders[%zu].name),\n", rel,
+                      compact_string(plan, d->folder->name), i);
+        if(d->tree_file_count > 0) {
+            writer_printf(w, "%s_REL(files[%u], folders[%zu].files),\n", rel, (unsigned)d->files,
+                          i);
+        } else {
+            writer_puts(w, "0,\n");
+        }
+        writer_printf(w, "%zu, %u,\n", vfs_file_count(d->folder), (unsigned)d->tree_file_count);
+        if(d->folder->children) {
+            writer_printf(w, "%s_REL(folders[%u], folders[%zu].children),\n", rel,
+                          (unsigned)d->children, i);
+        } else {
+            writer_puts(w, "0,\n");
+        }
+        writer_printf(w, "%zu, %u,\n", vfs_folder_count(d->folder),
+                      (unsigned)d->tree_folder_count);
+        if(d->metadata_count > 0) {
+            writer_printf(w, "%s_REL(metadata[%u], folders[%zu].metadata), %u\n", rel,
+                          (unsigned)d->metadata, i, (unsigned)d->metadata_count);
+        } else {
+            writer_puts(w, "0, 0\n");
+        }
+        writer_dedent(w);
+        writer_puts(w, "},\n");
+    }
+    writer_dedent(w);
+    writer_puts(w, "},\n");
+
+    writer_puts(w, ".files = {\n");
+    writer_indent(w);
+    for(size_t i = 0; i < plan->file_count; i++) {
+        const cfile_plan_t *f = &plan->files[i];
+        const char         *mime = file_mime(f->file);
+
+        writer_puts(w, "{ ");
+        write_path_comment(w, f->file->path);
+        writer_newline(w);
+        writer_indent(w);
+        writer_printf(w, "%s_REL(strings[%zu], files[%zu].name),\n", rel,
+                      compact_string(plan, f->file->name), i);
+        writer_printf(w, "%s_REL(strings[%zu], files[%zu].mime),\n", rel,
+                      compact_string(plan, mime), i);
+        writer_printf(w, "%s_REL(blob[%u], files[%zu].data), %zu,\n", rel,
+                      f->file->size ? (unsigned)f->data : 0u, i, f->file->size);
+        if(f->metadata_count > 0) {
+            writer_printf(w, "%s_REL(metadata[%u], files[%zu].metadata), %u,\n", rel,
+                          (unsigned)f->metadata, i, (unsigned)f->metadata_count);
+        } else {
+            writer_puts(w, "0, 0,\n");
+        }
+        writer_printf(w, "%zu\n", mime_id(mimes, mime));
+        writer_dedent(w);
+        writer_puts(w, "},\n");
+    }
+    if(plan->file_count == 0) {
+        writer_puts(w, "{ 0 }\n");
+    }
+    writer_dedent(w);
+    writer_puts(w, "},\n");
+
+    /* Folders first, then files, in the order their offsets were planned */
+    cirf_error_t err = CIRF_OK;
+    size_t       meta_index = 0;
+    writer_puts(w, ".metadata = {\n");
+    writer_indent(w);
+    for(size_t i = 0; i < plan->folder_count && err == CIRF_OK; i++) {
+        err = write_compact_metadata(w, rel, keys, plan, plan->folders[i].folder->metadata,
+                                     &meta_index);
+    }
+    for(size_t i = 0; i < plan->file_count && err == CIRF_OK; i++) {
+        err = write_compact_metadata(w, rel, keys, plan, plan->files[i].file->metadata,
+                                     &meta_index);
+    }
+    if(plan->metadata_count == 0) {
+        writer_puts(w, "{ 0 }\n");
+    }
+    writer_dedent(w);
+    writer_puts(w, "},\n");
+
+    /* Exactly sized: the literal's own terminator is not stored */
+    writer_puts(w, ".strings =\n");
+    writer_indent(w);
+    for(size_t i = 0; i < plan->string_count; i++) {
+        writer_write_string_bytes(w, (const unsigned char *)plan->strings[i],
+                                  strlen(plan->strings[i]) + 1);
+        writer_puts(w, i + 1 < plan->string_count ? "\n" : ",\n");
+    }
+    writer_dedent(w);
+
+    /* The blob is a char member, so words are spelled in hex here; #embed
+     * works anywhere in an initializer */
+    if(data_encoding == CODEGEN_DATA_STRING && plan->blob_bytes > 0) {
+        writer_puts(w, ".blob =\n");
+        writer_indent(w);
+        for(size_t i = 0; i < plan->file_count; i++) {
+            const vfs_file_t *f = plan->files[i].file;
+            if(f->size == 0) continue;
+            write_path_comment(w, f->path);
+            writer_newline(w);
+            writer_write_bytes_string(w, f->data, f->size, CODEGEN_STRING_LINE);
+            writer_newline(w);
+        }
+        writer_puts(w, ",\n");
+        writer_dedent(w);
+    } else {
+        writer_puts(w, ".blob = {\n");
+        writer_indent(w);
+        for(size_t i = 0; i < plan->file_count; i++) {
+            const vfs_file_t *f = plan->files[i].file;
+            if(f->size == 0) continue;
+            write_path_comment(w, f->path);
+            writer_newline(w);
+            if(data_encoding == CODEGEN_DATA_EMBED && f->source_path) {
+                char *path = absolute_source_path(f);
+                if(!path) {
+                    err = CIRF_ERR_INVALID;
+                    break;
+                }
+                writer_printf(w, "#embed \"%s\"\n", path);
+                free(path);
+            } else {
+                writer_write_bytes_hex(w, f->data, f->size, 12);
+            }
+            writer_puts(w, ",\n");
+        }
+        if(plan->blob_bytes == 0) {
+            writer_puts(w, "0\n");
+        }
+        writer_dedent(w);
+        writer_puts(w, "},\n");
+    }
+
+    writer_dedent(w);
+    writer_puts(w, "};\n\n");
+    writer_printf(w, "#undef %s_REL\n", rel);
+
+    free(rel);
+    return err;
+}
+
+/* ========================================================================
+ * Output files
+ * ======================================================================== */
+
+/* Declarations of one resource set */
+static cirf_error_t write_set_decls(writer_t *w, const cirf_config_t *config) {
+    const char *name = config->name;
+
+    /* Root declaration */
+    writer_printf(w, "extern const cirf_folder_t %s_root;\n", name);
+
+    /* Folder declarations */
+    generate_folder_extern_decls(w, name, config->root);
+    writer_newline(w);
+
+    /* File declarations */
+    generate_file_extern_decls(w, name, config->root);
+
+    path_list_t list = {0};
+    if(collect_paths(config->root, name, &list) != 0) {
+        free(list.items);
+        return CIRF_ERR_NOMEM;
+    }
+    cirf_error_t err =
+        generate_const_lookup(w, name, &list, "cirf_file_t", "cirf_find_file", "root");
+    free(list.items);
+    return err;
+}
+
+static cirf_error_t generate_header(cirf_config_t *const *layers, size_t count, const char *name,
+                                    const meta_keys_t *keys, const mime_table_t *mimes,
+                                    const path_list_t *overlay, const compact_plan_t *compact,
+                                    const char *path) {
+    FILE *fp = fopen(path, "w");
+    if(!fp) return CIRF_ERR_IO;
+
+    writer_t *w = writer_create(fp);
+    if(!w) {
+        fclose(fp);
+        return CIRF_ERR_NOMEM;
+    }
+
+    /* Header guard */
+    char *guard = make_identifier(name);
+    for(char *p = guard; *p; p++)
+        *p = toupper((unsigned char)*p);
+
+    writer_printf(w, "#ifndef %s_H\n", guard);
+    writer_printf(w, "#define %s_H\n\n", guard);
+    free(guard);
+
+    /* Include common types - use cirf_file_t, cirf_folder_t, cirf_metadata_t - and
+     * the lookups that {NAME}_FILE() falls back to on colliding hashes */
+    writer_puts(w, "#include <cirf/types.h>\n");
+    writer_puts(w, "#include <cirf/hash.h>\n");
+    writer_puts(w, "#include <cirf/runtime.h>\n\n");
+
+    /* The generated initializers depend on the exact structure layout */
+    writer_printf(w, "#if !defined(CIRF_ABI_VERSION) || CIRF_ABI_VERSION != %d\n",
+                  CIRF_ABI_VERSION);
+    writer_puts(w, "#error \"cirf/types.h does not match the cirf version that generated this "
+                   "file\"\n");
+    writer_puts(w, "#endif\n\n");
+
+    cirf_error_t err = write_meta_key_defines(w, name, keys);
+    if(err == CIRF_OK && mimes->count > 0) {
+        writer_puts(w, "/* MIME type IDs (cirf_file_t.mime_id), shared by all sets below */\n");
+        err = write_id_defines(w, name, "MIME", "COUNT", mimes->types, mimes->count, 1);
+        if(!compact) {
+            writer_printf(w, "extern const char * const %s_mimes[%zu];\n\n", name,
+                          mimes->count + 1);
+        }
+    }
+    if(err == CIRF_OK && compact) {
+        err = write_compact_decls(w, layers[0], compact);
+    }
+    for(size_t l = 0; l < count && err == CIRF_OK && !compact; l++) {
+        if(l > 0) writer_newline(w);
+        err = write_set_decls(w, layers[l]);
+    }
+
+    if(err == CIRF_OK && overlay) {
+        writer_printf(w, "\nextern const cirf_overlay_t %s_overlay;\n", name);
+
+        path_list_t list = {0};
+        list.items = malloc((overlay->count ? overlay->count : 1) * sizeof(path_entry_t));
+        if(list.items) {
+            memcpy(list.items, overlay->items, overlay->count * sizeof(path_entry_t));
+            list.count = overlay->count;
+            err = generate_const_lookup(w, name, &list, "cirf_file_t", "cirf_overlay_find_file",
+                                        "overlay");
+            free(list.items);
+        } else {
+            err = CIRF_ERR_NOMEM;
+        }
+    }
+
+    writer_printf(w, "\n#endif /* %s_H */\n", name);
+
+    if(writer_flush(w) != 0 && err == CIRF_OK) err = CIRF_ERR_IO;
+    writer_destroy(w);
+    if(fclose(fp) != 0 && err == CIRF_OK) err = CIRF_ERR_IO;
+    return err;
+}
+
+/* Definitions of one resource set */
+static cirf_error_t write_set_source(writer_t *w, const cirf_config_t *config,
+                                     const meta_keys_t *keys, const mime_table_t *mimes,
+                                     unsigned indexes, int data_encoding, writer_t *asm_w) {
+    const char *name = config->name;
+
+    codegen_ctx_t ctx = {.name = name,
+                         .w = w,
+                         .file_index = 0,
+                         .folder_index = 0,
+                         .metadata_index = 0,
+                         .meta_keys = keys,
+                         .mimes = mimes,
+                         .indexes = indexes,
+                         .data_encoding = data_encoding,
+                         .asm_w = asm_w,
+                         .has_index = 0,
+                         .trie_node_count = 0,
+                         .filter_block_count = 0};
+
+    /* Generate all file data arrays */
+    cirf_error_t err = generate_all_data(&ctx, config->root);
+    if(err != CIRF_OK) return err;
+
+    /* Collect folder info for cross-references */
+    folder_info_t *info_list = NULL;
+    int            file_idx = 0;
+    int            folder_idx = 0;
+    collect_folder_info(config->root, &info_list, &file_idx, &folder_idx);
+
+    /* Forward declarations for all folders (except root) */
+    for(folder_info_t *info = info_list; info; info = info->next) {
+        if(info->self_index > 0) { /* Skip root */
+            generate_folder_forward_decl(&ctx, info->folder);
+        }
     }
     writer_newline(w);
 
@@ -550,40 +2521,1022 @@ static cirf_error_t generate_source(const cirf_config_t *config, const char *pat
     file_meta_info_t *file_meta_list = NULL;
     generate_all_file_metadata(&ctx, config->root, &file_meta_list);
 
-    /* Generate files arrays */
-    file_idx = 0;
-    generate_all_files_arrays(&ctx, config->root, info_list, file_meta_list, &file_idx);
+    /* One flat table of all files in DFS order: a folder's own files, then
+     * the files of each child subtree. Every folder's files[] and subtree
+     * are contiguous slices of it. */
+    if(file_idx > 0) {
+        writer_printf(w, "static const cirf_file_t %s_files[%d] = {\n", name, file_idx);
+        writer_indent(w);
+        file_idx = 0;
+        generate_all_files_arrays(&ctx, config->root, file_meta_list, &file_idx);
+        writer_dedent(w);
+        writer_puts(w, "};\n\n");
+
+        file_idx = 0;
+        generate_file_aliases(&ctx, config->root, &file_idx);
+        writer_newline(w);
+    }
+
+    /* Generate lookup indexes (referenced from the root folder) */
+    if(ctx.indexes) {
+        err = generate_index(&ctx, config->root);
+    }
 
     /* Generate folder structures (children before parents) */
     generate_all_folders(&ctx, config->root, info_list);
 
     free_file_meta_info(file_meta_list);
     free_folder_info(info_list);
+    return err;
+}
+
+static cirf_error_t generate_source(cirf_config_t *const *layers, size_t count,
+                                    const codegen_options_t *options, const meta_keys_t *keys,
+                                    const mime_table_t *mimes, const path_list_t *overlay,
+                                    const compact_plan_t *compact, const char *header_name) {
+    FILE *fp = fopen(options->source_path, "w");
+    if(!fp) return CIRF_ERR_IO;
+
+    writer_t *w = writer_create(fp);
+    if(!w) {
+        fclose(fp);
+        return CIRF_ERR_NOMEM;
+    }
+
+    writer_printf(w, "#include \"%s\"\n\n", header_name);
+
+    if(options->data_encoding == CODEGEN_DATA_WORDS && !compact) {
+        writer_puts(w, "/* File data is stored as little-endian 64-bit words */\n");
+        writer_puts(w, "#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__\n");
+        writer_puts(w, "#error \"generated with --encoding words, which needs a little-endian "
+                       "target\"\n");
+        writer_puts(w, "#endif\n\n");
+    }
+
+    if(options->data_encoding == CODEGEN_DATA_EMBED) {
+        writer_puts(w, "#if !defined(__has_embed)\n");
+        writer_puts(w, "#error \"generated with --encoding embed, which needs a compiler with "
+                       "C23 #embed\"\n");
+        writer_puts(w, "#endif\n\n");
+    }
+
+    /* With --encoding incbin the file data goes to an assembly file */
+    FILE     *afp = NULL;
+    writer_t *aw = NULL;
+    if(options->data_encoding == CODEGEN_DATA_INCBIN) {
+        afp = fopen(options->asm_path, "w");
+        aw = afp ? writer_create(afp) : NULL;
+        if(!aw) {
+            if(afp) fclose(afp);
+            writer_destroy(w);
+            fclose(fp);
+            return afp ? CIRF_ERR_NOMEM : CIRF_ERR_IO;
+        }
+        write_asm_prologue(aw, options->name);
+    }
+
+    cirf_error_t err = CIRF_OK;
+    if(compact) {
+        /* MIME types live in the image's string pool */
+        err = write_compact_source(w, layers[0], keys, mimes, compact, options->data_encoding);
+        count = 0;
+    } else {
+        write_mime_table(w, mimes);
+    }
+    for(size_t l = 0; l < count && err == CIRF_OK; l++) {
+        err = write_set_source(w, layers[l], keys, mimes, options->indexes,
+                               options->data_encoding, aw);
+    }
+
+    if(err == CIRF_OK && overlay) {
+        /* Lookups through an overlay always go through its hash index */
+        codegen_ctx_t ctx = {.name = options->name,
+                             .w = w,
+                             .indexes = CODEGEN_INDEX_HASH |
+                                        (options->indexes & CODEGEN_INDEX_FILTER)};
+        err = generate_overlay(&ctx, layers, count, overlay);
+    }
 
     /* No API implementations - use cirf_runtime library for helper functions */
 
+    if(aw) {
+        write_asm_epilogue(aw);
+        if(writer_flush(aw) != 0 && err == CIRF_OK) err = CIRF_ERR_IO;
+        writer_destroy(aw);
+        if(fclose(afp) != 0 && err == CIRF_OK) err = CIRF_ERR_IO;
+    }
+
+    if(writer_flush(w) != 0 && err == CIRF_OK) err = CIRF_ERR_IO;
     writer_destroy(w);
-    fclose(fp);
+    if(fclose(fp) != 0 && err == CIRF_OK) err = CIRF_ERR_IO;
+    return err;
+}
+
+/* ========================================================================
+ * Object output
+ *
+ * With options->object_path, one set in the pointer layout is written
+ * straight into a relocatable ELF object for options->object_target: the
+ * same symbols, structures and hash/filter indexes as the C source, laid
+ * out for the target's pointer size, byte order and alignment, so no C
+ * compiler ever sees the data. The header is generated as for C output.
+ * ======================================================================== */
+
+typedef struct {
+        int      label; /* -1 without metadata */
+        size_t   count;
+        uint64_t keys;
+} object_meta_t;
+
+typedef struct {
+        elf_object_t       *obj;
+        const char         *name;
+        const meta_keys_t  *meta_keys;
+        const mime_table_t *mimes;
+        size_t              pointer_size;
+        size_t              struct_align;  /* Of the runtime structures on the target */
+        int                *key_labels;    /* Per key ID, -1 until first used */
+        int                *mime_labels;   /* Per MIME ID - 1 */
+        int                *file_labels;   /* Per entry of the flat file table */
+        int                *data_labels;   /* Per file */
+        object_meta_t      *file_meta;     /* Per file */
+        int                *folder_labels; /* Per folder, depth-first */
+        int                 index_label;   /* {name}_index, -1 if there is none */
+} object_ctx_t;
+
+static uint32_t meta_type_id(vfs_meta_type_t type) {
+    switch(type) {
+        case VFS_META_INT:
+            return CIRF_META_INT;
+        case VFS_META_REAL:
+            return CIRF_META_REAL;
+        case VFS_META_BOOL:
+            return CIRF_META_BOOL;
+        default:
+            return CIRF_META_STRING;
+    }
+}
+
+/* A NUL-terminated string in .rodata */
+static int object_string(object_ctx_t *ctx, const char *s) {
+    int label = elf_label(ctx->obj);
+    elf_place(ctx->obj, label, ELF_RODATA);
+    elf_put_bytes(ctx->obj, ELF_RODATA, s, strlen(s) + 1);
+    return label;
+}
+
+/* .name and .path; the name is the tail of the path and points into it */
+static void object_put_name_path(object_ctx_t *ctx, const char *name, const char *path) {
+    size_t name_len = strlen(name);
+    size_t path_len = strlen(path);
+    int    label = object_string(ctx, path);
+    if(path_len >= name_len && strcmp(path + path_len - name_len, name) == 0) {
+        elf_put_addr(ctx->obj, ELF_RELRO, label, path_len - name_len);
+    } else {
+        elf_put_addr(ctx->obj, ELF_RELRO, object_string(ctx, name), 0);
+    }
+    elf_put_addr(ctx->obj, ELF_RELRO, label, 0);
+}
+
+/* .name_len, the 32-bit field after it (mime_id or flags) and .name_fp */
+static void object_put_name_key(object_ctx_t *ctx, const char *name, uint32_t next) {
+    size_t len = strlen(name);
+    elf_put_u32(ctx->obj, ELF_RELRO, (uint32_t)len);
+    elf_put_u32(ctx->obj, ELF_RELRO, next);
+    elf_put_u64(ctx->obj, ELF_RELRO, cirf_name_fp(name, len));
+    elf_align(ctx->obj, ELF_RELRO, ctx->struct_align);
+}
+
+/* One cirf_metadata_t array, see generate_metadata() */
+static cirf_error_t object_metadata(object_ctx_t *ctx, const vfs_metadata_t *meta,
+                                    object_meta_t *out) {
+    out->label = -1;
+    out->count = 0;
+    out->keys = 0;
+    if(!meta) return CIRF_OK;
+
+    size_t        count;
+    meta_entry_t *entries = sort_metadata(ctx->meta_keys, meta, &count);
+    if(!entries) return CIRF_ERR_NOMEM;
+
+    elf_align(ctx->obj, ELF_RELRO, ctx->struct_align);
+    out->label = elf_label(ctx->obj);
+    elf_place(ctx->obj, out->label, ELF_RELRO);
+    for(size_t i = 0; i < count; i++) {
+        const vfs_metadata_t *m = entries[i].meta;
+        uint32_t              id = entries[i].key_id;
+        if(ctx->key_labels[id] < 0) {
+            ctx->key_labels[id] = object_string(ctx, m->key);
+        }
+        if(id < 64) out->keys |= (uint64_t)1 << id;
+
+        elf_put_addr(ctx->obj, ELF_RELRO, ctx->key_labels[id], 0);
+        elf_put_addr(ctx->obj, ELF_RELRO, object_string(ctx, m->value), 0);
+        elf_put_u32(ctx->obj, ELF_RELRO, id);
+        elf_put_u32(ctx->obj, ELF_RELRO, meta_type_id(m->type));
+        elf_put_u64(ctx->obj, ELF_RELRO, (uint64_t)m->integer);
+        elf_put_f64(ctx->obj, ELF_RELRO, m->real);
+        elf_align(ctx->obj, ELF_RELRO, ctx->struct_align);
+    }
+    out->count = count;
+    free(entries);
+    return CIRF_OK;
+}
+
+static void object_put_metadata_ref(object_ctx_t *ctx, const object_meta_t *meta) {
+    elf_put_addr(ctx->obj, ELF_RELRO, meta->label, 0);
+    elf_put_size(ctx->obj, ELF_RELRO, meta->count);
+    elf_put_u64(ctx->obj, ELF_RELRO, meta->keys);
+}
+
+/* A global symbol over what was written to .data.rel.ro since start */
+static cirf_error_t object_symbol(object_ctx_t *ctx, char *sym, int label, size_t start) {
+    if(!sym) return CIRF_ERR_NOMEM;
+    elf_symbol(ctx->obj, sym, label, elf_offset(ctx->obj, ELF_RELRO) - start);
+    free(sym);
+    return CIRF_OK;
+}
+
+/* The type strings and {name}_mimes[], NULL first as in write_mime_table() */
+static cirf_error_t object_mime_table(object_ctx_t *ctx) {
+    const mime_table_t *mimes = ctx->mimes;
+    if(mimes->count == 0) return CIRF_OK;
+
+    for(size_t i = 0; i < mimes->count; i++) {
+        ctx->mime_labels[i] = object_string(ctx, mimes->types[i]);
+    }
+
+    char *sym = malloc(strlen(mimes->name) + sizeof("_mimes"));
+    if(sym) sprintf(sym, "%s_mimes", mimes->name);
+    int    label = elf_label(ctx->obj);
+    size_t start = elf_offset(ctx->obj, ELF_RELRO);
+    elf_place(ctx->obj, label, ELF_RELRO);
+    elf_put_addr(ctx->obj, ELF_RELRO, -1, 0);
+    for(size_t i = 0; i < mimes->count; i++) {
+        elf_put_addr(ctx->obj, ELF_RELRO, ctx->mime_labels[i], 0);
+    }
+    return object_symbol(ctx, sym, label, start);
+}
+
+/* File data and metadata in the order of the flat file table */
+static cirf_error_t object_file_data(object_ctx_t *ctx, const vfs_folder_t *folder,
+                                     int *file_idx) {
+    for(const vfs_file_t *f = folder->files; f; f = f->next) {
+        int i = (*file_idx)++;
+        ctx->data_labels[i] = elf_label(ctx->obj);
+        elf_align(ctx->obj, ELF_RODATA, incbin_alignment(f->size));
+        elf_place(ctx->obj, ctx->data_labels[i], ELF_RODATA);
+        elf_put_bytes(ctx->obj, ELF_RODATA, f->data, f->size);
+
+        cirf_error_t err = object_metadata(ctx, f->metadata, &ctx->file_meta[i]);
+        if(err != CIRF_OK) return err;
+    }
+
+    for(const vfs_folder_t *c = folder->children; c; c = c->next) {
+        cirf_error_t err = object_file_data(ctx, c, file_idx);
+        if(err != CIRF_OK) return err;
+    }
+    return CIRF_OK;
+}
+
+/* The entries of the flat file table; folders are numbered depth-first */
+static void object_files(object_ctx_t *ctx, const vfs_folder_t *folder, int *file_idx,
+                         int *folder_idx) {
+    int parent = (*folder_idx)++;
+    for(const vfs_file_t *f = folder->files; f; f = f->next) {
+        int    i = (*file_idx)++;
+        size_t mime = mime_id(ctx->mimes, file_mime(f));
+        elf_place(ctx->obj, ctx->file_labels[i], ELF_RELRO);
+        object_put_name_path(ctx, f->name, f->path);
+        elf_put_addr(ctx->obj, ELF_RELRO, ctx->mime_labels[mime - 1], 0);
+        elf_put_addr(ctx->obj, ELF_RELRO, ctx->data_labels[i], 0);
+        elf_put_size(ctx->obj, ELF_RELRO, f->size);
+        elf_put_addr(ctx->obj, ELF_RELRO, ctx->folder_labels[parent], 0);
+        object_put_metadata_ref(ctx, &ctx->file_meta[i]);
+        object_put_name_key(ctx, f->name, (uint32_t)mime);
+    }
+
+    for(const vfs_folder_t *c = folder->children; c; c = c->next) {
+        object_files(ctx, c, file_idx, folder_idx);
+    }
+}
+
+/* {name}_file_<path>, pointers into the flat table as in generate_file_aliases() */
+static cirf_error_t object_file_aliases(object_ctx_t *ctx, const vfs_folder_t *folder,
+                                        int *file_idx) {
+    for(const vfs_file_t *f = folder->files; f; f = f->next) {
+        int    label = elf_label(ctx->obj);
+        size_t start = elf_offset(ctx->obj, ELF_RELRO);
+        elf_place(ctx->obj, label, ELF_RELRO);
+        elf_put_addr(ctx->obj, ELF_RELRO, ctx->file_labels[(*file_idx)++], 0);
+        cirf_error_t err = object_symbol(ctx, make_file_symbol(ctx->name, f->path), label, start);
+        if(err != CIRF_OK) return err;
+    }
+
+    for(const vfs_folder_t *c = folder->children; c; c = c->next) {
+        cirf_error_t err = object_file_aliases(ctx, c, file_idx);
+        if(err != CIRF_OK) return err;
+    }
+    return CIRF_OK;
+}
+
+/*
+ * The hash and filter indexes and {name}_index, see generate_index_tables().
+ * Folder entries are numbered depth-first, which is the order in which
+ * collect_paths() visits them.
+ */
+static cirf_error_t object_index(object_ctx_t *ctx, const vfs_folder_t *root, unsigned indexes) {
+    path_list_t list = {0};
+    if(collect_paths(root, ctx->name, &list) != 0) {
+        free(list.items);
+        return CIRF_ERR_NOMEM;
+    }
+    if(list.count == 0) {
+        free(list.items);
+        return CIRF_OK;
+    }
+
+    int *folder_of = malloc(list.count * sizeof(int));
+    if(!folder_of) {
+        free(list.items);
+        return CIRF_ERR_NOMEM;
+    }
+    int folders = 0;
+    for(size_t i = 0; i < list.count; i++) {
+        folder_of[i] = list.items[i].folder ? ++folders : -1;
+    }
+
+    phash_t             *ph = NULL;
+    const path_entry_t **by_slot = NULL;
+    bloom_t             *bloom = NULL;
+    int                  has_hash = 0;
+    int                  seeds = -1; /* Labels of the tables */
+    int                  entries = -1;
+    int                  filter = -1;
+    if(indexes & CODEGEN_INDEX_HASH) {
+        has_hash = plan_hash_slots(ctx->name, &list, &ph, &by_slot);
+    }
+    if(has_hash > 0) {
+        seeds = elf_label(ctx->obj);
+        elf_align(ctx->obj, ELF_RODATA, 4);
+        elf_place(ctx->obj, seeds, ELF_RODATA);
+        for(size_t b = 0; b < ph->bucket_count; b++) {
+            elf_put_u32(ctx->obj, ELF_RODATA, (uint32_t)ph->seeds[b]);
+        }
+
+        entries = elf_label(ctx->obj);
+        elf_align(ctx->obj, ELF_RELRO, ctx->pointer_size);
+        elf_place(ctx->obj, entries, ELF_RELRO);
+        for(size_t i = 0; i < list.count; i++) {
+            const path_entry_t *e = by_slot[i];
+            int                 folder = folder_of[e - list.items];
+            elf_put_addr(ctx->obj, ELF_RELRO, e->file ? ctx->file_labels[e->file_index] : -1, 0);
+            elf_put_addr(ctx->obj, ELF_RELRO, folder >= 0 ? ctx->folder_labels[folder] : -1, 0);
+        }
+    }
+    if(has_hash >= 0 && (indexes & CODEGEN_INDEX_FILTER)) {
+        bloom = plan_filter(&list);
+        if(bloom) {
+            filter = elf_label(ctx->obj);
+            elf_align(ctx->obj, ELF_RODATA, 8);
+            elf_place(ctx->obj, filter, ELF_RODATA);
+            for(size_t i = 0; i < bloom->block_count * CIRF_BLOOM_WORDS; i++) {
+                elf_put_u64(ctx->obj, ELF_RODATA, bloom->words[i]);
+            }
+        }
+    }
+
+    cirf_error_t err = CIRF_OK;
+    if(has_hash < 0 || ((indexes & CODEGEN_INDEX_FILTER) && !bloom)) {
+        err = CIRF_ERR_NOMEM;
+    } else if(has_hash || bloom) {
+        /* Members in the order of cirf_index_t; trie and query stay NULL/0 */
+        ctx->index_label = elf_label(ctx->obj);
+        elf_align(ctx->obj, ELF_RELRO, ctx->pointer_size);
+        elf_place(ctx->obj, ctx->index_label, ELF_RELRO);
+        elf_put_addr(ctx->obj, ELF_RELRO, seeds, 0);
+        elf_put_size(ctx->obj, ELF_RELRO, has_hash ? list.count : 0);
+        elf_put_addr(ctx->obj, ELF_RELRO, entries, 0);
+        elf_put_size(ctx->obj, ELF_RELRO, has_hash ? list.count : 0);
+        for(int i = 0; i < 5; i++) {
+            elf_put_size(ctx->obj, ELF_RELRO, 0);
+        }
+        elf_put_addr(ctx->obj, ELF_RELRO, filter, 0);
+        elf_put_size(ctx->obj, ELF_RELRO, bloom ? bloom->block_count : 0);
+        for(int i = 0; i < 6; i++) {
+            elf_put_size(ctx->obj, ELF_RELRO, 0);
+        }
+    }
+
+    if(bloom) bloom_destroy(bloom);
+    if(ph) phash_destroy(ph);
+    free(by_slot);
+    free(folder_of);
+    free(list.items);
+    return err;
+}
+
+/* Folder structures and their children arrays, see generate_folder_struct() */
+static cirf_error_t object_folders(object_ctx_t *ctx, folder_info_t *const *infos, int count) {
+    int *parent_of = malloc((size_t)count * sizeof(int));
+    if(!parent_of) return CIRF_ERR_NOMEM;
+    parent_of[0] = -1;
+
+    cirf_error_t err = CIRF_OK;
+    for(int i = 0; i < count && err == CIRF_OK; i++) {
+        const folder_info_t *info = infos[i];
+        const vfs_folder_t  *folder = info->folder;
+
+        object_meta_t meta;
+        err = object_metadata(ctx, folder->metadata, &meta);
+        if(err != CIRF_OK) break;
+
+        /* Children are numbered after their parent, each after the subtree
+         * of the previous one */
+        int children = -1;
+        if(info->children_count > 0) {
+            children = elf_label(ctx->obj);
+            elf_align(ctx->obj, ELF_RELRO, ctx->pointer_size);
+            elf_place(ctx->obj, children, ELF_RELRO);
+            for(int c = info->children_start; c < info->tree_folders_end;
+                c = infos[c]->tree_folders_end) {
+                parent_of[c] = i;
+                elf_put_addr(ctx->obj, ELF_RELRO, ctx->folder_labels[c], 0);
+            }
+        }
+
+        int    tree_file_count = info->tree_files_end - info->files_start;
+        int    files = ctx->file_labels ? ctx->file_labels[info->files_start] : -1;
+        size_t start;
+        elf_align(ctx->obj, ELF_RELRO, ctx->struct_align);
+        start = elf_offset(ctx->obj, ELF_RELRO);
+        elf_place(ctx->obj, ctx->folder_labels[i], ELF_RELRO);
+        object_put_name_path(ctx, folder->name, folder->path);
+        elf_put_addr(ctx->obj, ELF_RELRO,
+                     parent_of[i] >= 0 ? ctx->folder_labels[parent_of[i]] : -1, 0);
+        elf_put_addr(ctx->obj, ELF_RELRO, children, 0);
+        elf_put_size(ctx->obj, ELF_RELRO, (uint64_t)info->children_count);
+        elf_put_addr(ctx->obj, ELF_RELRO, info->files_count > 0 ? files : -1, 0);
+        elf_put_size(ctx->obj, ELF_RELRO, (uint64_t)info->files_count);
+        object_put_metadata_ref(ctx, &meta);
+        elf_put_addr(ctx->obj, ELF_RELRO, i == 0 ? ctx->index_label : -1, 0);
+        elf_put_addr(ctx->obj, ELF_RELRO, tree_file_count > 0 ? files : -1, 0);
+        elf_put_size(ctx->obj, ELF_RELRO, (uint64_t)tree_file_count);
+        elf_put_size(ctx->obj, ELF_RELRO, (uint64_t)(info->tree_folders_end - i - 1));
+        object_put_name_key(ctx, folder->name, CIRF_FOLDER_SORTED | CIRF_FOLDER_SUBTREE);
+        err = object_symbol(ctx, make_dir_symbol(ctx->name, folder->path), ctx->folder_labels[i],
+                            start);
+    }
+
+    free(parent_of);
+    return err;
+}
+
+static cirf_error_t generate_object(const cirf_config_t *config, const codegen_options_t *options,
+                                    const meta_keys_t *keys, const mime_table_t *mimes) {
+    const elf_target_t *target = options->object_target;
+
+    folder_info_t *info_list = NULL;
+    int            file_count = 0;
+    int            folder_count = 0;
+    collect_folder_info(config->root, &info_list, &file_count, &folder_count);
+
+    object_ctx_t ctx = {.obj = elf_create(target),
+                        .name = config->name,
+                        .meta_keys = keys,
+                        .mimes = mimes,
+                        .pointer_size = target->pointer_size,
+                        .struct_align = target->pointer_size > target->align64
+                                            ? target->pointer_size
+                                            : target->align64,
+                        .index_label = -1};
+    folder_info_t **infos = malloc((size_t)folder_count * sizeof(folder_info_t *));
+    ctx.key_labels = malloc((keys->count ? keys->count : 1) * sizeof(int));
+    ctx.mime_labels = malloc((mimes->count ? mimes->count : 1) * sizeof(int));
+    ctx.file_labels = file_count ? malloc((size_t)file_count * sizeof(int)) : NULL;
+    ctx.data_labels = file_count ? malloc((size_t)file_count * sizeof(int)) : NULL;
+    ctx.file_meta = file_count ? malloc((size_t)file_count * sizeof(object_meta_t)) : NULL;
+    ctx.folder_labels = malloc((size_t)folder_count * sizeof(int));
+
+    cirf_error_t err = CIRF_OK;
+    if(!ctx.obj || !infos || !ctx.key_labels || !ctx.mime_labels ||
+       (file_count && (!ctx.file_labels || !ctx.data_labels || !ctx.file_meta)) ||
+       !ctx.folder_labels) {
+        err = CIRF_ERR_NOMEM;
+    } else {
+        int n = 0;
+        for(folder_info_t *info = info_list; info; info = info->next) {
+            infos[n++] = info;
+        }
+        for(size_t i = 0; i < keys->count; i++) {
+            ctx.key_labels[i] = -1;
+        }
+        for(int i = 0; i < file_count; i++) {
+            ctx.file_labels[i] = elf_label(ctx.obj);
+        }
+        for(int i = 0; i < folder_count; i++) {
+            ctx.folder_labels[i] = elf_label(ctx.obj);
+        }
+        err = object_mime_table(&ctx);
+    }
+
+    int file_idx = 0;
+    int folder_idx = 0;
+    if(err == CIRF_OK) err = object_file_data(&ctx, config->root, &file_idx);
+
+    /* One contiguous table, as every folder's files[] is a slice of it */
+    if(err == CIRF_OK) {
+        file_idx = 0;
+        elf_align(ctx.obj, ELF_RELRO, ctx.struct_align);
+        object_files(&ctx, config->root, &file_idx, &folder_idx);
+    }
+    file_idx = 0;
+    if(err == CIRF_OK) err = object_file_aliases(&ctx, config->root, &file_idx);
+    if(err == CIRF_OK && options->indexes) err = object_index(&ctx, config->root, options->indexes);
+    if(err == CIRF_OK) err = object_folders(&ctx, infos, folder_count);
+    if(err == CIRF_OK) err = elf_write(ctx.obj, options->object_path);
+
+    elf_destroy(ctx.obj);
+    free(infos);
+    free(ctx.key_labels);
+    free(ctx.mime_labels);
+    free(ctx.file_labels);
+    free(ctx.data_labels);
+    free(ctx.file_meta);
+    free(ctx.folder_labels);
+    free_folder_info(info_list);
+    return err;
+}
+
+/* ========================================================================
+ * Pack output
+ *
+ * With options->pack_path, one set is written to a pack file (see
+ * <cirf/pack.h>) that the runtime maps with cirf_pack_open(), instead of
+ * C source. Records and strings are built in memory and written ahead of
+ * the file data, which goes from the loaded files straight to the output.
+ * ======================================================================== */
+
+typedef struct {
+        unsigned char *bytes;
+        size_t         len;
+        size_t         cap;
+        int            failed; /* Out of memory; bytes is incomplete */
+} pack_buf_t;
+
+typedef struct {
+        pack_buf_t          folders;
+        pack_buf_t          files;
+        pack_buf_t          metadata;
+        pack_buf_t          mimes;
+        pack_buf_t          seeds;
+        pack_buf_t          entries;
+        pack_buf_t          filter;
+        pack_buf_t          strings;
+        const meta_keys_t  *meta_keys;
+        uint32_t           *key_strings;    /* Per key ID, UINT32_MAX until first used */
+        uint32_t            metadata_count; /* Entries written so far */
+        uint32_t            hash_bucket_count;
+        uint32_t            hash_entry_count;
+        uint32_t            filter_block_count;
+        uint64_t            data_size; /* Bytes of file data, padding included */
+} pack_ctx_t;
+
+static void pack_put(pack_buf_t *b, const void *data, size_t len) {
+    if(b->failed) return;
+    if(b->cap - b->len < len) {
+        size_t cap = b->cap ? b->cap : 256;
+        while(cap - b->len < len) {
+            cap *= 2;
+        }
+        unsigned char *bytes = realloc(b->bytes, cap);
+        if(!bytes) {
+            b->failed = 1;
+            return;
+        }
+        b->bytes = bytes;
+        b->cap = cap;
+    }
+    memcpy(b->bytes + b->len, data, len);
+    b->len += len;
+}
+
+static void pack_put_u32(pack_buf_t *b, uint32_t value) {
+    unsigned char le[4];
+    for(int i = 0; i < 4; i++) {
+        le[i] = (unsigned char)(value >> (8 * i));
+    }
+    pack_put(b, le, sizeof(le));
+}
+
+static void pack_put_u64(pack_buf_t *b, uint64_t value) {
+    unsigned char le[8];
+    for(int i = 0; i < 8; i++) {
+        le[i] = (unsigned char)(value >> (8 * i));
+    }
+    pack_put(b, le, sizeof(le));
+}
+
+/* Offset of a new NUL-terminated string in the pool */
+static uint32_t pack_string(pack_ctx_t *ctx, const char *s) {
+    uint32_t offset = (uint32_t)ctx->strings.len;
+    pack_put(&ctx->strings, s, strlen(s) + 1);
+    return offset;
+}
+
+/* .name and .path; the name is the tail of the path and points into it */
+static void pack_put_name_path(pack_ctx_t *ctx, pack_buf_t *b, const char *name,
+                               const char *path) {
+    size_t   name_len = strlen(name);
+    size_t   path_len = strlen(path);
+    uint32_t offset = pack_string(ctx, path);
+    if(path_len >= name_len && strcmp(path + path_len - name_len, name) == 0) {
+        pack_put_u32(b, offset + (uint32_t)(path_len - name_len));
+    } else {
+        pack_put_u32(b, pack_string(ctx, name));
+    }
+    pack_put_u32(b, offset);
+}
+
+/* One record's metadata entries; .metadata and .metadata_count go to b */
+static cirf_error_t pack_metadata(pack_ctx_t *ctx, pack_buf_t *b, const vfs_metadata_t *meta) {
+    size_t        count;
+    meta_entry_t *entries = sort_metadata(ctx->meta_keys, meta, &count);
+    if(!entries && meta) return CIRF_ERR_NOMEM;
+
+    pack_put_u32(b, count ? ctx->metadata_count : 0);
+    pack_put_u32(b, (uint32_t)count);
+    for(size_t i = 0; i < count; i++) {
+        const vfs_metadata_t *m = entries[i].meta;
+        uint32_t              id = entries[i].key_id;
+        uint64_t              real;
+        if(ctx->key_strings[id] == UINT32_MAX) {
+            ctx->key_strings[id] = pack_string(ctx, m->key);
+        }
+        memcpy(&real, &m->real, sizeof(real));
+
+        pack_put_u32(&ctx->metadata, ctx->key_strings[id]);
+        pack_put_u32(&ctx->metadata, pack_string(ctx, m->value));
+        pack_put_u32(&ctx->metadata, id);
+        pack_put_u32(&ctx->metadata, meta_type_id(m->type));
+        pack_put_u64(&ctx->metadata, (uint64_t)m->integer);
+        pack_put_u64(&ctx->metadata, real);
+    }
+    ctx->metadata_count += (uint32_t)count;
+    free(entries);
     return CIRF_OK;
 }
 
+/* File records in the order of the flat file table; folders are numbered
+ * depth-first */
+static cirf_error_t pack_files(pack_ctx_t *ctx, const vfs_folder_t *folder,
+                               const mime_table_t *mimes, uint32_t *folder_idx) {
+    uint32_t parent = (*folder_idx)++;
+    for(const vfs_file_t *f = folder->files; f; f = f->next) {
+        uint64_t offset = align_up(ctx->data_size, incbin_alignment(f->size));
+        ctx->data_size = offset + f->size;
+
+        pack_put_u64(&ctx->files, offset); /* Made absolute by pack_write() */
+        pack_put_u64(&ctx->files, f->size);
+        pack_put_name_path(ctx, &ctx->files, f->name, f->path);
+        pack_put_u32(&ctx->files, parent);
+        pack_put_u32(&ctx->files, (uint32_t)mime_id(mimes, file_mime(f)));
+        cirf_error_t err = pack_metadata(ctx, &ctx->files, f->metadata);
+        if(err != CIRF_OK) return err;
+    }
+
+    for(const vfs_folder_t *c = folder->children; c; c = c->next) {
+        cirf_error_t err = pack_files(ctx, c, mimes, folder_idx);
+        if(err != CIRF_OK) return err;
+    }
+    return CIRF_OK;
+}
+
+/* Folder records, depth-first as numbered by collect_folder_info() */
+static cirf_error_t pack_folders(pack_ctx_t *ctx, folder_info_t *const *infos, int count) {
+    uint32_t *parent_of = malloc((size_t)count * sizeof(uint32_t));
+    if(!parent_of) return CIRF_ERR_NOMEM;
+    parent_of[0] = CIRF_PACK_NONE;
+
+    cirf_error_t err = CIRF_OK;
+    for(int i = 0; i < count && err == CIRF_OK; i++) {
+        const folder_info_t *info = infos[i];
+        for(int c = info->children_start; c < info->tree_folders_end;
+            c = infos[c]->tree_folders_end) {
+            parent_of[c] = (uint32_t)i;
+        }
+
+        pack_put_name_path(ctx, &ctx->folders, info->folder->name, info->folder->path);
+        pack_put_u32(&ctx->folders, parent_of[i]);
+        pack_put_u32(&ctx->folders, (uint32_t)info->children_count);
+        pack_put_u32(&ctx->folders, (uint32_t)(info->tree_folders_end - i - 1));
+        pack_put_u32(&ctx->folders, (uint32_t)info->files_start);
+        pack_put_u32(&ctx->folders, (uint32_t)info->files_count);
+        pack_put_u32(&ctx->folders, (uint32_t)(info->tree_files_end - info->files_start));
+        err = pack_metadata(ctx, &ctx->folders, info->folder->metadata);
+    }
+
+    free(parent_of);
+    return err;
+}
+
+/* The hash and filter indexes over every path, see object_index() */
+static cirf_error_t pack_index(pack_ctx_t *ctx, const cirf_config_t *config, unsigned indexes) {
+    path_list_t list = {0};
+    if(collect_paths(config->root, config->name, &list) != 0) {
+        free(list.items);
+        return CIRF_ERR_NOMEM;
+    }
+    if(list.count == 0) {
+        free(list.items);
+        return CIRF_OK;
+    }
+
+    uint32_t *folder_of = malloc(list.count * sizeof(uint32_t));
+    if(!folder_of) {
+        free(list.items);
+        return CIRF_ERR_NOMEM;
+    }
+    uint32_t folders = 0;
+    for(size_t i = 0; i < list.count; i++) {
+        folder_of[i] = list.items[i].folder ? ++folders : 0;
+    }
+
+    phash_t             *ph = NULL;
+    const path_entry_t **by_slot = NULL;
+    bloom_t             *bloom = NULL;
+    int                  has_hash = 0;
+    if(indexes & CODEGEN_INDEX_HASH) {
+        has_hash = plan_hash_slots(config->name, &list, &ph, &by_slot);
+    }
+    if(has_hash > 0) {
+        for(size_t b = 0; b < ph->bucket_count; b++) {
+            pack_put_u32(&ctx->seeds, (uint32_t)ph->seeds[b]);
+        }
+        for(size_t i = 0; i < list.count; i++) {
+            const path_entry_t *e = by_slot[i];
+            pack_put_u32(&ctx->entries, e->file ? (uint32_t)e->file_index
+                                                : CIRF_PACK_FOLDER | folder_of[e - list.items]);
+        }
+        ctx->hash_bucket_count = (uint32_t)ph->bucket_count;
+        ctx->hash_entry_count = (uint32_t)list.count;
+    }
+    if(has_hash >= 0 && (indexes & CODEGEN_INDEX_FILTER)) {
+        bloom = plan_filter(&list);
+        if(bloom) {
+            for(size_t i = 0; i < bloom->block_count * CIRF_BLOOM_WORDS; i++) {
+                pack_put_u64(&ctx->filter, bloom->words[i]);
+            }
+            ctx->filter_block_count = (uint32_t)bloom->block_count;
+        }
+    }
+
+    cirf_error_t err = CIRF_OK;
+    if(has_hash < 0 || ((indexes & CODEGEN_INDEX_FILTER) && !bloom)) {
+        err = CIRF_ERR_NOMEM;
+    }
+
+    if(bloom) bloom_destroy(bloom);
+    if(ph) phash_destroy(ph);
+    free(by_slot);
+    free(folder_of);
+    free(list.items);
+    return err;
+}
+
+static int pack_write_bytes(FILE *fp, const void *data, size_t len, uint64_t *offset) {
+    *offset += len;
+    return len == 0 || fwrite(data, 1, len, fp) == len ? 0 : -1;
+}
+
+static int pack_write_padding(FILE *fp, uint64_t align, uint64_t *offset) {
+    static const unsigned char zeros[32];
+    return pack_write_bytes(fp, zeros, (size_t)(align_up(*offset, align) - *offset), offset);
+}
+
+/* File data in the order of the flat file table, aligned as in pack_files() */
+static int pack_write_data(FILE *fp, const vfs_folder_t *folder, uint64_t *offset) {
+    for(const vfs_file_t *f = folder->files; f; f = f->next) {
+        if(pack_write_padding(fp, incbin_alignment(f->size), offset) != 0 ||
+           pack_write_bytes(fp, f->data, f->size, offset) != 0) {
+            return -1;
+        }
+    }
+    for(const vfs_folder_t *c = folder->children; c; c = c->next) {
+        if(pack_write_data(fp, c, offset) != 0) return -1;
+    }
+    return 0;
+}
+
+/* Header, the tables of ctx in the order of cirf_pack_header_t, then the data */
+static cirf_error_t pack_write(pack_ctx_t *ctx, const vfs_folder_t *root, uint32_t folder_count,
+                               uint32_t file_count, uint32_t mime_count, const char *path) {
+    pack_buf_t *tables[] = {&ctx->folders, &ctx->files,   &ctx->metadata, &ctx->mimes,
+                            &ctx->seeds,   &ctx->entries, &ctx->filter,   &ctx->strings};
+    uint64_t    offsets[sizeof(tables) / sizeof(tables[0])];
+    uint64_t    end = sizeof(cirf_pack_header_t);
+    for(size_t t = 0; t < sizeof(tables) / sizeof(tables[0]); t++) {
+        if(tables[t]->failed) return CIRF_ERR_NOMEM;
+        offsets[t] = align_up(end, 8);
+        end = offsets[t] + tables[t]->len;
+    }
+    uint64_t data = align_up(end, 32);
+
+    /* File data offsets were relative to the start of the data */
+    for(uint32_t i = 0; i < file_count; i++) {
+        unsigned char *field = ctx->files.bytes + (size_t)i * sizeof(cirf_pack_file_t);
+        uint64_t       value = 0;
+        for(int b = 7; b >= 0; b--) {
+            value = value << 8 | field[b];
+        }
+        value += data;
+        for(int b = 0; b < 8; b++) {
+            field[b] = (unsigned char)(value >> (8 * b));
+        }
+    }
+
+    pack_buf_t header = {0};
+    pack_put(&header, CIRF_PACK_MAGIC, 8);
+    pack_put_u32(&header, CIRF_PACK_VERSION);
+    pack_put_u32(&header, (uint32_t)sizeof(cirf_pack_header_t));
+    pack_put_u64(&header, data + ctx->data_size);
+    pack_put_u32(&header, folder_count);
+    pack_put_u32(&header, file_count);
+    pack_put_u32(&header, ctx->metadata_count);
+    pack_put_u32(&header, mime_count);
+    pack_put_u32(&header, ctx->hash_bucket_count);
+    pack_put_u32(&header, ctx->hash_entry_count);
+    pack_put_u32(&header, ctx->filter_block_count);
+    pack_put_u32(&header, 0);
+    for(size_t t = 0; t < sizeof(tables) / sizeof(tables[0]); t++) {
+        pack_put_u64(&header, offsets[t]);
+    }
+    pack_put_u64(&header, ctx->strings.len);
+    pack_put_u64(&header, data);
+    pack_put_u64(&header, ctx->data_size);
+    if(header.failed) return CIRF_ERR_NOMEM;
+
+    FILE *fp = fopen(path, "wb");
+    if(!fp) {
+        free(header.bytes);
+        return CIRF_ERR_IO;
+    }
+    uint64_t offset = 0;
+    int      failed = pack_write_bytes(fp, header.bytes, header.len, &offset);
+    for(size_t t = 0; t < sizeof(tables) / sizeof(tables[0]) && !failed; t++) {
+        failed = pack_write_padding(fp, 8, &offset) != 0 ||
+                 pack_write_bytes(fp, tables[t]->bytes, tables[t]->len, &offset) != 0;
+    }
+    if(!failed) failed = pack_write_padding(fp, 32, &offset) != 0;
+    if(!failed) failed = pack_write_data(fp, root, &offset) != 0;
+    if(fclose(fp) != 0) failed = 1;
+    free(header.bytes);
+    return failed ? CIRF_ERR_IO : CIRF_OK;
+}
+
+static cirf_error_t generate_pack(const cirf_config_t *config, const codegen_options_t *options,
+                                  const meta_keys_t *keys, const mime_table_t *mimes) {
+    folder_info_t *info_list = NULL;
+    int            file_count = 0;
+    int            folder_count = 0;
+    collect_folder_info(config->root, &info_list, &file_count, &folder_count);
+
+    pack_ctx_t      ctx = {.meta_keys = keys};
+    folder_info_t **infos = malloc((size_t)folder_count * sizeof(folder_info_t *));
+    ctx.key_strings = malloc((keys->count ? keys->count : 1) * sizeof(uint32_t));
+
+    cirf_error_t err = CIRF_OK;
+    if(!infos || !ctx.key_strings) {
+        err = CIRF_ERR_NOMEM;
+    } else {
+        int n = 0;
+        for(folder_info_t *info = info_list; info; info = info->next) {
+            infos[n++] = info;
+        }
+        for(size_t i = 0; i < keys->count; i++) {
+            ctx.key_strings[i] = UINT32_MAX;
+        }
+        for(size_t i = 0; i < mimes->count; i++) {
+            pack_put_u32(&ctx.mimes, pack_string(&ctx, mimes->types[i]));
+        }
+    }
+
+    uint32_t folder_idx = 0;
+    if(err == CIRF_OK) err = pack_files(&ctx, config->root, mimes, &folder_idx);
+    if(err == CIRF_OK) err = pack_folders(&ctx, infos, folder_count);
+    if(err == CIRF_OK && options->indexes) err = pack_index(&ctx, config, options->indexes);
+    if(err == CIRF_OK && ctx.strings.len > UINT32_MAX) {
+        fprintf(stderr, "Error: '%s' has too many names and strings for a pack (4 GiB)\n",
+                config->name);
+        err = CIRF_ERR_INVALID;
+    }
+    if(err == CIRF_OK) {
+        err = pack_write(&ctx, config->root, (uint32_t)folder_count, (uint32_t)file_count,
+                         (uint32_t)mimes->count, options->pack_path);
+    }
+
+    pack_buf_t *bufs[] = {&ctx.folders, &ctx.files,   &ctx.metadata, &ctx.mimes,
+                          &ctx.seeds,   &ctx.entries, &ctx.filter,   &ctx.strings};
+    for(size_t i = 0; i < sizeof(bufs) / sizeof(bufs[0]); i++) {
+        free(bufs[i]->bytes);
+    }
+    free(infos);
+    free(ctx.key_strings);
+    free_folder_info(info_list);
+    return err;
+}
+
 cirf_error_t codegen_generate(const cirf_config_t *config, const codegen_options_t *options) {
-    if(!config || !options || !options->source_path || !options->header_path) {
+    if(!config) {
         return CIRF_ERR_INVALID;
     }
+    cirf_config_t *layers[1] = {(cirf_config_t *)config};
+    return codegen_generate_overlay(layers, 1, options);
+}
 
-    cirf_error_t err = generate_header(config, options->header_path);
-    if(err != CIRF_OK) {
-        return err;
+cirf_error_t codegen_generate_overlay(cirf_config_t *const *layers, size_t count,
+                                      const codegen_options_t *options) {
+    if(!layers || count == 0 || !options || !options->name ||
+       !(options->source_path || options->object_path || options->pack_path) ||
+       !(options->header_path || options->pack_path) || (options->compact && count > 1)) {
+        return CIRF_ERR_INVALID;
+    }
+    /* Objects and packs hold one set in the pointer layout, with hash and
+     * filter indexes */
+    if((options->object_path || options->pack_path) &&
+       (count > 1 || options->compact ||
+        (options->indexes & ~(CODEGEN_INDEX_HASH | CODEGEN_INDEX_FILTER)))) {
+        return CIRF_ERR_INVALID;
+    }
+    if(options->object_path && (!options->object_target || options->pack_path)) {
+        return CIRF_ERR_INVALID;
+    }
+    /* The compact blob is one array, so it cannot come from .incbin */
+    if(options->data_encoding == CODEGEN_DATA_INCBIN &&
+       (!options->asm_path || options->compact)) {
+        return CIRF_ERR_INVALID;
     }
 
-    /* Extract header filename for #include */
-    const char *header_name = strrchr(options->header_path, '/');
-    if(header_name) {
-        header_name++;
-    } else {
-        header_name = options->header_path;
+    /* Sorted siblings let the runtime binary-search each folder */
+    for(size_t l = 0; l < count; l++) {
+        cirf_error_t err = vfs_sort(layers[l]->root);
+        if(err != CIRF_OK) {
+            return err;
+        }
+    }
+
+    /* Key and MIME type IDs are shared by all layers */
+    meta_keys_t    keys = {0};
+    mime_table_t   mimes = {.name = options->name};
+    path_list_t    overlay = {0};
+    compact_plan_t plan = {0};
+    cirf_error_t   err = collect_meta_keys(layers, count, &keys);
+    if(err == CIRF_OK) {
+        err = collect_mime_types(layers, count, &mimes);
+    }
+    if(err == CIRF_OK && count > 1) {
+        err = collect_overlay_files(layers, count, &overlay);
+    }
+    if(err == CIRF_OK && options->compact) {
+        if(mimes.count > UINT16_MAX) {
+            fprintf(stderr, "Error: too many MIME types for the compact layout\n");
+            err = CIRF_ERR_INVALID;
+        } else {
+            err = plan_compact(layers[0], &keys, &plan);
+        }
+        if(err == CIRF_OK && options->stats) {
+            err = compact_stats(&plan, &mimes, options->stats);
+        }
+    }
+    const compact_plan_t *compact = options->compact ? &plan : NULL;
+
+    /* A pack has no symbols to declare */
+    if(err == CIRF_OK && !options->pack_path) {
+        err = generate_header(layers, count, options->name, &keys, &mimes,
+                              count > 1 ? &overlay : NULL, compact, options->header_path);
+    }
+
+    if(err == CIRF_OK && options->pack_path) {
+        err = generate_pack(layers[0], options, &keys, &mimes);
+    } else if(err == CIRF_OK && options->object_path) {
+        err = generate_object(layers[0], options, &keys, &mimes);
+    } else if(err == CIRF_OK) {
+        /* Extract header filename for #include */
+        const char *header_name = strrchr(options->header_path, '/');
+        if(header_name) {
+            header_name++;
+        } else {
+            header_name = options->header_path;
+        }
+
+        err = generate_source(layers, count, options, &keys, &mimes, count > 1 ? &overlay : NULL,
+                              compact, header_name);
     }
 
-    return generate_source(config, options->source_path, header_name);
+    free_compact_plan(&plan);
+    free(overlay.items);
+    free(keys.items);
+    free(keys.by_id);
+    free(mimes.types);
+    return err;
 }
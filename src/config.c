@@ -1,6 +1,7 @@
 #include "cirf/config.h"
 #include "cirf/glob.h"
 #include "cirf/json.h"
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -84,6 +85,41 @@ static cirf_error_t load_metadata(const json_value_t *obj, vfs_metadata_t **out)
 
         if(val->type == JSON_STRING) {
             vfs_add_metadata(out, key, val->data.string);
+        } else if(val->type == JSON_NUMBER) {
+            char text[32];
+            if(val->data.number.is_integer) {
+                snprintf(text, sizeof(text), "%ld", val->data.number.integer);
+            } else {
+                /* Shortest of the usual precisions that reads back exactly */
+                snprintf(text, sizeof(text), "%.15g", val->data.number.real);
+                if(strtod(text, NULL) != val->data.number.real) {
+                    snprintf(text, sizeof(text), "%.17g", val->data.number.real);
+                }
+            }
+
+            vfs_metadata_t *m = vfs_add_metadata(out, key, text);
+            if(!m) return CIRF_ERR_NOMEM;
+            m->real = val->data.number.real;
+            if(val->data.number.is_integer) {
+                m->type = VFS_META_INT;
+                m->integer = val->data.number.integer;
+            } else {
+                /* Truncate, saturating where the value does not fit */
+                m->type = VFS_META_REAL;
+                if(m->real >= 9.2233720368547758e18) {
+                    m->integer = LLONG_MAX;
+                } else if(m->real <= -9.2233720368547758e18) {
+                    m->integer = LLONG_MIN;
+                } else {
+                    m->integer = (long long)m->real;
+                }
+            }
+        } else if(val->type == JSON_BOOL) {
+            vfs_metadata_t *m = vfs_add_metadata(out, key, val->data.boolean ? "true" : "false");
+            if(!m) return CIRF_ERR_NOMEM;
+            m->type = VFS_META_BOOL;
+            m->integer = val->data.boolean ? 1 : 0;
+            m->real = (double)m->integer;
         }
     }
 
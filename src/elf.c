@@ -0,0 +1,522 @@
+#include "cirf/elf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ELF constants, spelled out so the generator does not need <elf.h> */
+#define ELF_ET_REL 1
+#define ELF_SHT_PROGBITS 1
+#define ELF_SHT_SYMTAB 2
+#define ELF_SHT_STRTAB 3
+#define ELF_SHT_RELA 4
+#define ELF_SHT_REL 9
+#define ELF_SHF_WRITE 0x1
+#define ELF_SHF_ALLOC 0x2
+#define ELF_SHF_INFO_LINK 0x40
+#define ELF_STB_LOCAL 0
+#define ELF_STB_GLOBAL 1
+#define ELF_STT_OBJECT 1
+#define ELF_STT_SECTION 3
+
+/* Section header indexes */
+enum { SEC_NULL, SEC_RODATA, SEC_RELRO, SEC_REL, SEC_SYMTAB, SEC_STRTAB, SEC_SHSTRTAB, SEC_STACK,
+       SEC_COUNT };
+
+/* Symbol indexes before the globals: null, then one per data section */
+#define SYM_FIRST_GLOBAL 3
+
+/*
+ * e_flags is 0 as in the objects of `ld -r -b binary`: linkers do not
+ * check the ABI variant of objects without code. ARM still records EABI 5.
+ */
+static const elf_target_t targets[] = {
+    {"x86_64", 8, 0, 62, 0, 1, 1, 8},             /* R_X86_64_64 */
+    {"i386", 4, 0, 3, 0, 1, 0, 4},                /* R_386_32 */
+    {"aarch64", 8, 0, 183, 0, 257, 1, 8},         /* R_AARCH64_ABS64 */
+    {"aarch64_be", 8, 1, 183, 0, 257, 1, 8},      /* R_AARCH64_ABS64 */
+    {"arm", 4, 0, 40, 0x05000000, 2, 0, 8},       /* R_ARM_ABS32 */
+    {"armeb", 4, 1, 40, 0x05000000, 2, 0, 8},     /* R_ARM_ABS32 */
+    {"riscv32", 4, 0, 243, 0, 1, 1, 8},           /* R_RISCV_32 */
+    {"riscv64", 8, 0, 243, 0, 2, 1, 8},           /* R_RISCV_64 */
+    {"ppc64", 8, 1, 21, 0, 38, 1, 8},             /* R_PPC64_ADDR64 */
+    {"ppc64le", 8, 0, 21, 0, 38, 1, 8},           /* R_PPC64_ADDR64 */
+    {"s390x", 8, 1, 22, 0, 22, 1, 8},             /* R_390_64 */
+    {"xtensa", 4, 0, 94, 0, 1, 1, 8},             /* R_XTENSA_32 */
+};
+
+#define TARGET_COUNT (sizeof(targets) / sizeof(targets[0]))
+
+typedef struct {
+        unsigned char *data;
+        size_t         size;
+        size_t         cap;
+        size_t         align;
+} elf_buf_t;
+
+typedef struct {
+        int    section; /* -1 until placed */
+        size_t offset;
+} elf_label_t;
+
+typedef struct {
+        size_t offset; /* In ELF_RELRO */
+        int    label;
+        size_t addend;
+} elf_reloc_t;
+
+typedef struct {
+        char  *name;
+        int    label;
+        size_t size;
+} elf_sym_t;
+
+struct elf_object {
+        const elf_target_t *target;
+        int                 failed; /* Out of memory or misuse */
+        elf_buf_t           sections[2];
+        elf_label_t        *labels;
+        size_t              label_count;
+        size_t              label_cap;
+        elf_reloc_t        *relocs;
+        size_t              reloc_count;
+        size_t              reloc_cap;
+        elf_sym_t          *syms;
+        size_t              sym_count;
+        size_t              sym_cap;
+};
+
+const elf_target_t *elf_target_find(const char *name) {
+    for(size_t i = 0; i < TARGET_COUNT; i++) {
+        if(strcmp(targets[i].name, name) == 0) return &targets[i];
+    }
+    return NULL;
+}
+
+const elf_target_t *elf_target_host(void) {
+#if defined(__x86_64__)
+    return elf_target_find("x86_64");
+#elif defined(__i386__)
+    return elf_target_find("i386");
+#elif defined(__aarch64__) && defined(__AARCH64EB__)
+    return elf_target_find("aarch64_be");
+#elif defined(__aarch64__)
+    return elf_target_find("aarch64");
+#elif defined(__arm__) && defined(__ARMEB__)
+    return elf_target_find("armeb");
+#elif defined(__arm__)
+    return elf_target_find("arm");
+#elif defined(__riscv) && __riscv_xlen == 64
+    return elf_target_find("riscv64");
+#elif defined(__riscv)
+    return elf_target_find("riscv32");
+#elif defined(__powerpc64__) && defined(__LITTLE_ENDIAN__)
+    return elf_target_find("ppc64le");
+#elif defined(__powerpc64__)
+    return elf_target_find("ppc64");
+#elif defined(__s390x__)
+    return elf_target_find("s390x");
+#elif defined(__XTENSA__)
+    return elf_target_find("xtensa");
+#else
+    return NULL;
+#endif
+}
+
+const char *elf_target_names(void) {
+    return "x86_64, i386, aarch64, aarch64_be, arm, armeb, riscv32, riscv64, ppc64, ppc64le, "
+           "s390x, xtensa";
+}
+
+elf_object_t *elf_create(const elf_target_t *target) {
+    elf_object_t *obj = calloc(1, sizeof(elf_object_t));
+    if(!obj) return NULL;
+    obj->target = target;
+    obj->sections[ELF_RODATA].align = 1;
+    obj->sections[ELF_RELRO].align = target->pointer_size;
+    return obj;
+}
+
+void elf_destroy(elf_object_t *obj) {
+    if(!obj) return;
+    for(int i = 0; i < 2; i++) {
+        free(obj->sections[i].data);
+    }
+    for(size_t i = 0; i < obj->sym_count; i++) {
+        free(obj->syms[i].name);
+    }
+    free(obj->labels);
+    free(obj->relocs);
+    free(obj->syms);
+    free(obj);
+}
+
+/* Grow an array of elements of size elem to hold one more; 0 on failure */
+static int grow(void **items, size_t count, size_t *cap, size_t elem) {
+    if(count < *cap) return 1;
+    size_t n = *cap ? *cap * 2 : 64;
+    void  *grown = realloc(*items, n * elem);
+    if(!grown) return 0;
+    *items = grown;
+    *cap = n;
+    return 1;
+}
+
+/* Room for len more bytes at the end of buf, or NULL */
+static unsigned char *buf_reserve(elf_buf_t *buf, size_t len) {
+    if(buf->cap - buf->size < len) {
+        size_t cap = buf->cap ? buf->cap : 4096;
+        while(cap - buf->size < len) {
+            cap *= 2;
+        }
+        unsigned char *grown = realloc(buf->data, cap);
+        if(!grown) return NULL;
+        buf->data = grown;
+        buf->cap = cap;
+    }
+    return buf->data + buf->size;
+}
+
+static void store(const elf_target_t *target, unsigned char *p, uint64_t value, size_t width) {
+    for(size_t i = 0; i < width; i++) {
+        size_t shift = target->big_endian ? (width - 1 - i) * 8 : i * 8;
+        p[i] = (unsigned char)(value >> shift);
+    }
+}
+
+static void buf_align(elf_object_t *obj, elf_buf_t *buf, size_t align) {
+    size_t pad = (align - buf->size % align) % align;
+    if(align > buf->align) buf->align = align;
+    if(pad == 0) return;
+    unsigned char *p = buf_reserve(buf, pad);
+    if(!p) {
+        obj->failed = 1;
+        return;
+    }
+    memset(p, 0, pad);
+    buf->size += pad;
+}
+
+static void buf_put_bytes(elf_object_t *obj, elf_buf_t *buf, const void *data, size_t len) {
+    if(len == 0) return;
+    unsigned char *p = buf_reserve(buf, len);
+    if(!p) {
+        obj->failed = 1;
+        return;
+    }
+    memcpy(p, data, len);
+    buf->size += len;
+}
+
+/* Unaligned integer in target byte order, for the ELF tables themselves */
+static void buf_put_uint(elf_object_t *obj, elf_buf_t *buf, uint64_t value, size_t width) {
+    unsigned char *p = buf_reserve(buf, width);
+    if(!p) {
+        obj->failed = 1;
+        return;
+    }
+    store(obj->target, p, value, width);
+    buf->size += width;
+}
+
+void elf_align(elf_object_t *obj, int section, size_t align) {
+    buf_align(obj, &obj->sections[section], align);
+}
+
+void elf_put_bytes(elf_object_t *obj, int section, const void *data, size_t len) {
+    buf_put_bytes(obj, &obj->sections[section], data, len);
+}
+
+void elf_put_u32(elf_object_t *obj, int section, uint32_t value) {
+    buf_align(obj, &obj->sections[section], 4);
+    buf_put_uint(obj, &obj->sections[section], value, 4);
+}
+
+void elf_put_u64(elf_object_t *obj, int section, uint64_t value) {
+    buf_align(obj, &obj->sections[section], obj->target->align64);
+    buf_put_uint(obj, &obj->sections[section], value, 8);
+}
+
+void elf_put_f64(elf_object_t *obj, int section, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    elf_put_u64(obj, section, bits);
+}
+
+void elf_put_size(elf_object_t *obj, int section, uint64_t value) {
+    buf_align(obj, &obj->sections[section], obj->target->pointer_size);
+    buf_put_uint(obj, &obj->sections[section], value, obj->target->pointer_size);
+}
+
+size_t elf_offset(const elf_object_t *obj, int section) {
+    return obj->sections[section].size;
+}
+
+int elf_label(elf_object_t *obj) {
+    if(!grow((void **)&obj->labels, obj->label_count, &obj->label_cap, sizeof(elf_label_t))) {
+        obj->failed = 1;
+        return -1;
+    }
+    obj->labels[obj->label_count].section = -1;
+    obj->labels[obj->label_count].offset = 0;
+    return (int)obj->label_count++;
+}
+
+void elf_place(elf_object_t *obj, int label, int section) {
+    if(label < 0) return;
+    obj->labels[label].section = section;
+    obj->labels[label].offset = obj->sections[section].size;
+}
+
+void elf_put_addr(elf_object_t *obj, int section, int label, size_t addend) {
+    /* Only .data.rel.ro has a relocation section */
+    if(section != ELF_RELRO) {
+        obj->failed = 1;
+        return;
+    }
+    elf_put_size(obj, section, 0);
+    if(label < 0) return;
+
+    if(!grow((void **)&obj->relocs, obj->reloc_count, &obj->reloc_cap, sizeof(elf_reloc_t))) {
+        obj->failed = 1;
+        return;
+    }
+    elf_reloc_t *r = &obj->relocs[obj->reloc_count++];
+    r->offset = obj->sections[section].size - obj->target->pointer_size;
+    r->label = label;
+    r->addend = addend;
+}
+
+void elf_symbol(elf_object_t *obj, const char *name, int label, size_t size) {
+    if(label < 0 ||
+       !grow((void **)&obj->syms, obj->sym_count, &obj->sym_cap, sizeof(elf_sym_t))) {
+        obj->failed = 1;
+        return;
+    }
+    elf_sym_t *s = &obj->syms[obj->sym_count];
+    s->name = malloc(strlen(name) + 1);
+    if(!s->name) {
+        obj->failed = 1;
+        return;
+    }
+    strcpy(s->name, name);
+    s->label = label;
+    s->size = size;
+    obj->sym_count++;
+}
+
+/* ========================================================================
+ * Output
+ * ======================================================================== */
+
+typedef struct {
+        uint32_t name;
+        uint32_t type;
+        uint64_t flags;
+        uint64_t offset;
+        uint64_t size;
+        uint32_t link;
+        uint32_t info;
+        uint64_t align;
+        uint64_t entsize;
+} elf_shdr_t;
+
+static void put_word(elf_object_t *obj, elf_buf_t *buf, uint64_t value) {
+    buf_put_uint(obj, buf, value, obj->target->pointer_size);
+}
+
+static void put_shdr(elf_object_t *obj, elf_buf_t *buf, const elf_shdr_t *sh) {
+    buf_put_uint(obj, buf, sh->name, 4);
+    buf_put_uint(obj, buf, sh->type, 4);
+    put_word(obj, buf, sh->flags);
+    put_word(obj, buf, 0); /* sh_addr */
+    put_word(obj, buf, sh->offset);
+    put_word(obj, buf, sh->size);
+    buf_put_uint(obj, buf, sh->link, 4);
+    buf_put_uint(obj, buf, sh->info, 4);
+    put_word(obj, buf, sh->align);
+    put_word(obj, buf, sh->entsize);
+}
+
+static void put_sym(elf_object_t *obj, elf_buf_t *buf, uint32_t name, unsigned char info,
+                    uint16_t shndx, uint64_t value, uint64_t size) {
+    buf_put_uint(obj, buf, name, 4);
+    if(obj->target->pointer_size == 8) {
+        buf_put_uint(obj, buf, info, 1);
+        buf_put_uint(obj, buf, 0, 1); /* STV_DEFAULT */
+        buf_put_uint(obj, buf, shndx, 2);
+        buf_put_uint(obj, buf, value, 8);
+        buf_put_uint(obj, buf, size, 8);
+    } else {
+        buf_put_uint(obj, buf, value, 4);
+        buf_put_uint(obj, buf, size, 4);
+        buf_put_uint(obj, buf, info, 1);
+        buf_put_uint(obj, buf, 0, 1);
+        buf_put_uint(obj, buf, shndx, 2);
+    }
+}
+
+/* Relocation entries; with SHT_REL the addends go into the section bytes */
+static cirf_error_t build_relocs(elf_object_t *obj, elf_buf_t *out) {
+    const elf_target_t *t = obj->target;
+    elf_buf_t          *relro = &obj->sections[ELF_RELRO];
+
+    for(size_t i = 0; i < obj->reloc_count; i++) {
+        const elf_reloc_t *r = &obj->relocs[i];
+        const elf_label_t *l = &obj->labels[r->label];
+        if(l->section < 0) return CIRF_ERR_INVALID;
+
+        uint64_t sym = l->section == ELF_RODATA ? 1 : 2;
+        uint64_t addend = l->offset + r->addend;
+        put_word(obj, out, r->offset);
+        put_word(obj, out, t->pointer_size == 8 ? sym << 32 | t->reloc_type
+                                                : sym << 8 | t->reloc_type);
+        if(t->rela) {
+            put_word(obj, out, addend);
+        } else {
+            store(t, relro->data + r->offset, addend, t->pointer_size);
+        }
+    }
+    return CIRF_OK;
+}
+
+static cirf_error_t build_symbols(elf_object_t *obj, elf_buf_t *symtab, elf_buf_t *strtab) {
+    buf_put_bytes(obj, strtab, "", 1);
+    put_sym(obj, symtab, 0, 0, 0, 0, 0);
+    put_sym(obj, symtab, 0, ELF_STB_LOCAL << 4 | ELF_STT_SECTION, SEC_RODATA, 0, 0);
+    put_sym(obj, symtab, 0, ELF_STB_LOCAL << 4 | ELF_STT_SECTION, SEC_RELRO, 0, 0);
+
+    for(size_t i = 0; i < obj->sym_count; i++) {
+        const elf_sym_t   *s = &obj->syms[i];
+        const elf_label_t *l = &obj->labels[s->label];
+        if(l->section < 0) return CIRF_ERR_INVALID;
+
+        uint32_t name = (uint32_t)strtab->size;
+        buf_put_bytes(obj, strtab, s->name, strlen(s->name) + 1);
+        put_sym(obj, symtab, name, ELF_STB_GLOBAL << 4 | ELF_STT_OBJECT,
+                l->section == ELF_RODATA ? SEC_RODATA : SEC_RELRO, l->offset, s->size);
+    }
+    return CIRF_OK;
+}
+
+static size_t align_to(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+static int write_padded(FILE *fp, const void *data, size_t len, size_t *pos, size_t at) {
+    static const unsigned char zeros[64];
+    while(*pos < at) {
+        size_t n = at - *pos < sizeof(zeros) ? at - *pos : sizeof(zeros);
+        if(fwrite(zeros, 1, n, fp) != n) return -1;
+        *pos += n;
+    }
+    if(len && fwrite(data, 1, len, fp) != len) return -1;
+    *pos += len;
+    return 0;
+}
+
+cirf_error_t elf_write(elf_object_t *obj, const char *path) {
+    const elf_target_t *t = obj->target;
+    size_t              p = t->pointer_size;
+    elf_buf_t           rel = {0}, symtab = {0}, strtab = {0}, shstrtab = {0}, head = {0};
+
+    cirf_error_t err = build_relocs(obj, &rel);
+    if(err == CIRF_OK) err = build_symbols(obj, &symtab, &strtab);
+
+    /* Section names */
+    static const char *const names[SEC_COUNT] = {
+        "", ".rodata", ".data.rel.ro", NULL, ".symtab", ".strtab", ".shstrtab", ".note.GNU-stack"};
+    uint32_t name_at[SEC_COUNT];
+    for(int i = 0; i < SEC_COUNT; i++) {
+        const char *name = names[i] ? names[i] : t->rela ? ".rela.data.rel.ro" : ".rel.data.rel.ro";
+        name_at[i] = (uint32_t)shstrtab.size;
+        buf_put_bytes(obj, &shstrtab, name, strlen(name) + 1);
+    }
+
+    /* File layout: header, section contents, section headers */
+    size_t ehsize = p == 8 ? 64 : 52;
+    size_t rel_entsize = (t->rela ? 3 : 2) * p;
+    size_t sym_entsize = p == 8 ? 24 : 16;
+    elf_buf_t *rodata = &obj->sections[ELF_RODATA];
+    elf_buf_t *relro = &obj->sections[ELF_RELRO];
+
+    elf_shdr_t sh[SEC_COUNT] = {{0}};
+    size_t     off = ehsize;
+    sh[SEC_RODATA] = (elf_shdr_t){name_at[SEC_RODATA], ELF_SHT_PROGBITS, ELF_SHF_ALLOC, 0,
+                                  rodata->size, 0, 0, rodata->align, 0};
+    sh[SEC_RELRO] = (elf_shdr_t){name_at[SEC_RELRO], ELF_SHT_PROGBITS,
+                                 ELF_SHF_ALLOC | ELF_SHF_WRITE, 0, relro->size, 0, 0,
+                                 relro->align, 0};
+    sh[SEC_REL] = (elf_shdr_t){name_at[SEC_REL], t->rela ? ELF_SHT_RELA : ELF_SHT_REL,
+                               ELF_SHF_INFO_LINK, 0, rel.size, SEC_SYMTAB, SEC_RELRO, p,
+                               rel_entsize};
+    sh[SEC_SYMTAB] = (elf_shdr_t){name_at[SEC_SYMTAB], ELF_SHT_SYMTAB, 0, 0, symtab.size,
+                                  SEC_STRTAB, SYM_FIRST_GLOBAL, p, sym_entsize};
+    sh[SEC_STRTAB] = (elf_shdr_t){name_at[SEC_STRTAB], ELF_SHT_STRTAB, 0, 0, strtab.size, 0, 0,
+                                  1, 0};
+    sh[SEC_SHSTRTAB] = (elf_shdr_t){name_at[SEC_SHSTRTAB], ELF_SHT_STRTAB, 0, 0, shstrtab.size,
+                                    0, 0, 1, 0};
+    sh[SEC_STACK] = (elf_shdr_t){name_at[SEC_STACK], ELF_SHT_PROGBITS, 0, 0, 0, 0, 0, 1, 0};
+    for(int i = SEC_RODATA; i < SEC_COUNT; i++) {
+        off = align_to(off, sh[i].align);
+        sh[i].offset = off;
+        off += sh[i].size;
+    }
+    size_t shoff = align_to(off, p);
+
+    /* ELF header */
+    static const unsigned char ident[4] = {0x7f, 'E', 'L', 'F'};
+    buf_put_bytes(obj, &head, ident, 4);
+    buf_put_uint(obj, &head, p == 8 ? 2 : 1, 1);      /* EI_CLASS */
+    buf_put_uint(obj, &head, t->big_endian ? 2 : 1, 1); /* EI_DATA */
+    buf_put_uint(obj, &head, 1, 1);                   /* EI_VERSION */
+    buf_put_bytes(obj, &head, "\0\0\0\0\0\0\0\0\0", 9); /* EI_OSABI, EI_ABIVERSION, padding */
+    buf_put_uint(obj, &head, ELF_ET_REL, 2);
+    buf_put_uint(obj, &head, t->machine, 2);
+    buf_put_uint(obj, &head, 1, 4); /* e_version */
+    put_word(obj, &head, 0);        /* e_entry */
+    put_word(obj, &head, 0);        /* e_phoff */
+    put_word(obj, &head, shoff);
+    buf_put_uint(obj, &head, t->flags, 4);
+    buf_put_uint(obj, &head, ehsize, 2);
+    buf_put_uint(obj, &head, 0, 2); /* e_phentsize */
+    buf_put_uint(obj, &head, 0, 2); /* e_phnum */
+    buf_put_uint(obj, &head, p == 8 ? 64 : 40, 2);
+    buf_put_uint(obj, &head, SEC_COUNT, 2);
+    buf_put_uint(obj, &head, SEC_SHSTRTAB, 2);
+
+    elf_buf_t shdrs = {0};
+    for(int i = 0; i < SEC_COUNT; i++) {
+        put_shdr(obj, &shdrs, &sh[i]);
+    }
+
+    if(err == CIRF_OK && obj->failed) err = CIRF_ERR_NOMEM;
+
+    FILE *fp = NULL;
+    if(err == CIRF_OK) {
+        fp = fopen(path, "wb");
+        if(!fp) err = CIRF_ERR_IO;
+    }
+    if(err == CIRF_OK) {
+        const elf_buf_t *parts[SEC_COUNT] = {&head, rodata, relro, &rel, &symtab, &strtab,
+                                             &shstrtab, NULL};
+        size_t           pos = 0;
+        for(int i = 0; i < SEC_COUNT && err == CIRF_OK; i++) {
+            size_t at = i == 0 ? 0 : sh[i].offset;
+            if(parts[i] && write_padded(fp, parts[i]->data, parts[i]->size, &pos, at) != 0) {
+                err = CIRF_ERR_IO;
+            }
+        }
+        if(err == CIRF_OK && write_padded(fp, shdrs.data, shdrs.size, &pos, shoff) != 0) {
+            err = CIRF_ERR_IO;
+        }
+    }
+    if(fp && fclose(fp) != 0 && err == CIRF_OK) err = CIRF_ERR_IO;
+
+    free(rel.data);
+    free(symtab.data);
+    free(strtab.data);
+    free(shstrtab.data);
+    free(head.data);
+    free(shdrs.data);
+    return err;
+}
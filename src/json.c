@@ -1,5 +1,6 @@
 #include "cirf/json.h"
 #include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -127,11 +128,13 @@ static cirf_error_t parse_string(json_parser_t *p, char **out) {
     return CIRF_OK;
 }
 
-static cirf_error_t parse_number(json_parser_t *p, long *out) {
+static cirf_error_t parse_number(json_parser_t *p, json_value_t *val) {
     skip_whitespace(p);
 
     const char *start = p->pos;
     int         negative = 0;
+    int         overflow = 0;
+    int         is_integer = 1;
 
     if(p->pos < p->end && *p->pos == '-') {
         negative = 1;
@@ -145,20 +148,27 @@ static cirf_error_t parse_number(json_parser_t *p, long *out) {
 
     long value = 0;
     while(p->pos < p->end && isdigit((unsigned char)*p->pos)) {
-        value = value * 10 + (*p->pos - '0');
+        int digit = *p->pos - '0';
+        if(value > (LONG_MAX - digit) / 10) {
+            overflow = 1;
+        } else {
+            value = value * 10 + digit;
+        }
         p->pos++;
     }
 
-    /* Skip fractional part if present */
+    /* Fractional part */
     if(p->pos < p->end && *p->pos == '.') {
+        is_integer = 0;
         p->pos++;
         while(p->pos < p->end && isdigit((unsigned char)*p->pos)) {
             p->pos++;
         }
     }
 
-    /* Skip exponent if present */
+    /* Exponent */
     if(p->pos < p->end && (*p->pos == 'e' || *p->pos == 'E')) {
+        is_integer = 0;
         p->pos++;
         if(p->pos < p->end && (*p->pos == '+' || *p->pos == '-')) {
             p->pos++;
@@ -168,7 +178,16 @@ static cirf_error_t parse_number(json_parser_t *p, long *out) {
         }
     }
 
-    *out = negative ? -value : value;
+    /* The number ends at a delimiter, so strtod() stops at p->pos too */
+    double real = strtod(start, NULL);
+
+    if(overflow) {
+        value = LONG_MAX;
+        is_integer = 0;
+    }
+    val->data.number.integer = negative ? -value : value;
+    val->data.number.real = real;
+    val->data.number.is_integer = is_integer;
     return CIRF_OK;
 }
 
@@ -408,7 +427,7 @@ static cirf_error_t parse_value(json_parser_t *p, json_value_t **out) {
         case '8':
         case '9':
             val->type = JSON_NUMBER;
-            err = parse_number(p, &val->data.number);
+            err = parse_number(p, val);
             break;
 
         default:
@@ -558,7 +577,7 @@ long json_get_number(const json_value_t *obj, const char *key, long default_val)
     if(!val || val->type != JSON_NUMBER) {
         return default_val;
     }
-    return val->data.number;
+    return val->data.number.integer;
 }
 
 int json_get_bool(const json_value_t *obj, const char *key, int default_val) {
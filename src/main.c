@@ -1,31 +1,66 @@
 #include "cirf/codegen.h"
 #include "cirf/config.h"
+#include "cirf/elf.h"
 #include "cirf/error.h"
 #include "cirf/version.h"
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define MAX_CONFIGS 16
+
 typedef struct {
-        const char *name;
-        const char *config_path;
-        const char *output_path;
-        const char *header_path;
-        const char *depfile_path;
-        int         deps_mode;
+        const char         *name;
+        const char         *config_paths[MAX_CONFIGS]; /* Overlay layers, lowest precedence first */
+        size_t              config_count;
+        const char         *output_path;
+        const char         *header_path;
+        const char         *asm_path;
+        const char         *object_path;
+        const char         *pack_path;
+        const char         *depfile_path;
+        int                 deps_mode;
+        unsigned            indexes;
+        int                 indexes_set; /* -I was given */
+        int                 compact;
+        int                 data_encoding;
+        const elf_target_t *target; /* Of object_path */
 } cli_options_t;
 
 static void print_usage(const char *prog) {
     fprintf(stderr, "Usage: %s -n <name> -c <config> -o <output.c> -H <output.h>\n", prog);
+    fprintf(stderr, "       %s -n <name> -c <config> -O <output.o> -H <output.h>\n", prog);
+    fprintf(stderr, "       %s -n <name> -c <config> -P <output.pack>\n", prog);
     fprintf(stderr, "       %s -d -c <config>\n", prog);
     fprintf(stderr, "\n");
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "  -n, --name <name>      Base name for generated symbols (required)\n");
-    fprintf(stderr, "  -c, --config <file>    Input configuration file (JSON)\n");
+    fprintf(stderr, "  -c, --config <file>    Input configuration file (JSON); repeat to overlay\n");
+    fprintf(stderr, "                         several sets, later files taking precedence\n");
     fprintf(stderr, "  -o, --output <file>    Output C source file\n");
     fprintf(stderr, "  -H, --header <file>    Output C header file\n");
     fprintf(stderr, "  -d, --deps             Output source file dependencies (one per line)\n");
     fprintf(stderr, "  -M, --depfile <file>   Write Makefile-format dependency file\n");
+    fprintf(stderr, "  -I, --index <list>     Lookup indexes to generate, comma-separated\n");
+    fprintf(stderr, "                         (hash, trie, filter, query, hot, none;\n");
+    fprintf(stderr, "                         default: hash,filter,query)\n");
+    fprintf(stderr, "  -C, --compact          Compact layout with 32-bit offsets, no indexes\n");
+    fprintf(stderr, "                         (one config only)\n");
+    fprintf(stderr, "  -E, --encoding <enc>   File data spelling: hex, string, words, incbin\n");
+    fprintf(stderr, "                         or embed (default: hex; string compiles fastest\n");
+    fprintf(stderr, "                         on GCC/Clang, words needs a little-endian target,\n");
+    fprintf(stderr, "                         incbin writes the data to an assembly file and\n");
+    fprintf(stderr, "                         embed needs C23 #embed)\n");
+    fprintf(stderr, "  -A, --asm <file>       Output assembly file for -E incbin\n");
+    fprintf(stderr, "  -O, --object <file>    Output an ELF object instead of C source\n");
+    fprintf(stderr, "                         (one config; indexes hash and filter only)\n");
+    fprintf(stderr, "  -T, --target <name>    Target of -O (default: the host): x86_64,\n");
+    fprintf(stderr, "                         i386, aarch64, aarch64_be, arm, armeb, riscv32,\n");
+    fprintf(stderr, "                         riscv64, ppc64, ppc64le, s390x or xtensa\n");
+    fprintf(stderr, "  -P, --pack <file>      Output a pack file for cirf_pack_open() instead\n");
+    fprintf(stderr, "                         of C source and header (one config; indexes\n");
+    fprintf(stderr, "                         hash and filter only)\n");
     fprintf(stderr, "  -h, --help             Show this help message\n");
     fprintf(stderr, "  -v, --version          Show version information\n");
 }
@@ -38,8 +73,42 @@ static int streq(const char *a, const char *b) {
     return strcmp(a, b) == 0;
 }
 
+static int parse_indexes(const char *list, unsigned *out) {
+    unsigned    indexes = 0;
+    const char *p = list;
+
+    while(*p) {
+        const char *end = strchr(p, ',');
+        size_t      len = end ? (size_t)(end - p) : strlen(p);
+
+        if(len == 4 && strncmp(p, "hash", len) == 0) {
+            indexes |= CODEGEN_INDEX_HASH;
+        } else if(len == 4 && strncmp(p, "trie", len) == 0) {
+            indexes |= CODEGEN_INDEX_TRIE;
+        } else if(len == 6 && strncmp(p, "filter", len) == 0) {
+            indexes |= CODEGEN_INDEX_FILTER;
+        } else if(len == 5 && strncmp(p, "query", len) == 0) {
+            indexes |= CODEGEN_INDEX_QUERY;
+        } else if(len == 3 && strncmp(p, "hot", len) == 0) {
+            indexes |= CODEGEN_INDEX_HOT;
+        } else if(len == 4 && strncmp(p, "none", len) == 0) {
+            indexes = 0;
+        } else {
+            fprintf(stderr, "Error: Unknown index kind: %.*s\n", (int)len, p);
+            return -1;
+        }
+
+        p += len;
+        if(*p == ',') p++;
+    }
+
+    *out = indexes;
+    return 0;
+}
+
 static int parse_args(int argc, char **argv, cli_options_t *opts) {
     memset(opts, 0, sizeof(*opts));
+    opts->indexes = CODEGEN_INDEX_HASH | CODEGEN_INDEX_FILTER | CODEGEN_INDEX_QUERY;
 
     for(int i = 1; i < argc; i++) {
         const char *arg = argv[i];
@@ -68,7 +137,11 @@ static int parse_args(int argc, char **argv, cli_options_t *opts) {
                 fprintf(stderr, "Error: %s requires an argument\n", arg);
                 return -1;
             }
-            opts->config_path = argv[i];
+            if(opts->config_count == MAX_CONFIGS) {
+                fprintf(stderr, "Error: At most %d configs can be overlaid\n", MAX_CONFIGS);
+                return -1;
+            }
+            opts->config_paths[opts->config_count++] = argv[i];
             continue;
         }
 
@@ -95,6 +168,47 @@ static int parse_args(int argc, char **argv, cli_options_t *opts) {
             continue;
         }
 
+        if(streq(arg, "-A") || streq(arg, "--asm")) {
+            if(++i >= argc) {
+                fprintf(stderr, "Error: %s requires an argument\n", arg);
+                return -1;
+            }
+            opts->asm_path = argv[i];
+            continue;
+        }
+
+        if(streq(arg, "-O") || streq(arg, "--object")) {
+            if(++i >= argc) {
+                fprintf(stderr, "Error: %s requires an argument\n", arg);
+                return -1;
+            }
+            opts->object_path = argv[i];
+            continue;
+        }
+
+        if(streq(arg, "-P") || streq(arg, "--pack")) {
+            if(++i >= argc) {
+                fprintf(stderr, "Error: %s requires an argument\n", arg);
+                return -1;
+            }
+            opts->pack_path = argv[i];
+            continue;
+        }
+
+        if(streq(arg, "-T") || streq(arg, "--target")) {
+            if(++i >= argc) {
+                fprintf(stderr, "Error: %s requires an argument\n", arg);
+                return -1;
+            }
+            opts->target = elf_target_find(argv[i]);
+            if(!opts->target) {
+                fprintf(stderr, "Error: Unknown target: %s (known: %s)\n", argv[i],
+                        elf_target_names());
+                return -1;
+            }
+            continue;
+        }
+
         if(streq(arg, "-M") || streq(arg, "--depfile")) {
             if(++i >= argc) {
                 fprintf(stderr, "Error: %s requires an argument\n", arg);
@@ -104,6 +218,45 @@ static int parse_args(int argc, char **argv, cli_options_t *opts) {
             continue;
         }
 
+        if(streq(arg, "-I") || streq(arg, "--index")) {
+            if(++i >= argc) {
+                fprintf(stderr, "Error: %s requires an argument\n", arg);
+                return -1;
+            }
+            if(parse_indexes(argv[i], &opts->indexes) != 0) {
+                return -1;
+            }
+            opts->indexes_set = 1;
+            continue;
+        }
+
+        if(streq(arg, "-E") || streq(arg, "--encoding")) {
+            if(++i >= argc) {
+                fprintf(stderr, "Error: %s requires an argument\n", arg);
+                return -1;
+            }
+            if(streq(argv[i], "hex")) {
+                opts->data_encoding = CODEGEN_DATA_HEX;
+            } else if(streq(argv[i], "string")) {
+                opts->data_encoding = CODEGEN_DATA_STRING;
+            } else if(streq(argv[i], "words")) {
+                opts->data_encoding = CODEGEN_DATA_WORDS;
+            } else if(streq(argv[i], "incbin")) {
+                opts->data_encoding = CODEGEN_DATA_INCBIN;
+            } else if(streq(argv[i], "embed")) {
+                opts->data_encoding = CODEGEN_DATA_EMBED;
+            } else {
+                fprintf(stderr, "Error: Unknown encoding: %s\n", argv[i]);
+                return -1;
+            }
+            continue;
+        }
+
+        if(streq(arg, "-C") || streq(arg, "--compact")) {
+            opts->compact = 1;
+            continue;
+        }
+
         fprintf(stderr, "Error: Unknown option: %s\n", arg);
         return -1;
     }
@@ -114,7 +267,7 @@ static int parse_args(int argc, char **argv, cli_options_t *opts) {
 static int validate_options(const cli_options_t *opts, const char *prog) {
     int valid = 1;
 
-    if(!opts->config_path) {
+    if(opts->config_count == 0) {
         fprintf(stderr, "Error: -c/--config is required\n");
         valid = 0;
     }
@@ -134,13 +287,76 @@ static int validate_options(const cli_options_t *opts, const char *prog) {
         valid = 0;
     }
 
-    if(!opts->output_path) {
-        fprintf(stderr, "Error: -o/--output is required\n");
+    if(opts->pack_path) {
+        if(opts->output_path || opts->object_path || opts->header_path) {
+            fprintf(stderr, "Error: -P/--pack cannot be combined with -o/--output, -O/--object "
+                            "or -H/--header\n");
+            valid = 0;
+        }
+        if(opts->config_count > 1 || opts->compact ||
+           opts->data_encoding == CODEGEN_DATA_INCBIN) {
+            fprintf(stderr, "Error: -P/--pack cannot be combined with overlays, -C/--compact "
+                            "or -E incbin\n");
+            valid = 0;
+        }
+        if(opts->indexes_set &&
+           (opts->indexes & ~(CODEGEN_INDEX_HASH | CODEGEN_INDEX_FILTER))) {
+            fprintf(stderr, "Error: -P/--pack supports the hash and filter indexes only\n");
+            valid = 0;
+        }
+    } else {
+        if(!opts->output_path && !opts->object_path) {
+            fprintf(stderr, "Error: -o/--output, -O/--object or -P/--pack is required\n");
+            valid = 0;
+        }
+
+        if(!opts->header_path) {
+            fprintf(stderr, "Error: -H/--header is required\n");
+            valid = 0;
+        }
+    }
+
+    if(opts->compact && opts->config_count > 1) {
+        fprintf(stderr, "Error: -C/--compact cannot be combined with overlays\n");
         valid = 0;
     }
 
-    if(!opts->header_path) {
-        fprintf(stderr, "Error: -H/--header is required\n");
+    if(opts->data_encoding == CODEGEN_DATA_INCBIN) {
+        if(!opts->asm_path) {
+            fprintf(stderr, "Error: -A/--asm is required with -E incbin\n");
+            valid = 0;
+        }
+        if(opts->compact) {
+            fprintf(stderr, "Error: -C/--compact cannot be combined with -E incbin\n");
+            valid = 0;
+        }
+    } else if(opts->asm_path) {
+        fprintf(stderr, "Error: -A/--asm is only used with -E incbin\n");
+        valid = 0;
+    }
+
+    if(opts->object_path) {
+        if(opts->output_path) {
+            fprintf(stderr, "Error: -o/--output cannot be combined with -O/--object\n");
+            valid = 0;
+        }
+        if(opts->config_count > 1 || opts->compact ||
+           opts->data_encoding == CODEGEN_DATA_INCBIN) {
+            fprintf(stderr, "Error: -O/--object cannot be combined with overlays, -C/--compact "
+                            "or -E incbin\n");
+            valid = 0;
+        }
+        if(opts->indexes_set &&
+           (opts->indexes & ~(CODEGEN_INDEX_HASH | CODEGEN_INDEX_FILTER))) {
+            fprintf(stderr, "Error: -O/--object supports the hash and filter indexes only\n");
+            valid = 0;
+        }
+        if(!opts->target) {
+            fprintf(stderr, "Error: -T/--target is required on this host\n");
+            valid = 0;
+        }
+    } else if(opts->target) {
+        fprintf(stderr, "Error: -T/--target is only used with -O/--object\n");
         valid = 0;
     }
 
@@ -152,6 +368,61 @@ static int validate_options(const cli_options_t *opts, const char *prog) {
     return valid;
 }
 
+/*
+ * Symbol prefix of an overlay layer: the base name plus the config file's
+ * name without directory and extension, e.g. "assets_customer".
+ */
+static char *layer_name(const char *name, const char *config_path) {
+    const char *stem = strrchr(config_path, '/');
+    stem = stem ? stem + 1 : config_path;
+    const char *dot = strrchr(stem, '.');
+    size_t      stem_len = dot && dot != stem ? (size_t)(dot - stem) : strlen(stem);
+    size_t      name_len = strlen(name);
+
+    char *result = malloc(name_len + 1 + stem_len + 1);
+    if(!result) return NULL;
+    memcpy(result, name, name_len);
+    result[name_len] = '_';
+    for(size_t i = 0; i < stem_len; i++) {
+        char c = stem[i];
+        result[name_len + 1 + i] = isalnum((unsigned char)c) ? c : '_';
+    }
+    result[name_len + 1 + stem_len] = '\0';
+    return result;
+}
+
+static void destroy_configs(cirf_config_t **configs, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        config_destroy(configs[i]);
+    }
+}
+
+/* Source paths of all configs, one per line; caller frees */
+static char *collect_source_paths(cirf_config_t **configs, size_t count) {
+    char  *all = NULL;
+    size_t len = 0;
+    for(size_t i = 0; i < count; i++) {
+        char *deps = config_get_source_paths(configs[i]);
+        if(!deps || !*deps) {
+            free(deps);
+            continue;
+        }
+        size_t n = strlen(deps);
+        char  *grown = realloc(all, len + n + 2);
+        if(!grown) {
+            free(deps);
+            free(all);
+            return NULL;
+        }
+        all = grown;
+        if(len) all[len++] = '\n';
+        memcpy(all + len, deps, n + 1);
+        len += n;
+        free(deps);
+    }
+    return all;
+}
+
 int main(int argc, char **argv) {
     cli_options_t opts;
 
@@ -159,22 +430,34 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    if(opts.object_path && !opts.target) {
+        opts.target = elf_target_host();
+    }
     if(!validate_options(&opts, argv[0])) {
         return 1;
     }
+    /* Objects and packs have no query index; leave it out of the default set */
+    if((opts.object_path || opts.pack_path) && !opts.indexes_set) {
+        opts.indexes &= CODEGEN_INDEX_HASH | CODEGEN_INDEX_FILTER;
+    }
+
+    cirf_config_t *configs[MAX_CONFIGS] = {0};
+    size_t         count = opts.config_count;
 
     /* Deps mode: just output source file dependencies */
     if(opts.deps_mode) {
-        cirf_config_t *config = NULL;
-        cirf_error_t   err = config_load_deps(opts.config_path, "deps", &config);
-        if(err != CIRF_OK) {
-            fprintf(stderr, "Error loading config '%s': %s\n", opts.config_path,
-                    cirf_error_string(err));
-            return 1;
+        for(size_t i = 0; i < count; i++) {
+            cirf_error_t err = config_load_deps(opts.config_paths[i], "deps", &configs[i]);
+            if(err != CIRF_OK) {
+                fprintf(stderr, "Error loading config '%s': %s\n", opts.config_paths[i],
+                        cirf_error_string(err));
+                destroy_configs(configs, i);
+                return 1;
+            }
         }
 
-        char *deps = config_get_source_paths(config);
-        config_destroy(config);
+        char *deps = collect_source_paths(configs, count);
+        destroy_configs(configs, count);
 
         if(deps) {
             printf("%s\n", deps);
@@ -183,23 +466,55 @@ int main(int argc, char **argv) {
         return 0;
     }
 
-    /* Load configuration */
-    cirf_config_t *config = NULL;
-    cirf_error_t   err = config_load(opts.config_path, opts.name, &config);
-    if(err != CIRF_OK) {
-        fprintf(stderr, "Error loading config '%s': %s\n", opts.config_path,
-                cirf_error_string(err));
-        return 1;
+    /* Load configuration; with several configs each is one overlay layer */
+    for(size_t i = 0; i < count; i++) {
+        char *name = count > 1 ? layer_name(opts.name, opts.config_paths[i]) : NULL;
+        if(count > 1 && !name) {
+            fprintf(stderr, "Error: %s\n", cirf_error_string(CIRF_ERR_NOMEM));
+            destroy_configs(configs, i);
+            return 1;
+        }
+
+        cirf_error_t err = config_load(opts.config_paths[i], name ? name : opts.name, &configs[i]);
+        free(name);
+        if(err != CIRF_OK) {
+            fprintf(stderr, "Error loading config '%s': %s\n", opts.config_paths[i],
+                    cirf_error_string(err));
+            destroy_configs(configs, i);
+            return 1;
+        }
+
+        for(size_t j = 0; j < i; j++) {
+            if(strcmp(configs[j]->name, configs[i]->name) == 0) {
+                fprintf(stderr, "Error: Configs '%s' and '%s' give the same layer name '%s'\n",
+                        opts.config_paths[j], opts.config_paths[i], configs[i]->name);
+                destroy_configs(configs, i + 1);
+                return 1;
+            }
+        }
     }
 
     /* Generate code */
-    codegen_options_t gen_opts = {
-        .name = opts.name, .source_path = opts.output_path, .header_path = opts.header_path};
-
-    err = codegen_generate(config, &gen_opts);
+    codegen_stats_t   stats = {0};
+    codegen_options_t gen_opts = {.name = opts.name,
+                                  .source_path = opts.output_path,
+                                  .header_path = opts.header_path,
+                                  .indexes = opts.indexes,
+                                  .compact = opts.compact,
+                                  .data_encoding = opts.data_encoding,
+                                  .asm_path = opts.asm_path,
+                                  .object_path = opts.object_path,
+                                  .object_target = opts.target,
+                                  .pack_path = opts.pack_path,
+                                  .stats = &stats};
+
+    const char  *output = opts.pack_path     ? opts.pack_path
+                          : opts.object_path ? opts.object_path
+                                             : opts.output_path;
+    cirf_error_t err = codegen_generate_overlay(configs, count, &gen_opts);
     if(err != CIRF_OK) {
         fprintf(stderr, "Error generating code: %s\n", cirf_error_string(err));
-        config_destroy(config);
+        destroy_configs(configs, count);
         return 1;
     }
 
@@ -208,14 +523,21 @@ int main(int argc, char **argv) {
         FILE *depfile = fopen(opts.depfile_path, "w");
         if(!depfile) {
             fprintf(stderr, "Error: Cannot open depfile '%s'\n", opts.depfile_path);
-            config_destroy(config);
+            destroy_configs(configs, count);
             return 1;
         }
 
         /* Makefile format: target: dep1 dep2 ... */
-        fprintf(depfile, "%s %s:", opts.output_path, opts.header_path);
+        fprintf(depfile, "%s", output);
+        if(opts.header_path) {
+            fprintf(depfile, " %s", opts.header_path);
+        }
+        if(opts.asm_path) {
+            fprintf(depfile, " %s", opts.asm_path);
+        }
+        fputc(':', depfile);
 
-        char *deps = config_get_source_paths(config);
+        char *deps = collect_source_paths(configs, count);
         if(deps) {
             /* Convert newlines to spaces for Makefile format */
             for(char *p = deps; *p; p++) {
@@ -228,8 +550,22 @@ int main(int argc, char **argv) {
         fclose(depfile);
     }
 
-    config_destroy(config);
+    destroy_configs(configs, count);
 
-    printf("Generated %s and %s\n", opts.output_path, opts.header_path);
+    if(opts.pack_path) {
+        printf("Generated %s\n", output);
+    } else if(opts.asm_path) {
+        printf("Generated %s, %s and %s\n", output, opts.header_path, opts.asm_path);
+    } else if(opts.object_path) {
+        printf("Generated %s (%s) and %s\n", output, opts.target->name, opts.header_path);
+    } else {
+        printf("Generated %s and %s\n", output, opts.header_path);
+    }
+    if(opts.compact) {
+        printf("Compact layout: %zu bytes of tables, saving %zu bytes on 32-bit and %zu on "
+               "64-bit targets\n",
+               stats.compact_bytes, stats.pointer_bytes_32 - stats.compact_bytes,
+               stats.pointer_bytes_64 - stats.compact_bytes);
+    }
     return 0;
 }
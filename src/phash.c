@@ -0,0 +1,163 @@
+#include "cirf/phash.h"
+#include "cirf/hash.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Give up on a bucket after this many seeds; the caller falls back to
+ * emitting no index. Never reached in practice for distinct hashes. */
+#define PHASH_MAX_SEED 0x00ffffffu
+
+typedef struct {
+        size_t bucket;
+        size_t size;
+        size_t start; /* Offset of the bucket's keys in the grouped order */
+} phash_bucket_t;
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_bucket(const void *a, const void *b) {
+    const phash_bucket_t *x = a;
+    const phash_bucket_t *y = b;
+    /* Largest buckets first, ties broken by bucket number for determinism */
+    if(x->size != y->size) return x->size > y->size ? -1 : 1;
+    return (x->bucket > y->bucket) - (x->bucket < y->bucket);
+}
+
+static int has_duplicates(const uint64_t *hashes, size_t count) {
+    uint64_t *sorted = malloc(count * sizeof(uint64_t));
+    if(!sorted) return -1;
+    memcpy(sorted, hashes, count * sizeof(uint64_t));
+    qsort(sorted, count, sizeof(uint64_t), compare_u64);
+
+    int dup = 0;
+    for(size_t i = 1; i < count; i++) {
+        if(sorted[i] == sorted[i - 1]) {
+            dup = 1;
+            break;
+        }
+    }
+    free(sorted);
+    return dup;
+}
+
+void phash_destroy(phash_t *ph) {
+    if(!ph) return;
+    free(ph->seeds);
+    free(ph->slots);
+    free(ph);
+}
+
+cirf_error_t phash_build(const uint64_t *hashes, size_t count, phash_t **out) {
+    if(!hashes || !count || !out || count > INT32_MAX) {
+        return CIRF_ERR_INVALID;
+    }
+
+    int dup = has_duplicates(hashes, count);
+    if(dup < 0) return CIRF_ERR_NOMEM;
+    if(dup) return CIRF_ERR_DUPLICATE;
+
+    phash_t *ph = calloc(1, sizeof(phash_t));
+    if(!ph) return CIRF_ERR_NOMEM;
+
+    ph->key_count = count;
+    ph->bucket_count = count;
+    ph->seeds = calloc(ph->bucket_count, sizeof(int32_t));
+    ph->slots = calloc(count, sizeof(size_t));
+
+    phash_bucket_t *buckets = calloc(ph->bucket_count, sizeof(phash_bucket_t));
+    size_t         *order = malloc(count * sizeof(size_t));
+    size_t         *fill = calloc(ph->bucket_count, sizeof(size_t));
+    unsigned char  *taken = calloc(count, 1);
+    uint32_t       *stamp = calloc(count, sizeof(uint32_t));
+
+    if(!ph->seeds || !ph->slots || !buckets || !order || !fill || !taken || !stamp) {
+        free(buckets);
+        free(order);
+        free(fill);
+        free(taken);
+        free(stamp);
+        phash_destroy(ph);
+        return CIRF_ERR_NOMEM;
+    }
+
+    /* Group keys by bucket (counting sort) */
+    for(size_t b = 0; b < ph->bucket_count; b++) {
+        buckets[b].bucket = b;
+    }
+    for(size_t i = 0; i < count; i++) {
+        buckets[hashes[i] % ph->bucket_count].size++;
+    }
+    size_t start = 0;
+    for(size_t b = 0; b < ph->bucket_count; b++) {
+        buckets[b].start = start;
+        start += buckets[b].size;
+    }
+    for(size_t i = 0; i < count; i++) {
+        size_t b = hashes[i] % ph->bucket_count;
+        order[buckets[b].start + fill[b]++] = i;
+    }
+
+    qsort(buckets, ph->bucket_count, sizeof(phash_bucket_t), compare_bucket);
+
+    cirf_error_t err = CIRF_OK;
+    uint32_t     generation = 0;
+    size_t       next_free = 0;
+
+    for(size_t bi = 0; bi < ph->bucket_count && err == CIRF_OK; bi++) {
+        const phash_bucket_t *bk = &buckets[bi];
+        const size_t         *keys = &order[bk->start];
+
+        if(bk->size == 0) break; /* Sorted by size: the rest are empty */
+
+        if(bk->size == 1) {
+            /* Single-key buckets take the remaining free slots directly */
+            while(taken[next_free])
+                next_free++;
+            taken[next_free] = 1;
+            ph->slots[keys[0]] = next_free;
+            ph->seeds[bk->bucket] = -(int32_t)next_free - 1;
+            continue;
+        }
+
+        uint32_t seed;
+        for(seed = 1; seed <= PHASH_MAX_SEED; seed++) {
+            generation++;
+            size_t k;
+            for(k = 0; k < bk->size; k++) {
+                size_t slot = (size_t)(cirf_hash_mix(hashes[keys[k]], seed) % count);
+                if(taken[slot] || stamp[slot] == generation) break;
+                stamp[slot] = generation;
+                ph->slots[keys[k]] = slot;
+            }
+            if(k == bk->size) break;
+        }
+
+        if(seed > PHASH_MAX_SEED) {
+            err = CIRF_ERR_NOT_FOUND;
+            break;
+        }
+
+        for(size_t k = 0; k < bk->size; k++) {
+            taken[ph->slots[keys[k]]] = 1;
+        }
+        ph->seeds[bk->bucket] = (int32_t)seed;
+    }
+
+    free(buckets);
+    free(order);
+    free(fill);
+    free(taken);
+    free(stamp);
+
+    if(err != CIRF_OK) {
+        phash_destroy(ph);
+        return err;
+    }
+
+    *out = ph;
+    return CIRF_OK;
+}
@@ -0,0 +1,1029 @@
+/*
+ * cirf/preload.c - LD_PRELOAD interposer over the mount table
+ *
+ * Build as a shared object together with runtime.c, the generated resource
+ * sources and a definition of cirf_preload_init() (see cirf/preload.h).
+ *
+ * Configuration options:
+ *   CIRF_PRELOAD_MAX_FDS - Descriptors below this number can back a
+ *                          resource (default 1024)
+ */
+
+/* Define open() and open64() etc. as separate symbols, never renamed */
+#undef _FILE_OFFSET_BITS
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* RTLD_NEXT, the *64 calls */
+#endif
+
+#include "cirf/preload.h"
+#include "cirf/runtime.h"
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef CIRF_NO_MOUNT
+#error "cirf preload needs the mount table; build without CIRF_NO_MOUNT"
+#endif
+
+#ifndef CIRF_PRELOAD_MAX_FDS
+#define CIRF_PRELOAD_MAX_FDS 1024
+#endif
+
+/* ========================================================================
+ * Next definitions
+ * ======================================================================== */
+
+static struct {
+        int (*open)(const char *, int, ...);
+        int (*open64)(const char *, int, ...);
+        int (*__open_2)(const char *, int);
+        int (*__open64_2)(const char *, int);
+        int (*openat)(int, const char *, int, ...);
+        int (*openat64)(int, const char *, int, ...);
+        int (*__openat_2)(int, const char *, int);
+        int (*__openat64_2)(int, const char *, int);
+        ssize_t (*read)(int, void *, size_t);
+        ssize_t (*pread)(int, void *, size_t, off_t);
+        ssize_t (*pread64)(int, void *, size_t, off64_t);
+        off_t (*lseek)(int, off_t, int);
+        off64_t (*lseek64)(int, off64_t, int);
+        int (*fstat)(int, struct stat *);
+        int (*fstat64)(int, struct stat64 *);
+        int (*stat)(const char *, struct stat *);
+        int (*stat64)(const char *, struct stat64 *);
+        int (*lstat)(const char *, struct stat *);
+        int (*lstat64)(const char *, struct stat64 *);
+        int (*fstatat)(int, const char *, struct stat *, int);
+        int (*fstatat64)(int, const char *, struct stat64 *, int);
+#ifdef STATX_BASIC_STATS
+        int (*statx)(int, const char *, int, unsigned int, struct statx *);
+#endif
+        void *(*mmap)(void *, size_t, int, int, int, off_t);
+        void *(*mmap64)(void *, size_t, int, int, int, off64_t);
+        int (*dup)(int);
+        int (*dup2)(int, int);
+        int (*dup3)(int, int, int);
+        int (*fcntl)(int, int, ...);
+        int (*fcntl64)(int, int, ...);
+        int (*close)(int);
+        DIR *(*opendir)(const char *);
+        DIR *(*fdopendir)(int);
+        struct dirent *(*readdir)(DIR *);
+        struct dirent64 *(*readdir64)(DIR *);
+        void (*rewinddir)(DIR *);
+        int (*dirfd)(DIR *);
+        int (*closedir)(DIR *);
+        FILE *(*fopen)(const char *, const char *);
+        FILE *(*fopen64)(const char *, const char *);
+} next;
+
+static pthread_once_t next_once = PTHREAD_ONCE_INIT;
+
+/* POSIX guarantees dlsym() results convert through void ** */
+#define RESOLVE(fn) (*(void **)&next.fn = dlsym(RTLD_NEXT, #fn))
+
+static void next_resolve(void) {
+    RESOLVE(open);
+    RESOLVE(open64);
+    RESOLVE(__open_2);
+    RESOLVE(__open64_2);
+    RESOLVE(openat);
+    RESOLVE(openat64);
+    RESOLVE(__openat_2);
+    RESOLVE(__openat64_2);
+    RESOLVE(read);
+    RESOLVE(pread);
+    RESOLVE(pread64);
+    RESOLVE(lseek);
+    RESOLVE(lseek64);
+    RESOLVE(fstat);
+    RESOLVE(fstat64);
+    RESOLVE(stat);
+    RESOLVE(stat64);
+    RESOLVE(lstat);
+    RESOLVE(lstat64);
+    RESOLVE(fstatat);
+    RESOLVE(fstatat64);
+#ifdef STATX_BASIC_STATS
+    RESOLVE(statx);
+#endif
+    RESOLVE(mmap);
+    RESOLVE(mmap64);
+    RESOLVE(dup);
+    RESOLVE(dup2);
+    RESOLVE(dup3);
+    RESOLVE(fcntl);
+    RESOLVE(fcntl64);
+    RESOLVE(close);
+    RESOLVE(opendir);
+    RESOLVE(fdopendir);
+    RESOLVE(readdir);
+    RESOLVE(readdir64);
+    RESOLVE(rewinddir);
+    RESOLVE(dirfd);
+    RESOLVE(closedir);
+    RESOLVE(fopen);
+    RESOLVE(fopen64);
+}
+
+#define NEXT(fn) (pthread_once(&next_once, next_resolve), next.fn)
+
+__attribute__((constructor)) static void preload_start(void) {
+    pthread_once(&next_once, next_resolve);
+    cirf_preload_init();
+}
+
+/* ========================================================================
+ * Descriptor table
+ *
+ * Indexed by descriptor number. A descriptor that is not a resource costs
+ * one byte load before the call goes through; resource state is only
+ * touched under the lock.
+ *
+ * Each descriptor points at an entry from the pool, the open resource.
+ * Descriptors dup'ed from one another share the entry and so the position,
+ * as they share the open file description in the kernel. Every entry in
+ * use is referenced by a tracked descriptor, so the pool cannot run out.
+ * ======================================================================== */
+
+typedef struct {
+        const cirf_file_t   *file;   /* NULL for a folder */
+        const cirf_folder_t *folder; /* NULL for a file */
+        uint64_t             pos;
+        unsigned             refs;   /* Descriptors on it, 0 when free */
+} fd_entry_t;
+
+static fd_entry_t      fd_pool[CIRF_PRELOAD_MAX_FDS];
+static fd_entry_t     *fd_table[CIRF_PRELOAD_MAX_FDS];
+static unsigned char   fd_used[CIRF_PRELOAD_MAX_FDS];
+static pthread_mutex_t fd_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int fd_tracked(int fd) {
+    return fd >= 0 && fd < CIRF_PRELOAD_MAX_FDS &&
+           __atomic_load_n(&fd_used[fd], __ATOMIC_ACQUIRE);
+}
+
+/* Copy the entry for fd; 0 if fd was closed in the meantime */
+static int fd_get(int fd, fd_entry_t *e) {
+    pthread_mutex_lock(&fd_lock);
+    int used = fd_used[fd];
+    if(used) *e = *fd_table[fd];
+    pthread_mutex_unlock(&fd_lock);
+    return used;
+}
+
+static void fd_forget(int fd) {
+    if(!fd_tracked(fd)) return;
+    pthread_mutex_lock(&fd_lock);
+    if(fd_used[fd]) {
+        fd_table[fd]->refs--;
+        __atomic_store_n(&fd_used[fd], 0, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&fd_lock);
+}
+
+/*
+ * A descriptor number handed out by libc cannot still be a resource. This
+ * drops entries left behind by closes we never saw (close_range(), fclose()
+ * after fdopen(), raw syscalls).
+ */
+static int fd_fresh(int fd) {
+    fd_forget(fd);
+    return fd;
+}
+
+/*
+ * Back a resource with a descriptor on /dev/null. Returns the descriptor,
+ * or -1 with errno set.
+ */
+static int fd_track(const cirf_file_t *file, const cirf_folder_t *folder, int flags) {
+    int fd = NEXT(open)("/dev/null", O_RDONLY | (flags & O_CLOEXEC));
+    if(fd < 0) return -1;
+    if(fd >= CIRF_PRELOAD_MAX_FDS) {
+        NEXT(close)(fd);
+        errno = EMFILE;
+        return -1;
+    }
+    pthread_mutex_lock(&fd_lock);
+    if(fd_used[fd]) fd_table[fd]->refs--; /* Left behind by a close we never saw */
+    /* Usually the entry of the same number is free */
+    fd_entry_t *e = &fd_pool[fd];
+    while(e->refs)
+        e = e == &fd_pool[CIRF_PRELOAD_MAX_FDS - 1] ? fd_pool : e + 1;
+    e->file = file;
+    e->folder = folder;
+    e->pos = 0;
+    e->refs = 1;
+    fd_table[fd] = e;
+    __atomic_store_n(&fd_used[fd], 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&fd_lock);
+    return fd;
+}
+
+/*
+ * Make newfd, just returned by a dup call on oldfd, share the resource of
+ * oldfd if it has one. Returns newfd, or -1 with errno set.
+ */
+static int fd_dup(int oldfd, int newfd) {
+    if(newfd < 0 || newfd == oldfd) return newfd;
+    fd_forget(newfd);
+    if(!fd_tracked(oldfd)) return newfd;
+    if(newfd >= CIRF_PRELOAD_MAX_FDS) {
+        NEXT(close)(newfd);
+        errno = EMFILE;
+        return -1;
+    }
+    pthread_mutex_lock(&fd_lock);
+    if(fd_used[oldfd]) {
+        fd_table[newfd] = fd_table[oldfd];
+        fd_table[newfd]->refs++;
+        __atomic_store_n(&fd_used[newfd], 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&fd_lock);
+    return newfd;
+}
+
+/* ========================================================================
+ * Path resolution
+ * ======================================================================== */
+
+/*
+ * Drop "." components and fold ".." into the one before it, the way the
+ * kernel walks real directories ("/res/./a/../b" is "/res/b"). Returns
+ * path itself when it has neither, buf otherwise, or NULL if too long.
+ */
+static const char *path_clean(const char *path, char *buf, size_t size) {
+    const char *p = path;
+    for(;;) {
+        if(p[0] == '.' && (p[1] == '/' || p[1] == '\0' ||
+                           (p[1] == '.' && (p[2] == '/' || p[2] == '\0')))) {
+            break;
+        }
+        p = strchr(p, '/');
+        if(!p) return path;
+        p++;
+    }
+
+    size_t n = 0;
+    if(path[0] == '/') buf[n++] = '/';
+    for(p = path; *p;) {
+        while(*p == '/')
+            p++;
+        const char *end = p;
+        while(*end && *end != '/')
+            end++;
+        size_t len = (size_t)(end - p);
+        if(len == 2 && p[0] == '.' && p[1] == '.') {
+            size_t start = n;
+            while(start > 0 && buf[start - 1] != '/')
+                start--;
+            size_t last = n - start;
+            if(last && !(last == 2 && buf[start] == '.' && buf[start + 1] == '.')) {
+                n = start > 1 ? start - 1 : start; /* Drop it, keeping a leading '/' */
+                p = end;
+                continue;
+            }
+            if(n == 1 && buf[0] == '/') { /* "/.." is "/" */
+                p = end;
+                continue;
+            }
+        } else if(len == 0 || (len == 1 && p[0] == '.')) {
+            p = end;
+            continue;
+        }
+        if(n + len + 2 > size) return NULL;
+        if(n && buf[n - 1] != '/') buf[n++] = '/';
+        memcpy(buf + n, p, len);
+        n += len;
+        p = end;
+    }
+    buf[n] = '\0';
+    return buf;
+}
+
+/*
+ * Resolve path through the mount table, or relative to dirfd when dirfd
+ * is a folder resource. Returns 1 if it names a resource, 0 otherwise.
+ */
+static int lookup(int dirfd, const char *path, const cirf_file_t **file,
+                  const cirf_folder_t **folder) {
+    *file = NULL;
+    *folder = NULL;
+    if(!path || !path[0]) return 0;
+
+    char clean[PATH_MAX];
+    path = path_clean(path, clean, sizeof(clean));
+    if(!path) return 0;
+
+    fd_entry_t dir;
+    if(path[0] != '/' && fd_tracked(dirfd) && fd_get(dirfd, &dir) && dir.folder) {
+        /* ".." above the folder is a real directory again */
+        if(path[0] == '.' && path[1] == '.' && (path[2] == '/' || path[2] == '\0')) return 0;
+        size_t len = strlen(path);
+        while(len > 0 && path[len - 1] == '/')
+            len--;
+        *file = cirf_find_file_n(dir.folder, path, len);
+        if(!*file) *folder = cirf_find_folder_n(dir.folder, path, len);
+    } else if(path[0] == '/' || dirfd == AT_FDCWD) {
+        *file = cirf_resolve_file(path);
+        if(!*file) *folder = cirf_resolve_folder(path);
+    }
+    return *file || *folder;
+}
+
+/*
+ * Open a resource. Returns 1 with *fd set (or -1 and errno) when path
+ * names a resource, 0 when the call should go through.
+ */
+static int serve_open(int dirfd, const char *path, int flags, int *fd) {
+    const cirf_file_t   *file;
+    const cirf_folder_t *folder;
+    if(!lookup(dirfd, path, &file, &folder)) return 0;
+
+    *fd = -1;
+    if((flags & O_CREAT) && (flags & O_EXCL)) {
+        errno = EEXIST;
+    } else if(folder && (flags & O_ACCMODE) != O_RDONLY) {
+        errno = EISDIR;
+    } else if((flags & O_ACCMODE) != O_RDONLY || (flags & O_TRUNC)) {
+        errno = EROFS;
+    } else if(file && (flags & O_DIRECTORY)) {
+        errno = ENOTDIR;
+    } else {
+        *fd = fd_track(file, folder, flags);
+    }
+    return 1;
+}
+
+/* ========================================================================
+ * open
+ * ======================================================================== */
+
+static mode_t open_mode(int flags, va_list ap) {
+    return (flags & (O_CREAT | O_TMPFILE)) ? (mode_t)va_arg(ap, int) : 0;
+}
+
+int open(const char *path, int flags, ...) {
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+
+    int fd;
+    if(serve_open(AT_FDCWD, path, flags, &fd)) return fd;
+    return fd_fresh(NEXT(open)(path, flags, mode));
+}
+
+int open64(const char *path, int flags, ...) {
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+
+    int fd;
+    if(serve_open(AT_FDCWD, path, flags, &fd)) return fd;
+    return fd_fresh(NEXT(open64)(path, flags, mode));
+}
+
+int openat(int dirfd, const char *path, int flags, ...) {
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+
+    int fd;
+    if(serve_open(dirfd, path, flags, &fd)) return fd;
+    return fd_fresh(NEXT(openat)(dirfd, path, flags, mode));
+}
+
+int openat64(int dirfd, const char *path, int flags, ...) {
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+
+    int fd;
+    if(serve_open(dirfd, path, flags, &fd)) return fd;
+    return fd_fresh(NEXT(openat64)(dirfd, path, flags, mode));
+}
+
+/* Called instead of open() under _FORTIFY_SOURCE when flags are not constant */
+int __open_2(const char *path, int flags);
+int __open64_2(const char *path, int flags);
+int __openat_2(int dirfd, const char *path, int flags);
+int __openat64_2(int dirfd, const char *path, int flags);
+
+int __open_2(const char *path, int flags) {
+    int fd;
+    if(serve_open(AT_FDCWD, path, flags, &fd)) return fd;
+    return fd_fresh(NEXT(__open_2)(path, flags));
+}
+
+int __open64_2(const char *path, int flags) {
+    int fd;
+    if(serve_open(AT_FDCWD, path, flags, &fd)) return fd;
+    return fd_fresh(NEXT(__open64_2)(path, flags));
+}
+
+int __openat_2(int dirfd, const char *path, int flags) {
+    int fd;
+    if(serve_open(dirfd, path, flags, &fd)) return fd;
+    return fd_fresh(NEXT(__openat_2)(dirfd, path, flags));
+}
+
+int __openat64_2(int dirfd, const char *path, int flags) {
+    int fd;
+    if(serve_open(dirfd, path, flags, &fd)) return fd;
+    return fd_fresh(NEXT(__openat64_2)(dirfd, path, flags));
+}
+
+/* ========================================================================
+ * read, pread, lseek, dup, close
+ * ======================================================================== */
+
+/*
+ * Read from a resource at offset, or at its position (advancing it) when
+ * offset is negative. Returns -2 if fd was closed under us.
+ *
+ * Only the position is claimed under the lock; the data never changes, so
+ * the copy runs unlocked and concurrent readers do not queue behind it.
+ */
+static ssize_t serve_read(int fd, void *buf, size_t count, int64_t offset) {
+    pthread_mutex_lock(&fd_lock);
+    if(!fd_used[fd]) {
+        pthread_mutex_unlock(&fd_lock);
+        return -2;
+    }
+    fd_entry_t        *e = fd_table[fd];
+    const cirf_file_t *file = e->file;
+    if(!file) {
+        pthread_mutex_unlock(&fd_lock);
+        errno = EISDIR;
+        return -1;
+    }
+
+    uint64_t pos = offset < 0 ? e->pos : (uint64_t)offset;
+    size_t   n = 0;
+    if(pos < file->size) {
+        n = file->size - (size_t)pos;
+        if(n > count) n = count;
+        if(n > SSIZE_MAX) n = SSIZE_MAX;
+    }
+    if(offset < 0) e->pos = pos + n;
+    pthread_mutex_unlock(&fd_lock);
+
+    if(n) memcpy(buf, file->data + pos, n);
+    return (ssize_t)n;
+}
+
+ssize_t read(int fd, void *buf, size_t count) {
+    if(fd_tracked(fd)) {
+        ssize_t n = serve_read(fd, buf, count, -1);
+        if(n != -2) return n;
+    }
+    return NEXT(read)(fd, buf, count);
+}
+
+ssize_t pread(int fd, void *buf, size_t count, off_t offset) {
+    if(fd_tracked(fd)) {
+        if(offset < 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        ssize_t n = serve_read(fd, buf, count, offset);
+        if(n != -2) return n;
+    }
+    return NEXT(pread)(fd, buf, count, offset);
+}
+
+ssize_t pread64(int fd, void *buf, size_t count, off64_t offset) {
+    if(fd_tracked(fd)) {
+        if(offset < 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        ssize_t n = serve_read(fd, buf, count, offset);
+        if(n != -2) return n;
+    }
+    return NEXT(pread64)(fd, buf, count, offset);
+}
+
+/* New position, -1 with errno on error, -2 if fd was closed under us */
+static int64_t serve_seek(int fd, int64_t offset, int whence) {
+    pthread_mutex_lock(&fd_lock);
+    if(!fd_used[fd]) {
+        pthread_mutex_unlock(&fd_lock);
+        return -2;
+    }
+    fd_entry_t *e = fd_table[fd];
+    int64_t     size = e->file ? (int64_t)e->file->size : 0;
+    int64_t     base;
+    switch(whence) {
+    case SEEK_SET: base = 0; break;
+    case SEEK_CUR: base = (int64_t)e->pos; break;
+    case SEEK_END: base = size; break;
+#ifdef SEEK_DATA
+    case SEEK_DATA:
+    case SEEK_HOLE:
+        /* One data extent, then the hole at end of file */
+        base = 0;
+        if(offset < 0 || offset >= size) {
+            pthread_mutex_unlock(&fd_lock);
+            errno = ENXIO;
+            return -1;
+        }
+        if(whence == SEEK_HOLE) offset = size;
+        break;
+#endif
+    default:
+        pthread_mutex_unlock(&fd_lock);
+        errno = EINVAL;
+        return -1;
+    }
+    if((offset < 0 && base + offset < 0) || (offset > 0 && base > INT64_MAX - offset)) {
+        pthread_mutex_unlock(&fd_lock);
+        errno = EINVAL;
+        return -1;
+    }
+    e->pos = (uint64_t)(base + offset);
+    pthread_mutex_unlock(&fd_lock);
+    return base + offset;
+}
+
+off_t lseek(int fd, off_t offset, int whence) {
+    if(fd_tracked(fd)) {
+        int64_t pos = serve_seek(fd, offset, whence);
+        if(pos != -2) {
+            if((int64_t)(off_t)pos != pos) {
+                errno = EOVERFLOW;
+                return -1;
+            }
+            return (off_t)pos;
+        }
+    }
+    return NEXT(lseek)(fd, offset, whence);
+}
+
+off64_t lseek64(int fd, off64_t offset, int whence) {
+    if(fd_tracked(fd)) {
+        int64_t pos = serve_seek(fd, offset, whence);
+        if(pos != -2) return pos;
+    }
+    return NEXT(lseek64)(fd, offset, whence);
+}
+
+int dup(int fd) {
+    return fd_dup(fd, NEXT(dup)(fd));
+}
+
+int dup2(int fd, int newfd) {
+    return fd_dup(fd, NEXT(dup2)(fd, newfd));
+}
+
+int dup3(int fd, int newfd, int flags) {
+    return fd_dup(fd, NEXT(dup3)(fd, newfd, flags));
+}
+
+/*
+ * Every fcntl() argument is an int, a long or a pointer, all passed like a
+ * pointer on the targets glibc supports; glibc forwards them the same way.
+ */
+static int serve_fcntl(int (*fn)(int, int, ...), int fd, int cmd, void *arg) {
+    int rc = fn(fd, cmd, arg);
+    return cmd == F_DUPFD || cmd == F_DUPFD_CLOEXEC ? fd_dup(fd, rc) : rc;
+}
+
+int fcntl(int fd, int cmd, ...) {
+    va_list ap;
+    va_start(ap, cmd);
+    void *arg = va_arg(ap, void *);
+    va_end(ap);
+    return serve_fcntl(NEXT(fcntl), fd, cmd, arg);
+}
+
+/* What fcntl() is renamed to with 64-bit file offsets (glibc 2.28 on) */
+int fcntl64(int fd, int cmd, ...);
+
+int fcntl64(int fd, int cmd, ...) {
+    va_list ap;
+    va_start(ap, cmd);
+    void *arg = va_arg(ap, void *);
+    va_end(ap);
+    return serve_fcntl(NEXT(fcntl64), fd, cmd, arg);
+}
+
+int close(int fd) {
+    fd_forget(fd);
+    return NEXT(close)(fd);
+}
+
+/* ========================================================================
+ * stat
+ * ======================================================================== */
+
+/* Read-only regular file or directory; inode numbers come from addresses */
+#define STAT_FILL(st, file, folder)                                          \
+    do {                                                                     \
+        memset((st), 0, sizeof(*(st)));                                      \
+        (st)->st_ino = (uintptr_t)((file) ? (const void *)(file)             \
+                                          : (const void *)(folder)) >> 3;    \
+        (st)->st_uid = getuid();                                             \
+        (st)->st_gid = getgid();                                             \
+        (st)->st_blksize = 4096;                                             \
+        if(file) {                                                           \
+            (st)->st_mode = S_IFREG | 0444;                                  \
+            (st)->st_nlink = 1;                                              \
+            (st)->st_size = (off_t)(file)->size;                             \
+            (st)->st_blocks = (blkcnt_t)(((file)->size + 511) / 512);        \
+        } else {                                                             \
+            (st)->st_mode = S_IFDIR | 0555;                                  \
+            (st)->st_nlink = 2 + (nlink_t)(folder)->child_count;             \
+        }                                                                    \
+    } while(0)
+
+int fstat(int fd, struct stat *st) {
+    fd_entry_t e;
+    if(fd_tracked(fd) && fd_get(fd, &e)) {
+        STAT_FILL(st, e.file, e.folder);
+        return 0;
+    }
+    return NEXT(fstat)(fd, st);
+}
+
+int fstat64(int fd, struct stat64 *st) {
+    fd_entry_t e;
+    if(fd_tracked(fd) && fd_get(fd, &e)) {
+        STAT_FILL(st, e.file, e.folder);
+        return 0;
+    }
+    return NEXT(fstat64)(fd, st);
+}
+
+int stat(const char *path, struct stat *st) {
+    const cirf_file_t   *file;
+    const cirf_folder_t *folder;
+    if(lookup(AT_FDCWD, path, &file, &folder)) {
+        STAT_FILL(st, file, folder);
+        return 0;
+    }
+    return NEXT(stat)(path, st);
+}
+
+int stat64(const char *path, struct stat64 *st) {
+    const cirf_file_t   *file;
+    const cirf_folder_t *folder;
+    if(lookup(AT_FDCWD, path, &file, &folder)) {
+        STAT_FILL(st, file, folder);
+        return 0;
+    }
+    return NEXT(stat64)(path, st);
+}
+
+int lstat(const char *path, struct stat *st) {
+    const cirf_file_t   *file;
+    const cirf_folder_t *folder;
+    if(lookup(AT_FDCWD, path, &file, &folder)) {
+        STAT_FILL(st, file, folder);
+        return 0;
+    }
+    return NEXT(lstat)(path, st);
+}
+
+int lstat64(const char *path, struct stat64 *st) {
+    const cirf_file_t   *file;
+    const cirf_folder_t *folder;
+    if(lookup(AT_FDCWD, path, &file, &folder)) {
+        STAT_FILL(st, file, folder);
+        return 0;
+    }
+    return NEXT(lstat64)(path, st);
+}
+
+/* Resource named by an *at() call, including AT_EMPTY_PATH on a descriptor */
+static int lookup_at(int dirfd, const char *path, int flags, const cirf_file_t **file,
+                     const cirf_folder_t **folder) {
+    fd_entry_t e;
+    if((flags & AT_EMPTY_PATH) && path && !path[0]) {
+        if(!fd_tracked(dirfd) || !fd_get(dirfd, &e)) return 0;
+        *file = e.file;
+        *folder = e.folder;
+        return 1;
+    }
+    return lookup(dirfd, path, file, folder);
+}
+
+int fstatat(int dirfd, const char *path, struct stat *st, int flags) {
+    const cirf_file_t   *file;
+    const cirf_folder_t *folder;
+    if(lookup_at(dirfd, path, flags, &file, &folder)) {
+        STAT_FILL(st, file, folder);
+        return 0;
+    }
+    return NEXT(fstatat)(dirfd, path, st, flags);
+}
+
+int fstatat64(int dirfd, const char *path, struct stat64 *st, int flags) {
+    const cirf_file_t   *file;
+    const cirf_folder_t *folder;
+    if(lookup_at(dirfd, path, flags, &file, &folder)) {
+        STAT_FILL(st, file, folder);
+        return 0;
+    }
+    return NEXT(fstatat64)(dirfd, path, st, flags);
+}
+
+#ifdef STATX_BASIC_STATS
+/* What ls and other coreutils use */
+int statx(int dirfd, const char *path, int flags, unsigned int mask, struct statx *stx) {
+    const cirf_file_t   *file;
+    const cirf_folder_t *folder;
+    if(!lookup_at(dirfd, path, flags, &file, &folder)) {
+        return NEXT(statx)(dirfd, path, flags, mask, stx);
+    }
+
+    struct stat64 st;
+    STAT_FILL(&st, file, folder);
+    memset(stx, 0, sizeof(*stx));
+    stx->stx_mask = STATX_BASIC_STATS & ~(STATX_ATIME | STATX_MTIME | STATX_CTIME);
+    stx->stx_blksize = (uint32_t)st.st_blksize;
+    stx->stx_nlink = (uint32_t)st.st_nlink;
+    stx->stx_uid = st.st_uid;
+    stx->stx_gid = st.st_gid;
+    stx->stx_mode = (uint16_t)st.st_mode;
+    stx->stx_ino = st.st_ino;
+    stx->stx_size = (uint64_t)st.st_size;
+    stx->stx_blocks = (uint64_t)st.st_blocks;
+    return 0;
+}
+#endif
+
+/* ========================================================================
+ * mmap
+ *
+ * Resources live in the program's read-only data at no particular
+ * alignment, so a mapping is a private anonymous one filled with a copy.
+ * The data never changes, so MAP_SHARED readers see the same bytes; a
+ * shared writable mapping is refused like on a read-only file.
+ * ======================================================================== */
+
+/* Mapping, MAP_FAILED with errno, or NULL if fd was closed under us */
+static void *serve_mmap(void *addr, size_t len, int prot, int flags, int fd, int64_t offset) {
+    fd_entry_t e;
+    if(!fd_get(fd, &e)) return NULL;
+
+    long page = sysconf(_SC_PAGESIZE);
+    if(!e.file) {
+        errno = ENODEV;
+        return MAP_FAILED;
+    }
+    if(len == 0 || offset < 0 || offset % page != 0) {
+        errno = EINVAL;
+        return MAP_FAILED;
+    }
+    if((flags & MAP_TYPE) != MAP_PRIVATE && (prot & PROT_WRITE)) {
+        errno = EACCES;
+        return MAP_FAILED;
+    }
+
+    int   anon = (flags & ~MAP_TYPE) | MAP_PRIVATE | MAP_ANONYMOUS;
+    void *map = NEXT(mmap)(addr, len, PROT_READ | PROT_WRITE, anon, -1, 0);
+    if(map == MAP_FAILED) return MAP_FAILED;
+
+    if((uint64_t)offset < e.file->size) {
+        size_t n = e.file->size - (size_t)offset;
+        memcpy(map, e.file->data + offset, n < len ? n : len);
+    }
+    if(prot != (PROT_READ | PROT_WRITE) && mprotect(map, len, prot) != 0) {
+        int err = errno;
+        munmap(map, len);
+        errno = err;
+        return MAP_FAILED;
+    }
+    return map;
+}
+
+void *mmap(void *addr, size_t len, int prot, int flags, int fd, off_t offset) {
+    if(!(flags & MAP_ANONYMOUS) && fd_tracked(fd)) {
+        void *map = serve_mmap(addr, len, prot, flags, fd, offset);
+        if(map) return map;
+    }
+    return NEXT(mmap)(addr, len, prot, flags, fd, offset);
+}
+
+void *mmap64(void *addr, size_t len, int prot, int flags, int fd, off64_t offset) {
+    if(!(flags & MAP_ANONYMOUS) && fd_tracked(fd)) {
+        void *map = serve_mmap(addr, len, prot, flags, fd, offset);
+        if(map) return map;
+    }
+    return NEXT(mmap64)(addr, len, prot, flags, fd, offset);
+}
+
+/* ========================================================================
+ * Directory streams
+ *
+ * A resource folder is listed through a DIR * that points at our own
+ * record; the other DIR calls check the record list before passing
+ * through, which costs one load while no folder is open.
+ * ======================================================================== */
+
+typedef struct preload_dir {
+        struct preload_dir *next;
+        cirf_dir_t          dir;
+        int                 fd;  /* Folder descriptor, for dirfd() */
+        long                pos; /* Entries returned, counting "." and ".." */
+        struct dirent       ent;
+        struct dirent64     ent64;
+} preload_dir_t;
+
+static preload_dir_t  *dir_list;
+static size_t          dir_live;
+static pthread_mutex_t dir_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static preload_dir_t *dir_find(DIR *handle) {
+    if(!__atomic_load_n(&dir_live, __ATOMIC_ACQUIRE)) return NULL;
+    pthread_mutex_lock(&dir_lock);
+    preload_dir_t *d = dir_list;
+    while(d && (DIR *)d != handle)
+        d = d->next;
+    pthread_mutex_unlock(&dir_lock);
+    return d;
+}
+
+/* Stream over a folder descriptor; takes ownership of fd */
+static DIR *dir_open(int fd) {
+    fd_entry_t e;
+    if(!fd_get(fd, &e) || !e.folder) {
+        errno = ENOTDIR;
+        return NULL;
+    }
+    preload_dir_t *d = calloc(1, sizeof(*d));
+    if(!d) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    d->fd = fd;
+    cirf_opendir(&d->dir, e.folder);
+
+    pthread_mutex_lock(&dir_lock);
+    d->next = dir_list;
+    dir_list = d;
+    __atomic_add_fetch(&dir_live, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&dir_lock);
+    return (DIR *)d;
+}
+
+/* Next entry: "." and ".." first, then the folder's children and files */
+static int dir_next(preload_dir_t *d, const char **name, const void **node, unsigned char *type) {
+    const cirf_folder_t *folder = d->dir.folder;
+    if(d->pos < 2) {
+        const cirf_folder_t *self = d->pos == 0 || !folder->parent ? folder : folder->parent;
+        *name = d->pos == 0 ? "." : "..";
+        *node = self;
+        *type = DT_DIR;
+    } else {
+        const cirf_dirent_t *ent = cirf_readdir(&d->dir);
+        if(!ent) return 0;
+        *name = ent->name;
+        *node = ent->file ? (const void *)ent->file : (const void *)ent->folder;
+        *type = ent->file ? DT_REG : DT_DIR;
+    }
+    d->pos++;
+    return 1;
+}
+
+#define DIRENT_FILL(ent, name, node, type, pos)                              \
+    do {                                                                     \
+        size_t n = strlen(name);                                             \
+        if(n >= sizeof((ent)->d_name)) n = sizeof((ent)->d_name) - 1;       \
+        (ent)->d_ino = (uintptr_t)(node) >> 3;                               \
+        (ent)->d_off = (pos);                                                \
+        (ent)->d_reclen = sizeof(*(ent));                                    \
+        (ent)->d_type = (type);                                              \
+        memcpy((ent)->d_name, (name), n);                                    \
+        (ent)->d_name[n] = '\0';                                             \
+    } while(0)
+
+DIR *opendir(const char *path) {
+    int fd;
+    if(serve_open(AT_FDCWD, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC, &fd)) {
+        if(fd < 0) return NULL;
+        DIR *handle = dir_open(fd);
+        if(!handle) close(fd);
+        return handle;
+    }
+    return NEXT(opendir)(path);
+}
+
+DIR *fdopendir(int fd) {
+    if(fd_tracked(fd)) return dir_open(fd);
+    return NEXT(fdopendir)(fd);
+}
+
+struct dirent *readdir(DIR *handle) {
+    preload_dir_t *d = dir_find(handle);
+    if(!d) return NEXT(readdir)(handle);
+
+    const char   *name;
+    const void   *node;
+    unsigned char type;
+    if(!dir_next(d, &name, &node, &type)) return NULL;
+    DIRENT_FILL(&d->ent, name, node, type, d->pos);
+    return &d->ent;
+}
+
+struct dirent64 *readdir64(DIR *handle) {
+    preload_dir_t *d = dir_find(handle);
+    if(!d) return NEXT(readdir64)(handle);
+
+    const char   *name;
+    const void   *node;
+    unsigned char type;
+    if(!dir_next(d, &name, &node, &type)) return NULL;
+    DIRENT_FILL(&d->ent64, name, node, type, d->pos);
+    return &d->ent64;
+}
+
+void rewinddir(DIR *handle) {
+    preload_dir_t *d = dir_find(handle);
+    if(!d) {
+        NEXT(rewinddir)(handle);
+        return;
+    }
+    cirf_rewinddir(&d->dir);
+    d->pos = 0;
+}
+
+int dirfd(DIR *handle) {
+    preload_dir_t *d = dir_find(handle);
+    if(!d) return NEXT(dirfd)(handle);
+    return d->fd;
+}
+
+int closedir(DIR *handle) {
+    if(!__atomic_load_n(&dir_live, __ATOMIC_ACQUIRE)) return NEXT(closedir)(handle);
+
+    pthread_mutex_lock(&dir_lock);
+    preload_dir_t **link = &dir_list;
+    while(*link && (DIR *)*link != handle)
+        link = &(*link)->next;
+    preload_dir_t *d = *link;
+    if(d) {
+        *link = d->next;
+        __atomic_sub_fetch(&dir_live, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&dir_lock);
+
+    if(!d) return NEXT(closedir)(handle);
+    close(d->fd);
+    free(d);
+    return 0;
+}
+
+/* ========================================================================
+ * fopen
+ *
+ * libc opens files for stdio internally, past the open() above, so FILE
+ * streams over resources come from cirf_fopen() instead.
+ * ======================================================================== */
+
+/* Stream, NULL with errno, or NULL with *served == 0 to pass through */
+static FILE *serve_fopen(const char *path, const char *mode, int *served) {
+    const cirf_file_t   *file;
+    const cirf_folder_t *folder;
+    *served = lookup(AT_FDCWD, path, &file, &folder);
+    if(!*served) return NULL;
+
+    if(!mode || mode[0] != 'r' || strchr(mode, '+')) {
+        errno = folder ? EISDIR : EROFS;
+        return NULL;
+    }
+    if(folder) {
+        errno = EISDIR;
+        return NULL;
+    }
+    return cirf_fopen(file);
+}
+
+FILE *fopen(const char *path, const char *mode) {
+    int   served;
+    FILE *fp = serve_fopen(path, mode, &served);
+    return served ? fp : NEXT(fopen)(path, mode);
+}
+
+FILE *fopen64(const char *path, const char *mode) {
+    int   served;
+    FILE *fp = serve_fopen(path, mode, &served);
+    return served ? fp : NEXT(fopen64)(path, mode);
+}
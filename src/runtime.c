@@ -2,267 +2,2694 @@
  * cirf/runtime.c - Runtime library implementation
  *
  * Configuration options (define before including or via compiler flags):
- *   CIRF_MAX_PATH     - Maximum path length (default: 256)
+ *   CIRF_MAX_PATH     - Unused; lookups no longer copy paths (kept for compatibility)
  *   CIRF_NO_STDIO     - Disable FILE* functions (for systems without fmemopen)
+ *   CIRF_NO_FD        - Disable memfd export (cirf_open_fd, cirf_fd_path)
+ *   CIRF_NO_PACK      - Disable resource packs (cirf_pack_open)
  *   CIRF_NO_MOUNT     - Disable mount system (saves memory if not needed)
+ *   CIRF_NO_THREADS   - No pthreads or atomics: single-threaded mount table and
+ *                       no cirf_foreach_file_parallel()
+ *   CIRF_MAX_MOUNTS   - Static mount table of this capacity (no malloc)
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* fopencookie() on glibc */
+#endif
+
 #include "cirf/runtime.h"
+#include "cirf/hash.h"
 #include <string.h>
 
-/* Configurable maximum path length - uses stack allocation */
-#ifndef CIRF_MAX_PATH
-#define CIRF_MAX_PATH 256
-#endif
-
 /* ========================================================================
- * Path-based lookup functions
+ * Path index
  * ======================================================================== */
 
-const cirf_file_t *cirf_find_file(const cirf_folder_t *root, const char *path) {
-    if(!root || !path) return NULL;
+static int has_path_index(const cirf_folder_t *root) {
+    return root->index && (root->index->hash_entry_count || root->index->trie_entry_count);
+}
 
-    const char *slash = strrchr(path, '/');
-    if(!slash) {
-        /* File is in root folder */
-        for(size_t i = 0; i < root->file_count; i++) {
-            if(strcmp(root->files[i].name, path) == 0) {
-                return &root->files[i];
-            }
-        }
-        return NULL;
+static int has_trie_index(const cirf_folder_t *root) {
+    return root->index && root->index->trie_entry_count;
+}
+
+/*
+ * Check that a path is in the canonical form stored in the generated
+ * indexes: no leading, trailing or repeated slashes, and no NUL bytes.
+ * Other spellings are still accepted by the tree walk.
+ */
+static int path_canonical(const char *path, size_t len) {
+    char prev = '/';
+    for(size_t i = 0; i < len; i++) {
+        if(path[i] == '\0' || (path[i] == '/' && prev == '/')) return 0;
+        prev = path[i];
     }
+    return prev != '/' || len == 0;
+}
 
-    /* Check if path matches a folder */
-    const cirf_folder_t *folder = cirf_find_folder(root, path);
-    if(folder) {
-        /* path was a folder, not a file */
-        return NULL;
+/* The only entry that can have hash h; must still be verified */
+static const cirf_path_entry_t *hash_probe(const cirf_index_t *index, cirf_hash_t h) {
+    int32_t seed = index->hash_seeds[h % index->hash_bucket_count];
+    size_t  slot;
+    if(seed < 0) {
+        slot = (size_t)(-(seed + 1));
+    } else {
+        slot = (size_t)(cirf_hash_mix(h, (uint32_t)seed) % index->hash_entry_count);
     }
+    return &index->hash_entries[slot];
+}
 
-    /* Find parent folder - use stack allocation */
-    size_t folder_len = (size_t)(slash - path);
-    if(folder_len >= CIRF_MAX_PATH) return NULL;
+static const char *entry_path(const cirf_path_entry_t *e) {
+    return e->file ? e->file->path : e->folder->path;
+}
 
-    char folder_path[CIRF_MAX_PATH];
-    memcpy(folder_path, path, folder_len);
-    folder_path[folder_len] = '\0';
+/* One hash, one slot, one verifying compare */
+static const cirf_path_entry_t *hash_lookup(const cirf_index_t *index, cirf_hash_t h,
+                                            const char *path, size_t len) {
+    const cirf_path_entry_t *e = hash_probe(index, h);
+    const char              *candidate = entry_path(e);
+    if(strncmp(candidate, path, len) != 0 || candidate[len] != '\0') return NULL;
+    return e;
+}
 
-    folder = cirf_find_folder(root, folder_path);
-    if(!folder) return NULL;
+/* Child of a trie node whose label starts with c */
+static const cirf_trie_node_t *trie_child(const cirf_index_t *index, const cirf_trie_node_t *node,
+                                          unsigned char c) {
+    const cirf_trie_node_t *nodes = index->trie_nodes;
+    uint32_t                i = (uint32_t)(node - nodes) + 1;
 
-    const char *filename = slash + 1;
-    for(size_t i = 0; i < folder->file_count; i++) {
-        if(strcmp(folder->files[i].name, filename) == 0) {
-            return &folder->files[i];
-        }
+    while(i < node->end) {
+        unsigned char first = (unsigned char)index->trie_labels[nodes[i].label];
+        if(first == c) return &nodes[i];
+        if(first > c) break; /* Children are sorted by label */
+        i = nodes[i].end;
     }
     return NULL;
 }
 
-const cirf_folder_t *cirf_find_folder(const cirf_folder_t *root, const char *path) {
-    if(!root || !path) return NULL;
-    if(*path == '\0') return root;
+/*
+ * Follow `path` down the trie as far as it matches. Returns the deepest node
+ * reached and sets *pos to the number of bytes matched; a match may end
+ * inside that node's label.
+ */
+static const cirf_trie_node_t *trie_descend(const cirf_index_t *index, const char *path,
+                                            size_t len, size_t *pos) {
+    const cirf_trie_node_t *node = index->trie_nodes;
+    size_t                  p = 0;
 
-    const cirf_folder_t *current = root;
-    const char          *p = path;
+    while(p < len) {
+        const cirf_trie_node_t *child = trie_child(index, node, (unsigned char)path[p]);
+        if(!child) break;
+
+        size_t n = child->label_len < len - p ? child->label_len : len - p;
+        if(memcmp(index->trie_labels + child->label, path + p, n) != 0) break;
+        node = child;
+        p += n;
+    }
 
-    while(*p && current) {
-        /* Skip leading slashes */
-        while(*p == '/')
-            p++;
-        if(*p == '\0') break;
+    *pos = p;
+    return node;
+}
 
-        /* Find end of component */
-        const char *end = p;
-        while(*end && *end != '/')
-            end++;
-        size_t len = (size_t)(end - p);
-
-        /* Search for matching child */
-        const cirf_folder_t *found = NULL;
-        for(size_t i = 0; i < current->child_count; i++) {
-            const char *name = current->children[i]->name;
-            if(strlen(name) == len && memcmp(name, p, len) == 0) {
-                found = current->children[i];
-                break;
+static const cirf_path_entry_t *trie_lookup(const cirf_index_t *index, const char *path,
+                                            size_t len) {
+    size_t                  pos;
+    const cirf_trie_node_t *node = trie_descend(index, path, len, &pos);
+    if(pos != len || !node->terminal) return NULL;
+
+    /* pos == len may still end inside the node's label */
+    const cirf_path_entry_t *e = &index->trie_entries[node->entry_first];
+    const char              *candidate = e->file ? e->file->path : e->folder->path;
+    return candidate[len] == '\0' ? e : NULL;
+}
+
+static const cirf_path_entry_t *index_lookup(const cirf_index_t *index, const char *path,
+                                             size_t len) {
+    if(index->hash_entry_count) return hash_lookup(index, cirf_hash_bytes(path, len), path, len);
+    if(index->trie_entry_count) return trie_lookup(index, path, len);
+    return NULL;
+}
+
+/* Bloom filter test: non-zero if no file of the set can have hash h */
+static int filter_rejects(const cirf_index_t *index, cirf_hash_t h) {
+    const uint64_t *block =
+        index->filter + cirf_bloom_block(h, index->filter_block_count) * CIRF_BLOOM_WORDS;
+    uint64_t bits = cirf_bloom_bits(h);
+    for(unsigned j = 0; j < CIRF_BLOOM_WORDS; j++) {
+        if(!(block[j] & cirf_bloom_mask(bits, j))) return 1;
+    }
+    return 0;
+}
+
+/* ========================================================================
+ * Folder search
+ *
+ * Generated folders carry CIRF_FOLDER_SORTED: files[] and children[] are in
+ * byte order of their names, and every entry stores its name length and
+ * fingerprint. Those are binary-searched, and the name string is only read
+ * once the fingerprints agree. Hand-written folders are scanned linearly.
+ * ======================================================================== */
+
+/* Order of name (with fingerprint fp) against an entry's name */
+static int name_order(const char *name, size_t len, uint64_t fp, const char *ename,
+                      size_t elen, uint64_t efp) {
+    if(fp != efp) return fp < efp ? -1 : 1;
+    if(len > 8 && elen > 8) {
+        size_t n = len < elen ? len : elen;
+        int    c = memcmp(name + 8, ename + 8, n - 8);
+        if(c) return c;
+    }
+    return (len > elen) - (len < elen);
+}
+
+static const cirf_folder_t *folder_child(const cirf_folder_t *folder, const char *name,
+                                         size_t len) {
+    if(!(folder->flags & CIRF_FOLDER_SORTED)) {
+        for(size_t i = 0; i < folder->child_count; i++) {
+            const char *child = folder->children[i]->name;
+            if(strlen(child) == len && memcmp(child, name, len) == 0) {
+                return folder->children[i];
             }
         }
+        return NULL;
+    }
+
+    uint64_t fp = cirf_name_fp(name, len);
+    size_t   lo = 0;
+    size_t   hi = folder->child_count;
+    while(lo < hi) {
+        size_t               mid = lo + (hi - lo) / 2;
+        const cirf_folder_t *c = folder->children[mid];
+        int                  order = name_order(name, len, fp, c->name, c->name_len, c->name_fp);
+        if(order == 0) return c;
+        if(order < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
 
-        current = found;
-        p = end;
+static const cirf_file_t *folder_file(const cirf_folder_t *folder, const char *name,
+                                      size_t len) {
+    if(!(folder->flags & CIRF_FOLDER_SORTED)) {
+        for(size_t i = 0; i < folder->file_count; i++) {
+            const char *file = folder->files[i].name;
+            if(strlen(file) == len && memcmp(file, name, len) == 0) {
+                return &folder->files[i];
+            }
+        }
+        return NULL;
     }
 
-    return current;
+    uint64_t fp = cirf_name_fp(name, len);
+    size_t   lo = 0;
+    size_t   hi = folder->file_count;
+    while(lo < hi) {
+        size_t             mid = lo + (hi - lo) / 2;
+        const cirf_file_t *f = &folder->files[mid];
+        int                order = name_order(name, len, fp, f->name, f->name_len, f->name_fp);
+        if(order == 0) return f;
+        if(order < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
 }
 
 /* ========================================================================
- * Metadata functions
+ * Hot lookup arrays
+ *
+ * Roots generated with -I hot walk dense arrays instead of the structures:
+ * a folder's children and files are ranges of breadth-first and flat-table
+ * positions, and only the fingerprints are read while searching them.
  * ======================================================================== */
 
-const char *cirf_get_metadata(const cirf_metadata_t *metadata, size_t count, const char *key) {
-    if(!metadata || !key) return NULL;
-    for(size_t i = 0; i < count; i++) {
-        if(strcmp(metadata[i].key, key) == 0) {
-            return metadata[i].value;
+#define HOT_NONE ((size_t)-1)
+
+static const cirf_hot_t *hot_arrays(const cirf_folder_t *folder) {
+    return folder->index ? folder->index->hot : NULL;
+}
+
+/*
+ * First position in [first, first + count) whose fingerprint is not below
+ * fp. The loop runs the same number of times for every fp and has no
+ * data-dependent branch, so random lookups do not pay for mispredictions.
+ */
+static size_t hot_lower_bound(const uint64_t *fps, size_t first, size_t count, uint64_t fp) {
+    const uint64_t *base = fps + first;
+    while(count > 1) {
+        size_t half = count / 2;
+        base += (size_t)(base[half - 1] < fp) * half;
+        count -= half;
+    }
+    return (size_t)(base - fps) + (count && *base < fp);
+}
+
+/*
+ * Non-zero if entry k sorts before (fp, tail). Tails are only read where
+ * fingerprints are equal: rarely in most folders, and at every step where
+ * many names share their first 8 bytes, so the branch is well predicted
+ * either way.
+ */
+static int hot_below(const uint64_t *fps, const uint64_t *tails, size_t k, uint64_t fp,
+                     uint64_t tail) {
+    if(fps[k] == fp) return tails[k] < tail;
+    return fps[k] < fp;
+}
+
+/* First position in [first, first + count) not below (fp, tail); see hot_lower_bound() */
+static size_t hot_tail_bound(const uint64_t *fps, const uint64_t *tails, size_t first,
+                             size_t count, uint64_t fp, uint64_t tail) {
+    while(count > 1) {
+        size_t half = count / 2;
+        first += (size_t)hot_below(fps, tails, first + half - 1, fp, tail) * half;
+        count -= half;
+    }
+    return first + (count && hot_below(fps, tails, first, fp, tail));
+}
+
+/*
+ * Position of name in [first, first + count) of a hot array, or HOT_NONE.
+ *
+ * Names of up to 16 bytes are found from the fingerprints, tails and
+ * lengths alone; longer ones are compared by name, but only with the
+ * entries sharing their first 16 bytes. Fingerprints pad names with zero
+ * bytes, so a name holding a NUL must never match.
+ */
+static size_t hot_search(const cirf_hot_t *hot, const uint64_t *fps, const uint64_t *tails,
+                         const uint32_t *lens, const uint32_t *names, size_t first, size_t count,
+                         const char *name, size_t len) {
+    uint64_t fp = cirf_name_fp(name, len);
+    size_t   end = first + count;
+    size_t   lo;
+    if(len <= 8) {
+        /* Sorts first among the names sharing its fingerprint */
+        lo = hot_lower_bound(fps, first, count, fp);
+        if(lo == end || fps[lo] != fp) return HOT_NONE;
+        return lens[lo] == len && !memchr(name, '\0', len) ? lo : HOT_NONE;
+    }
+
+    uint64_t tail = cirf_name_fp(name + 8, len - 8);
+    lo = hot_tail_bound(fps, tails, first, count, fp, tail);
+    if(lo == end || fps[lo] != fp || tails[lo] != tail) return HOT_NONE;
+    if(len <= 16) return lens[lo] == len && !memchr(name, '\0', len) ? lo : HOT_NONE;
+
+    /* Names sharing their first 16 bytes: bound the run by doubling the step,
+     * then search it by the rest of the name. The bound may overshoot into
+     * later entries, which sort after the name */
+    size_t hi = lo + 1;
+    size_t step = 1;
+    while(hi < end && fps[hi] == fp && tails[hi] == tail) {
+        hi += step;
+        step *= 2;
+    }
+    if(hi > end) hi = end;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        size_t elen = lens[mid];
+        int    order = -1;
+        if(fps[mid] == fp && tails[mid] == tail) {
+            size_t n = len < elen ? len : elen;
+            order = n > 16 ? memcmp(name + 16, hot->names + names[mid] + 16, n - 16) : 0;
+            if(!order) order = (len > elen) - (len < elen);
+        }
+        if(order == 0) return mid;
+        if(order < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
         }
     }
-    return NULL;
+    return HOT_NONE;
+}
+
+/* Breadth-first number of the folder named by path[0, len), or HOT_NONE */
+static size_t hot_walk(const cirf_hot_t *hot, const char *path, size_t len) {
+    size_t folder = 0;
+    size_t pos = 0;
+    while(folder != HOT_NONE && pos < len) {
+        if(path[pos] == '/') {
+            pos++;
+            continue;
+        }
+        size_t end = pos;
+        while(end < len && path[end] != '/')
+            end++;
+        const cirf_hot_range_t *r = &hot->folder_ranges[folder];
+        folder = hot_search(hot, hot->folder_fps, hot->folder_tails, hot->folder_lens,
+                            hot->folder_names, r->child_first, r->child_count, path + pos,
+                            end - pos);
+        pos = end;
+    }
+    return folder;
 }
 
 /* ========================================================================
- * Navigation functions
+ * Path-based lookup functions
  * ======================================================================== */
 
-const cirf_folder_t *cirf_get_root(const cirf_file_t *file) {
-    if(!file) return NULL;
-    const cirf_folder_t *folder = file->parent;
-    while(folder && folder->parent) {
-        folder = folder->parent;
+/* Walk the folders named by path[0, len) below folder, ignoring extra slashes */
+static const cirf_folder_t *walk_folders(const cirf_folder_t *folder, const char *path,
+                                         size_t len) {
+    const cirf_hot_t *hot = hot_arrays(folder);
+    if(hot) {
+        size_t i = hot_walk(hot, path, len);
+        return i != HOT_NONE ? hot->folders[i] : NULL;
+    }
+
+    size_t pos = 0;
+    while(folder && pos < len) {
+        if(path[pos] == '/') {
+            pos++;
+            continue;
+        }
+        size_t end = pos;
+        while(end < len && path[end] != '/')
+            end++;
+        folder = folder_child(folder, path + pos, end - pos);
+        pos = end;
     }
     return folder;
 }
 
+/* Walk to the folder holding the last component of path, then find it there */
+static const cirf_file_t *walk_file(const cirf_folder_t *folder, const char *path, size_t len) {
+    size_t name = len;
+    while(name > 0 && path[name - 1] != '/')
+        name--;
+
+    const cirf_hot_t *hot = hot_arrays(folder);
+    if(hot) {
+        size_t d = hot_walk(hot, path, name);
+        if(d == HOT_NONE) return NULL;
+        const cirf_hot_range_t *r = &hot->folder_ranges[d];
+        size_t i = hot_search(hot, hot->file_fps, hot->file_tails, hot->file_lens, hot->file_names,
+                              r->file_first, r->file_count, path + name, len - name);
+        return i != HOT_NONE ? &folder->tree_files[i] : NULL;
+    }
+
+    folder = walk_folders(folder, path, name);
+    return folder ? folder_file(folder, path + name, len - name) : NULL;
+}
+
+const cirf_file_t *cirf_find_file(const cirf_folder_t *root, const char *path) {
+    if(!path) return NULL;
+    return cirf_find_file_n(root, path, strlen(path));
+}
+
+const cirf_folder_t *cirf_find_folder(const cirf_folder_t *root, const char *path) {
+    if(!path) return NULL;
+    return cirf_find_folder_n(root, path, strlen(path));
+}
+
+const cirf_file_t *cirf_find_file_n(const cirf_folder_t *root, const char *path, size_t len) {
+    if(!root || (!path && len)) return NULL;
+
+    const cirf_index_t *index = root->index;
+    if(index && path_canonical(path, len)) {
+        /* Misses usually stop at the filter: one hash, one cache line */
+        cirf_hash_t h = 0;
+        if(index->filter_block_count || index->hash_entry_count) {
+            h = cirf_hash_bytes(path, len);
+        }
+        if(index->filter_block_count && filter_rejects(index, h)) return NULL;
+
+        const cirf_path_entry_t *e = NULL;
+        if(index->hash_entry_count) {
+            e = hash_lookup(index, h, path, len);
+        } else if(index->trie_entry_count) {
+            e = trie_lookup(index, path, len);
+        } else {
+            return walk_file(root, path, len);
+        }
+        return e ? e->file : NULL;
+    }
+    return walk_file(root, path, len);
+}
+
+const cirf_folder_t *cirf_find_folder_n(const cirf_folder_t *root, const char *path,
+                                        size_t len) {
+    if(!root || (!path && len)) return NULL;
+    if(len == 0) return root;
+
+    if(has_path_index(root) && path_canonical(path, len)) {
+        const cirf_path_entry_t *e = index_lookup(root->index, path, len);
+        return e ? e->folder : NULL;
+    }
+    return walk_folders(root, path, len);
+}
+
 /* ========================================================================
- * Iteration functions
+ * Relative lookup
+ *
+ * A cursor remembers the hash state of "<folder path>/", so a lookup below
+ * the folder only hashes the relative part. Without a hash index it walks
+ * from the folder instead of the root.
  * ======================================================================== */
 
-void cirf_foreach_file(const cirf_folder_t *folder, cirf_file_callback_t callback, void *ctx) {
-    if(!folder || !callback) return;
-    for(size_t i = 0; i < folder->file_count; i++) {
-        callback(&folder->files[i], ctx);
+int cirf_cursor_init(cirf_cursor_t *cur, const cirf_folder_t *folder) {
+    if(!cur || !folder) return -1;
+
+    const cirf_folder_t *root = folder;
+    while(root->parent)
+        root = root->parent;
+
+    cur->root = root;
+    cur->folder = folder;
+    cur->path_len = strlen(folder->path);
+    cirf_hash_init(&cur->hash);
+    if(cur->path_len) {
+        cirf_hash_update(&cur->hash, folder->path, cur->path_len);
+        cirf_hash_update(&cur->hash, "/", 1);
     }
+    return 0;
 }
 
-void cirf_foreach_file_recursive(const cirf_folder_t *folder, cirf_file_callback_t callback,
-                                 void *ctx) {
-    if(!folder || !callback) return;
-    for(size_t i = 0; i < folder->file_count; i++) {
-        callback(&folder->files[i], ctx);
-    }
-    for(size_t i = 0; i < folder->child_count; i++) {
-        cirf_foreach_file_recursive(folder->children[i], callback, ctx);
+/* Resolve a canonical relative path through the root's hash index */
+static const cirf_path_entry_t *cursor_lookup(const cirf_cursor_t *cur, const char *path,
+                                              size_t len) {
+    cirf_hash_state_t st = cur->hash;
+    cirf_hash_update(&st, path, len);
+
+    const cirf_path_entry_t *e = hash_probe(cur->root->index, cirf_hash_final(&st));
+    const char              *candidate = entry_path(e);
+    size_t                   n = cur->path_len;
+    if(n) {
+        if(strncmp(candidate, cur->folder->path, n) != 0 || candidate[n] != '/') return NULL;
+        candidate += n + 1;
     }
+    if(strncmp(candidate, path, len) != 0 || candidate[len] != '\0') return NULL;
+    return e;
 }
 
-size_t cirf_count_files(const cirf_folder_t *folder) {
-    if(!folder) return 0;
-    size_t count = folder->file_count;
-    for(size_t i = 0; i < folder->child_count; i++) {
-        count += cirf_count_files(folder->children[i]);
+static int cursor_indexed(const cirf_cursor_t *cur, const char *path, size_t len) {
+    return cur->root->index && cur->root->index->hash_entry_count && path_canonical(path, len);
+}
+
+const cirf_file_t *cirf_cursor_find_file(const cirf_cursor_t *cur, const char *path,
+                                         size_t len) {
+    if(!cur || (!path && len)) return NULL;
+
+    if(len && cursor_indexed(cur, path, len)) {
+        const cirf_path_entry_t *e = cursor_lookup(cur, path, len);
+        return e ? e->file : NULL;
     }
-    return count;
+    return walk_file(cur->folder, path, len);
 }
 
-size_t cirf_count_folders(const cirf_folder_t *folder) {
-    if(!folder) return 0;
-    size_t count = folder->child_count;
-    for(size_t i = 0; i < folder->child_count; i++) {
-        count += cirf_count_folders(folder->children[i]);
+const cirf_folder_t *cirf_cursor_find_folder(const cirf_cursor_t *cur, const char *path,
+                                             size_t len) {
+    if(!cur || (!path && len)) return NULL;
+    if(len == 0) return cur->folder;
+
+    if(cursor_indexed(cur, path, len)) {
+        const cirf_path_entry_t *e = cursor_lookup(cur, path, len);
+        return e ? e->folder : NULL;
     }
-    return count;
+    return walk_folders(cur->folder, path, len);
 }
 
 /* ========================================================================
- * Standard I/O compatibility (POSIX)
+ * Prefix queries
  * ======================================================================== */
 
-#ifndef CIRF_NO_STDIO
+/* Tree-walk fallback for prefix matching on roots without a trie */
+static cirf_path_entry_t tree_match(const cirf_folder_t *root, const char *path, size_t len,
+                                    int folders_only, size_t *consumed) {
+    cirf_path_entry_t    best = {NULL, NULL};
+    const cirf_folder_t *current = root;
+    size_t               pos = 0;
 
-/* Check for fmemopen availability */
-#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || \
-    defined(__OpenBSD__) || defined(__DragonFly__) ||                                          \
-    (defined(_POSIX_VERSION) && _POSIX_VERSION >= 200809L)
-#define CIRF_HAVE_FMEMOPEN 1
-#endif
+    while(pos < len) {
+        size_t end = pos;
+        while(end < len && path[end] != '/')
+            end++;
+        size_t n = end - pos;
 
-#ifdef CIRF_HAVE_FMEMOPEN
+        const cirf_folder_t *next = folder_child(current, path + pos, n);
+        if(!next) {
+            const cirf_file_t *file = folders_only ? NULL : folder_file(current, path + pos, n);
+            if(file) {
+                best.file = file;
+                best.folder = NULL;
+                *consumed = end;
+            }
+            break;
+        }
 
-FILE *cirf_fopen(const cirf_file_t *file) {
-    if(!file) return NULL;
-    /* Cast away const - fmemopen with "r" mode won't modify the buffer */
-    return fmemopen((void *)file->data, file->size, "r");
+        current = next;
+        best.folder = current;
+        *consumed = end;
+        pos = end < len ? end + 1 : end;
+    }
+    return best;
 }
 
-FILE *cirf_fopen_path(const cirf_folder_t *root, const char *path) {
-    const cirf_file_t *file = cirf_find_file(root, path);
-    if(!file) return NULL;
-    return cirf_fopen(file);
-}
+static cirf_path_entry_t match_prefix(const cirf_folder_t *root, const char *path,
+                                      int folders_only, size_t *consumed) {
+    cirf_path_entry_t best = {NULL, NULL};
+    size_t            best_len = 0;
 
-#else /* No fmemopen */
+    /* Leading slashes belong to the matched prefix */
+    size_t skip = 0;
+    while(path[skip] == '/')
+        skip++;
+    const char *p = path + skip;
+    size_t      len = strlen(p);
 
-FILE *cirf_fopen(const cirf_file_t *file) {
-    (void)file;
-    return NULL; /* fmemopen not available */
+    if(has_trie_index(root)) {
+        const cirf_index_t     *index = root->index;
+        const cirf_trie_node_t *node = index->trie_nodes;
+        size_t                  pos = 0;
+
+        while(pos < len) {
+            const cirf_trie_node_t *child = trie_child(index, node, (unsigned char)p[pos]);
+            if(!child || child->label_len > len - pos ||
+               memcmp(index->trie_labels + child->label, p + pos, child->label_len) != 0) {
+                break;
+            }
+            node = child;
+            pos += child->label_len;
+
+            /* Only whole components count as a match */
+            if(node->terminal && (pos == len || p[pos] == '/')) {
+                const cirf_path_entry_t *e = &index->trie_entries[node->entry_first];
+                if(!folders_only || e->folder) {
+                    best = *e;
+                    best_len = pos;
+                }
+            }
+        }
+    } else {
+        best = tree_match(root, p, len, folders_only, &best_len);
+    }
+
+    *consumed = (best.file || best.folder) ? skip + best_len : 0;
+    return best;
 }
 
-FILE *cirf_fopen_path(const cirf_folder_t *root, const char *path) {
-    (void)root;
-    (void)path;
-    return NULL; /* fmemopen not available */
+cirf_path_entry_t cirf_match_prefix(const cirf_folder_t *root, const char *path,
+                                    size_t *consumed) {
+    cirf_path_entry_t best = {NULL, NULL};
+    size_t            len = 0;
+    if(root && path) {
+        best = match_prefix(root, path, 0, &len);
+    }
+    if(consumed) *consumed = len;
+    return best;
 }
 
-#endif /* CIRF_HAVE_FMEMOPEN */
+const cirf_folder_t *cirf_match_folder(const cirf_folder_t *root, const char *path,
+                                       size_t *consumed) {
+    const cirf_folder_t *folder = root;
+    size_t               len = 0;
+    if(root && path) {
+        cirf_path_entry_t best = match_prefix(root, path, 1, &len);
+        if(best.folder) folder = best.folder;
+    }
+    if(consumed) *consumed = len;
+    return folder;
+}
 
-#endif /* CIRF_NO_STDIO */
+int cirf_prefix_iter_init(cirf_prefix_iter_t *it, const cirf_folder_t *root,
+                          const char *prefix) {
+    if(!it) return -1;
+    it->next = NULL;
+    it->end = NULL;
+    if(!root || !prefix || !has_trie_index(root)) return -1;
+
+    const cirf_index_t     *index = root->index;
+    size_t                  len = strlen(prefix);
+    size_t                  pos;
+    const cirf_trie_node_t *node = trie_descend(index, prefix, len, &pos);
+    if(pos == len) {
+        it->next = &index->trie_entries[node->entry_first];
+        it->end = &index->trie_entries[node->entry_end];
+    }
+    return 0;
+}
+
+const cirf_file_t *cirf_prefix_iter_next(cirf_prefix_iter_t *it) {
+    if(!it) return NULL;
+    while(it->next < it->end) {
+        const cirf_path_entry_t *e = it->next++;
+        if(e->file) return e->file;
+    }
+    return NULL;
+}
 
 /* ========================================================================
- * Virtual filesystem mount (optional - requires malloc)
- *
- * Define CIRF_NO_MOUNT to disable this feature for embedded systems
- * that don't need multiple resource sets or want to avoid malloc.
+ * Inverted indexes
  * ======================================================================== */
 
-#ifndef CIRF_NO_MOUNT
+/*
+ * Order of a posting against a query: by key (unless key is NULL), then by
+ * value, or by its first value_len bytes when prefix is set. Postings
+ * matching a prefix are contiguous, since they are sorted by value.
+ */
+static int posting_cmp(const cirf_posting_t *p, const char *key, const char *value,
+                       size_t value_len, int prefix) {
+    int c = key ? strcmp(p->key, key) : 0;
+    if(c || !value) return c;
+    return prefix ? strncmp(p->value, value, value_len) : strcmp(p->value, value);
+}
 
-#include <stdlib.h> /* Only needed for mount system */
+/* Narrow span to the files of all postings that compare equal to the query */
+static void posting_span(cirf_file_span_t *span, const cirf_posting_t *postings, size_t count,
+                         const char *key, const char *value, size_t value_len, int prefix) {
+    size_t lo = 0;
+    size_t hi = count;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(posting_cmp(&postings[mid], key, value, value_len, prefix) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    size_t first = lo;
 
-cirf_mount_t *cirf_mounts = NULL;
+    hi = count;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(posting_cmp(&postings[mid], key, value, value_len, prefix) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
 
-int cirf_mount(const char *prefix, const cirf_folder_t *root) {
-    if(!prefix || !root) return -1;
+    if(first < lo) {
+        const cirf_posting_t *last = &postings[lo - 1];
+        span->ids += postings[first].first;
+        span->count = last->first + last->count - postings[first].first;
+    } else {
+        span->ids = NULL;
+    }
+}
+
+/*
+ * Start an empty span over root's files. Returns 0 if the set can be
+ * queried: it has a query index (every file has a MIME posting) or no files.
+ */
+static int query_init(cirf_file_span_t *span, const cirf_folder_t *root) {
+    span->files = NULL;
+    span->ids = NULL;
+    span->count = 0;
+    if(!root) return -1;
+    if(root->index && root->index->mime_posting_count) {
+        span->files = root->tree_files;
+        span->ids = root->index->query_files;
+        return 0;
+    }
+    return cirf_count_files(root) == 0 ? 0 : -1;
+}
 
-    cirf_mount_t *mount = malloc(sizeof(cirf_mount_t));
-    if(!mount) return -1;
+int cirf_query_meta(cirf_file_span_t *span, const cirf_folder_t *root, const char *key,
+                    const char *value) {
+    if(!span) return -1;
+    if(query_init(span, root) != 0 || !key) return -1;
+    if(!span->ids) return 0;
 
-    mount->prefix = prefix;
-    mount->root = root;
-    mount->next = cirf_mounts;
-    cirf_mounts = mount;
+    const cirf_index_t *index = root->index;
+    posting_span(span, index->meta_postings, index->meta_posting_count, key, value,
+                 value ? strlen(value) : 0, 0);
     return 0;
 }
 
-int cirf_unmount(const char *prefix) {
-    if(!prefix) return -1;
-
-    cirf_mount_t **prev = &cirf_mounts;
-    cirf_mount_t  *curr = cirf_mounts;
+int cirf_query_mime(cirf_file_span_t *span, const cirf_folder_t *root, const char *mime) {
+    if(!span) return -1;
+    if(query_init(span, root) != 0 || !mime) return -1;
+    if(!span->ids) return 0;
 
-    while(curr) {
-        if(strcmp(curr->prefix, prefix) == 0) {
-            *prev = curr->next;
-            free(curr);
-            return 0;
-        }
-        prev = &curr->next;
-        curr = curr->next;
+    /* A trailing wildcard ("image/" plus '*') matches by prefix */
+    size_t len = strlen(mime);
+    int    prefix = 0;
+    if(strcmp(mime, "*") == 0 || strcmp(mime, "*/*") == 0) {
+        len = 0;
+        prefix = 1;
+    } else if(len >= 2 && mime[len - 2] == '/' && mime[len - 1] == '*') {
+        len--;
+        prefix = 1;
     }
-    return -1;
+
+    const cirf_index_t *index = root->index;
+    posting_span(span, index->mime_postings, index->mime_posting_count, NULL, mime, len, prefix);
+    return 0;
 }
 
-const cirf_file_t *cirf_resolve_file(const char *path) {
+/* ========================================================================
+ * Overlays
+ * ======================================================================== */
+
+const cirf_file_t *cirf_overlay_find_file(const cirf_overlay_t *ov, const char *path) {
     if(!path) return NULL;
+    return cirf_overlay_find_file_n(ov, path, strlen(path));
+}
 
-    for(cirf_mount_t *m = cirf_mounts; m; m = m->next) {
-        size_t prefix_len = strlen(m->prefix);
-        if(strncmp(path, m->prefix, prefix_len) == 0) {
-            return cirf_find_file(m->root, path + prefix_len);
-        }
+const cirf_file_t *cirf_overlay_find_file_n(const cirf_overlay_t *ov, const char *path,
+                                            size_t len) {
+    if(!ov || (!path && len)) return NULL;
+
+    const cirf_index_t *index = ov->index;
+    if(index && index->hash_entry_count && path_canonical(path, len)) {
+        cirf_hash_t h = cirf_hash_bytes(path, len);
+        if(index->filter_block_count && filter_rejects(index, h)) return NULL;
+        const cirf_path_entry_t *e = hash_lookup(index, h, path, len);
+        return e ? e->file : NULL;
+    }
+
+    for(size_t i = ov->layer_count; i-- > 0;) {
+        const cirf_file_t *file = cirf_find_file_n(ov->layers[i], path, len);
+        if(file) return file;
     }
     return NULL;
 }
 
+/* Non-zero if a layer above `layer` also has the file's path */
+static int overlay_shadowed(const cirf_overlay_t *ov, size_t layer, const cirf_file_t *file) {
+    for(size_t i = layer + 1; i < ov->layer_count; i++) {
+        if(cirf_find_file(ov->layers[i], file->path)) return 1;
+    }
+    return 0;
+}
+
+void cirf_overlay_foreach_file(const cirf_overlay_t *ov, cirf_file_callback_t callback,
+                               void *ctx) {
+    if(!ov || !callback) return;
+
+    if(ov->files) {
+        for(size_t i = 0; i < ov->file_count; i++) {
+            callback(ov->files[i], ctx);
+        }
+        return;
+    }
+
+    for(size_t l = ov->layer_count; l-- > 0;) {
+        cirf_iter_t        it;
+        const cirf_file_t *file;
+        cirf_iter_init(&it, ov->layers[l]);
+        while((file = cirf_iter_next(&it)) != NULL) {
+            if(!overlay_shadowed(ov, l, file)) callback(file, ctx);
+        }
+    }
+}
+
+/* ========================================================================
+ * Metadata functions
+ * ======================================================================== */
+
+const char *cirf_get_metadata(const cirf_metadata_t *metadata, size_t count, const char *key) {
+    if(!metadata || !key) return NULL;
+    for(size_t i = 0; i < count; i++) {
+        if(strcmp(metadata[i].key, key) == 0) {
+            return metadata[i].value;
+        }
+    }
+    return NULL;
+}
+
+static unsigned popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (unsigned)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* Binary search of metadata[lo, hi), sorted by key ID */
+static const cirf_metadata_t *meta_search(const cirf_metadata_t *metadata, size_t lo, size_t hi,
+                                          uint32_t key_id) {
+    while(lo < hi) {
+        size_t   mid = lo + (hi - lo) / 2;
+        uint32_t id = metadata[mid].key_id;
+        if(id == key_id) return &metadata[mid];
+        if(id < key_id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Entries are sorted by key ID and keys lists the IDs below 64, so the
+ * entry of such an ID sits after exactly the set bits below its own.
+ * Higher IDs follow those entries and are binary-searched.
+ */
+static const cirf_metadata_t *meta_by_id(const cirf_metadata_t *metadata, size_t count,
+                                         uint64_t keys, uint32_t key_id) {
+    if(key_id < 64) {
+        uint64_t bit = (uint64_t)1 << key_id;
+        if(!(keys & bit)) return NULL;
+        return &metadata[popcount64(keys & (bit - 1))];
+    }
+    return meta_search(metadata, popcount64(keys), count, key_id);
+}
+
+const cirf_metadata_t *cirf_file_meta(const cirf_file_t *file, uint32_t key_id) {
+    if(!file || !file->metadata) return NULL;
+    return meta_by_id(file->metadata, file->metadata_count, file->metadata_keys, key_id);
+}
+
+const cirf_metadata_t *cirf_folder_meta(const cirf_folder_t *folder, uint32_t key_id) {
+    if(!folder || !folder->metadata) return NULL;
+    return meta_by_id(folder->metadata, folder->metadata_count, folder->metadata_keys, key_id);
+}
+
+int64_t cirf_meta_int(const cirf_metadata_t *m, int64_t fallback) {
+    if(!m || m->type == CIRF_META_STRING) return fallback;
+    return m->integer;
+}
+
+double cirf_meta_real(const cirf_metadata_t *m, double fallback) {
+    if(!m || m->type == CIRF_META_STRING) return fallback;
+    return m->real;
+}
+
+int cirf_meta_bool(const cirf_metadata_t *m, int fallback) {
+    if(!m || m->type != CIRF_META_BOOL) return fallback;
+    return m->integer != 0;
+}
+
+/* ========================================================================
+ * Navigation functions
+ * ======================================================================== */
+
+const cirf_folder_t *cirf_get_root(const cirf_file_t *file) {
+    if(!file) return NULL;
+    const cirf_folder_t *folder = file->parent;
+    while(folder && folder->parent) {
+        folder = folder->parent;
+    }
+    return folder;
+}
+
+/* ========================================================================
+ * Iteration functions
+ * ======================================================================== */
+
+void cirf_foreach_file(const cirf_folder_t *folder, cirf_file_callback_t callback, void *ctx) {
+    if(!folder || !callback) return;
+    for(size_t i = 0; i < folder->file_count; i++) {
+        callback(&folder->files[i], ctx);
+    }
+}
+
+void cirf_foreach_file_recursive(const cirf_folder_t *folder, cirf_file_callback_t callback,
+                                 void *ctx) {
+    if(!folder || !callback) return;
+    if(folder->flags & CIRF_FOLDER_SUBTREE) {
+        for(size_t i = 0; i < folder->tree_file_count; i++) {
+            callback(&folder->tree_files[i], ctx);
+        }
+        return;
+    }
+
+    cirf_iter_t        it;
+    const cirf_file_t *file;
+    cirf_iter_init(&it, folder);
+    while((file = cirf_iter_next(&it)) != NULL) {
+        callback(file, ctx);
+    }
+}
+
+size_t cirf_count_files(const cirf_folder_t *folder) {
+    if(!folder) return 0;
+    if(folder->flags & CIRF_FOLDER_SUBTREE) return folder->tree_file_count;
+    size_t               count = folder->file_count;
+    cirf_iter_t          it;
+    const cirf_folder_t *sub;
+    cirf_iter_init(&it, folder);
+    while((sub = cirf_iter_next_folder(&it)) != NULL) {
+        count += sub->file_count;
+    }
+    return count;
+}
+
+size_t cirf_count_folders(const cirf_folder_t *folder) {
+    if(folder && (folder->flags & CIRF_FOLDER_SUBTREE)) return folder->tree_folder_count;
+    size_t      count = 0;
+    cirf_iter_t it;
+    cirf_iter_init(&it, folder);
+    while(cirf_iter_next_folder(&it)) {
+        count++;
+    }
+    return count;
+}
+
+size_t cirf_file_index(const cirf_folder_t *root, const cirf_file_t *file) {
+    if(!root || !file || !(root->flags & CIRF_FOLDER_SUBTREE)) return (size_t)-1;
+    /* Compare addresses as integers: file may belong to another array */
+    uintptr_t first = (uintptr_t)root->tree_files;
+    uintptr_t addr = (uintptr_t)file;
+    if(addr < first || addr >= first + root->tree_file_count * sizeof(cirf_file_t)) {
+        return (size_t)-1;
+    }
+    return (size_t)(addr - first) / sizeof(cirf_file_t);
+}
+
+/* ========================================================================
+ * Explicit iteration
+ * ======================================================================== */
+
+/* Index of child in parent->children */
+static size_t child_position(const cirf_folder_t *parent, const cirf_folder_t *child) {
+    if(parent->flags & CIRF_FOLDER_SORTED) {
+        size_t lo = 0;
+        size_t hi = parent->child_count;
+        while(lo < hi) {
+            size_t               mid = lo + (hi - lo) / 2;
+            const cirf_folder_t *c = parent->children[mid];
+            if(c == child) return mid;
+            int order = name_order(child->name, child->name_len, child->name_fp, c->name,
+                                   c->name_len, c->name_fp);
+            if(order < 0) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+    }
+    size_t i = 0;
+    while(i < parent->child_count && parent->children[i] != child) {
+        i++;
+    }
+    return i;
+}
+
+void cirf_iter_init(cirf_iter_t *it, const cirf_folder_t *folder) {
+    it->top = folder;
+    it->folder = folder;
+    it->file = 0;
+    it->child = 0;
+}
+
+const cirf_folder_t *cirf_iter_next_folder(cirf_iter_t *it) {
+    const cirf_folder_t *f = it->folder;
+    while(f) {
+        if(it->child < f->child_count) {
+            f = f->children[it->child];
+            it->folder = f;
+            it->file = 0;
+            it->child = 0;
+            return f;
+        }
+        if(f == it->top || !f->parent) break;
+        /* Subtree done: continue with the next sibling */
+        it->child = child_position(f->parent, f) + 1;
+        f = f->parent;
+        it->file = f->file_count;
+    }
+    it->folder = NULL;
+    return NULL;
+}
+
+const cirf_file_t *cirf_iter_next(cirf_iter_t *it) {
+    const cirf_folder_t *top = it->top;
+    if(top && (top->flags & CIRF_FOLDER_SUBTREE)) {
+        /* The subtree is one slice of the flat file table */
+        return it->file < top->tree_file_count ? &top->tree_files[it->file++] : NULL;
+    }
+
+    while(it->folder) {
+        if(it->file < it->folder->file_count) {
+            return &it->folder->files[it->file++];
+        }
+        cirf_iter_next_folder(it);
+    }
+    return NULL;
+}
+
+int cirf_opendir(cirf_dir_t *dir, const cirf_folder_t *folder) {
+    if(!dir || !folder) return -1;
+    dir->folder = folder;
+    dir->pos = 0;
+    return 0;
+}
+
+const cirf_dirent_t *cirf_readdir(cirf_dir_t *dir) {
+    const cirf_folder_t *folder = dir->folder;
+    size_t               pos = dir->pos;
+    if(pos < folder->child_count) {
+        dir->ent.folder = folder->children[pos];
+        dir->ent.file = NULL;
+        dir->ent.name = dir->ent.folder->name;
+    } else if(pos - folder->child_count < folder->file_count) {
+        dir->ent.file = &folder->files[pos - folder->child_count];
+        dir->ent.folder = NULL;
+        dir->ent.name = dir->ent.file->name;
+    } else {
+        return NULL;
+    }
+    dir->pos = pos + 1;
+    return &dir->ent;
+}
+
+void cirf_rewinddir(cirf_dir_t *dir) {
+    dir->pos = 0;
+}
+
+/* ========================================================================
+ * Parallel iteration
+ *
+ * The files of a generated subtree are one slice of the flat file table.
+ * The slice is split evenly between the workers, and each worker takes
+ * chunks from the front of its own range. A chunk is a run of at most
+ * CIRF_PARALLEL_CHUNK_FILES files and about CIRF_PARALLEL_CHUNK bytes, or a
+ * single file if that is larger, so a huge file holds up nothing but
+ * itself. A worker whose range is empty steals the back half of another
+ * worker's range; it exits once every range is empty.
+ *
+ * A range is packed into one 64-bit word (begin << 32 | end) and updated
+ * with CAS. Begins only grow and every file index is in at most one range,
+ * so a range never returns to a value a racing CAS could mistake for it.
+ * ======================================================================== */
+
+#ifndef CIRF_NO_THREADS
+
+#if !defined(__GNUC__) && !defined(__clang__)
+#error "cirf_foreach_file_parallel needs GCC/Clang atomics; define CIRF_NO_THREADS"
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define CIRF_CACHE_LINE 64
+
+#ifndef CIRF_PARALLEL_CHUNK
+#define CIRF_PARALLEL_CHUNK 65536 /* Target bytes of file data per chunk */
+#endif
+
+#ifndef CIRF_PARALLEL_CHUNK_FILES
+#define CIRF_PARALLEL_CHUNK_FILES 64 /* Most files per chunk */
+#endif
+
+typedef struct par_job par_job_t;
+
+typedef struct {
+        uint64_t         range; /* begin << 32 | end, indexes into job->files */
+        const par_job_t *job;
+        pthread_t        thread;
+} par_state_t;
+
+/*
+ * One worker per cache line: thieves write to range. The union rounds the
+ * state up to whole lines whatever the size of pthread_t.
+ */
+#define PAR_LINES ((sizeof(par_state_t) + CIRF_CACHE_LINE - 1) / CIRF_CACHE_LINE)
+
+typedef union par_worker {
+        par_state_t s;
+        char        line[PAR_LINES * CIRF_CACHE_LINE];
+} par_worker_t;
+
+struct par_job {
+        const cirf_file_t   *files;
+        cirf_file_callback_t callback;
+        void                *ctx;
+        par_worker_t        *workers;
+        unsigned             count;
+};
+
+static uint64_t par_range(uint32_t begin, uint32_t end) {
+    return ((uint64_t)begin << 32) | end;
+}
+
+/* Take the next chunk from the front of w's range; 0 if it is empty */
+static int par_take(par_worker_t *w, const cirf_file_t *files, uint32_t *first,
+                    uint32_t *last) {
+    uint64_t r = __atomic_load_n(&w->s.range, __ATOMIC_ACQUIRE);
+    for(;;) {
+        uint32_t begin = (uint32_t)(r >> 32);
+        uint32_t end = (uint32_t)r;
+        if(begin >= end) return 0;
+
+        uint32_t stop = begin + 1;
+        size_t   bytes = files[begin].size;
+        while(stop < end && stop - begin < CIRF_PARALLEL_CHUNK_FILES &&
+              bytes + files[stop].size <= CIRF_PARALLEL_CHUNK) {
+            bytes += files[stop++].size;
+        }
+        if(__atomic_compare_exchange_n(&w->s.range, &r, par_range(stop, end), 0, __ATOMIC_ACQ_REL,
+                                       __ATOMIC_ACQUIRE)) {
+            *first = begin;
+            *last = stop;
+            return 1;
+        }
+    }
+}
+
+/* Move the back half of another worker's range into self's; 0 if all are empty */
+static int par_steal(const par_job_t *job, unsigned self) {
+    for(unsigned k = 1; k < job->count; k++) {
+        par_worker_t *victim = &job->workers[(self + k) % job->count];
+        uint64_t      r = __atomic_load_n(&victim->s.range, __ATOMIC_ACQUIRE);
+        for(;;) {
+            uint32_t begin = (uint32_t)(r >> 32);
+            uint32_t end = (uint32_t)r;
+            if(begin >= end) break;
+
+            uint32_t mid = begin + (end - begin) / 2;
+            if(__atomic_compare_exchange_n(&victim->s.range, &r, par_range(begin, mid), 0,
+                                           __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                __atomic_store_n(&job->workers[self].s.range, par_range(mid, end),
+                                 __ATOMIC_RELEASE);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void par_run(const par_job_t *job, unsigned self) {
+    uint32_t first, last;
+    do {
+        while(par_take(&job->workers[self], job->files, &first, &last)) {
+            for(uint32_t i = first; i < last; i++) {
+                job->callback(&job->files[i], job->ctx);
+            }
+        }
+    } while(par_steal(job, self));
+}
+
+static void *par_thread(void *arg) {
+    par_worker_t *w = arg;
+    par_run(w->s.job, (unsigned)(w - w->s.job->workers));
+    return NULL;
+}
+
+int cirf_foreach_file_parallel(const cirf_folder_t *folder, cirf_file_callback_t callback,
+                               void *ctx, unsigned threads) {
+    if(!folder || !callback) return -1;
+
+    if(threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (unsigned)online : 1;
+    }
+
+    size_t count = (folder->flags & CIRF_FOLDER_SUBTREE) ? folder->tree_file_count : 0;
+    if(threads > count) threads = (unsigned)count;
+
+    /* Hand-written trees and single workers run on the calling thread */
+    par_worker_t *workers = NULL;
+    if(threads < 2 || count > UINT32_MAX ||
+       posix_memalign((void **)&workers, CIRF_CACHE_LINE, threads * sizeof(par_worker_t)) != 0) {
+        cirf_foreach_file_recursive(folder, callback, ctx);
+        return 0;
+    }
+
+    par_job_t job = {.files = folder->tree_files,
+                     .callback = callback,
+                     .ctx = ctx,
+                     .workers = workers,
+                     .count = threads};
+    for(unsigned i = 0; i < threads; i++) {
+        workers[i].s.range = par_range((uint32_t)(count * i / threads),
+                                     (uint32_t)(count * (i + 1) / threads));
+        workers[i].s.job = &job;
+    }
+
+    /* A worker that fails to start leaves its range to be stolen */
+    unsigned started = 1;
+    while(started < threads &&
+          pthread_create(&workers[started].s.thread, NULL, par_thread, &workers[started]) == 0) {
+        started++;
+    }
+
+    par_run(&job, 0);
+    for(unsigned i = 1; i < started; i++) {
+        pthread_join(workers[i].s.thread, NULL);
+    }
+    free(workers);
+    return 0;
+}
+
+#endif /* CIRF_NO_THREADS */
+
+/* ========================================================================
+ * Compact layout
+ *
+ * Records hold self-relative offsets instead of pointers. Names are only
+ * reachable through their offsets, so sorted siblings are binary-searched
+ * on the name strings themselves. The name is the first member of both
+ * record types, which lets one search serve folders and files.
+ * ======================================================================== */
+
+static const void *compact_ref(const int32_t *field) {
+    return (const char *)field + *field;
+}
+
+const char *cirf_cfile_name(const cirf_cfile_t *file) {
+    return compact_ref(&file->name);
+}
+
+const char *cirf_cfile_mime(const cirf_cfile_t *file) {
+    return compact_ref(&file->mime);
+}
+
+const unsigned char *cirf_cfile_data(const cirf_cfile_t *file) {
+    return compact_ref(&file->data);
+}
+
+size_t cirf_cfile_size(const cirf_cfile_t *file) {
+    return file->size;
+}
+
+/* Entry of key_id among count entries sorted by key ID, or NULL */
+static const cirf_cmeta_t *cmeta_search(const cirf_cmeta_t *metadata, size_t count,
+                                        uint32_t key_id) {
+    size_t lo = 0;
+    size_t hi = count;
+    while(lo < hi) {
+        size_t   mid = lo + (hi - lo) / 2;
+        uint32_t id = metadata[mid].key_id;
+        if(id == key_id) return &metadata[mid];
+        if(id < key_id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+const cirf_cmeta_t *cirf_cfile_meta(const cirf_cfile_t *file, uint32_t key_id) {
+    if(!file || !file->metadata_count) return NULL;
+    return cmeta_search(compact_ref(&file->metadata), file->metadata_count, key_id);
+}
+
+const char *cirf_cfolder_name(const cirf_cfolder_t *folder) {
+    return compact_ref(&folder->name);
+}
+
+const cirf_cfile_t *cirf_cfolder_files(const cirf_cfolder_t *folder) {
+    return compact_ref(&folder->files);
+}
+
+const cirf_cfolder_t *cirf_cfolder_children(const cirf_cfolder_t *folder) {
+    return compact_ref(&folder->children);
+}
+
+const cirf_cmeta_t *cirf_cfolder_meta(const cirf_cfolder_t *folder, uint32_t key_id) {
+    if(!folder || !folder->metadata_count) return NULL;
+    return cmeta_search(compact_ref(&folder->metadata), folder->metadata_count, key_id);
+}
+
+const char *cirf_cmeta_key(const cirf_cmeta_t *m) {
+    return compact_ref(&m->key);
+}
+
+const char *cirf_cmeta_value(const cirf_cmeta_t *m) {
+    return compact_ref(&m->value);
+}
+
+int64_t cirf_cmeta_int(const cirf_cmeta_t *m, int64_t fallback) {
+    if(!m || m->type == CIRF_META_STRING) return fallback;
+    return m->integer;
+}
+
+double cirf_cmeta_real(const cirf_cmeta_t *m, double fallback) {
+    if(!m || m->type == CIRF_META_STRING) return fallback;
+    return m->real;
+}
+
+int cirf_cmeta_bool(const cirf_cmeta_t *m, int fallback) {
+    if(!m || m->type != CIRF_META_BOOL) return fallback;
+    return m->integer != 0;
+}
+
+/* Find name[0, len) among count records of the given size, sorted by name */
+static const void *compact_search(const void *records, size_t count, size_t size,
+                                  const char *name, size_t len) {
+    size_t lo = 0;
+    size_t hi = count;
+    while(lo < hi) {
+        size_t      mid = lo + (hi - lo) / 2;
+        const char *record = (const char *)records + mid * size;
+        const char *rname = compact_ref((const int32_t *)record);
+        int         order = strncmp(name, rname, len);
+        if(order == 0) order = -(rname[len] != '\0');
+        if(order == 0) return record;
+        if(order < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+/* Walk the folders named by path[0, len) below folder, ignoring extra slashes */
+static const cirf_cfolder_t *compact_walk(const cirf_cfolder_t *folder, const char *path,
+                                          size_t len) {
+    size_t pos = 0;
+    while(folder && pos < len) {
+        if(path[pos] == '/') {
+            pos++;
+            continue;
+        }
+        size_t end = pos;
+        while(end < len && path[end] != '/')
+            end++;
+        folder = compact_search(cirf_cfolder_children(folder), folder->child_count,
+                                sizeof(cirf_cfolder_t), path + pos, end - pos);
+        pos = end;
+    }
+    return folder;
+}
+
+const cirf_cfile_t *cirf_compact_find_file(const cirf_cfolder_t *root, const char *path) {
+    if(!root || !path) return NULL;
+
+    size_t len = strlen(path);
+    size_t name = len;
+    while(name > 0 && path[name - 1] != '/')
+        name--;
+    const cirf_cfolder_t *folder = compact_walk(root, path, name);
+    if(!folder || name == len) return NULL;
+    return compact_search(cirf_cfolder_files(folder), folder->file_count, sizeof(cirf_cfile_t),
+                          path + name, len - name);
+}
+
+const cirf_cfolder_t *cirf_compact_find_folder(const cirf_cfolder_t *root, const char *path) {
+    if(!root || !path) return NULL;
+    return compact_walk(root, path, strlen(path));
+}
+
+void cirf_compact_foreach_file(const cirf_cfolder_t *folder, cirf_cfile_callback_t callback,
+                               void *ctx) {
+    if(!folder || !callback) return;
+    const cirf_cfile_t *files = cirf_cfolder_files(folder);
+    for(uint32_t i = 0; i < folder->file_count; i++) {
+        callback(&files[i], ctx);
+    }
+}
+
+void cirf_compact_foreach_file_recursive(const cirf_cfolder_t *folder,
+                                         cirf_cfile_callback_t callback, void *ctx) {
+    if(!folder || !callback) return;
+    const cirf_cfile_t *files = cirf_cfolder_files(folder);
+    for(uint32_t i = 0; i < folder->tree_file_count; i++) {
+        callback(&files[i], ctx);
+    }
+}
+
+/* ========================================================================
+ * Streams
+ * ======================================================================== */
+
+int cirf_stream_open(cirf_stream_t *stream, const cirf_file_t *file) {
+    if(!stream || !file) return -1;
+    cirf_stream_init(stream, file->data, file->size);
+    return 0;
+}
+
+void cirf_stream_init(cirf_stream_t *stream, const void *data, size_t size) {
+    stream->data = (const unsigned char *)data;
+    stream->size = size;
+    stream->pos = 0;
+}
+
+size_t cirf_stream_read(cirf_stream_t *stream, void *buf, size_t size) {
+    size_t avail = stream->size - stream->pos;
+    if(size > avail) size = avail;
+    if(size) memcpy(buf, stream->data + stream->pos, size);
+    stream->pos += size;
+    return size;
+}
+
+int cirf_stream_seek(cirf_stream_t *stream, int64_t offset, int origin) {
+    int64_t base;
+    switch(origin) {
+    case CIRF_SEEK_SET:
+        base = 0;
+        break;
+    case CIRF_SEEK_CUR:
+        base = (int64_t)stream->pos;
+        break;
+    case CIRF_SEEK_END:
+        base = (int64_t)stream->size;
+        break;
+    default:
+        return -1;
+    }
+    if(offset < -base || offset > (int64_t)stream->size - base) return -1;
+    stream->pos = (size_t)(base + offset);
+    return 0;
+}
+
+size_t cirf_stream_tell(const cirf_stream_t *stream) {
+    return stream->pos;
+}
+
+int cirf_stream_eof(const cirf_stream_t *stream) {
+    return stream->pos == stream->size;
+}
+
+const unsigned char *cirf_stream_peek(const cirf_stream_t *stream, size_t *len) {
+    *len = stream->size - stream->pos;
+    return stream->data + stream->pos;
+}
+
+const char *cirf_stream_readline(cirf_stream_t *stream, size_t *len) {
+    size_t avail = stream->size - stream->pos;
+    if(!avail) return NULL;
+
+    const char *line = (const char *)stream->data + stream->pos;
+    const char *nl = memchr(line, '\n', avail);
+    size_t      n = nl ? (size_t)(nl - line) + 1 : avail;
+    stream->pos += n;
+    *len = n;
+    return line;
+}
+
+/* ========================================================================
+ * Standard I/O compatibility (POSIX)
+ * ======================================================================== */
+
+#ifndef CIRF_NO_STDIO
+
+/* Check for fmemopen availability */
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || \
+    defined(__OpenBSD__) || defined(__DragonFly__) ||                                          \
+    (defined(_POSIX_VERSION) && _POSIX_VERSION >= 200809L)
+#define CIRF_HAVE_FMEMOPEN 1
+#endif
+
+#ifdef CIRF_HAVE_FMEMOPEN
+
+FILE *cirf_fopen(const cirf_file_t *file) {
+    if(!file) return NULL;
+    /* Cast away const - fmemopen with "r" mode won't modify the buffer */
+    return fmemopen((void *)file->data, file->size, "r");
+}
+
+FILE *cirf_fopen_path(const cirf_folder_t *root, const char *path) {
+    const cirf_file_t *file = cirf_find_file(root, path);
+    if(!file) return NULL;
+    return cirf_fopen(file);
+}
+
+#else /* No fmemopen */
+
+FILE *cirf_fopen(const cirf_file_t *file) {
+    (void)file;
+    return NULL; /* fmemopen not available */
+}
+
+FILE *cirf_fopen_path(const cirf_folder_t *root, const char *path) {
+    (void)root;
+    (void)path;
+    return NULL; /* fmemopen not available */
+}
+
+#endif /* CIRF_HAVE_FMEMOPEN */
+
+/* FILE* adapter: fopencookie() on glibc, funopen() on the BSDs and macOS */
+#if defined(__GLIBC__)
+#define CIRF_HAVE_FOPENCOOKIE 1
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || \
+    defined(__OpenBSD__) || defined(__DragonFly__)
+#define CIRF_HAVE_FUNOPEN 1
+#endif
+
+#if defined(CIRF_HAVE_FOPENCOOKIE) || defined(CIRF_HAVE_FUNOPEN)
+
+/* Seek on behalf of stdio: SEEK_* origin, new position or -1 */
+static int64_t stream_cookie_seek(cirf_stream_t *stream, int64_t offset, int whence) {
+    int origin = whence == SEEK_SET   ? CIRF_SEEK_SET
+                 : whence == SEEK_CUR ? CIRF_SEEK_CUR
+                 : whence == SEEK_END ? CIRF_SEEK_END
+                                      : -1;
+    if(cirf_stream_seek(stream, offset, origin) != 0) return -1;
+    return (int64_t)stream->pos;
+}
+
+#endif
+
+#if defined(CIRF_HAVE_FOPENCOOKIE)
+
+static ssize_t cookie_read(void *cookie, char *buf, size_t size) {
+    return (ssize_t)cirf_stream_read((cirf_stream_t *)cookie, buf, size);
+}
+
+static int cookie_seek(void *cookie, off64_t *offset, int whence) {
+    int64_t pos = stream_cookie_seek((cirf_stream_t *)cookie, (int64_t)*offset, whence);
+    if(pos < 0) return -1;
+    *offset = (off64_t)pos;
+    return 0;
+}
+
+FILE *cirf_stream_fopen(cirf_stream_t *stream) {
+    cookie_io_functions_t io = {cookie_read, NULL, cookie_seek, NULL};
+    return stream ? fopencookie(stream, "r", io) : NULL;
+}
+
+#elif defined(CIRF_HAVE_FUNOPEN)
+
+static int funopen_read(void *cookie, char *buf, int size) {
+    return (int)cirf_stream_read((cirf_stream_t *)cookie, buf, size > 0 ? (size_t)size : 0);
+}
+
+static fpos_t funopen_seek(void *cookie, fpos_t offset, int whence) {
+    return (fpos_t)stream_cookie_seek((cirf_stream_t *)cookie, (int64_t)offset, whence);
+}
+
+FILE *cirf_stream_fopen(cirf_stream_t *stream) {
+    return stream ? funopen(stream, funopen_read, NULL, funopen_seek, NULL) : NULL;
+}
+
+#else /* No cookie streams */
+
+FILE *cirf_stream_fopen(cirf_stream_t *stream) {
+    (void)stream;
+    return NULL; /* fopencookie/funopen not available */
+}
+
+#endif
+
+#endif /* CIRF_NO_STDIO */
+
+/* ========================================================================
+ * File descriptors (Linux)
+ *
+ * Sealed memfds are kept in an open-addressing table keyed by file, created
+ * under a lock so that each file is copied once. cirf_open_fd() reopens the
+ * memfd through /proc/self/fd, which gives every caller its own offset.
+ * ======================================================================== */
+
+#ifndef CIRF_NO_FD
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* Older headers lack the memfd and sealing constants */
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC       0x0001u
+#define MFD_ALLOW_SEALING 0x0002u
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS   1033
+#define F_SEAL_SEAL   0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW   0x0004
+#define F_SEAL_WRITE  0x0008
+#endif
+
+typedef struct fd_slot {
+        const cirf_file_t *file; /* NULL if the slot is free */
+        int                fd;
+} fd_slot_t;
+
+static fd_slot_t *fd_slots;    /* Never shrinks; the memfds live until exit */
+static size_t     fd_capacity; /* Power of two, or 0 */
+static size_t     fd_count;
+
+#ifndef CIRF_NO_THREADS
+#include <pthread.h>
+static pthread_mutex_t fd_lock = PTHREAD_MUTEX_INITIALIZER;
+#define FD_LOCK()   pthread_mutex_lock(&fd_lock)
+#define FD_UNLOCK() pthread_mutex_unlock(&fd_lock)
+#else
+#define FD_LOCK()   ((void)0)
+#define FD_UNLOCK() ((void)0)
+#endif
+
+static size_t fd_home(const cirf_file_t *file, size_t capacity) {
+    uint64_t h = (uint64_t)(uintptr_t)file * 0x9e3779b97f4a7c15ull;
+    return (size_t)(h >> 32) & (capacity - 1);
+}
+
+static fd_slot_t *fd_find(const cirf_file_t *file) {
+    if(!fd_capacity) return NULL;
+    for(size_t i = fd_home(file, fd_capacity);; i = (i + 1) & (fd_capacity - 1)) {
+        if(fd_slots[i].file == file) return &fd_slots[i];
+        if(!fd_slots[i].file) return NULL;
+    }
+}
+
+/* Make room for one more entry, keeping the load at most one half */
+static int fd_reserve(void) {
+    if((fd_count + 1) * 2 <= fd_capacity) return 0;
+
+    size_t     capacity = fd_capacity ? fd_capacity * 2 : 64;
+    fd_slot_t *slots = calloc(capacity, sizeof(fd_slot_t));
+    if(!slots) return -1;
+    for(size_t i = 0; i < fd_capacity; i++) {
+        if(!fd_slots[i].file) continue;
+        size_t j = fd_home(fd_slots[i].file, capacity);
+        while(slots[j].file)
+            j = (j + 1) & (capacity - 1);
+        slots[j] = fd_slots[i];
+    }
+    free(fd_slots);
+    fd_slots = slots;
+    fd_capacity = capacity;
+    return 0;
+}
+
+/* Copy a file into a new memfd and seal it; -1 on failure */
+static int fd_materialize(const cirf_file_t *file) {
+    /* Shows up in /proc/<pid>/fd as "/memfd:cirf:<name> (deleted)" */
+    char   name[64] = "cirf:";
+    size_t len = strlen(file->name);
+    if(len > sizeof(name) - 6) len = sizeof(name) - 6;
+    memcpy(name + 5, file->name, len);
+    name[5 + len] = '\0';
+
+    int fd = (int)syscall(SYS_memfd_create, name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if(fd < 0) return -1;
+
+    size_t done = 0;
+    while(done < file->size) {
+        ssize_t n = write(fd, file->data + done, file->size - done);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) break;
+        done += (size_t)n;
+    }
+    if(done < file->size ||
+       fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+/* The cached memfd of file, created on first use; -1 on failure */
+static int fd_cached(const cirf_file_t *file) {
+    FD_LOCK();
+    fd_slot_t *slot = fd_find(file);
+    int        fd = slot ? slot->fd : -1;
+    if(!slot) {
+        if(fd_reserve() != 0) {
+            errno = ENOMEM;
+        } else if((fd = fd_materialize(file)) >= 0) {
+            size_t i = fd_home(file, fd_capacity);
+            while(fd_slots[i].file)
+                i = (i + 1) & (fd_capacity - 1);
+            fd_slots[i].file = file;
+            fd_slots[i].fd = fd;
+            fd_count++;
+        }
+    }
+    FD_UNLOCK();
+    return fd;
+}
+
+/* Write "/proc/self/fd/<fd>" to buf; -1 if it does not fit */
+static int fd_format_path(int fd, char *buf, size_t size) {
+    static const char prefix[] = "/proc/self/fd/";
+    char              digits[12];
+    size_t            n = 0;
+    do {
+        digits[n++] = (char)('0' + fd % 10);
+        fd /= 10;
+    } while(fd);
+
+    if(size < sizeof(prefix) + n) return -1;
+    memcpy(buf, prefix, sizeof(prefix) - 1);
+    for(size_t i = 0; i < n; i++) {
+        buf[sizeof(prefix) - 1 + i] = digits[n - 1 - i];
+    }
+    buf[sizeof(prefix) - 1 + n] = '\0';
+    return 0;
+}
+
+int cirf_open_fd(const cirf_file_t *file) {
+    if(!file) {
+        errno = EINVAL;
+        return -1;
+    }
+    int fd = fd_cached(file);
+    if(fd < 0) return -1;
+
+    char path[CIRF_FD_PATH_MAX];
+    fd_format_path(fd, path, sizeof(path));
+    int own = open(path, O_RDONLY | O_CLOEXEC);
+    if(own >= 0) return own;
+
+    /* Without /proc, a duplicate; it shares its offset, so prefer pread() */
+    return fcntl(fd, F_DUPFD_CLOEXEC, 0);
+}
+
+int cirf_fd_path(const cirf_file_t *file, char *buf, size_t size) {
+    if(!file || !buf) return -1;
+    int fd = fd_cached(file);
+    return fd < 0 ? -1 : fd_format_path(fd, buf, size);
+}
+
+#else /* Not Linux */
+
+int cirf_open_fd(const cirf_file_t *file) {
+    (void)file;
+    return -1; /* memfd not available */
+}
+
+int cirf_fd_path(const cirf_file_t *file, char *buf, size_t size) {
+    (void)file;
+    (void)buf;
+    (void)size;
+    return -1; /* memfd not available */
+}
+
+#endif /* __linux__ */
+
+#endif /* CIRF_NO_FD */
+
+/* ========================================================================
+ * Resource packs
+ *
+ * The pack is mapped whole and read-only. One allocation holds the
+ * cirf_pack_t, the folder, file and metadata structures, the children and
+ * MIME pointer arrays and the decoded index; every string and all file
+ * data stay in the mapping. Records are read byte by byte as little-endian,
+ * so any host can load a pack, and every count, offset and reference is
+ * checked against the file before it is followed.
+ * ======================================================================== */
+
+#ifndef CIRF_NO_PACK
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include "cirf/pack.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+struct cirf_pack {
+        const unsigned char *map;     /* The whole file */
+        size_t               map_size;
+        cirf_index_t         index;   /* Root's index, if the pack has one */
+        cirf_folder_t       *folders; /* Depth-first, root first */
+};
+
+/* The pack's tables, located and bounds-checked */
+typedef struct {
+        const unsigned char *base;
+        uint64_t             size;
+        uint32_t             folder_count;
+        uint32_t             file_count;
+        uint32_t             metadata_count;
+        uint32_t             mime_count;
+        uint32_t             hash_bucket_count;
+        uint32_t             hash_entry_count;
+        uint32_t             filter_block_count;
+        const unsigned char *folders;
+        const unsigned char *files;
+        const unsigned char *metadata;
+        const unsigned char *mimes;
+        const unsigned char *seeds;
+        const unsigned char *entries;
+        const unsigned char *filter;
+        const char          *strings;
+        uint64_t             strings_size;
+        int                  bad; /* A reference was out of range */
+} pack_view_t;
+
+static uint32_t pack_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t pack_u64(const unsigned char *p) {
+    return (uint64_t)pack_u32(p) | (uint64_t)pack_u32(p + 4) << 32;
+}
+
+#define PACK_U32(rec, type, field) pack_u32((rec) + offsetof(type, field))
+#define PACK_U64(rec, type, field) pack_u64((rec) + offsetof(type, field))
+
+/* count records of record_size bytes at offset, or NULL if past the end */
+static const unsigned char *pack_table(const pack_view_t *v, uint64_t offset, uint64_t count,
+                                       size_t record_size) {
+    if(offset > v->size || count > (v->size - offset) / record_size) return NULL;
+    return v->base + offset;
+}
+
+/* String at a pool offset; the pool ends with a NUL, so any offset in it
+ * gives a terminated string */
+static const char *pack_string_at(pack_view_t *v, uint32_t offset) {
+    if(offset >= v->strings_size) {
+        v->bad = 1;
+        return v->strings;
+    }
+    return v->strings + offset;
+}
+
+static int pack_view(pack_view_t *v, const unsigned char *base, size_t size) {
+    const unsigned char *h = base;
+    memset(v, 0, sizeof(*v));
+    v->base = base;
+    v->size = size;
+    if(size < sizeof(cirf_pack_header_t) || memcmp(h, CIRF_PACK_MAGIC, 8) != 0 ||
+       PACK_U32(h, cirf_pack_header_t, version) != CIRF_PACK_VERSION ||
+       PACK_U32(h, cirf_pack_header_t, header_size) != sizeof(cirf_pack_header_t) ||
+       PACK_U64(h, cirf_pack_header_t, pack_size) != size) {
+        return -1;
+    }
+
+    v->folder_count = PACK_U32(h, cirf_pack_header_t, folder_count);
+    v->file_count = PACK_U32(h, cirf_pack_header_t, file_count);
+    v->metadata_count = PACK_U32(h, cirf_pack_header_t, metadata_count);
+    v->mime_count = PACK_U32(h, cirf_pack_header_t, mime_count);
+    v->hash_bucket_count = PACK_U32(h, cirf_pack_header_t, hash_bucket_count);
+    v->hash_entry_count = PACK_U32(h, cirf_pack_header_t, hash_entry_count);
+    v->filter_block_count = PACK_U32(h, cirf_pack_header_t, filter_block_count);
+    v->strings_size = PACK_U64(h, cirf_pack_header_t, strings_size);
+
+    v->folders = pack_table(v, PACK_U64(h, cirf_pack_header_t, folders), v->folder_count,
+                            sizeof(cirf_pack_folder_t));
+    v->files = pack_table(v, PACK_U64(h, cirf_pack_header_t, files), v->file_count,
+                          sizeof(cirf_pack_file_t));
+    v->metadata = pack_table(v, PACK_U64(h, cirf_pack_header_t, metadata), v->metadata_count,
+                             sizeof(cirf_pack_meta_t));
+    v->mimes = pack_table(v, PACK_U64(h, cirf_pack_header_t, mimes), v->mime_count, 4);
+    v->seeds = pack_table(v, PACK_U64(h, cirf_pack_header_t, hash_seeds), v->hash_bucket_count,
+                          4);
+    v->entries =
+        pack_table(v, PACK_U64(h, cirf_pack_header_t, hash_entries), v->hash_entry_count, 4);
+    v->filter = pack_table(v, PACK_U64(h, cirf_pack_header_t, filter), v->filter_block_count,
+                           CIRF_BLOOM_WORDS * 8);
+    v->strings = (const char *)pack_table(v, PACK_U64(h, cirf_pack_header_t, strings),
+                                          v->strings_size, 1);
+
+    if(!v->folders || !v->files || !v->metadata || !v->mimes || !v->seeds || !v->entries ||
+       !v->filter || !v->strings || v->folder_count == 0 || v->strings_size == 0 ||
+       v->strings[v->strings_size - 1] != '\0' ||
+       (v->hash_bucket_count == 0) != (v->hash_entry_count == 0)) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Room for count elements in the pack's allocation, 8-byte aligned */
+static size_t pack_reserve(size_t *total, uint64_t count, size_t size, int *overflow) {
+    size_t offset = (*total + 7) & ~(size_t)7;
+    if(offset < *total || count > (SIZE_MAX - offset) / size) {
+        *overflow = 1;
+        return 0;
+    }
+    *total = offset + (size_t)count * size;
+    return offset;
+}
+
+/* Metadata entries [first, first + count) of the pack, or NULL if there are none */
+static const cirf_metadata_t *pack_meta_ref(pack_view_t *v, const cirf_metadata_t *metadata,
+                                            uint32_t first, uint32_t count, uint64_t *keys) {
+    *keys = 0;
+    if(first > v->metadata_count || count > v->metadata_count - first) {
+        v->bad = 1;
+        return NULL;
+    }
+    for(uint32_t i = 0; i < count; i++) {
+        if(metadata[first + i].key_id < 64) *keys |= (uint64_t)1 << metadata[first + i].key_id;
+    }
+    return count ? &metadata[first] : NULL;
+}
+
+static void pack_name_key(const char *name, uint32_t *len, uint64_t *fp) {
+    size_t n = strlen(name);
+    *len = (uint32_t)n;
+    *fp = cirf_name_fp(name, n);
+}
+
+static void pack_build_files(pack_view_t *v, cirf_file_t *files, cirf_folder_t *folders,
+                             const cirf_metadata_t *metadata, const char **mimes) {
+    for(uint32_t i = 0; i < v->file_count; i++) {
+        const unsigned char *r = v->files + (size_t)i * sizeof(cirf_pack_file_t);
+        cirf_file_t         *f = &files[i];
+        uint64_t             data = PACK_U64(r, cirf_pack_file_t, data);
+        uint64_t             size = PACK_U64(r, cirf_pack_file_t, size);
+        uint32_t             parent = PACK_U32(r, cirf_pack_file_t, parent);
+        uint32_t             mime = PACK_U32(r, cirf_pack_file_t, mime_id);
+
+        if(data > v->size || size > v->size - data || parent >= v->folder_count ||
+           mime > v->mime_count) {
+            v->bad = 1;
+            return;
+        }
+        f->name = pack_string_at(v, PACK_U32(r, cirf_pack_file_t, name));
+        f->path = pack_string_at(v, PACK_U32(r, cirf_pack_file_t, path));
+        f->mime = mime ? mimes[mime - 1] : NULL;
+        f->data = v->base + data;
+        f->size = (size_t)size;
+        f->parent = &folders[parent];
+        f->metadata = pack_meta_ref(v, metadata, PACK_U32(r, cirf_pack_file_t, metadata),
+                                    PACK_U32(r, cirf_pack_file_t, metadata_count),
+                                    &f->metadata_keys);
+        f->metadata_count = f->metadata ? PACK_U32(r, cirf_pack_file_t, metadata_count) : 0;
+        f->mime_id = mime;
+        pack_name_key(f->name, &f->name_len, &f->name_fp);
+    }
+}
+
+/*
+ * Folders and their children arrays. A folder's children are found by
+ * skipping over each child's subtree; they must tile the folder's subtree
+ * exactly and name it as their parent, so the tree is well formed.
+ */
+static void pack_build_folders(pack_view_t *v, cirf_pack_t *pack, cirf_file_t *files,
+                               const cirf_metadata_t *metadata, const cirf_folder_t **children) {
+    size_t next_child = 0;
+    for(uint32_t i = 0; i < v->folder_count && !v->bad; i++) {
+        const unsigned char *r = v->folders + (size_t)i * sizeof(cirf_pack_folder_t);
+        cirf_folder_t       *d = &pack->folders[i];
+        uint32_t             parent = PACK_U32(r, cirf_pack_folder_t, parent);
+        uint32_t             child_count = PACK_U32(r, cirf_pack_folder_t, child_count);
+        uint32_t             tree_folders = PACK_U32(r, cirf_pack_folder_t, tree_folder_count);
+        uint32_t             first = PACK_U32(r, cirf_pack_folder_t, files);
+        uint32_t             file_count = PACK_U32(r, cirf_pack_folder_t, file_count);
+        uint32_t             tree_files = PACK_U32(r, cirf_pack_folder_t, tree_file_count);
+
+        if((i == 0 ? parent != CIRF_PACK_NONE || tree_folders != v->folder_count - 1
+                   : parent >= i) ||
+           tree_folders > v->folder_count - i - 1 || child_count > v->folder_count - next_child ||
+           first > v->file_count || tree_files > v->file_count - first ||
+           file_count > tree_files) {
+            v->bad = 1;
+            return;
+        }
+
+        const cirf_folder_t **kids = children + next_child;
+        uint32_t              c = i + 1;
+        for(uint32_t k = 0; k < child_count; k++) {
+            const unsigned char *cr = v->folders + (size_t)c * sizeof(cirf_pack_folder_t);
+            uint32_t             below = PACK_U32(cr, cirf_pack_folder_t, tree_folder_count);
+            if(c > i + tree_folders || PACK_U32(cr, cirf_pack_folder_t, parent) != i ||
+               below > i + tree_folders - c) {
+                v->bad = 1;
+                return;
+            }
+            kids[k] = &pack->folders[c];
+            c += below + 1;
+        }
+        if(c != i + tree_folders + 1) {
+            v->bad = 1;
+            return;
+        }
+        next_child += child_count;
+
+        d->name = pack_string_at(v, PACK_U32(r, cirf_pack_folder_t, name));
+        d->path = pack_string_at(v, PACK_U32(r, cirf_pack_folder_t, path));
+        d->parent = i == 0 ? NULL : &pack->folders[parent];
+        d->children = child_count ? kids : NULL;
+        d->child_count = child_count;
+        d->files = file_count ? &files[first] : NULL;
+        d->file_count = file_count;
+        d->metadata = pack_meta_ref(v, metadata, PACK_U32(r, cirf_pack_folder_t, metadata),
+                                    PACK_U32(r, cirf_pack_folder_t, metadata_count),
+                                    &d->metadata_keys);
+        d->metadata_count = d->metadata ? PACK_U32(r, cirf_pack_folder_t, metadata_count) : 0;
+        d->tree_files = tree_files ? &files[first] : NULL;
+        d->tree_file_count = tree_files;
+        d->tree_folder_count = tree_folders;
+        d->flags = CIRF_FOLDER_SORTED | CIRF_FOLDER_SUBTREE;
+        pack_name_key(d->name, &d->name_len, &d->name_fp);
+    }
+}
+
+static void pack_build_index(pack_view_t *v, cirf_pack_t *pack, cirf_file_t *files,
+                             int32_t *seeds, cirf_path_entry_t *entries, uint64_t *filter) {
+    cirf_index_t *index = &pack->index;
+    for(uint32_t b = 0; b < v->hash_bucket_count; b++) {
+        seeds[b] = (int32_t)pack_u32(v->seeds + (size_t)b * 4);
+        if(seeds[b] < 0 && (uint32_t)-(seeds[b] + 1) >= v->hash_entry_count) v->bad = 1;
+    }
+    for(uint32_t e = 0; e < v->hash_entry_count; e++) {
+        uint32_t ref = pack_u32(v->entries + (size_t)e * 4);
+        uint32_t n = ref & ~CIRF_PACK_FOLDER;
+        if(ref & CIRF_PACK_FOLDER) {
+            entries[e].file = NULL;
+            entries[e].folder = n > 0 && n < v->folder_count ? &pack->folders[n] : NULL;
+            if(!entries[e].folder) v->bad = 1;
+        } else {
+            entries[e].file = n < v->file_count ? &files[n] : NULL;
+            entries[e].folder = NULL;
+            if(!entries[e].file) v->bad = 1;
+        }
+    }
+    for(size_t w = 0; w < (size_t)v->filter_block_count * CIRF_BLOOM_WORDS; w++) {
+        filter[w] = pack_u64(v->filter + w * 8);
+    }
+
+    index->hash_seeds = seeds;
+    index->hash_bucket_count = v->hash_bucket_count;
+    index->hash_entries = entries;
+    index->hash_entry_count = v->hash_entry_count;
+    index->filter = filter;
+    index->filter_block_count = v->filter_block_count;
+    if(v->hash_entry_count || v->filter_block_count) pack->folders[0].index = index;
+}
+
+static cirf_pack_t *pack_load(const unsigned char *map, size_t size) {
+    pack_view_t v;
+    if(pack_view(&v, map, size) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    /* Every array starts 8-byte aligned, which suits each element type */
+    size_t total = sizeof(cirf_pack_t);
+    int    overflow = 0;
+    size_t folders_at = pack_reserve(&total, v.folder_count, sizeof(cirf_folder_t), &overflow);
+    size_t files_at = pack_reserve(&total, v.file_count, sizeof(cirf_file_t), &overflow);
+    size_t meta_at = pack_reserve(&total, v.metadata_count, sizeof(cirf_metadata_t), &overflow);
+    size_t filter_at = pack_reserve(&total, (uint64_t)v.filter_block_count * CIRF_BLOOM_WORDS,
+                                    sizeof(uint64_t), &overflow);
+    size_t entries_at =
+        pack_reserve(&total, v.hash_entry_count, sizeof(cirf_path_entry_t), &overflow);
+    size_t children_at =
+        pack_reserve(&total, v.folder_count, sizeof(const cirf_folder_t *), &overflow);
+    size_t mimes_at = pack_reserve(&total, v.mime_count, sizeof(const char *), &overflow);
+    size_t seeds_at = pack_reserve(&total, v.hash_bucket_count, sizeof(int32_t), &overflow);
+    if(overflow) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    unsigned char *block = calloc(1, total);
+    if(!block) return NULL;
+    cirf_pack_t           *pack = (cirf_pack_t *)block;
+    cirf_file_t           *files = (cirf_file_t *)(block + files_at);
+    cirf_metadata_t       *metadata = (cirf_metadata_t *)(block + meta_at);
+    const char           **mimes = (const char **)(block + mimes_at);
+    const cirf_folder_t  **children = (const cirf_folder_t **)(block + children_at);
+    pack->map = map;
+    pack->map_size = size;
+    pack->folders = (cirf_folder_t *)(block + folders_at);
+
+    for(uint32_t i = 0; i < v.mime_count; i++) {
+        mimes[i] = pack_string_at(&v, pack_u32(v.mimes + (size_t)i * 4));
+    }
+    for(uint32_t i = 0; i < v.metadata_count; i++) {
+        const unsigned char *r = v.metadata + (size_t)i * sizeof(cirf_pack_meta_t);
+        cirf_metadata_t     *m = &metadata[i];
+        uint64_t             real = PACK_U64(r, cirf_pack_meta_t, real);
+        m->key = pack_string_at(&v, PACK_U32(r, cirf_pack_meta_t, key));
+        m->value = pack_string_at(&v, PACK_U32(r, cirf_pack_meta_t, value));
+        m->key_id = PACK_U32(r, cirf_pack_meta_t, key_id);
+        m->type = PACK_U32(r, cirf_pack_meta_t, type);
+        m->integer = (int64_t)PACK_U64(r, cirf_pack_meta_t, integer);
+        memcpy(&m->real, &real, sizeof(real));
+    }
+    pack_build_files(&v, files, pack->folders, metadata, mimes);
+    if(!v.bad) pack_build_folders(&v, pack, files, metadata, children);
+    if(!v.bad) {
+        pack_build_index(&v, pack, files, (int32_t *)(block + seeds_at),
+                         (cirf_path_entry_t *)(block + entries_at),
+                         (uint64_t *)(block + filter_at));
+    }
+
+    if(v.bad) {
+        free(block);
+        errno = EINVAL;
+        return NULL;
+    }
+    return pack;
+}
+
+cirf_pack_t *cirf_pack_open(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return NULL;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return NULL;
+    }
+    if(st.st_size < (off_t)sizeof(cirf_pack_header_t) || (uint64_t)st.st_size > SIZE_MAX) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    /* Shared and read-only: every process mapping the pack uses the same
+     * page cache pages, and only the pages actually read are ever loaded */
+    size_t size = (size_t)st.st_size;
+    void  *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    int    saved = errno;
+    close(fd);
+    if(map == MAP_FAILED) {
+        errno = saved;
+        return NULL;
+    }
+
+    cirf_pack_t *pack = pack_load(map, size);
+    if(!pack) {
+        saved = errno;
+        munmap(map, size);
+        errno = saved;
+    }
+    return pack;
+}
+
+const cirf_folder_t *cirf_pack_root(const cirf_pack_t *pack) {
+    return &pack->folders[0];
+}
+
+void cirf_pack_close(cirf_pack_t *pack) {
+    if(!pack) return;
+    munmap((void *)pack->map, pack->map_size);
+    free(pack);
+}
+
+#else /* No mmap */
+
+#include <errno.h>
+
+cirf_pack_t *cirf_pack_open(const char *path) {
+    (void)path;
+    errno = ENOSYS;
+    return NULL;
+}
+
+const cirf_folder_t *cirf_pack_root(const cirf_pack_t *pack) {
+    (void)pack;
+    return NULL;
+}
+
+void cirf_pack_close(cirf_pack_t *pack) {
+    (void)pack;
+}
+
+#endif /* __unix__ || __APPLE__ */
+
+#endif /* CIRF_NO_PACK */
+
+/* ========================================================================
+ * Virtual filesystem mount (optional)
+ *
+ * Define CIRF_NO_MOUNT to disable this feature entirely.
+ *
+ * A mount table is an array of cirf_mount_t sorted by prefix length,
+ * longest first, so the first matching prefix is the longest one. Tables
+ * with caller-provided storage (cirf_mount_table_t) never allocate and
+ * leave synchronization to the caller.
+ *
+ * The global table behind cirf_mount()/cirf_resolve_file() comes in two
+ * flavors:
+ *
+ *   default           Heap-allocated immutable snapshots. Writers publish
+ *                     a new snapshot with an atomic store; readers never
+ *                     lock. Each thread owns a reader record in which it
+ *                     announces the epoch it entered in, and a writer frees
+ *                     the old snapshot once no reader is still inside an
+ *                     earlier epoch. Readers scale with cores.
+ *
+ *   CIRF_MAX_MOUNTS   Two static buffers of CIRF_MAX_MOUNTS entries, for
+ *                     systems without malloc. Readers pin the active buffer
+ *                     with a counter; a writer fills the other buffer once
+ *                     its readers have drained and then switches over. No
+ *                     heap, no thread-local storage and no pthreads.
+ *
+ * Writers are serialized. Define CIRF_NO_THREADS for single-threaded
+ * programs; no atomics are used then.
+ * ======================================================================== */
+
+#ifndef CIRF_NO_MOUNT
+
+#if defined(CIRF_MAX_MOUNTS) && CIRF_MAX_MOUNTS > 0
+#define CIRF_STATIC_MOUNTS 1
+#endif
+
+#if !defined(CIRF_NO_THREADS) && !defined(__GNUC__) && !defined(__clang__)
+#error "cirf mount table needs GCC/Clang atomics; define CIRF_NO_THREADS"
+#endif
+
+/* Index of prefix in a mount array, or count if it is not mounted */
+static size_t mount_index(const cirf_mount_t *mounts, size_t count, const char *prefix,
+                          size_t len) {
+    for(size_t i = 0; i < count; i++) {
+        if(mounts[i].prefix_len == len && memcmp(mounts[i].prefix, prefix, len) == 0) {
+            return i;
+        }
+    }
+    return count;
+}
+
+/*
+ * Copy src to dst with entry `skip` left out and `add` (if not NULL)
+ * inserted in order. Returns the number of entries written.
+ */
+static size_t mount_copy(cirf_mount_t *dst, const cirf_mount_t *src, size_t count, size_t skip,
+                         const cirf_mount_t *add) {
+    size_t n = 0;
+    for(size_t i = 0; i < count; i++) {
+        if(i == skip) continue;
+        if(add && src[i].prefix_len < add->prefix_len) {
+            dst[n++] = *add;
+            add = NULL;
+        }
+        dst[n++] = src[i];
+    }
+    if(add) dst[n++] = *add;
+    return n;
+}
+
+static const cirf_file_t *mount_resolve(const cirf_mount_t *mounts, size_t count,
+                                        const char *path, size_t len) {
+    for(size_t i = 0; i < count; i++) {
+        const cirf_mount_t *m = &mounts[i];
+        if(m->prefix_len <= len && memcmp(path, m->prefix, m->prefix_len) == 0) {
+            return cirf_find_file_n(m->root, path + m->prefix_len, len - m->prefix_len);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Folders also match the prefix without its trailing '/' ("/assets" for
+ * "/assets/"), and a trailing '/' on the path is ignored.
+ */
+static const cirf_folder_t *mount_resolve_folder(const cirf_mount_t *mounts, size_t count,
+                                                 const char *path, size_t len) {
+    while(len > 1 && path[len - 1] == '/')
+        len--;
+    for(size_t i = 0; i < count; i++) {
+        const cirf_mount_t *m = &mounts[i];
+        size_t              plen = m->prefix_len;
+        if(plen && m->prefix[plen - 1] == '/' && len == plen - 1 &&
+           memcmp(path, m->prefix, len) == 0) {
+            return m->root;
+        }
+        if(plen <= len && memcmp(path, m->prefix, plen) == 0) {
+            return cirf_find_folder_n(m->root, path + plen, len - plen);
+        }
+    }
+    return NULL;
+}
+
+/* ------------------------------------------------------------------------
+ * Caller-provided tables
+ * ------------------------------------------------------------------------ */
+
+void cirf_mount_table_init(cirf_mount_table_t *table, cirf_mount_t *storage, size_t capacity) {
+    if(!table) return;
+    table->mounts = storage;
+    table->count = 0;
+    table->capacity = storage ? capacity : 0;
+}
+
+int cirf_mount_table_add(cirf_mount_table_t *table, const char *prefix,
+                         const cirf_folder_t *root) {
+    if(!table || !prefix || !root) return -1;
+
+    size_t len = strlen(prefix);
+    size_t i = mount_index(table->mounts, table->count, prefix, len);
+    if(i < table->count) {
+        table->mounts[i].root = root;
+        return 0;
+    }
+    if(table->count == table->capacity) return -1;
+
+    /* Shift shorter prefixes up to keep the order */
+    i = table->count;
+    while(i > 0 && table->mounts[i - 1].prefix_len < len) {
+        table->mounts[i] = table->mounts[i - 1];
+        i--;
+    }
+    table->mounts[i].prefix = prefix;
+    table->mounts[i].prefix_len = len;
+    table->mounts[i].root = root;
+    table->count++;
+    return 0;
+}
+
+int cirf_mount_table_remove(cirf_mount_table_t *table, const char *prefix) {
+    if(!table || !prefix) return -1;
+
+    size_t i = mount_index(table->mounts, table->count, prefix, strlen(prefix));
+    if(i == table->count) return -1;
+    for(; i + 1 < table->count; i++) {
+        table->mounts[i] = table->mounts[i + 1];
+    }
+    table->count--;
+    return 0;
+}
+
+const cirf_file_t *cirf_mount_table_resolve(const cirf_mount_table_t *table, const char *path) {
+    if(!table || !path) return NULL;
+    return mount_resolve(table->mounts, table->count, path, strlen(path));
+}
+
+/* ------------------------------------------------------------------------
+ * Global table
+ *
+ * Each flavor provides:
+ *   view_enter()/view_leave()   pin the current table for a reader
+ *   writer_lock()/writer_unlock()
+ *   writer_view()               current table, under the writer lock
+ *   table_begin()/table_commit() storage for the next table, then publish
+ * ------------------------------------------------------------------------ */
+
+typedef struct mount_view {
+        const cirf_mount_t *mounts;
+        size_t              count;
+} mount_view_t;
+
+#ifdef CIRF_STATIC_MOUNTS
+
+static cirf_mount_t mount_slots[2][CIRF_MAX_MOUNTS];
+static size_t       mount_counts[2];
+static unsigned     mount_active = 0;
+
+#ifndef CIRF_NO_THREADS
+
+#include <sched.h>
+
+static unsigned long mount_users[2]; /* Readers pinning each buffer */
+static int           mount_writer = 0;
+
+static int view_enter(mount_view_t *view) {
+    unsigned i;
+    for(;;) {
+        i = __atomic_load_n(&mount_active, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&mount_users[i], 1, __ATOMIC_SEQ_CST);
+        if(__atomic_load_n(&mount_active, __ATOMIC_SEQ_CST) == i) break;
+        __atomic_sub_fetch(&mount_users[i], 1, __ATOMIC_SEQ_CST);
+    }
+    view->mounts = mount_slots[i];
+    view->count = mount_counts[i];
+    return (int)i;
+}
+
+static void view_leave(int token) {
+    __atomic_sub_fetch(&mount_users[token], 1, __ATOMIC_RELEASE);
+}
+
+static void writer_lock(void) {
+    while(__atomic_exchange_n(&mount_writer, 1, __ATOMIC_ACQUIRE))
+        sched_yield();
+}
+
+static void writer_unlock(void) {
+    __atomic_store_n(&mount_writer, 0, __ATOMIC_RELEASE);
+}
+
+#else /* CIRF_NO_THREADS */
+
+static int view_enter(mount_view_t *view) {
+    view->mounts = mount_slots[mount_active];
+    view->count = mount_counts[mount_active];
+    return 0;
+}
+
+static void view_leave(int token) {
+    (void)token;
+}
+
+static void writer_lock(void) {
+}
+
+static void writer_unlock(void) {
+}
+
+#endif /* CIRF_NO_THREADS */
+
+static mount_view_t writer_view(void) {
+    mount_view_t view = {mount_slots[mount_active], mount_counts[mount_active]};
+    return view;
+}
+
+static cirf_mount_t *table_begin(size_t count) {
+    if(count > CIRF_MAX_MOUNTS) return NULL;
+    unsigned spare = mount_active ^ 1u;
+#ifndef CIRF_NO_THREADS
+    /* Wait for readers still on the table published before the current one */
+    while(__atomic_load_n(&mount_users[spare], __ATOMIC_SEQ_CST) != 0)
+        sched_yield();
+#endif
+    return mount_slots[spare];
+}
+
+static void table_commit(cirf_mount_t *mounts, size_t count) {
+    unsigned spare = mount_active ^ 1u;
+    (void)mounts;
+    mount_counts[spare] = count;
+#ifndef CIRF_NO_THREADS
+    __atomic_store_n(&mount_active, spare, __ATOMIC_SEQ_CST);
+#else
+    mount_active = spare;
+#endif
+}
+
+#else /* !CIRF_STATIC_MOUNTS */
+
+#include <stdlib.h> /* Heap snapshots */
+
+typedef struct mount_table {
+        size_t       count;
+        cirf_mount_t mounts[]; /* Sorted by prefix_len, descending */
+} mount_table_t;
+
+static mount_table_t *mount_table = NULL;
+static mount_table_t *mount_next = NULL; /* Built under the writer lock */
+
+#ifndef CIRF_NO_THREADS
+
+#include <pthread.h>
+#include <sched.h>
+
+/*
+ * Per-thread reader record, one cache line each so readers on different
+ * cores never write to a shared line. Records are never freed; a record
+ * released by an exiting thread is reused by the next new thread.
+ */
+typedef struct mount_reader {
+        struct mount_reader *next;   /* Registry list, push-only */
+        unsigned long        epoch;  /* Epoch entered in, 0 while outside */
+        int                  in_use; /* Owned by a live thread */
+        char pad[CIRF_CACHE_LINE - sizeof(void *) - sizeof(unsigned long) - sizeof(int)];
+} mount_reader_t;
+
+static unsigned long   mount_epoch = 1;
+static mount_reader_t *mount_readers = NULL;
+
+static pthread_mutex_t mount_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t  mount_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t   mount_key;
+static __thread mount_reader_t *mount_self = NULL;
+
+static void reader_release(void *arg) {
+    mount_reader_t *r = arg;
+    __atomic_store_n(&r->epoch, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&r->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void reader_key_create(void) {
+    pthread_key_create(&mount_key, reader_release);
+}
+
+/* Claim a free record or register a new one; lock-free */
+static mount_reader_t *reader_acquire(void) {
+    for(mount_reader_t *r = __atomic_load_n(&mount_readers, __ATOMIC_ACQUIRE); r; r = r->next) {
+        int expected = 0;
+        if(!__atomic_load_n(&r->in_use, __ATOMIC_RELAXED) &&
+           __atomic_compare_exchange_n(&r->in_use, &expected, 1, 0, __ATOMIC_ACQ_REL,
+                                       __ATOMIC_RELAXED)) {
+            return r;
+        }
+    }
+
+    void *mem;
+    if(posix_memalign(&mem, CIRF_CACHE_LINE, sizeof(mount_reader_t)) != 0) return NULL;
+    mount_reader_t *r = mem;
+    memset(r, 0, sizeof(*r));
+    r->in_use = 1;
+    r->next = __atomic_load_n(&mount_readers, __ATOMIC_RELAXED);
+    while(!__atomic_compare_exchange_n(&mount_readers, &r->next, r, 1, __ATOMIC_RELEASE,
+                                       __ATOMIC_RELAXED)) {
+    }
+    return r;
+}
+
+static int view_enter(mount_view_t *view) {
+    mount_reader_t *r = mount_self;
+    if(!r) {
+        pthread_once(&mount_key_once, reader_key_create);
+        r = reader_acquire();
+        if(!r) return -1;
+        pthread_setspecific(mount_key, r);
+        mount_self = r;
+    }
+    __atomic_store_n(&r->epoch, __atomic_load_n(&mount_epoch, __ATOMIC_SEQ_CST),
+                     __ATOMIC_SEQ_CST);
+
+    const mount_table_t *t = __atomic_load_n(&mount_table, __ATOMIC_SEQ_CST);
+    view->mounts = t ? t->mounts : NULL;
+    view->count = t ? t->count : 0;
+    return 0;
+}
+
+static void view_leave(int token) {
+    (void)token;
+    __atomic_store_n(&mount_self->epoch, 0, __ATOMIC_RELEASE);
+}
+
+static void writer_lock(void) {
+    pthread_mutex_lock(&mount_lock);
+}
+
+static void writer_unlock(void) {
+    pthread_mutex_unlock(&mount_lock);
+}
+
+/* Publish a new snapshot and free the old one once no reader can see it */
+static void table_publish(mount_table_t *table) {
+    mount_table_t *old = __atomic_exchange_n(&mount_table, table, __ATOMIC_SEQ_CST);
+    if(!old) return;
+
+    unsigned long target = __atomic_add_fetch(&mount_epoch, 1, __ATOMIC_SEQ_CST);
+    for(mount_reader_t *r = __atomic_load_n(&mount_readers, __ATOMIC_ACQUIRE); r; r = r->next) {
+        for(;;) {
+            unsigned long e = __atomic_load_n(&r->epoch, __ATOMIC_SEQ_CST);
+            if(e == 0 || e >= target) break;
+            sched_yield();
+        }
+    }
+    free(old);
+}
+
+#else /* CIRF_NO_THREADS */
+
+static int view_enter(mount_view_t *view) {
+    view->mounts = mount_table ? mount_table->mounts : NULL;
+    view->count = mount_table ? mount_table->count : 0;
+    return 0;
+}
+
+static void view_leave(int token) {
+    (void)token;
+}
+
+static void writer_lock(void) {
+}
+
+static void writer_unlock(void) {
+}
+
+static void table_publish(mount_table_t *table) {
+    mount_table_t *old = mount_table;
+    mount_table = table;
+    free(old);
+}
+
+#endif /* CIRF_NO_THREADS */
+
+static mount_view_t writer_view(void) {
+    mount_view_t view = {NULL, 0};
+    if(mount_table) {
+        view.mounts = mount_table->mounts;
+        view.count = mount_table->count;
+    }
+    return view;
+}
+
+static cirf_mount_t *table_begin(size_t count) {
+    mount_next = malloc(sizeof(mount_table_t) + count * sizeof(cirf_mount_t));
+    return mount_next ? mount_next->mounts : NULL;
+}
+
+static void table_commit(cirf_mount_t *mounts, size_t count) {
+    (void)mounts;
+    mount_next->count = count;
+    table_publish(count ? mount_next : NULL);
+    if(!count) free(mount_next);
+    mount_next = NULL;
+}
+
+#endif /* CIRF_STATIC_MOUNTS */
+
+int cirf_mount(const char *prefix, const cirf_folder_t *root) {
+    if(!prefix || !root) return -1;
+
+    cirf_mount_t mount = {prefix, strlen(prefix), root};
+
+    writer_lock();
+    mount_view_t cur = writer_view();
+
+    /* Mounting an existing prefix again replaces its root */
+    size_t        skip = mount_index(cur.mounts, cur.count, prefix, mount.prefix_len);
+    size_t        count = skip < cur.count ? cur.count : cur.count + 1;
+    cirf_mount_t *next = table_begin(count);
+    if(!next) {
+        writer_unlock();
+        return -1;
+    }
+    table_commit(next, mount_copy(next, cur.mounts, cur.count, skip, &mount));
+    writer_unlock();
+    return 0;
+}
+
+int cirf_unmount(const char *prefix) {
+    if(!prefix) return -1;
+
+    writer_lock();
+    mount_view_t cur = writer_view();
+
+    size_t skip = mount_index(cur.mounts, cur.count, prefix, strlen(prefix));
+    if(skip == cur.count) {
+        writer_unlock();
+        return -1;
+    }
+    cirf_mount_t *next = table_begin(cur.count - 1);
+    if(!next) {
+        writer_unlock();
+        return -1;
+    }
+    table_commit(next, mount_copy(next, cur.mounts, cur.count, skip, NULL));
+    writer_unlock();
+    return 0;
+}
+
+const cirf_file_t *cirf_resolve_file(const char *path) {
+    if(!path) return NULL;
+
+    mount_view_t view;
+    int          token = view_enter(&view);
+    if(token < 0) return NULL;
+
+    const cirf_file_t *file = mount_resolve(view.mounts, view.count, path, strlen(path));
+    view_leave(token);
+    return file;
+}
+
+const cirf_folder_t *cirf_resolve_folder(const char *path) {
+    if(!path) return NULL;
+
+    mount_view_t view;
+    int          token = view_enter(&view);
+    if(token < 0) return NULL;
+
+    const cirf_folder_t *folder =
+        mount_resolve_folder(view.mounts, view.count, path, strlen(path));
+    view_leave(token);
+    return folder;
+}
+
 #ifndef CIRF_NO_STDIO
 FILE *cirf_resolve_fopen(const char *path) {
     const cirf_file_t *file = cirf_resolve_file(path);
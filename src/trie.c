@@ -0,0 +1,103 @@
+#include "cirf/trie.h"
+#include <stdlib.h>
+#include <string.h>
+
+static size_t trie_add_node(trie_t *t) {
+    if(t->node_count == t->node_cap) {
+        size_t       cap = t->node_cap ? t->node_cap * 2 : 64;
+        trie_node_t *nodes = realloc(t->nodes, cap * sizeof(trie_node_t));
+        if(!nodes) return (size_t)-1;
+        t->nodes = nodes;
+        t->node_cap = cap;
+    }
+    memset(&t->nodes[t->node_count], 0, sizeof(trie_node_t));
+    return t->node_count++;
+}
+
+static int trie_add_label(trie_t *t, const char *label, size_t len, size_t *offset) {
+    if(t->labels_len + len > t->labels_cap) {
+        size_t cap = t->labels_cap ? t->labels_cap * 2 : 256;
+        while(cap < t->labels_len + len)
+            cap *= 2;
+        char *labels = realloc(t->labels, cap);
+        if(!labels) return -1;
+        t->labels = labels;
+        t->labels_cap = cap;
+    }
+    memcpy(t->labels + t->labels_len, label, len);
+    *offset = t->labels_len;
+    t->labels_len += len;
+    return 0;
+}
+
+/* Length of the common prefix of a and b starting at depth */
+static size_t common_prefix(const char *a, const char *b, size_t depth) {
+    size_t n = depth;
+    while(a[n] && a[n] == b[n])
+        n++;
+    return n - depth;
+}
+
+/*
+ * Build the subtree for keys [lo, hi), which all share their first `depth`
+ * bytes. The node itself has already been allocated at index `self`.
+ */
+static int trie_build_range(trie_t *t, const char *const *keys, size_t lo, size_t hi,
+                            size_t depth, size_t self) {
+    t->nodes[self].entry_first = lo;
+    t->nodes[self].entry_end = hi;
+
+    if(lo < hi && keys[lo][depth] == '\0') {
+        t->nodes[self].terminal = 1;
+        lo++;
+    }
+
+    while(lo < hi) {
+        /* Group keys sharing the next byte */
+        unsigned char c = (unsigned char)keys[lo][depth];
+        size_t        group_end = lo + 1;
+        while(group_end < hi && (unsigned char)keys[group_end][depth] == c)
+            group_end++;
+
+        /* Sorted keys: the first and last of the group bound the common prefix */
+        size_t len = common_prefix(keys[lo], keys[group_end - 1], depth);
+
+        size_t child = trie_add_node(t);
+        if(child == (size_t)-1) return -1;
+        if(trie_add_label(t, keys[lo] + depth, len, &t->nodes[child].label) != 0) return -1;
+        t->nodes[child].label_len = len;
+
+        if(trie_build_range(t, keys, lo, group_end, depth + len, child) != 0) return -1;
+        lo = group_end;
+    }
+
+    t->nodes[self].end = t->node_count;
+    return 0;
+}
+
+cirf_error_t trie_build(const char *const *keys, size_t count, trie_t **out) {
+    if(!keys || !out) return CIRF_ERR_INVALID;
+
+    for(size_t i = 1; i < count; i++) {
+        if(strcmp(keys[i - 1], keys[i]) >= 0) return CIRF_ERR_INVALID;
+    }
+
+    trie_t *t = calloc(1, sizeof(trie_t));
+    if(!t) return CIRF_ERR_NOMEM;
+
+    size_t root = trie_add_node(t);
+    if(root == (size_t)-1 || trie_build_range(t, keys, 0, count, 0, root) != 0) {
+        trie_destroy(t);
+        return CIRF_ERR_NOMEM;
+    }
+
+    *out = t;
+    return CIRF_OK;
+}
+
+void trie_destroy(trie_t *trie) {
+    if(!trie) return;
+    free(trie->nodes);
+    free(trie->labels);
+    free(trie);
+}
@@ -341,11 +341,11 @@ cirf_error_t vfs_load_all_data(vfs_folder_t *root) {
     return load_folder_data(root);
 }
 
-void vfs_add_metadata(vfs_metadata_t **list, const char *key, const char *value) {
-    if(!list || !key || !value) return;
+vfs_metadata_t *vfs_add_metadata(vfs_metadata_t **list, const char *key, const char *value) {
+    if(!list || !key || !value) return NULL;
 
     vfs_metadata_t *meta = calloc(1, sizeof(vfs_metadata_t));
-    if(!meta) return;
+    if(!meta) return NULL;
 
     meta->key = strdup_local(key);
     meta->value = strdup_local(value);
@@ -354,7 +354,7 @@ void vfs_add_metadata(vfs_metadata_t **list, const char *key, const char *value)
         free(meta->key);
         free(meta->value);
         free(meta);
-        return;
+        return NULL;
     }
 
     /* Add at end to preserve order */
@@ -367,6 +367,7 @@ void vfs_add_metadata(vfs_metadata_t **list, const char *key, const char *value)
         }
         last->next = meta;
     }
+    return meta;
 }
 
 const char *vfs_get_metadata(const vfs_metadata_t *list, const char *key) {
@@ -401,3 +402,61 @@ size_t vfs_file_count(const vfs_folder_t *folder) {
     }
     return count;
 }
+
+static int compare_folder_name(const void *a, const void *b) {
+    const vfs_folder_t *fa = *(const vfs_folder_t *const *)a;
+    const vfs_folder_t *fb = *(const vfs_folder_t *const *)b;
+    return strcmp(fa->name, fb->name);
+}
+
+static int compare_file_name(const void *a, const void *b) {
+    const vfs_file_t *fa = *(const vfs_file_t *const *)a;
+    const vfs_file_t *fb = *(const vfs_file_t *const *)b;
+    return strcmp(fa->name, fb->name);
+}
+
+cirf_error_t vfs_sort(vfs_folder_t *folder) {
+    if(!folder) return CIRF_ERR_INVALID;
+
+    size_t file_count = vfs_file_count(folder);
+    if(file_count > 1) {
+        vfs_file_t **files = malloc(file_count * sizeof(*files));
+        if(!files) return CIRF_ERR_NOMEM;
+
+        size_t i = 0;
+        for(vfs_file_t *f = folder->files; f; f = f->next) {
+            files[i++] = f;
+        }
+        qsort(files, file_count, sizeof(*files), compare_file_name);
+        for(i = 0; i + 1 < file_count; i++) {
+            files[i]->next = files[i + 1];
+        }
+        files[file_count - 1]->next = NULL;
+        folder->files = files[0];
+        free(files);
+    }
+
+    size_t child_count = vfs_folder_count(folder);
+    if(child_count > 1) {
+        vfs_folder_t **children = malloc(child_count * sizeof(*children));
+        if(!children) return CIRF_ERR_NOMEM;
+
+        size_t i = 0;
+        for(vfs_folder_t *c = folder->children; c; c = c->next) {
+            children[i++] = c;
+        }
+        qsort(children, child_count, sizeof(*children), compare_folder_name);
+        for(i = 0; i + 1 < child_count; i++) {
+            children[i]->next = children[i + 1];
+        }
+        children[child_count - 1]->next = NULL;
+        folder->children = children[0];
+        free(children);
+    }
+
+    for(vfs_folder_t *c = folder->children; c; c = c->next) {
+        cirf_error_t err = vfs_sort(c);
+        if(err != CIRF_OK) return err;
+    }
+    return CIRF_OK;
+}
@@ -1,35 +1,118 @@
 #include "cirf/writer.h"
+#include <errno.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+/*
+ * Output is formatted into one large buffer and handed to write() a
+ * megabyte at a time; stdio is only used for the descriptor. Resource
+ * data dominates the output, so writer_write_bytes_hex() fills whole lines
+ * from a table instead of formatting byte by byte.
+ */
+#define WRITER_BUFFER_SIZE (1u << 20)
 
 struct writer {
         FILE       *fp;
+        int         fd;
+        int         failed;      /* A write() failed; output is incomplete */
+        char       *buf;
+        size_t      used;
         int         indent_level;
         int         at_line_start;
         const char *indent_string;
+        size_t      indent_len;
 };
 
+/* "0xNN, " for every byte value, padded to 8 bytes for whole-word copies */
+static char hex_items[256][8];
+
+static void init_hex_items(void) {
+    static const char digits[] = "0123456789abcdef";
+    if(hex_items[255][0]) return;
+    for(int i = 0; i < 256; i++) {
+        memcpy(hex_items[i], "0x00, \0", 8);
+        hex_items[i][2] = digits[i >> 4];
+        hex_items[i][3] = digits[i & 15];
+    }
+}
+
 writer_t *writer_create(FILE *fp) {
     writer_t *w = calloc(1, sizeof(writer_t));
     if(!w) return NULL;
 
+    w->buf = malloc(WRITER_BUFFER_SIZE);
+    if(!w->buf) {
+        free(w);
+        return NULL;
+    }
+
+    /* Anything the caller put through fp goes first */
+    fflush(fp);
     w->fp = fp;
+    w->fd = fileno(fp);
     w->indent_level = 0;
     w->at_line_start = 1;
     w->indent_string = "    ";
+    w->indent_len = strlen(w->indent_string);
 
+    init_hex_items();
     return w;
 }
 
+static void write_all(writer_t *w, const char *data, size_t len) {
+    while(len > 0 && !w->failed) {
+        ssize_t n = write(w->fd, data, len);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            w->failed = 1;
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+int writer_flush(writer_t *w) {
+    write_all(w, w->buf, w->used);
+    w->used = 0;
+    return w->failed ? -1 : 0;
+}
+
 void writer_destroy(writer_t *w) {
+    if(!w) return;
+    writer_flush(w);
+    free(w->buf);
     free(w);
 }
 
+/* Room for n more bytes at w->buf + w->used; n must not exceed the buffer */
+static char *reserve(writer_t *w, size_t n) {
+    if(WRITER_BUFFER_SIZE - w->used < n) writer_flush(w);
+    return w->buf + w->used;
+}
+
+static void emit(writer_t *w, const char *s, size_t n) {
+    if(n > WRITER_BUFFER_SIZE / 2) {
+        writer_flush(w);
+        write_all(w, s, n);
+        return;
+    }
+    memcpy(reserve(w, n), s, n);
+    w->used += n;
+}
+
+static void emit_char(writer_t *w, char c) {
+    if(w->used == WRITER_BUFFER_SIZE) writer_flush(w);
+    w->buf[w->used++] = c;
+}
+
 static void write_indent(writer_t *w) {
     if(w->at_line_start) {
         for(int i = 0; i < w->indent_level; i++) {
-            fputs(w->indent_string, w->fp);
+            emit(w, w->indent_string, w->indent_len);
         }
         w->at_line_start = 0;
     }
@@ -40,9 +123,31 @@ void writer_printf(writer_t *w, const char *fmt, ...) {
 
     va_list args;
     va_start(args, fmt);
-    vfprintf(w->fp, fmt, args);
+    size_t  room = WRITER_BUFFER_SIZE - w->used;
+    int     n = vsnprintf(w->buf + w->used, room, fmt, args);
     va_end(args);
 
+    if(n >= 0 && (size_t)n >= room) {
+        /* Did not fit: flush and format again, on the heap if need be */
+        writer_flush(w);
+        char *out = (size_t)n < WRITER_BUFFER_SIZE ? w->buf : malloc((size_t)n + 1);
+        if(!out) {
+            w->failed = 1;
+            return;
+        }
+        va_start(args, fmt);
+        vsnprintf(out, (size_t)n + 1, fmt, args);
+        va_end(args);
+        if(out == w->buf) {
+            w->used = (size_t)n;
+        } else {
+            write_all(w, out, (size_t)n);
+            free(out);
+        }
+    } else if(n > 0) {
+        w->used += (size_t)n;
+    }
+
     /* Check if we ended with newline */
     size_t len = strlen(fmt);
     if(len > 0 && fmt[len - 1] == '\n') {
@@ -52,9 +157,9 @@ void writer_printf(writer_t *w, const char *fmt, ...) {
 
 void writer_puts(writer_t *w, const char *s) {
     write_indent(w);
-    fputs(s, w->fp);
 
     size_t len = strlen(s);
+    emit(w, s, len);
     if(len > 0 && s[len - 1] == '\n') {
         w->at_line_start = 1;
     }
@@ -62,7 +167,7 @@ void writer_puts(writer_t *w, const char *s) {
 
 void writer_putc(writer_t *w, char c) {
     write_indent(w);
-    fputc(c, w->fp);
+    emit_char(w, c);
 
     if(c == '\n') {
         w->at_line_start = 1;
@@ -70,7 +175,7 @@ void writer_putc(writer_t *w, char c) {
 }
 
 void writer_newline(writer_t *w) {
-    fputc('\n', w->fp);
+    emit_char(w, '\n');
     w->at_line_start = 1;
 }
 
@@ -84,56 +189,212 @@ void writer_dedent(writer_t *w) {
     }
 }
 
+/*
+ * Lines of "0xNN, " items, each line ending ",\n" plus the indent of the
+ * next one, and no separator after the last byte. One line is formatted
+ * at a time straight into the buffer.
+ */
 void writer_write_bytes_hex(writer_t *w, const unsigned char *data, size_t len,
                             int bytes_per_line) {
-    for(size_t i = 0; i < len; i++) {
-        if(i > 0) {
-            fputc(',', w->fp);
-            if((i % bytes_per_line) == 0) {
-                fputc('\n', w->fp);
-                w->at_line_start = 1;
-                write_indent(w);
-            } else {
-                fputc(' ', w->fp);
+    if(len == 0) return;
+    write_indent(w);
+
+    size_t per_line = bytes_per_line > 0 ? (size_t)bytes_per_line : 1;
+    size_t indent = (size_t)w->indent_level * w->indent_len;
+    /* Items, the 2-byte slack of the last 8-byte copy, newline and indent */
+    size_t line_max = per_line * 6 + 2 + 1 + indent;
+    if(line_max > WRITER_BUFFER_SIZE) {
+        per_line = (WRITER_BUFFER_SIZE - 3 - indent) / 6;
+        line_max = per_line * 6 + 3 + indent;
+    }
+
+    while(len > 0) {
+        size_t n = len < per_line ? len : per_line;
+        char  *p = reserve(w, line_max);
+        for(size_t i = 0; i < n; i++) {
+            memcpy(p, hex_items[data[i]], 8);
+            p += 6;
+        }
+        data += n;
+        len -= n;
+        if(len == 0) {
+            p -= 2; /* No ", " after the last byte */
+        } else {
+            p[-1] = '\n';
+            for(int i = 0; i < w->indent_level; i++) {
+                memcpy(p, w->indent_string, w->indent_len);
+                p += w->indent_len;
             }
+        }
+        w->used = (size_t)(p - w->buf);
+    }
+}
+
+/*
+ * Lines of string-literal pieces, bytes_per_line bytes each, for adjacent
+ * literals to concatenate. Control and non-ASCII bytes use the shortest
+ * octal escape that the next character cannot extend, and '?' is escaped
+ * to rule out trigraphs.
+ */
+void writer_write_bytes_string(writer_t *w, const unsigned char *data, size_t len,
+                               int bytes_per_line) {
+    if(len == 0) return;
+    write_indent(w);
+
+    size_t per_line = bytes_per_line > 0 ? (size_t)bytes_per_line : 1;
+    size_t indent = (size_t)w->indent_level * w->indent_len;
+    if(per_line > (WRITER_BUFFER_SIZE - 4 - indent) / 4) {
+        per_line = (WRITER_BUFFER_SIZE - 4 - indent) / 4;
+    }
+    /* Quotes, escapes of up to four characters, newline and indent */
+    size_t line_max = per_line * 4 + 3 + indent;
+
+    while(len > 0) {
+        size_t n = len < per_line ? len : per_line;
+        char  *p = reserve(w, line_max);
+        *p++ = '"';
+        for(size_t i = 0; i < n; i++) {
+            unsigned char c = data[i];
+            if(c >= 0x20 && c < 0x7f) {
+                if(c == '\\' || c == '"' || c == '?') *p++ = '\\';
+                *p++ = (char)c;
+                continue;
+            }
+            int full = i + 1 < n && data[i + 1] >= '0' && data[i + 1] <= '7';
+            *p++ = '\\';
+            if(full || c >= 0100) *p++ = (char)('0' + (c >> 6));
+            if(full || c >= 010) *p++ = (char)('0' + ((c >> 3) & 7));
+            *p++ = (char)('0' + (c & 7));
+        }
+        *p++ = '"';
+        data += n;
+        len -= n;
+        if(len > 0) {
+            *p++ = '\n';
+            for(int i = 0; i < w->indent_level; i++) {
+                memcpy(p, w->indent_string, w->indent_len);
+                p += w->indent_len;
+            }
+        }
+        w->used = (size_t)(p - w->buf);
+    }
+}
+
+/*
+ * Lines of 64-bit words, words_per_line each, holding the bytes in
+ * little-endian order. The last word is padded with zeros.
+ */
+void writer_write_bytes_words(writer_t *w, const unsigned char *data, size_t len,
+                              int words_per_line) {
+    if(len == 0) return;
+    write_indent(w);
+
+    size_t per_line = words_per_line > 0 ? (size_t)words_per_line : 1;
+    size_t indent = (size_t)w->indent_level * w->indent_len;
+    if(per_line > (WRITER_BUFFER_SIZE - 2 - indent) / 20) {
+        per_line = (WRITER_BUFFER_SIZE - 2 - indent) / 20;
+    }
+    size_t        line_max = per_line * 20 + 1 + indent;
+    size_t        words = (len + 7) / 8;
+    unsigned char last[8] = {0};
+    memcpy(last, data + (words - 1) * 8, len - (words - 1) * 8);
+
+    while(words > 0) {
+        size_t n = words < per_line ? words : per_line;
+        char  *p = reserve(w, line_max);
+        for(size_t i = 0; i < n; i++) {
+            const unsigned char *word = words - i == 1 ? last : data + i * 8;
+            *p++ = '0';
+            *p++ = 'x';
+            for(int b = 7; b >= 0; b--) {
+                memcpy(p, hex_items[word[b]] + 2, 2);
+                p += 2;
+            }
+            *p++ = ',';
+            *p++ = ' ';
+        }
+        data += n * 8;
+        words -= n;
+        if(words == 0) {
+            p -= 2;
         } else {
-            write_indent(w);
+            p[-1] = '\n';
+            for(int i = 0; i < w->indent_level; i++) {
+                memcpy(p, w->indent_string, w->indent_len);
+                p += w->indent_len;
+            }
         }
-        fprintf(w->fp, "0x%02x", data[i]);
+        w->used = (size_t)(p - w->buf);
     }
 }
 
 void writer_write_string_escaped(writer_t *w, const char *s) {
     write_indent(w);
-    fputc('"', w->fp);
+    emit_char(w, '"');
 
     while(*s) {
         switch(*s) {
             case '\n':
-                fputs("\\n", w->fp);
+                emit(w, "\\n", 2);
                 break;
             case '\r':
-                fputs("\\r", w->fp);
+                emit(w, "\\r", 2);
                 break;
             case '\t':
-                fputs("\\t", w->fp);
+                emit(w, "\\t", 2);
                 break;
             case '\\':
-                fputs("\\\\", w->fp);
+                emit(w, "\\\\", 2);
                 break;
             case '"':
-                fputs("\\\"", w->fp);
+                emit(w, "\\\"", 2);
                 break;
             default:
                 if((unsigned char)*s < 0x20) {
-                    fprintf(w->fp, "\\x%02x", (unsigned char)*s);
+                    char *p = reserve(w, 4);
+                    p[0] = '\\';
+                    p[1] = 'x';
+                    p[2] = hex_items[(unsigned char)*s][2];
+                    p[3] = hex_items[(unsigned char)*s][3];
+                    w->used += 4;
                 } else {
-                    fputc(*s, w->fp);
+                    emit_char(w, *s);
                 }
                 break;
         }
         s++;
     }
 
-    fputc('"', w->fp);
+    emit_char(w, '"');
+}
+
+/*
+ * Write arbitrary bytes as a single C string literal. Non-printable bytes use
+ * three-digit octal escapes, which cannot run into a following digit the way
+ * hex escapes do, and '?' is escaped to rule out trigraphs.
+ */
+void writer_write_string_bytes(writer_t *w, const unsigned char *data, size_t len) {
+    write_indent(w);
+    emit_char(w, '"');
+
+    for(size_t i = 0; i < len; i++) {
+        unsigned char c = data[i];
+        char         *p = reserve(w, 4);
+        if(c == '\\' || c == '"' || c == '?') {
+            p[0] = '\\';
+            p[1] = (char)c;
+            w->used += 2;
+        } else if(c < 0x20 || c >= 0x7f) {
+            p[0] = '\\';
+            p[1] = (char)('0' + (c >> 6));
+            p[2] = (char)('0' + ((c >> 3) & 7));
+            p[3] = (char)('0' + (c & 7));
+            w->used += 4;
+        } else {
+            p[0] = (char)c;
+            w->used += 1;
+        }
+    }
+
+    emit_char(w, '"');
 }